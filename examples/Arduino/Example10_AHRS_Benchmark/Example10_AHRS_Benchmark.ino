@@ -0,0 +1,187 @@
+/****************************************************************
+ * Example10_AHRS_Benchmark.ino
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Measures the cost of the float and fixed-point orientation filter per
+ * update and the share of the CPU for gyroscope, accelerometer and
+ * magnetometer at 100Hz, then fuses the sensor with an IMU. Replace
+ * read_imu with the driver of your IMU, axes rotated onto those of the
+ * HSCDTD008A.
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include <Arduino.h>
+#include "hscdtd008a.h"
+#include "driver/hscdtd008a_ahrs.h"
+
+// Number of updates per benchmark.
+const int iterations = 200;
+
+// Rate of the fusion in the loop.
+const unsigned long period_us = 10000;
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+
+hscdtd_ahrs_config_t config = HSCDTD_AHRS_CONFIG_DEFAULT;
+hscdtd_ahrs_t ahrs;
+hscdtd_ahrs_fx_t ahrs_fx;
+
+unsigned long next_us;
+
+
+// Placeholder IMU at rest and level, in mg and mdps.
+void read_imu(hscdtd_vec3_i32_t *p_accel, hscdtd_vec3_i32_t *p_gyro) {
+  p_accel->x = 0;
+  p_accel->y = 0;
+  p_accel->z = 1000;
+  p_gyro->x = 0;
+  p_gyro->y = 0;
+  p_gyro->z = 0;
+}
+
+void print_cost(const char *name, unsigned long elapsed) {
+  float cycles = (float)elapsed / iterations * (F_CPU / 1000000UL);
+
+  Serial.print(name);
+  Serial.print(":\t");
+  Serial.print(cycles);
+  Serial.print(" cycles,\t");
+  // Share of the CPU at 100 updates per second.
+  Serial.print(cycles * 100 / F_CPU * 100, 3);
+  Serial.println(" % at 100Hz");
+}
+
+void benchmark_float() {
+  hscdtd_vec3_t gyro, accel, mag;
+  unsigned long start, t_gyro, t_accel, t_mag;
+  uint32_t t = 0;
+  int i;
+
+  hscdtd_ahrs_init(&ahrs, &config);
+  t_gyro = t_accel = t_mag = 0;
+  for (i = 0; i < iterations; i++) {
+    t += period_us;
+    // A slow tumble, so no update takes a shortcut.
+    gyro.x = 0.1;
+    gyro.y = -0.2;
+    gyro.z = 0.05 * (i % 7);
+    accel.x = 0.5 + 0.01 * i;
+    accel.y = -0.3;
+    accel.z = 9.7;
+    mag.x = 200 - i;
+    mag.y = 50;
+    mag.z = -300;
+
+    start = micros();
+    hscdtd_ahrs_gyro(&ahrs, &gyro, t);
+    t_gyro += micros() - start;
+    start = micros();
+    hscdtd_ahrs_accel(&ahrs, &accel, t);
+    t_accel += micros() - start;
+    start = micros();
+    hscdtd_ahrs_mag(&ahrs, &mag, t);
+    t_mag += micros() - start;
+  }
+  print_cost("float gyro", t_gyro);
+  print_cost("float accel", t_accel);
+  print_cost("float mag", t_mag);
+  print_cost("float all", t_gyro + t_accel + t_mag);
+}
+
+void benchmark_fixed() {
+  hscdtd_vec3_i32_t gyro, accel, mag;
+  unsigned long start, t_gyro, t_accel, t_mag;
+  uint32_t t = 0;
+  int i;
+
+  hscdtd_ahrs_fx_init(&ahrs_fx, &config);
+  t_gyro = t_accel = t_mag = 0;
+  for (i = 0; i < iterations; i++) {
+    t += period_us;
+    gyro.x = 5730;
+    gyro.y = -11459;
+    gyro.z = 2865 * (i % 7);
+    accel.x = 51 + i;
+    accel.y = -31;
+    accel.z = 989;
+    mag.x = 200 - i;
+    mag.y = 50;
+    mag.z = -300;
+
+    start = micros();
+    hscdtd_ahrs_fx_gyro(&ahrs_fx, &gyro, t);
+    t_gyro += micros() - start;
+    start = micros();
+    hscdtd_ahrs_fx_accel(&ahrs_fx, &accel, t);
+    t_accel += micros() - start;
+    start = micros();
+    hscdtd_ahrs_fx_mag(&ahrs_fx, &mag, t);
+    t_mag += micros() - start;
+  }
+  print_cost("fixed gyro", t_gyro);
+  print_cost("fixed accel", t_accel);
+  print_cost("fixed mag", t_mag);
+  print_cost("fixed all", t_gyro + t_accel + t_mag);
+}
+
+void setup() {
+  hscdtd_status_t status;
+
+  Serial.begin(9600);
+
+  Serial.println("Cost per orientation filter update:");
+  benchmark_float();
+  benchmark_fixed();
+
+  geomag.begin();
+  // If you know the I2C address is different than in the provided
+  // data sheet. Uncomment the line below, and configure the address.
+  // geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    Serial.println("Failed to initialize sensor. Check wiring.");
+
+    // Halt program here.
+    while (true) { delay(1); }
+  }
+  hscdtd_ahrs_fx_init(&ahrs_fx, &config);
+  next_us = micros();
+}
+
+void loop() {
+  hscdtd_vec3_i32_t accel, gyro, euler;
+  hscdtd_status_t status;
+  uint32_t now;
+
+  if ((long)(micros() - next_us) < 0)
+    return;
+  next_us += period_us;
+
+  // IMU first, the magnetometer sample is timestamped at its conversion.
+  read_imu(&accel, &gyro);
+  now = micros();
+  hscdtd_ahrs_fx_gyro(&ahrs_fx, &gyro, now);
+  hscdtd_ahrs_fx_accel(&ahrs_fx, &accel, now);
+
+  status = geomag.startMeasurement();
+  if (status == HSCDTD_STAT_OK) {
+    hscdtd_ahrs_fx_mag_sample(&ahrs_fx, &geomag.sample);
+  } else {
+    Serial.println("Error occurred, unable to read sensor data.");
+  }
+
+  hscdtd_ahrs_fx_euler(&ahrs_fx, &euler);
+  Serial.print("Roll: ");
+  Serial.print(euler.x / 1000.0);
+  Serial.print(" deg,\tPitch: ");
+  Serial.print(euler.y / 1000.0);
+  Serial.print(" deg,\tYaw: ");
+  Serial.print(euler.z / 1000.0);
+  Serial.println(" deg");
+}
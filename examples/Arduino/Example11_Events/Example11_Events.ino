@@ -0,0 +1,96 @@
+/****************************************************************
+ * Example11_Events.ino
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Detects magnetic disturbances, such as a magnet or a steel object moved
+ * past the sensor, and prints an event record when one ends. Measures the
+ * cost of the detector per sample first.
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include <Arduino.h>
+#include "hscdtd008a.h"
+
+// Number of samples for the benchmark.
+const int iterations = 1000;
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+HSCDTD008AEvents events;
+
+
+void benchmark() {
+  hscdtd_sample_t sample = {};
+  unsigned long start, elapsed;
+  int i;
+
+  events.begin();
+  start = micros();
+  for (i = 0; i < iterations; i++) {
+    // Noise around a constant field, with a disturbance now and then.
+    sample.timestamp_us += 50000;
+    sample.raw.mag_x = 200 + (i % 5);
+    sample.raw.mag_y = -100 + ((i % 300 < 20) ? 60 : 0);
+    sample.raw.mag_z = -300 - (i % 3);
+    events.update(&sample);
+  }
+  elapsed = micros() - start;
+
+  Serial.print("Event detector: ");
+  Serial.print((float)elapsed / iterations * (F_CPU / 1000000UL));
+  Serial.println(" cycles/sample");
+}
+
+void setup() {
+  hscdtd_status_t status;
+
+  Serial.begin(9600);
+
+  benchmark();
+
+  geomag.begin();
+  // If you know the I2C address is different than in the provided
+  // data sheet. Uncomment the line below, and configure the address.
+  // geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    Serial.println("Failed to initialize sensor. Check wiring.");
+
+    // Halt program here.
+    while (true) { delay(1); }
+  }
+
+  // Default thresholds, baseline over 256 samples.
+  events.begin();
+}
+
+void loop() {
+  const hscdtd_event_t *p_event;
+  hscdtd_status_t status;
+
+  // Explicitly start a reading.
+  status = geomag.startMeasurement();
+  if (status != HSCDTD_STAT_OK) {
+    Serial.println("Error occurred, unable to read sensor data.");
+  } else if (events.update(&geomag) == HSCDTD_EVENT_END) {
+    p_event = events.getEvent();
+    Serial.print("Event: ");
+    Serial.print((p_event->end_us - p_event->start_us) / 1000);
+    Serial.print(" ms,\tpeak ");
+    Serial.print(p_event->peak_mag * 0.15);
+    Serial.print(" uT,\tX: ");
+    Serial.print(p_event->peak[0] * 0.15);
+    Serial.print(" Y: ");
+    Serial.print(p_event->peak[1] * 0.15);
+    Serial.print(" Z: ");
+    Serial.print(p_event->peak[2] * 0.15);
+    Serial.println(" uT");
+  }
+  // Sample at about 20Hz.
+  delay(50);
+}
@@ -0,0 +1,53 @@
+/****************************************************************
+ * Example12_Minimal_Node.ino
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * A node that only takes force state measurements in LSB. It uses
+ * nothing that HSCDTD_MINIMAL removes, define it in
+ * src/driver/hscdtd008a_config.h, or build with
+ *   arduino-cli compile --fqbn arduino:avr:uno \
+ *     --build-property "compiler.c.extra_flags=-DHSCDTD_MINIMAL" \
+ *     --build-property "compiler.cpp.extra_flags=-DHSCDTD_MINIMAL"
+ * and compare the sketch size with the default build. extras/size_report.sh
+ * does this for every example.
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include <Arduino.h>
+#include "hscdtd008a.h"
+
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+
+
+void setup() {
+  Serial.begin(9600);
+
+  geomag.begin();
+
+  // Without HSCDTD_NO_SELF_TEST this also runs the self test.
+  if (geomag.initialize() != HSCDTD_STAT_OK) {
+    Serial.println("Failed to initialize sensor. Check wiring.");
+
+    // Halt program here.
+    while (true) { delay(1); }
+  }
+}
+
+void loop() {
+  // Trigger a conversion and read it, in LSB (0.15uT).
+  if (geomag.startMeasurement() == HSCDTD_STAT_OK) {
+    Serial.print(geomag.sample.raw.mag_x);
+    Serial.print(',');
+    Serial.print(geomag.sample.raw.mag_y);
+    Serial.print(',');
+    Serial.println(geomag.sample.raw.mag_z);
+  } else {
+    Serial.println("Error occurred, unable to read sensor data.");
+  }
+  delay(1000);
+}
@@ -0,0 +1,98 @@
+/****************************************************************
+ * Example5_Calibration.ino
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include <Arduino.h>
+#include "hscdtd008a.h"
+
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+
+// Streaming calibrator, memory use does not grow with the number of samples.
+hscdtd_calib_t calibrator;
+hscdtd_calib_result_t calibration;
+bool calibrated = false;
+
+
+void setup() {
+  hscdtd_status_t status;
+
+  Serial.begin(9600);
+
+  geomag.begin();
+  // If you know the I2C address is different than in the provided
+  // data sheet. Uncomment the line below, and configure the address.
+  // geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    Serial.println("Failed to initialize sensor. Check wiring.");
+
+    // Halt program here.
+    while (true) { delay(1); }
+  }
+
+  // Calibrate standard offset, and make sure no fixed offset is applied
+  // while samples are collected for the calibration.
+  geomag.offsetCalibration();
+  geomag.applyOffsetDrift(0, 0, 0);
+
+  hscdtd_calib_init(&calibrator, 1.0);
+
+  Serial.println("Rotate the sensor in all directions.");
+}
+
+void loop() {
+  hscdtd_status_t status;
+
+  status = geomag.startMeasurement();
+  if (status != HSCDTD_STAT_OK) {
+    Serial.println("Error occurred, unable to read sensor data.");
+    delay(50);
+    return;
+  }
+
+  if (!calibrated) {
+    hscdtd_calib_update(&calibrator, &geomag.mag);
+
+    // Only try to solve once enough directions have been seen.
+    if (hscdtd_calib_coverage(&calibrator) > 0.9 &&
+        hscdtd_calib_solve(&calibrator, &calibration) == HSCDTD_STAT_OK &&
+        calibration.fit_error < 0.05) {
+      geomag.applyCalibration(&calibration);
+      calibrated = true;
+
+      Serial.print("Calibrated. Field strength: ");
+      Serial.print(calibration.field_strength);
+      Serial.print("uT, fit error: ");
+      Serial.print(calibration.fit_error * 100);
+      Serial.println("%");
+    }
+  } else {
+    // Hard-iron offset is removed by the sensor, only apply soft-iron.
+    hscdtd_calib_correct(&calibration, &geomag.mag);
+
+    Serial.print("X: ");
+    Serial.print(geomag.mag.mag_x);
+    Serial.print("uT,\t");
+
+    Serial.print("Y: ");
+    Serial.print(geomag.mag.mag_y);
+    Serial.print("uT,\t");
+
+    Serial.print("Z: ");
+    Serial.print(geomag.mag.mag_z);
+    Serial.print("uT");
+
+    Serial.println("");
+  }
+  // Wait a bit before reading the next sample.
+  delay(50);
+}
@@ -0,0 +1,109 @@
+/****************************************************************
+ * Example6_Heading_Benchmark.ino
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include <Arduino.h>
+#include "hscdtd008a.h"
+
+// Number of headings computed per mode.
+const int iterations = 1000;
+
+const char *mode_names[] = {"EXACT", "POLY", "LUT", "CORDIC"};
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+
+// Gravity vector as measured with the sensor tilted ~20 degrees.
+hscdtd_vec3_t down = {0.0, 3.35, 9.21};
+
+// Keeps the compiler from optimizing the benchmark away.
+volatile float sink;
+
+
+void benchmark(hscdtd_atan2_mode_t mode) {
+  hscdtd_mag_t sample;
+  unsigned long start, elapsed;
+  float error, max_error = 0;
+  int i;
+
+  start = micros();
+  for (i = 0; i < iterations; i++) {
+    // Rotate the field a bit each iteration so every octant is hit.
+    sample.mag_x = 20.0 - (i % 40);
+    sample.mag_y = (i % 23) - 11.0;
+    sample.mag_z = -40.0;
+    sink = hscdtd_heading_tilt(&sample, &down, mode);
+  }
+  elapsed = micros() - start;
+
+  // Error against atan2 over the full circle, in steps of 0.1 degree.
+  for (i = 0; i < 3600; i++) {
+    float angle = i * 0.1 * DEG_TO_RAD;
+    error = hscdtd_atan2_deg(sin(angle), cos(angle), mode) -
+            atan2(sin(angle), cos(angle)) * RAD_TO_DEG;
+    if (error > 180)
+      error -= 360;
+    if (error < -180)
+      error += 360;
+    error = fabs(error);
+    if (error > max_error)
+      max_error = error;
+  }
+
+  Serial.print(mode_names[mode]);
+  Serial.print(":\t");
+  Serial.print((float)elapsed / iterations);
+  Serial.print(" us,\t");
+  Serial.print((float)elapsed / iterations * (F_CPU / 1000000UL));
+  Serial.print(" cycles,\tmax error ");
+  Serial.print(max_error, 4);
+  Serial.println(" deg");
+}
+
+void setup() {
+  hscdtd_status_t status;
+
+  Serial.begin(9600);
+
+  Serial.println("Cost per tilt compensated heading:");
+  benchmark(HSCDTD_ATAN2_EXACT);
+  benchmark(HSCDTD_ATAN2_POLY);
+  benchmark(HSCDTD_ATAN2_LUT);
+  benchmark(HSCDTD_ATAN2_CORDIC);
+
+  geomag.begin();
+  // If you know the I2C address is different than in the provided
+  // data sheet. Uncomment the line below, and configure the address.
+  // geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    Serial.println("Failed to initialize sensor. Check wiring.");
+
+    // Halt program here.
+    while (true) { delay(1); }
+  }
+}
+
+void loop() {
+  hscdtd_status_t status;
+
+  // Explicitly start a reading.
+  status = geomag.startMeasurement();
+  // If the status is OK then we can print the heading.
+  if (status == HSCDTD_STAT_OK) {
+    Serial.print("Heading: ");
+    Serial.print(geomag.getHeading(HSCDTD_ATAN2_CORDIC));
+    Serial.println(" deg");
+  } else {
+    Serial.println("Error occurred, unable to read sensor data.");
+  }
+  // Wait a bit before reading the next sample.
+  delay(50);
+}
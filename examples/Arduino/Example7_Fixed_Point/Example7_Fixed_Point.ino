@@ -0,0 +1,116 @@
+/****************************************************************
+ * Example7_Fixed_Point.ino
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Uses the fixed-point (nT) API only. Define HSCDTD_FIXED_POINT in
+ * src/driver/hscdtd008a_config.h to drop the float API from the build and
+ * compare the sketch size reported by the IDE with and without it.
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include <Arduino.h>
+#include "hscdtd008a.h"
+
+// Number of conversions timed for the benchmark.
+const int iterations = 1000;
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+
+// Keeps the compiler from optimizing the benchmark away.
+volatile uint32_t sink;
+
+
+void benchmark() {
+  hscdtd_mag_raw_t raw;
+  hscdtd_mag_nt_t nt;
+  unsigned long start, elapsed;
+  int i;
+
+  start = micros();
+  for (i = 0; i < iterations; i++) {
+    raw.mag_x = i;
+    raw.mag_y = -i;
+    raw.mag_z = 300;
+    hscdtd_raw_to_nt(&raw, &nt);
+    sink = nt.mag_x;
+  }
+  elapsed = micros() - start;
+  Serial.print("LSB to nT:\t");
+  Serial.print((float)elapsed / iterations * (F_CPU / 1000000UL));
+  Serial.println(" cycles/sample");
+
+  start = micros();
+  for (i = 0; i < iterations; i++) {
+    raw.mag_x = i;
+    raw.mag_y = -i;
+    raw.mag_z = 300;
+    sink = hscdtd_magnitude_nt(&raw);
+  }
+  elapsed = micros() - start;
+  Serial.print("Magnitude:\t");
+  Serial.print((float)elapsed / iterations * (F_CPU / 1000000UL));
+  Serial.println(" cycles/sample");
+}
+
+void setup() {
+  hscdtd_status_t status;
+
+  Serial.begin(9600);
+
+  benchmark();
+
+  geomag.begin();
+  // If you know the I2C address is different than in the provided
+  // data sheet. Uncomment the line below, and configure the address.
+  // geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    Serial.println("Failed to initialize sensor. Check wiring.");
+
+    // Halt program here.
+    while (true) { delay(1); }
+  }
+
+  // Apply a fixed offset of 10uT on the x-axis.
+  geomag.applyOffsetDriftNt(10000, 0, 0);
+}
+
+void loop() {
+  hscdtd_status_t status;
+  hscdtd_mag_nt_t data;
+
+  // Explicitly start a reading.
+  status = geomag.startMeasurement();
+  // If the status is OK then we can print the result.
+  if (status == HSCDTD_STAT_OK) {
+    geomag.getMagDataNt(&data);
+
+    Serial.print("X: ");
+    Serial.print(data.mag_x);
+    Serial.print("nT,\t");
+
+    Serial.print("Y: ");
+    Serial.print(data.mag_y);
+    Serial.print("nT,\t");
+
+    Serial.print("Z: ");
+    Serial.print(data.mag_z);
+    Serial.print("nT,\t");
+
+    Serial.print("|B|: ");
+    Serial.print(geomag.getMagnitudeNt());
+    Serial.print("nT");
+
+    Serial.println("");
+  } else {
+    Serial.println("Error occurred, unable to read sensor data.");
+  }
+  // Wait a bit before reading the next sample.
+  delay(50);
+}
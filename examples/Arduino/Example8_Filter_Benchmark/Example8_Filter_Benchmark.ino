@@ -0,0 +1,135 @@
+/****************************************************************
+ * Example8_Filter_Benchmark.ino
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include <Arduino.h>
+#include "hscdtd008a.h"
+#include "driver/hscdtd008a_filter.h"
+
+// Sample rate of the stream, used for the biquad and Kalman filter.
+const float sample_rate = 20.0;
+
+// Number of samples per benchmark batch.
+const int batch = 32;
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+
+hscdtd_median_t median;
+hscdtd_lowpass_t lowpass;
+hscdtd_biquad_t biquad;
+hscdtd_kalman_t kalman;
+
+// Spike rejection first, then smoothing.
+hscdtd_filter_stage_t chain[] = {
+  {hscdtd_median_process, &median},
+  {hscdtd_biquad_process, &biquad},
+};
+
+hscdtd_mag_t samples[batch];
+
+
+void init_filters() {
+  hscdtd_median_init(&median, 1);
+  hscdtd_lowpass_init(&lowpass, 1, 0.2);
+  hscdtd_biquad_init_lowpass(&biquad, 1, 2.0, sample_rate);
+  hscdtd_kalman_init(&kalman, 1, 1.0 / sample_rate, 100.0, 1.0);
+}
+
+void benchmark(const char *name, hscdtd_filter_fn_t filter, void *state) {
+  unsigned long start, elapsed;
+  int i, latency = -1;
+
+  // Cost per sample, on a noisy constant field.
+  for (i = 0; i < batch; i++) {
+    samples[i].mag_x = 20.0 + (i % 3);
+    samples[i].mag_y = -10.0;
+    samples[i].mag_z = 40.0;
+  }
+  start = micros();
+  filter(state, 1, samples, batch);
+  elapsed = micros() - start;
+
+  // Latency is the number of samples until the output crosses half of a
+  // step in the input.
+  for (i = 0; i < batch; i++) {
+    samples[i].mag_x = (i < batch / 4) ? 0.0 : 10.0;
+    samples[i].mag_y = samples[i].mag_z = samples[i].mag_x;
+  }
+  init_filters();
+  filter(state, 1, samples, batch);
+  for (i = batch / 4; i < batch; i++) {
+    if (samples[i].mag_x >= 5.0) {
+      latency = i - batch / 4;
+      break;
+    }
+  }
+
+  Serial.print(name);
+  Serial.print(":\t");
+  Serial.print((float)elapsed / batch * (F_CPU / 1000000UL));
+  Serial.print(" cycles/sample,\tlatency ");
+  Serial.print(latency);
+  Serial.println(" samples");
+}
+
+void setup() {
+  hscdtd_status_t status;
+
+  Serial.begin(9600);
+
+  init_filters();
+  benchmark("Median", hscdtd_median_process, &median);
+  benchmark("Low-pass", hscdtd_lowpass_process, &lowpass);
+  benchmark("Biquad", hscdtd_biquad_process, &biquad);
+  benchmark("Kalman", hscdtd_kalman_process, &kalman);
+  init_filters();
+
+  geomag.begin();
+  // If you know the I2C address is different than in the provided
+  // data sheet. Uncomment the line below, and configure the address.
+  // geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    Serial.println("Failed to initialize sensor. Check wiring.");
+
+    // Halt program here.
+    while (true) { delay(1); }
+  }
+}
+
+void loop() {
+  hscdtd_status_t status;
+
+  // Explicitly start a reading.
+  status = geomag.startMeasurement();
+  // If the status is OK then we can filter and print the result.
+  if (status == HSCDTD_STAT_OK) {
+    hscdtd_filter_chain(chain, 2, &geomag.mag, 1, 1);
+
+    Serial.print("X: ");
+    Serial.print(geomag.mag.mag_x);
+    Serial.print("uT,\t");
+
+    Serial.print("Y: ");
+    Serial.print(geomag.mag.mag_y);
+    Serial.print("uT,\t");
+
+    Serial.print("Z: ");
+    Serial.print(geomag.mag.mag_z);
+    Serial.print("uT");
+
+    Serial.println("");
+  } else {
+    Serial.println("Error occurred, unable to read sensor data.");
+  }
+  // Sample at the rate the filters are designed for.
+  delay(1000 / sample_rate);
+}
@@ -0,0 +1,72 @@
+/****************************************************************
+ * Example9_Sensor_Array.ino
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include <Arduino.h>
+#include "hscdtd008a.h"
+
+
+// Two sensors on the same bus, one on each address.
+HSCDTD008A geomag_a;
+HSCDTD008A geomag_b;
+
+// Array that measures both sensors at (nearly) the same time.
+HSCDTD008AArray sensors;
+
+
+void setup() {
+  Serial.begin(9600);
+
+  geomag_a.begin(HSCDTD_DEFAULT_ADDR);
+  geomag_b.begin(HSCDTD_ALT_ADDR);
+
+  // Initialize the hardware.
+  if (geomag_a.initialize() != HSCDTD_STAT_OK ||
+      geomag_b.initialize() != HSCDTD_STAT_OK) {
+    Serial.println("Failed to initialize sensors. Check wiring.");
+
+    // Halt program here.
+    while (true) { delay(1); }
+  }
+
+  sensors.begin();
+  sensors.add(&geomag_a);
+  sensors.add(&geomag_b);
+}
+
+void loop() {
+  hscdtd_status_t status;
+
+  // Trigger both sensors back-to-back and collect the results.
+  status = sensors.sweep();
+  if (status == HSCDTD_STAT_OK) {
+    Serial.print("A: ");
+    Serial.print(geomag_a.mag.mag_x);
+    Serial.print(", ");
+    Serial.print(geomag_a.mag.mag_y);
+    Serial.print(", ");
+    Serial.print(geomag_a.mag.mag_z);
+
+    Serial.print("uT\tB: ");
+    Serial.print(geomag_b.mag.mag_x);
+    Serial.print(", ");
+    Serial.print(geomag_b.mag.mag_y);
+    Serial.print(", ");
+    Serial.print(geomag_b.mag.mag_z);
+
+    Serial.print("uT\tskew: ");
+    Serial.print(sensors.getTriggerSkewUs());
+    Serial.print("us\tsweep: ");
+    Serial.print(sensors.getSweepTimeUs());
+    Serial.println("us");
+  } else {
+    Serial.println("Error occurred, unable to read sensor data.");
+  }
+  // Wait a bit before the next sweep.
+  delay(50);
+}
@@ -0,0 +1,114 @@
+/****************************************************************
+ * Example2_Capture.cpp
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Records timestamped raw samples to a binary capture file, then replays
+ * the file through the conversion functions of the driver.
+ *
+ * Usage: Example2_Capture [file] [samples]
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include "hscdtd008a.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+
+
+double now_s(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void record(const char *path, long samples) {
+  hscdtd_status_t status;
+  hscdtd_capture_device_t desc;
+  hscdtd_capture_writer_t writer;
+
+  status = geomag.getCaptureDevice(&desc);
+  if (status == HSCDTD_STAT_OK)
+    status = hscdtd_capture_open_write(&writer, path, &desc, 1);
+  if (status != HSCDTD_STAT_OK) {
+    printf("Unable to create %s. Status:%d\n", path, status);
+    exit(1);
+  }
+
+  for (long i = 0; i < samples; i++) {
+    status = geomag.startMeasurement();
+    if (status != HSCDTD_STAT_OK) {
+      printf("Error occurred, unable to read sensor data. Status:%d\n", status);
+      break;
+    }
+    hscdtd_capture_append(&writer, 0, &geomag.sample);
+  }
+
+  hscdtd_capture_close_write(&writer);
+  printf("Recorded %u samples, mean interval %.1f us, jitter %.1f us\n",
+         writer.records, geomag.getTiming()->mean_interval_q4 / 16.0,
+         geomag.getTiming()->jitter_q4 / 16.0);
+}
+
+void replay(const char *path) {
+  hscdtd_status_t status;
+  hscdtd_capture_reader_t reader;
+  hscdtd_sample_t sample;
+  hscdtd_mag_nt_t nt;
+  uint8_t device;
+  long long sum[HSCDTD_NUM_AXIS] = {0, 0, 0};
+  double start, elapsed;
+
+  status = hscdtd_capture_open_read(&reader, path);
+  if (status != HSCDTD_STAT_OK) {
+    printf("Unable to open %s. Status:%d\n", path, status);
+    exit(1);
+  }
+
+  start = now_s();
+  while (hscdtd_capture_next(&reader, &sample, &device) == HSCDTD_STAT_OK) {
+    hscdtd_raw_to_nt(&sample.raw, &nt);
+    sum[0] += nt.mag_x;
+    sum[1] += nt.mag_y;
+    sum[2] += nt.mag_z;
+  }
+  elapsed = now_s() - start;
+
+  if (reader.records) {
+    printf("Mean X: %lld nT,\tY: %lld nT,\tZ: %lld nT\n",
+           sum[0] / reader.records, sum[1] / reader.records,
+           sum[2] / reader.records);
+  }
+  printf("Replayed %u records in %.3f ms (%.1f MB/s)\n", reader.records,
+         elapsed * 1e3,
+         reader.records * HSCDTD_CAPTURE_RECORD_SIZE / elapsed / 1e6);
+
+  hscdtd_capture_close_read(&reader);
+}
+
+int main(int argc, char** argv)
+{
+  hscdtd_status_t status;
+  const char *path = (argc > 1) ? argv[1] : "capture.bin";
+  long samples = (argc > 2) ? atol(argv[2]) : 1000;
+
+  geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    printf("Failed to initialize sensor. Status:%d. Check wiring.\n", status);
+
+    // Halt program here.
+    exit(1);
+  }
+
+  record(path, samples);
+  replay(path);
+}
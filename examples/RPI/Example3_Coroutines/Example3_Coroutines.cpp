@@ -0,0 +1,69 @@
+/****************************************************************
+ * Example3_Coroutines.cpp
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Drives the sensors at both addresses from one thread with C++20
+ * coroutines. Each sensor runs a self test and a temperature
+ * compensation, then measures; the waits of one sensor are used for the
+ * others.
+ *
+ * Usage: Example3_Coroutines [samples]
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include "hscdtd008a.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Create an instance per sensor.
+HSCDTD008A geomag[2];
+const uint8_t addresses[2] = {HSCDTD_DEFAULT_ADDR, HSCDTD_ALT_ADDR};
+
+
+HSCDTD008ATask run(HSCDTD008A &sensor, HSCDTD008AScheduler &sched,
+                   uint8_t addr, long samples) {
+  hscdtd_status_t status;
+
+  status = co_await sensor.runSelfTestAsync(sched);
+  if (status != HSCDTD_STAT_OK) {
+    printf("0x%02X: self test failed. Status:%d\n", addr, status);
+    co_return status;
+  }
+
+  status = co_await sensor.temperatureCompensationAsync(sched);
+  if (status != HSCDTD_STAT_OK)
+    co_return status;
+
+  for (long i = 0; i < samples; i++) {
+    status = co_await sensor.startMeasurementAsync(sched);
+    if (status != HSCDTD_STAT_OK) {
+      printf("0x%02X: unable to read sensor data. Status:%d\n", addr, status);
+      co_return status;
+    }
+    printf("0x%02X: X: %f uT,\tY: %f uT,\tZ: %f uT\n", addr,
+           sensor.mag.mag_x, sensor.mag.mag_y, sensor.mag.mag_z);
+  }
+  co_return HSCDTD_STAT_OK;
+}
+
+int main(int argc, char** argv)
+{
+  HSCDTD008AExecutor executor;
+  long samples = (argc > 1) ? atol(argv[1]) : 10;
+
+  for (int i = 0; i < 2; i++) {
+    geomag[i].begin(addresses[i]);
+    if (geomag[i].initialize() != HSCDTD_STAT_OK) {
+      printf("No sensor at 0x%02X\n", addresses[i]);
+      continue;
+    }
+    executor.spawn(run(geomag[i], executor, addresses[i], samples));
+  }
+
+  // Returns when all sensors are done.
+  executor.run();
+  return executor.getFailedTasks() ? 1 : 0;
+}
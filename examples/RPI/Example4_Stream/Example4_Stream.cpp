@@ -0,0 +1,71 @@
+/****************************************************************
+ * Example4_Stream.cpp
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Streams samples at 100Hz from the FIFO of the sensor. The library reads
+ * the FIFO from its own thread and calls back with batches of samples.
+ *
+ * Usage: Example4_Stream [seconds] [batch]
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include "hscdtd008a.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+HSCDTD008AStream stream;
+
+
+// Runs on the thread of the stream, keep it short.
+void on_samples(void *p_ctx, const hscdtd_sample_t *p_samples,
+                uint8_t count) {
+  hscdtd_mag_nt_t nt;
+
+  hscdtd_raw_to_nt(&p_samples[count - 1].raw, &nt);
+  printf("%u samples, last #%u at %u us: X: %ld nT,\tY: %ld nT,\tZ: %ld nT\n",
+         count, p_samples[count - 1].seq, p_samples[count - 1].timestamp_us,
+         (long) nt.mag_x, (long) nt.mag_y, (long) nt.mag_z);
+}
+
+int main(int argc, char** argv)
+{
+  hscdtd_status_t status;
+  hscdtd_stream_config_t config = HSCDTD_STREAM_CONFIG_DEFAULT;
+  int seconds = (argc > 1) ? atoi(argv[1]) : 5;
+
+  config.odr = HSCDTD_ODR_100HZ;
+  config.source = HSCDTD_STREAM_FIFO;
+  config.batch = (argc > 2) ? atoi(argv[2]) : 8;
+  // Deliver at least every 100ms, even if the batch is not full.
+  config.max_latency_us = 100000;
+
+  geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    printf("Failed to initialize sensor. Status:%d. Check wiring.\n", status);
+
+    // Halt program here.
+    exit(1);
+  }
+
+  status = stream.start(&geomag, &config, on_samples);
+  if (status != HSCDTD_STAT_OK) {
+    printf("Unable to start the stream. Status:%d\n", status);
+    exit(1);
+  }
+
+  sleep(seconds);
+  stream.stop();
+
+  printf("%u samples in %u batches, %u missed, FIFO full %u times\n",
+         stream.getStats()->samples, stream.getStats()->batches,
+         stream.getStats()->missed, stream.getStats()->fifo_full);
+}
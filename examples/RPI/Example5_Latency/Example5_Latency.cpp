@@ -0,0 +1,105 @@
+/****************************************************************
+ * Example5_Latency.cpp
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Measures the latency of samples from the end of the conversion to the
+ * application, first for force state measurements with startMeasurement,
+ * then for a stream polling DRDY at 100Hz. Prints the percentiles of
+ * every stage, and with -e every bucket of the histograms as CSV.
+ *
+ * Usage: Example5_Latency [samples] [-e]
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include "hscdtd008a.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+HSCDTD008AStream stream;
+hscdtd_latency_t latency;
+
+
+void on_samples(void *p_ctx, const hscdtd_sample_t *p_samples,
+                uint8_t count) {
+}
+
+
+void on_bucket(void *p_ctx, hscdtd_lat_stage_t stage, uint32_t low_us,
+               uint32_t high_us, uint32_t count) {
+  printf("%s,%s,%u,%u,%u\n", (const char *) p_ctx,
+         hscdtd_latency_stage_name(stage), low_us, high_us, count);
+}
+
+
+void report(const char *name, bool export_buckets) {
+  printf("%s\n%-11s %7s %7s %7s %7s %7s %7s %7s\n", name, "stage", "count",
+         "mean", "p50", "p90", "p99", "p99.9", "max");
+  for (int i = 0; i < HSCDTD_LAT_STAGES; i++) {
+    const hscdtd_hist_t *p_hist = &latency.stages[i];
+
+    printf("%-11s %7u %7u %7u %7u %7u %7u %7u\n",
+           hscdtd_latency_stage_name((hscdtd_lat_stage_t) i), p_hist->count,
+           hscdtd_hist_mean(p_hist), hscdtd_hist_percentile(p_hist, 500),
+           hscdtd_hist_percentile(p_hist, 900),
+           hscdtd_hist_percentile(p_hist, 990),
+           hscdtd_hist_percentile(p_hist, 999), p_hist->max_us);
+  }
+  if (export_buckets) {
+    printf("run,stage,low_us,high_us,count\n");
+    hscdtd_latency_export(&latency, on_bucket, (void *) name);
+  }
+  printf("\n");
+}
+
+
+int main(int argc, char** argv)
+{
+  hscdtd_status_t status;
+  hscdtd_stream_config_t config = HSCDTD_STREAM_CONFIG_DEFAULT;
+  int samples = (argc > 1) ? atoi(argv[1]) : 1000;
+  bool export_buckets = (argc > 2) && strcmp(argv[2], "-e") == 0;
+
+  geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    printf("Failed to initialize sensor. Status:%d. Check wiring.\n", status);
+
+    // Halt program here.
+    exit(1);
+  }
+
+  // Force state, every stage from the trigger on.
+  hscdtd_latency_reset(&latency);
+  geomag.setLatency(&latency);
+  for (int i = 0; i < samples; i++) {
+    if (geomag.startMeasurement() != HSCDTD_STAT_OK) {
+      printf("Error occurred, unable to read sensor data. Exiting ...\n");
+      exit(1);
+    }
+  }
+  report("force", export_buckets);
+
+  // Normal state at 100Hz, DRDY polled from the thread of the stream.
+  hscdtd_latency_reset(&latency);
+  config.odr = HSCDTD_ODR_100HZ;
+  config.source = HSCDTD_STREAM_POLL;
+  config.batch = 1;
+  status = stream.start(&geomag, &config, on_samples);
+  if (status != HSCDTD_STAT_OK) {
+    printf("Unable to start the stream. Status:%d\n", status);
+    exit(1);
+  }
+  usleep(samples * 10000);
+  stream.stop();
+  geomag.setLatency(0);
+  report("stream", export_buckets);
+}
@@ -0,0 +1,96 @@
+/****************************************************************
+ * Example7_Realtime.cpp
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Samples the sensor at 100Hz from a real-time thread: SCHED_FIFO, pinned
+ * to a CPU, with the memory locked. Prints the deadline misses, skipped
+ * periods and the jitter of the cycles every second.
+ *
+ * Needs root, or CAP_SYS_NICE and CAP_IPC_LOCK. With priority 0 it runs on
+ * the normal scheduler without locked memory, to compare.
+ *
+ * Usage: Example7_Realtime [seconds] [priority] [cpu]
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include "hscdtd008a.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+HSCDTD008ARealtime realtime;
+
+// Written by the real-time thread, read by main.
+volatile int16_t last_x, last_y, last_z;
+
+
+// Runs on the real-time thread, no printing or allocation here.
+void on_cycle(void *p_ctx, const hscdtd_sample_t *p_samples,
+              const hscdtd_status_t *p_status, uint8_t count) {
+  if (p_status[0] == HSCDTD_STAT_OK) {
+    last_x = p_samples[0].raw.mag_x;
+    last_y = p_samples[0].raw.mag_y;
+    last_z = p_samples[0].raw.mag_z;
+  }
+}
+
+
+void print_hist(const char *name, const hscdtd_hist_t *p_hist) {
+  printf("  %-6s p50 %5u  p99 %5u  p99.9 %5u  max %5u us\n", name,
+         hscdtd_hist_percentile(p_hist, 500),
+         hscdtd_hist_percentile(p_hist, 990),
+         hscdtd_hist_percentile(p_hist, 999), p_hist->max_us);
+}
+
+
+int main(int argc, char** argv)
+{
+  hscdtd_status_t status;
+  hscdtd_rt_config_t config = HSCDTD_RT_CONFIG_DEFAULT;
+  hscdtd_rt_stats_t stats;
+  int seconds = (argc > 1) ? atoi(argv[1]) : 10;
+
+  if (argc > 2)
+    config.priority = atoi(argv[2]);
+  if (argc > 3)
+    config.cpu = atoi(argv[3]);
+  config.lock_memory = (config.priority > 0);
+  // A force state conversion takes about 5ms, poll DRDY after that.
+  config.conversion_us = 5000;
+
+  geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    printf("Failed to initialize sensor. Status:%d. Check wiring.\n", status);
+
+    // Halt program here.
+    exit(1);
+  }
+
+  realtime.begin();
+  realtime.add(&geomag);
+  status = realtime.start(&config, on_cycle);
+  if (status != HSCDTD_STAT_OK) {
+    printf("Unable to start the real-time thread. Status:%d\n", status);
+    printf("Run as root, or with priority 0.\n");
+    exit(1);
+  }
+
+  for (int i = 0; i < seconds; i++) {
+    sleep(1);
+    realtime.getStats(&stats);
+    printf("x:%d y:%d z:%d  cycles %u  misses %u  skipped %u  errors %u\n",
+           last_x, last_y, last_z, stats.cycles, stats.deadline_misses,
+           stats.skipped, stats.errors);
+    print_hist("wake", &stats.wake);
+    print_hist("cycle", &stats.cycle);
+  }
+  realtime.stop();
+}
@@ -0,0 +1,93 @@
+/****************************************************************
+ * Example8_Publisher.cpp
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Publisher daemon: the only process on the bus. Streams the sensor at
+ * 100Hz and publishes every sample to a shared-memory ring, from which
+ * any number of processes read it, see Example9_Subscriber. Runs until
+ * SIGINT or SIGTERM, then closes the ring.
+ *
+ * Usage: Example8_Publisher [name] [slots]
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include "hscdtd008a.h"
+#include "driver/hscdtd008a_shm.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Create an instance of the sensor.
+HSCDTD008A geomag;
+HSCDTD008AStream stream;
+hscdtd_shm_publisher_t publisher;
+
+volatile sig_atomic_t running = 1;
+
+
+void on_signal(int sig) {
+  running = 0;
+}
+
+
+// Runs on the thread of the stream, one store per sample and one wake-up.
+void on_samples(void *p_ctx, const hscdtd_sample_t *p_samples,
+                uint8_t count) {
+  hscdtd_shm_publish(&publisher, 0, p_samples, count);
+}
+
+
+int main(int argc, char** argv)
+{
+  hscdtd_status_t status;
+  hscdtd_stream_config_t config = HSCDTD_STREAM_CONFIG_DEFAULT;
+  hscdtd_capture_device_t desc;
+  const char *name = (argc > 1) ? argv[1] : "/hscdtd008a";
+  uint32_t slots = (argc > 2) ? atoi(argv[2]) : HSCDTD_SHM_SLOTS_DEFAULT;
+
+  config.odr = HSCDTD_ODR_100HZ;
+  config.source = HSCDTD_STREAM_POLL;
+  config.batch = 1;
+
+  geomag.begin(0x0F);
+
+  // Initialize the hardware.
+  status = geomag.initialize();
+  if (status != HSCDTD_STAT_OK) {
+    printf("Failed to initialize sensor. Status:%d. Check wiring.\n", status);
+
+    // Halt program here.
+    exit(1);
+  }
+
+  // Readers convert with the device table of the ring.
+  geomag.getCaptureDevice(&desc);
+  status = hscdtd_shm_create(&publisher, name, slots, &desc, 1);
+  if (status != HSCDTD_STAT_OK) {
+    printf("Unable to create ring %s. Status:%d\n", name, status);
+    exit(1);
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  status = stream.start(&geomag, &config, on_samples);
+  if (status != HSCDTD_STAT_OK) {
+    printf("Unable to start the stream. Status:%d\n", status);
+    hscdtd_shm_destroy(&publisher);
+    exit(1);
+  }
+  printf("Publishing to %s, %u slots\n", name, slots);
+
+  while (running)
+    pause();
+
+  stream.stop();
+  printf("%u samples published, %u missed\n", stream.getStats()->samples,
+         stream.getStats()->missed);
+  hscdtd_shm_destroy(&publisher);
+}
@@ -0,0 +1,68 @@
+/****************************************************************
+ * Example9_Subscriber.cpp
+ * HSCDTD008A Library Demo
+ * HSCDTD008A Library contributors
+ * Original Creation Date: 2026-10-19
+ *
+ * Reads the samples of Example8_Publisher from the shared-memory ring,
+ * without touching the bus or linking the driver. Start as many as
+ * needed, each has its own cursor. Samples are used in place and checked
+ * afterwards.
+ *
+ * Usage: Example9_Subscriber [name] [-a]
+ *   -a  start with the oldest sample in the ring instead of the next one
+ *
+ * Distributed as-is; no warranty is given.
+ ***************************************************************/
+
+#include "driver/hscdtd008a_shm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+int main(int argc, char** argv)
+{
+  hscdtd_status_t status;
+  hscdtd_shm_client_t client;
+  const hscdtd_sample_t *p_sample;
+  long nt[HSCDTD_NUM_AXIS];
+  uint16_t nt_per_lsb;
+  uint8_t device;
+  const char *name = (argc > 1) ? argv[1] : "/hscdtd008a";
+  bool all = (argc > 2) && strcmp(argv[2], "-a") == 0;
+  uint32_t seq, timestamp_us;
+
+  // Wait for the publisher.
+  while ((status = hscdtd_shm_open(&client, name)) == HSCDTD_STAT_NO_DATA)
+    sleep(1);
+  if (status != HSCDTD_STAT_OK) {
+    printf("Unable to open ring %s. Status:%d\n", name, status);
+    exit(1);
+  }
+  printf("Reading %s from publisher %u, %u slots\n", name,
+         client.p_header->pid, client.p_header->slots);
+  if (all)
+    hscdtd_shm_seek_oldest(&client);
+
+  // Until the publisher closes the ring.
+  while ((status = hscdtd_shm_wait(&client, 1000)) != HSCDTD_STAT_ERROR) {
+    while (hscdtd_shm_peek(&client, &p_sample, &device) == HSCDTD_STAT_OK) {
+      // Resolution from the device table of the ring.
+      nt_per_lsb = client.p_header->devices[device].nt_per_lsb;
+      nt[0] = (long) p_sample->raw.mag_x * nt_per_lsb;
+      nt[1] = (long) p_sample->raw.mag_y * nt_per_lsb;
+      nt[2] = (long) p_sample->raw.mag_z * nt_per_lsb;
+      seq = p_sample->seq;
+      timestamp_us = p_sample->timestamp_us;
+      // Overwritten while it was converted, skip it.
+      if (hscdtd_shm_release(&client) != HSCDTD_STAT_OK)
+        continue;
+      printf("#%u at %u us: X: %ld nT,\tY: %ld nT,\tZ: %ld nT\n", seq,
+             timestamp_us, nt[0], nt[1], nt[2]);
+    }
+  }
+  printf("Publisher closed, %u samples lost\n", client.lost);
+  hscdtd_shm_close(&client);
+}
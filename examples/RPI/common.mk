@@ -0,0 +1,36 @@
+# Build rules shared by the RPI examples. An example sets EXAMPLE to the name
+# of its source file and includes this file, EXTRA_OBJS and LIBS add the
+# modules and libraries only that example needs.
+.DEFAULT_GOAL := $(EXAMPLE)
+SRC = ../../../src
+DRIVER = $(SRC)/driver
+INCLUDE = -I$(SRC) -I$(DRIVER)
+FLAGS = -DRPI -Wall -c
+
+# hscdtd008a.cpp holds every wrapper class, so anything linking it needs the
+# modules behind them too. An example that does not use the driver sets
+# LIB_OBJS empty.
+LIB_OBJS ?= hscdtd008a.o hscdtd008a_driver.o transport.o platform_rpi.o \
+	hscdtd008a_calib.o hscdtd008a_heading.o hscdtd008a_array.o \
+	hscdtd008a_capture.o hscdtd008a_bus.o hscdtd008a_sched.o \
+	hscdtd008a_stream.o hscdtd008a_duty.o hscdtd008a_adapt.o \
+	hscdtd008a_health.o hscdtd008a_latency.o hscdtd008a_event.o \
+	hscdtd008a_rt.o
+
+$(EXAMPLE): $(EXAMPLE).o $(LIB_OBJS) $(EXTRA_OBJS)
+	g++ -pthread -o $@ $^ $(LIBS)
+
+$(EXAMPLE).o: $(EXAMPLE).cpp
+	g++ $(CXXFLAGS) $(FLAGS) $(INCLUDE) -o $@ $<
+
+hscdtd008a.o: $(SRC)/hscdtd008a.cpp
+	g++ $(CXXFLAGS) $(FLAGS) $(INCLUDE) -o $@ $<
+
+%.o: $(DRIVER)/%.cpp
+	g++ $(CXXFLAGS) $(FLAGS) $(INCLUDE) -o $@ $<
+
+%.o: $(DRIVER)/%.c
+	gcc $(FLAGS) $(INCLUDE) -o $@ $<
+
+clean:
+	rm -f *.o $(EXAMPLE)
@@ -0,0 +1,51 @@
+#!/bin/sh
+# Flash and RAM of every Arduino example per build profile, as a markdown
+# table. Needs arduino-cli with the core of the board installed.
+#
+#   extras/size_report.sh [fqbn] [profile flags...]
+#
+# The default board is the Uno. Every further argument is a profile, the
+# flags it adds to the build; the default profiles are the full library,
+# HSCDTD_FIXED_POINT and HSCDTD_MINIMAL. A sketch that uses a feature the
+# profile removes does not build, its cell is "-".
+
+set -u
+
+LIB=$(cd "$(dirname "$0")/.." && pwd)
+FQBN=${1:-arduino:avr:uno}
+[ $# -gt 0 ] && shift
+[ $# -eq 0 ] && set -- "" "-DHSCDTD_FIXED_POINT" "-DHSCDTD_MINIMAL"
+
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+printf '| Example |'
+for flags in "$@"; do
+    printf ' %s |' "${flags:-default}"
+done
+printf '\n|--|'
+for flags in "$@"; do
+    printf '%s' '--|'
+done
+printf '\n'
+
+for sketch in "$LIB"/examples/Arduino/*/; do
+    printf '| %s |' "$(basename "$sketch")"
+    for flags in "$@"; do
+        out=$(arduino-cli compile --fqbn "$FQBN" --library "$LIB" \
+              --build-path "$BUILD" \
+              --build-property "compiler.c.extra_flags=$flags" \
+              --build-property "compiler.cpp.extra_flags=$flags" \
+              "$sketch" 2>&1)
+        flash=$(printf '%s\n' "$out" | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p')
+        ram=$(printf '%s\n' "$out" | sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p')
+        if [ -n "$flash" ]; then
+            printf ' %s / %s |' "$flash" "${ram:-?}"
+        else
+            printf ' - |'
+        fi
+        rm -rf "$BUILD"/*
+    done
+    printf '\n'
+done
+printf '\nFlash / RAM in bytes, %s.\n' "$FQBN"
@@ -0,0 +1,102 @@
+#include <string.h>
+#include "hscdtd008a_adapt.h"
+
+
+static uint32_t abs_diff(int16_t a, int16_t b)
+{
+    return (a > b) ? (uint32_t) (a - b) : (uint32_t) (b - a);
+}
+
+
+/**
+ * @brief Initialize an adaptive output data rate.
+ *
+ * Starts at odr_low.
+ *
+ * @param p_adapt Pointer to adaptive rate struct.
+ * @param p_config Thresholds and rates.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_adapt_init(hscdtd_adapt_t *p_adapt,
+                                  const hscdtd_adapt_config_t *p_config)
+{
+    if (!p_adapt || !p_config) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_config->odr_low > HSCDTD_ODR_100HZ ||
+        p_config->odr_high > HSCDTD_ODR_100HZ ||
+        p_config->fall_nt_s >= p_config->rise_nt_s ||
+        p_config->window_us == 0) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    memset(p_adapt, 0, sizeof(hscdtd_adapt_t));
+    p_adapt->config = *p_config;
+    p_adapt->odr = p_config->odr_low;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Feed a sample.
+ *
+ * @param p_adapt Pointer to adaptive rate struct.
+ * @param p_sample Next sample, in order.
+ * @return Output data rate the device should run at.
+ */
+hscdtd_odr_t hscdtd_adapt_update(hscdtd_adapt_t *p_adapt,
+                                 const hscdtd_sample_t *p_sample)
+{
+    hscdtd_adapt_config_t *p_config = &p_adapt->config;
+    uint32_t elapsed, change, d;
+
+    if (!p_adapt->anchored) {
+        p_adapt->anchor = p_sample->raw;
+        p_adapt->anchor_us = p_sample->timestamp_us;
+        p_adapt->active_us = p_sample->timestamp_us;
+        p_adapt->anchored = 1;
+        return p_adapt->odr;
+    }
+
+    elapsed = p_sample->timestamp_us - p_adapt->anchor_us;
+    if (elapsed < p_config->window_us)
+        return p_adapt->odr;
+
+    change = abs_diff(p_sample->raw.mag_x, p_adapt->anchor.mag_x);
+    d = abs_diff(p_sample->raw.mag_y, p_adapt->anchor.mag_y);
+    if (d > change)
+        change = d;
+    d = abs_diff(p_sample->raw.mag_z, p_adapt->anchor.mag_z);
+    if (d > change)
+        change = d;
+    p_adapt->rate_nt_s = (uint32_t) ((uint64_t) change *
+                                     HSCDTD_NT_PER_LSB_15B * 1000000UL /
+                                     elapsed);
+    p_adapt->anchor = p_sample->raw;
+    p_adapt->anchor_us = p_sample->timestamp_us;
+
+    if (p_adapt->rate_nt_s >= p_config->fall_nt_s)
+        p_adapt->active_us = p_sample->timestamp_us;
+
+    if (p_adapt->rate_nt_s >= p_config->rise_nt_s)
+        p_adapt->odr = p_config->odr_high;
+    else if (p_sample->timestamp_us - p_adapt->active_us >= p_config->hold_us)
+        p_adapt->odr = p_config->odr_low;
+    return p_adapt->odr;
+}
+
+
+/**
+ * @brief Set the rate the device runs at.
+ *
+ * For a change that did not come from hscdtd_adapt_update, or one that
+ * failed. The hold time starts again.
+ *
+ * @param p_adapt Pointer to adaptive rate struct.
+ * @param odr Output data rate of the device.
+ */
+void hscdtd_adapt_set_odr(hscdtd_adapt_t *p_adapt, hscdtd_odr_t odr)
+{
+    p_adapt->odr = odr;
+    p_adapt->anchored = 0;
+}
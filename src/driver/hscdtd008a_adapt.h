@@ -0,0 +1,73 @@
+#ifndef __HSCDTD008A_ADAPT__
+#define __HSCDTD008A_ADAPT__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+
+/**
+ * Output data rate that follows the signal.
+ *
+ * The rate of change of the field is measured over windows of at least
+ * window_us, as the largest change of an axis from the first to the last
+ * sample of the window, per second. Over a fixed window the noise of
+ * consecutive samples stays small against the thresholds at every output
+ * data rate.
+ *
+ * A window above rise_nt_s switches to odr_high. The rate falls back to
+ * odr_low once the windows stayed below fall_nt_s for hold_us. The gap
+ * between the thresholds and the hold time keep the rate from flapping.
+ *
+ * hscdtd_stream_config_t.p_adapt makes a stream adaptive, the state can
+ * also be fed with samples from any other loop.
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct {
+    hscdtd_odr_t odr_low;
+    hscdtd_odr_t odr_high;
+    // Rates of change in nT/s, fall_nt_s below rise_nt_s.
+    uint32_t rise_nt_s;
+    uint32_t fall_nt_s;
+    uint32_t window_us;
+    uint32_t hold_us;
+} hscdtd_adapt_config_t;
+
+// 10Hz when static, 100Hz from ~20uT/s, ~25 deg/s in the earth field.
+#define HSCDTD_ADAPT_CONFIG_DEFAULT \
+    {HSCDTD_ODR_10HZ, HSCDTD_ODR_100HZ, 20000, 5000, 200000, 5000000}
+
+
+typedef struct {
+    hscdtd_adapt_config_t config;
+    // Rate the state asks for.
+    hscdtd_odr_t odr;
+
+    // First sample of the current window.
+    hscdtd_mag_raw_t anchor;
+    uint32_t anchor_us;
+    uint8_t anchored;
+    // Last window at or above fall_nt_s.
+    uint32_t active_us;
+    // Rate of change of the last window.
+    uint32_t rate_nt_s;
+} hscdtd_adapt_t;
+
+
+hscdtd_status_t hscdtd_adapt_init(hscdtd_adapt_t *p_adapt,
+                                  const hscdtd_adapt_config_t *p_config);
+
+hscdtd_odr_t hscdtd_adapt_update(hscdtd_adapt_t *p_adapt,
+                                 const hscdtd_sample_t *p_sample);
+
+void hscdtd_adapt_set_odr(hscdtd_adapt_t *p_adapt, hscdtd_odr_t odr);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_ADAPT__
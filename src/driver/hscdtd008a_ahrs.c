@@ -0,0 +1,686 @@
+#include <math.h>
+#include <string.h>
+#include "hscdtd008a_ahrs.h"
+
+#define AHRS_SEEN_GYRO                  0x01
+#define AHRS_SEEN_ACCEL                 0x02
+#define AHRS_SEEN_MAG                   0x04
+
+#define Q30_ONE                         (1L << 30)
+#define Q30_HALF                        (1L << 29)
+#define Q30_MUL(a, b)                   ((int32_t) (((int64_t) (a) * (b)) >> 30))
+
+// mdps to rad/s Q16: pi / 180000 * 2^32, applied with a shift of 16.
+#define MDPS_TO_RAD_Q16                 74961
+// us to s Q30: 2^38 / 10^6, applied with a shift of 8.
+#define US_TO_S_Q38                     274878
+
+
+/**
+ * @brief Check the timestamp of a sample, advance the clock of the state.
+ *
+ * @param p_clock Pointer to clock of the filter.
+ * @param p_config Pointer to configuration of the filter.
+ * @param source AHRS_SEEN_* of the sample.
+ * @param timestamp_us Timestamp of the sample.
+ * @param p_dt_us Time since the previous sample of the source, clamped to
+ *                max_dt_us, 0 for its first sample.
+ * @return 0 if the sample is late and must be dropped.
+ */
+static uint8_t ahrs_clock(hscdtd_ahrs_clock_t *p_clock,
+                          const hscdtd_ahrs_config_t *p_config,
+                          uint8_t source, uint32_t timestamp_us,
+                          uint32_t *p_dt_us)
+{
+    uint32_t *p_last = (source == AHRS_SEEN_GYRO) ? &p_clock->gyro_us :
+                       (source == AHRS_SEEN_ACCEL) ? &p_clock->accel_us :
+                       &p_clock->mag_us;
+    uint32_t dt = 0;
+
+    if (p_clock->seen) {
+        if ((int32_t) (p_clock->now_us - timestamp_us) >
+            (int32_t) p_config->max_dt_us)
+            return 0;
+    }
+    if (p_clock->seen & source) {
+        if ((int32_t) (timestamp_us - *p_last) <= 0)
+            return 0;
+        dt = timestamp_us - *p_last;
+        if (dt > p_config->max_dt_us)
+            dt = p_config->max_dt_us;
+    }
+
+    if (source == AHRS_SEEN_ACCEL && !(p_clock->seen & AHRS_SEEN_ACCEL)) {
+        p_clock->init_end_us = timestamp_us + p_config->init_us;
+        p_clock->converging = (p_config->init_us > 0);
+    }
+    if (!p_clock->seen || (int32_t) (timestamp_us - p_clock->now_us) > 0)
+        p_clock->now_us = timestamp_us;
+    if (p_clock->converging &&
+        (int32_t) (p_clock->now_us - p_clock->init_end_us) >= 0)
+        p_clock->converging = 0;
+
+    p_clock->seen |= source;
+    *p_last = timestamp_us;
+    *p_dt_us = dt;
+    return 1;
+}
+
+
+static hscdtd_status_t ahrs_check_config(const hscdtd_ahrs_config_t *p_config)
+{
+    if (p_config->kp < 0 || p_config->ki < 0 || p_config->init_gain == 0 ||
+        p_config->max_dt_us == 0 || p_config->max_dt_us > 1000000UL ||
+        p_config->init_us > 0x7FFFFFFFUL) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+    return HSCDTD_STAT_OK;
+}
+
+
+// q += 0.5 * q * (0, d) for an angle d in rad, then normalize.
+static void ahrs_rotate(float *q, float dx, float dy, float dz)
+{
+    float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    float n, inv;
+
+    dx *= 0.5f;
+    dy *= 0.5f;
+    dz *= 0.5f;
+    q[0] = q0 - q1 * dx - q2 * dy - q3 * dz;
+    q[1] = q1 + q0 * dx + q2 * dz - q3 * dy;
+    q[2] = q2 + q0 * dy - q1 * dz + q3 * dx;
+    q[3] = q3 + q0 * dz + q1 * dy - q2 * dx;
+
+    // Steps are small, 1 / sqrt(n) to first order saves a soft-float
+    // square root and division per step.
+    n = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+    if (n > 0.99f && n < 1.01f)
+        inv = 1.5f - 0.5f * n;
+    else
+        inv = 1.0f / sqrtf(n);
+    q[0] *= inv;
+    q[1] *= inv;
+    q[2] *= inv;
+    q[3] *= inv;
+}
+
+
+// Unit vector, 0 for a zero vector.
+static uint8_t ahrs_unit(const hscdtd_vec3_t *p_in, float *p_out)
+{
+    float n = p_in->x * p_in->x + p_in->y * p_in->y + p_in->z * p_in->z;
+
+    if (n <= 0.0f)
+        return 0;
+    n = 1.0f / sqrtf(n);
+    p_out[0] = p_in->x * n;
+    p_out[1] = p_in->y * n;
+    p_out[2] = p_in->z * n;
+    return 1;
+}
+
+
+// Estimated direction of up in the body frame.
+static void ahrs_up(const float *q, float *p_v)
+{
+    p_v[0] = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    p_v[1] = 2.0f * (q[0] * q[1] + q[2] * q[3]);
+    p_v[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+}
+
+
+// Rotate towards the measurement by kp * e * dt, integrate e into the bias.
+static void ahrs_correct(hscdtd_ahrs_t *p_ahrs, const float *p_e,
+                         uint32_t dt_us)
+{
+    float dt = (float) dt_us * 1e-6f;
+    float kp = p_ahrs->kp;
+    uint8_t i;
+
+    if (dt_us == 0)
+        return;
+    if (p_ahrs->clock.converging) {
+        kp *= p_ahrs->config.init_gain;
+    } else if (p_ahrs->ki > 0.0f) {
+        for (i = 0; i < HSCDTD_NUM_AXIS; i++)
+            p_ahrs->bias[i] += p_ahrs->ki * p_e[i] * dt;
+    }
+    kp *= dt;
+    ahrs_rotate(p_ahrs->q, kp * p_e[0], kp * p_e[1], kp * p_e[2]);
+}
+
+
+/**
+ * @brief Initialize a float orientation filter, level and facing north.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_config Gains and step limits.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_ahrs_init(hscdtd_ahrs_t *p_ahrs,
+                                 const hscdtd_ahrs_config_t *p_config)
+{
+    hscdtd_status_t status;
+
+    if (!p_ahrs || !p_config) {
+        return HSCDTD_STAT_ERROR;
+    }
+    status = ahrs_check_config(p_config);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    memset(p_ahrs, 0, sizeof(hscdtd_ahrs_t));
+    p_ahrs->config = *p_config;
+    p_ahrs->kp = (float) p_config->kp * (1.0f / 65536.0f);
+    p_ahrs->ki = (float) p_config->ki * (1.0f / 65536.0f);
+    p_ahrs->q[0] = 1.0f;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Integrate a gyroscope sample.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_rad_s Angular rate in rad/s.
+ * @param timestamp_us Time of the sample.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the sample was late.
+ */
+hscdtd_status_t hscdtd_ahrs_gyro(hscdtd_ahrs_t *p_ahrs,
+                                 const hscdtd_vec3_t *p_rad_s,
+                                 uint32_t timestamp_us)
+{
+    uint32_t dt_us;
+    float dt;
+
+    if (!ahrs_clock(&p_ahrs->clock, &p_ahrs->config, AHRS_SEEN_GYRO,
+                    timestamp_us, &dt_us))
+        return HSCDTD_STAT_NO_DATA;
+    if (dt_us == 0)
+        return HSCDTD_STAT_OK;
+
+    dt = (float) dt_us * 1e-6f;
+    ahrs_rotate(p_ahrs->q, (p_rad_s->x + p_ahrs->bias[0]) * dt,
+                (p_rad_s->y + p_ahrs->bias[1]) * dt,
+                (p_rad_s->z + p_ahrs->bias[2]) * dt);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Correct the tilt with an accelerometer sample.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_accel Acceleration, any unit.
+ * @param timestamp_us Time of the sample.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the sample was late or zero.
+ */
+hscdtd_status_t hscdtd_ahrs_accel(hscdtd_ahrs_t *p_ahrs,
+                                  const hscdtd_vec3_t *p_accel,
+                                  uint32_t timestamp_us)
+{
+    uint32_t dt_us;
+    float a[3], v[3], e[3];
+
+    if (!ahrs_unit(p_accel, a))
+        return HSCDTD_STAT_NO_DATA;
+    if (!ahrs_clock(&p_ahrs->clock, &p_ahrs->config, AHRS_SEEN_ACCEL,
+                    timestamp_us, &dt_us))
+        return HSCDTD_STAT_NO_DATA;
+
+    ahrs_up(p_ahrs->q, v);
+    e[0] = a[1] * v[2] - a[2] * v[1];
+    e[1] = a[2] * v[0] - a[0] * v[2];
+    e[2] = a[0] * v[1] - a[1] * v[0];
+    ahrs_correct(p_ahrs, e, dt_us);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Correct the heading with a magnetometer sample.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_mag Magnetic field, any unit, hard-iron offset removed.
+ * @param timestamp_us Time of the sample.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the sample was late or zero.
+ */
+hscdtd_status_t hscdtd_ahrs_mag(hscdtd_ahrs_t *p_ahrs,
+                                const hscdtd_vec3_t *p_mag,
+                                uint32_t timestamp_us)
+{
+    const float *q = p_ahrs->q;
+    uint32_t dt_us;
+    float m[3], v[3], e[3];
+    float q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;
+    float hx, hy, bx, bz, wx, wy, wz, s;
+
+    if (!ahrs_unit(p_mag, m))
+        return HSCDTD_STAT_NO_DATA;
+    if (!ahrs_clock(&p_ahrs->clock, &p_ahrs->config, AHRS_SEEN_MAG,
+                    timestamp_us, &dt_us))
+        return HSCDTD_STAT_NO_DATA;
+
+    q0q1 = q[0] * q[1];
+    q0q2 = q[0] * q[2];
+    q0q3 = q[0] * q[3];
+    q1q1 = q[1] * q[1];
+    q1q2 = q[1] * q[2];
+    q1q3 = q[1] * q[3];
+    q2q2 = q[2] * q[2];
+    q2q3 = q[2] * q[3];
+    q3q3 = q[3] * q[3];
+
+    // Field in the earth frame, rotated onto the x-z plane: the reference
+    // direction of north.
+    hx = 2.0f * (m[0] * (0.5f - q2q2 - q3q3) + m[1] * (q1q2 - q0q3) +
+                 m[2] * (q1q3 + q0q2));
+    hy = 2.0f * (m[0] * (q1q2 + q0q3) + m[1] * (0.5f - q1q1 - q3q3) +
+                 m[2] * (q2q3 - q0q1));
+    bz = 2.0f * (m[0] * (q1q3 - q0q2) + m[1] * (q2q3 + q0q1) +
+                 m[2] * (0.5f - q1q1 - q2q2));
+    bx = sqrtf(hx * hx + hy * hy);
+
+    // Reference back in the body frame.
+    wx = 2.0f * (bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2));
+    wy = 2.0f * (bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3));
+    wz = 2.0f * (bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2));
+
+    // Only the rotation about the vertical.
+    ahrs_up(q, v);
+    s = (m[1] * wz - m[2] * wy) * v[0] + (m[2] * wx - m[0] * wz) * v[1] +
+        (m[0] * wy - m[1] * wx) * v[2];
+    e[0] = s * v[0];
+    e[1] = s * v[1];
+    e[2] = s * v[2];
+    ahrs_correct(p_ahrs, e, dt_us);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Correct the heading with a sample of the driver.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_sample Sample, output registers with the offset applied.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the sample was late or zero.
+ */
+hscdtd_status_t hscdtd_ahrs_mag_sample(hscdtd_ahrs_t *p_ahrs,
+                                       const hscdtd_sample_t *p_sample)
+{
+    hscdtd_vec3_t mag;
+
+    mag.x = p_sample->raw.mag_x;
+    mag.y = p_sample->raw.mag_y;
+    mag.z = p_sample->raw.mag_z;
+    return hscdtd_ahrs_mag(p_ahrs, &mag, p_sample->timestamp_us);
+}
+
+
+/**
+ * @brief Orientation as roll, pitch and yaw.
+ *
+ * Rotations about x, then y, then z of the earth frame. Yaw is
+ * counterclockwise from magnetic north seen from above.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_deg Roll in x, pitch in y, yaw in z, in degrees.
+ * @param mode atan2 implementation, see hscdtd_atan2_deg.
+ */
+void hscdtd_ahrs_euler(const hscdtd_ahrs_t *p_ahrs, hscdtd_vec3_t *p_deg,
+                       hscdtd_atan2_mode_t mode)
+{
+    const float *q = p_ahrs->q;
+    float s, c;
+
+    p_deg->x = hscdtd_atan2_deg(2.0f * (q[0] * q[1] + q[2] * q[3]),
+                                1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2]),
+                                mode);
+    s = 2.0f * (q[0] * q[2] - q[1] * q[3]);
+    if (s > 1.0f)
+        s = 1.0f;
+    if (s < -1.0f)
+        s = -1.0f;
+    c = sqrtf(1.0f - s * s);
+    p_deg->y = hscdtd_atan2_deg(s, c, mode);
+    p_deg->z = hscdtd_atan2_deg(2.0f * (q[0] * q[3] + q[1] * q[2]),
+                                1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3]),
+                                mode);
+}
+
+
+// Integer square root.
+static uint32_t fx_isqrt(uint32_t x)
+{
+    uint32_t res = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit) {
+        if (x >= res + bit) {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+
+static int32_t fx_dt_q30(uint32_t dt_us)
+{
+    return (int32_t) (((uint64_t) dt_us * US_TO_S_Q38) >> 8);
+}
+
+
+// q += q * (0, d) for a half angle d in Q30, then normalize.
+static void fx_rotate(int32_t *q, int32_t dx, int32_t dy, int32_t dz)
+{
+    int32_t q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    int32_t n, f;
+    uint8_t i;
+
+    q[0] = q0 - Q30_MUL(q1, dx) - Q30_MUL(q2, dy) - Q30_MUL(q3, dz);
+    q[1] = q1 + Q30_MUL(q0, dx) + Q30_MUL(q2, dz) - Q30_MUL(q3, dy);
+    q[2] = q2 + Q30_MUL(q0, dy) - Q30_MUL(q1, dz) + Q30_MUL(q3, dx);
+    q[3] = q3 + Q30_MUL(q0, dz) + Q30_MUL(q1, dy) - Q30_MUL(q2, dx);
+
+    // Newton steps of 1 / sqrt(n) once the norm is off by 1e-6, small
+    // steps skip them.
+    for (i = 0; i < 4; i++) {
+        n = Q30_MUL(q[0], q[0]) + Q30_MUL(q[1], q[1]) +
+            Q30_MUL(q[2], q[2]) + Q30_MUL(q[3], q[3]);
+        if (n - Q30_ONE < 1024 && n - Q30_ONE > -1024)
+            break;
+        f = Q30_ONE + ((Q30_ONE - n) >> 1);
+        q[0] = Q30_MUL(q[0], f);
+        q[1] = Q30_MUL(q[1], f);
+        q[2] = Q30_MUL(q[2], f);
+        q[3] = Q30_MUL(q[3], f);
+    }
+}
+
+
+// Unit vector in Q30, 0 for a zero vector.
+static uint8_t fx_unit(const hscdtd_vec3_i32_t *p_in, int32_t *p_out)
+{
+    int32_t v[3];
+    uint32_t m = 0, a, s, n, r;
+    uint8_t i;
+
+    v[0] = p_in->x;
+    v[1] = p_in->y;
+    v[2] = p_in->z;
+    for (i = 0; i < 3; i++) {
+        a = (v[i] < 0) ? 0UL - (uint32_t) v[i] : (uint32_t) v[i];
+        if (a > m)
+            m = a;
+    }
+    if (m == 0)
+        return 0;
+
+    // Largest component to 15 bits, so the sum of squares fits 32 bits.
+    while (m >= 0x8000UL) {
+        for (i = 0; i < 3; i++)
+            v[i] /= 2;
+        m >>= 1;
+    }
+    while (m < 0x4000UL) {
+        for (i = 0; i < 3; i++)
+            v[i] *= 2;
+        m <<= 1;
+    }
+    s = (uint32_t) (v[0] * v[0]) + (uint32_t) (v[1] * v[1]) +
+        (uint32_t) (v[2] * v[2]);
+    n = fx_isqrt(s);
+    r = 0xFFFFFFFFUL / n;
+    for (i = 0; i < 3; i++)
+        p_out[i] = (int32_t) (((int64_t) v[i] * r) >> 2);
+    return 1;
+}
+
+
+static void fx_up(const int32_t *q, int32_t *p_v)
+{
+    p_v[0] = 2 * (Q30_MUL(q[1], q[3]) - Q30_MUL(q[0], q[2]));
+    p_v[1] = 2 * (Q30_MUL(q[0], q[1]) + Q30_MUL(q[2], q[3]));
+    p_v[2] = Q30_MUL(q[0], q[0]) - Q30_MUL(q[1], q[1]) -
+             Q30_MUL(q[2], q[2]) + Q30_MUL(q[3], q[3]);
+}
+
+
+static void fx_correct(hscdtd_ahrs_fx_t *p_ahrs, const int32_t *p_e,
+                       uint32_t dt_us)
+{
+    int32_t dt = fx_dt_q30(dt_us);
+    int32_t kp = p_ahrs->config.kp;
+    int32_t d[3];
+    uint8_t i;
+
+    if (dt_us == 0)
+        return;
+    if (p_ahrs->clock.converging) {
+        kp *= p_ahrs->config.init_gain;
+    } else if (p_ahrs->config.ki > 0) {
+        for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+            p_ahrs->bias[i] += Q30_MUL(
+                ((int64_t) p_e[i] * p_ahrs->config.ki) >> 16, dt);
+        }
+    }
+    // kp * e in rad/s Q16, times dt / 2.
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++)
+        d[i] = (int32_t) ((((((int64_t) p_e[i] * kp) >> 30)) * dt) >> 17);
+    fx_rotate(p_ahrs->q, d[0], d[1], d[2]);
+}
+
+
+/**
+ * @brief Initialize a fixed-point orientation filter, level and facing north.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_config Gains and step limits.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_ahrs_fx_init(hscdtd_ahrs_fx_t *p_ahrs,
+                                    const hscdtd_ahrs_config_t *p_config)
+{
+    hscdtd_status_t status;
+
+    if (!p_ahrs || !p_config) {
+        return HSCDTD_STAT_ERROR;
+    }
+    status = ahrs_check_config(p_config);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+    // kp * init_gain * 2 must stay a Q16 rate.
+    if ((int64_t) p_config->kp * p_config->init_gain > 0x3FFFFFFFL) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    memset(p_ahrs, 0, sizeof(hscdtd_ahrs_fx_t));
+    p_ahrs->config = *p_config;
+    p_ahrs->q[0] = Q30_ONE;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Integrate a gyroscope sample.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_mdps Angular rate in millidegrees per second, at most 2^31 / 75.
+ * @param timestamp_us Time of the sample.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the sample was late.
+ */
+hscdtd_status_t hscdtd_ahrs_fx_gyro(hscdtd_ahrs_fx_t *p_ahrs,
+                                    const hscdtd_vec3_i32_t *p_mdps,
+                                    uint32_t timestamp_us)
+{
+    uint32_t dt_us;
+    int32_t dt, w[3], d[3];
+    uint8_t i;
+
+    if (!ahrs_clock(&p_ahrs->clock, &p_ahrs->config, AHRS_SEEN_GYRO,
+                    timestamp_us, &dt_us))
+        return HSCDTD_STAT_NO_DATA;
+    if (dt_us == 0)
+        return HSCDTD_STAT_OK;
+
+    dt = fx_dt_q30(dt_us);
+    w[0] = p_mdps->x;
+    w[1] = p_mdps->y;
+    w[2] = p_mdps->z;
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+        // rad/s Q16, plus the bias, times dt / 2.
+        w[i] = (int32_t) (((int64_t) w[i] * MDPS_TO_RAD_Q16) >> 16) +
+               (p_ahrs->bias[i] >> 14);
+        d[i] = (int32_t) (((int64_t) w[i] * dt) >> 17);
+    }
+    fx_rotate(p_ahrs->q, d[0], d[1], d[2]);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Correct the tilt with an accelerometer sample.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_accel Acceleration, any unit.
+ * @param timestamp_us Time of the sample.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the sample was late or zero.
+ */
+hscdtd_status_t hscdtd_ahrs_fx_accel(hscdtd_ahrs_fx_t *p_ahrs,
+                                     const hscdtd_vec3_i32_t *p_accel,
+                                     uint32_t timestamp_us)
+{
+    uint32_t dt_us;
+    int32_t a[3], v[3], e[3];
+
+    if (!fx_unit(p_accel, a))
+        return HSCDTD_STAT_NO_DATA;
+    if (!ahrs_clock(&p_ahrs->clock, &p_ahrs->config, AHRS_SEEN_ACCEL,
+                    timestamp_us, &dt_us))
+        return HSCDTD_STAT_NO_DATA;
+
+    fx_up(p_ahrs->q, v);
+    e[0] = Q30_MUL(a[1], v[2]) - Q30_MUL(a[2], v[1]);
+    e[1] = Q30_MUL(a[2], v[0]) - Q30_MUL(a[0], v[2]);
+    e[2] = Q30_MUL(a[0], v[1]) - Q30_MUL(a[1], v[0]);
+    fx_correct(p_ahrs, e, dt_us);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Correct the heading with a magnetometer sample.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_mag Magnetic field, any unit, hard-iron offset removed.
+ * @param timestamp_us Time of the sample.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the sample was late or zero.
+ */
+hscdtd_status_t hscdtd_ahrs_fx_mag(hscdtd_ahrs_fx_t *p_ahrs,
+                                   const hscdtd_vec3_i32_t *p_mag,
+                                   uint32_t timestamp_us)
+{
+    const int32_t *q = p_ahrs->q;
+    uint32_t dt_us;
+    int32_t m[3], v[3], e[3];
+    int32_t q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;
+    int32_t hx, hy, bx, bz, wx, wy, wz, s;
+
+    if (!fx_unit(p_mag, m))
+        return HSCDTD_STAT_NO_DATA;
+    if (!ahrs_clock(&p_ahrs->clock, &p_ahrs->config, AHRS_SEEN_MAG,
+                    timestamp_us, &dt_us))
+        return HSCDTD_STAT_NO_DATA;
+
+    q0q1 = Q30_MUL(q[0], q[1]);
+    q0q2 = Q30_MUL(q[0], q[2]);
+    q0q3 = Q30_MUL(q[0], q[3]);
+    q1q1 = Q30_MUL(q[1], q[1]);
+    q1q2 = Q30_MUL(q[1], q[2]);
+    q1q3 = Q30_MUL(q[1], q[3]);
+    q2q2 = Q30_MUL(q[2], q[2]);
+    q2q3 = Q30_MUL(q[2], q[3]);
+    q3q3 = Q30_MUL(q[3], q[3]);
+
+    // As hscdtd_ahrs_mag, every sum in the brackets stays within 1/2.
+    hx = 2 * (Q30_MUL(m[0], Q30_HALF - q2q2 - q3q3) +
+              Q30_MUL(m[1], q1q2 - q0q3) + Q30_MUL(m[2], q1q3 + q0q2));
+    hy = 2 * (Q30_MUL(m[0], q1q2 + q0q3) +
+              Q30_MUL(m[1], Q30_HALF - q1q1 - q3q3) +
+              Q30_MUL(m[2], q2q3 - q0q1));
+    bz = 2 * (Q30_MUL(m[0], q1q3 - q0q2) + Q30_MUL(m[1], q2q3 + q0q1) +
+              Q30_MUL(m[2], Q30_HALF - q1q1 - q2q2));
+    bx = (int32_t) (fx_isqrt((uint32_t) (Q30_MUL(hx, hx) +
+                                         Q30_MUL(hy, hy))) << 15);
+
+    wx = 2 * (Q30_MUL(bx, Q30_HALF - q2q2 - q3q3) +
+              Q30_MUL(bz, q1q3 - q0q2));
+    wy = 2 * (Q30_MUL(bx, q1q2 - q0q3) + Q30_MUL(bz, q0q1 + q2q3));
+    wz = 2 * (Q30_MUL(bx, q0q2 + q1q3) +
+              Q30_MUL(bz, Q30_HALF - q1q1 - q2q2));
+
+    fx_up(q, v);
+    s = Q30_MUL(Q30_MUL(m[1], wz) - Q30_MUL(m[2], wy), v[0]) +
+        Q30_MUL(Q30_MUL(m[2], wx) - Q30_MUL(m[0], wz), v[1]) +
+        Q30_MUL(Q30_MUL(m[0], wy) - Q30_MUL(m[1], wx), v[2]);
+    e[0] = Q30_MUL(s, v[0]);
+    e[1] = Q30_MUL(s, v[1]);
+    e[2] = Q30_MUL(s, v[2]);
+    fx_correct(p_ahrs, e, dt_us);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Correct the heading with a sample of the driver.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_sample Sample, output registers with the offset applied.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the sample was late or zero.
+ */
+hscdtd_status_t hscdtd_ahrs_fx_mag_sample(hscdtd_ahrs_fx_t *p_ahrs,
+                                          const hscdtd_sample_t *p_sample)
+{
+    hscdtd_vec3_i32_t mag;
+
+    mag.x = p_sample->raw.mag_x;
+    mag.y = p_sample->raw.mag_y;
+    mag.z = p_sample->raw.mag_z;
+    return hscdtd_ahrs_fx_mag(p_ahrs, &mag, p_sample->timestamp_us);
+}
+
+
+/**
+ * @brief Orientation as roll, pitch and yaw, see hscdtd_ahrs_euler.
+ *
+ * @param p_ahrs Pointer to filter struct.
+ * @param p_mdeg Roll in x, pitch in y, yaw in z, in millidegrees.
+ */
+void hscdtd_ahrs_fx_euler(const hscdtd_ahrs_fx_t *p_ahrs,
+                          hscdtd_vec3_i32_t *p_mdeg)
+{
+    const int32_t *q = p_ahrs->q;
+    int32_t s, c;
+
+    // CORDIC takes inputs below 2^29.
+    p_mdeg->x = hscdtd_atan2_cordic_mdeg(
+        (Q30_MUL(q[0], q[1]) + Q30_MUL(q[2], q[3])) >> 1,
+        (Q30_HALF - Q30_MUL(q[1], q[1]) - Q30_MUL(q[2], q[2])) >> 1);
+    s = 2 * (Q30_MUL(q[0], q[2]) - Q30_MUL(q[1], q[3]));
+    if (s > Q30_ONE)
+        s = Q30_ONE;
+    if (s < -Q30_ONE)
+        s = -Q30_ONE;
+    c = (int32_t) (fx_isqrt((uint32_t) (Q30_ONE - Q30_MUL(s, s))) << 15);
+    p_mdeg->y = hscdtd_atan2_cordic_mdeg(s >> 2, c >> 2);
+    p_mdeg->z = hscdtd_atan2_cordic_mdeg(
+        (Q30_MUL(q[0], q[3]) + Q30_MUL(q[1], q[2])) >> 1,
+        (Q30_HALF - Q30_MUL(q[2], q[2]) - Q30_MUL(q[3], q[3])) >> 1);
+}
@@ -0,0 +1,151 @@
+#ifndef __HSCDTD008A_AHRS__
+#define __HSCDTD008A_AHRS__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+#include "hscdtd008a_heading.h"
+
+/**
+ * Orientation filter fusing the magnetometer with an external accelerometer
+ * and gyroscope (Mahony complementary filter on a quaternion).
+ *
+ * Every source is fed on its own, at its own rate, with its own timestamp
+ * on the clock of the transport (transport_now_us, or a clock with the same
+ * epoch). Gyroscope samples integrate the orientation over the time since
+ * the previous gyroscope sample. An accelerometer or magnetometer sample
+ * rotates the orientation towards the measured direction once, scaled by
+ * the time since the previous sample of that source, so the correction per
+ * second does not depend on the rate of a source. Samples older than the
+ * state by more than max_dt_us, or older than the previous sample of their
+ * source, are dropped.
+ *
+ * The magnetometer only corrects the heading: its error is projected on the
+ * estimated vertical, so a disturbed field does not tilt the estimate.
+ * Apply the hard-iron offset (hscdtd008a_calib.h) before feeding it.
+ *
+ * All vectors must be in the same body frame, rotate the IMU axes onto those
+ * of the sensor. The earth frame is x to magnetic north, y west, z up: at
+ * rest the accelerometer reads +1g on the axis pointing up. Only directions
+ * are used, so the accelerometer and magnetometer can be in any unit.
+ *
+ * hscdtd_ahrs_t runs in float. hscdtd_ahrs_fx_t runs in integers only (Q30
+ * quaternion, 64 bit products), for targets without FPU and builds with
+ * HSCDTD_FIXED_POINT. Run Example10_AHRS_Benchmark for the cost of each on a
+ * target.
+ */
+
+// Gain in rad/s per unit of error, as Q16 for hscdtd_ahrs_config_t.
+#define HSCDTD_AHRS_GAIN(x)             ((int32_t) ((x) * 65536.0 + 0.5))
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct {
+    // Proportional and integral gain of the correction, HSCDTD_AHRS_GAIN.
+    int32_t kp;
+    int32_t ki;
+    // After the first accelerometer sample, kp is multiplied by init_gain
+    // for init_us and the integral is held, to converge from any start.
+    uint8_t init_gain;
+    uint32_t init_us;
+    // Longest step integrated at once, a longer gap is clamped.
+    uint32_t max_dt_us;
+} hscdtd_ahrs_config_t;
+
+#define HSCDTD_AHRS_CONFIG_DEFAULT \
+    {HSCDTD_AHRS_GAIN(1.0), HSCDTD_AHRS_GAIN(0.02), 10, 2000000, 100000}
+
+
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t z;
+} hscdtd_vec3_i32_t;
+
+
+// Timestamps of the state, shared by both filters.
+typedef struct {
+    uint32_t now_us;
+    uint32_t gyro_us;
+    uint32_t accel_us;
+    uint32_t mag_us;
+    uint32_t init_end_us;
+    // Sources that gave a sample, one bit each.
+    uint8_t seen;
+    // Within init_us of the first accelerometer sample.
+    uint8_t converging;
+} hscdtd_ahrs_clock_t;
+
+
+typedef struct {
+    hscdtd_ahrs_config_t config;
+    float kp;
+    float ki;
+    // Orientation w, x, y, z, body to earth frame.
+    float q[4];
+    // Integral of the error, added to the gyroscope, in rad/s.
+    float bias[3];
+    hscdtd_ahrs_clock_t clock;
+} hscdtd_ahrs_t;
+
+
+typedef struct {
+    hscdtd_ahrs_config_t config;
+    // Orientation w, x, y, z in Q30, body to earth frame.
+    int32_t q[4];
+    // Integral of the error, added to the gyroscope, in rad/s Q30.
+    int32_t bias[3];
+    hscdtd_ahrs_clock_t clock;
+} hscdtd_ahrs_fx_t;
+
+
+hscdtd_status_t hscdtd_ahrs_init(hscdtd_ahrs_t *p_ahrs,
+                                 const hscdtd_ahrs_config_t *p_config);
+
+hscdtd_status_t hscdtd_ahrs_gyro(hscdtd_ahrs_t *p_ahrs,
+                                 const hscdtd_vec3_t *p_rad_s,
+                                 uint32_t timestamp_us);
+
+hscdtd_status_t hscdtd_ahrs_accel(hscdtd_ahrs_t *p_ahrs,
+                                  const hscdtd_vec3_t *p_accel,
+                                  uint32_t timestamp_us);
+
+hscdtd_status_t hscdtd_ahrs_mag(hscdtd_ahrs_t *p_ahrs,
+                                const hscdtd_vec3_t *p_mag,
+                                uint32_t timestamp_us);
+
+hscdtd_status_t hscdtd_ahrs_mag_sample(hscdtd_ahrs_t *p_ahrs,
+                                       const hscdtd_sample_t *p_sample);
+
+void hscdtd_ahrs_euler(const hscdtd_ahrs_t *p_ahrs, hscdtd_vec3_t *p_deg,
+                       hscdtd_atan2_mode_t mode);
+
+hscdtd_status_t hscdtd_ahrs_fx_init(hscdtd_ahrs_fx_t *p_ahrs,
+                                    const hscdtd_ahrs_config_t *p_config);
+
+hscdtd_status_t hscdtd_ahrs_fx_gyro(hscdtd_ahrs_fx_t *p_ahrs,
+                                    const hscdtd_vec3_i32_t *p_mdps,
+                                    uint32_t timestamp_us);
+
+hscdtd_status_t hscdtd_ahrs_fx_accel(hscdtd_ahrs_fx_t *p_ahrs,
+                                     const hscdtd_vec3_i32_t *p_accel,
+                                     uint32_t timestamp_us);
+
+hscdtd_status_t hscdtd_ahrs_fx_mag(hscdtd_ahrs_fx_t *p_ahrs,
+                                   const hscdtd_vec3_i32_t *p_mag,
+                                   uint32_t timestamp_us);
+
+hscdtd_status_t hscdtd_ahrs_fx_mag_sample(hscdtd_ahrs_fx_t *p_ahrs,
+                                          const hscdtd_sample_t *p_sample);
+
+void hscdtd_ahrs_fx_euler(const hscdtd_ahrs_fx_t *p_ahrs,
+                          hscdtd_vec3_i32_t *p_mdeg);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_AHRS__
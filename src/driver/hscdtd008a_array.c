@@ -0,0 +1,174 @@
+#include <string.h>
+#include "hscdtd008a_array.h"
+#include "hscdtd008a_reg.h"
+#include "transport.h"
+
+// Polling attempts before a sweep gives up on a device, ~1ms each.
+#define HSCDTD_ARRAY_POLL_ATTEMPTS      50
+
+
+/**
+ * @brief Initialize an empty sensor array.
+ *
+ * @param p_array Pointer to array struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_array_init(hscdtd_array_t *p_array)
+{
+    if (!p_array) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    memset(p_array, 0, sizeof(hscdtd_array_t));
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Add a device to the array.
+ *
+ * The device must be initialized and in the force state. Devices are
+ * triggered in the order they are added.
+ *
+ * @param p_array Pointer to array struct.
+ * @param p_dev Pointer to device struct.
+ * @param p_out Pointer to store the samples of this device.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_array_add(hscdtd_array_t *p_array,
+                                 hscdtd_device_t *p_dev,
+                                 hscdtd_sample_t *p_out)
+{
+    if (!p_array || !p_dev || !p_out) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (p_array->count >= HSCDTD_ARRAY_MAX_DEVICES || !p_dev->p_transport) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    p_array->p_devs[p_array->count] = p_dev;
+    p_array->p_out[p_array->count] = p_out;
+    p_array->count++;
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Take one aligned snapshot of all devices.
+ *
+ * The sweep runs in three phases so the conversions overlap:
+ *  1. Clear stale status bits of all devices.
+ *  2. Trigger all devices back-to-back, a single write each. If all
+ *     devices share a transport with batch support, all writes are one
+ *     bus transaction.
+ *  3. Poll for data ready, waiting once for the slowest device, and
+ *     collect the data of every device.
+ *
+ * Every sample is timestamped at the end of its own conversion, see
+ * hscdtd_data_ready.
+ *
+ * @param p_array Pointer to array struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_array_sweep(hscdtd_array_t *p_array)
+{
+    hscdtd_status_t status;
+    hscdtd_xfer_t xfers[HSCDTD_ARRAY_MAX_DEVICES];
+    hscdtd_device_t *p_first;
+    uint32_t pending, first_trigger, last_trigger;
+    uint8_t stat, trigger;
+    uint8_t i, attempt, shared;
+
+    if (!p_array) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (p_array->count == 0) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    // Reading the status register clears DRDY of an earlier conversion.
+    for (i = 0; i < p_array->count; i++) {
+        status = read_register(p_array->p_devs[i], HSCDTD_REG_STATUS, &stat);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+    }
+
+    // Devices on one transport that supports batches are triggered in a
+    // single bus transaction.
+    p_first = p_array->p_devs[0];
+    shared = p_first->p_transport->batch != 0;
+    for (i = 1; i < p_array->count; i++) {
+        if (p_array->p_devs[i]->p_transport != p_first->p_transport ||
+            p_array->p_devs[i]->p_transport_ctx != p_first->p_transport_ctx)
+            shared = 0;
+    }
+
+    // Nothing but the trigger writes between the first and last trigger.
+    first_trigger = transport_now_us(p_first);
+    if (shared) {
+        trigger = HSCDTD_CTRL3_FRC_MSK;
+        for (i = 0; i < p_array->count; i++) {
+            xfers[i].addr = p_array->p_devs[i]->addr;
+            xfers[i].reg = HSCDTD_REG_CTRL3;
+            xfers[i].length = 1;
+            xfers[i].read = 0;
+            xfers[i].p_buffer = &trigger;
+
+            // As hscdtd_force_trigger.
+            p_array->p_devs[i]->window_start_us = first_trigger;
+            p_array->p_devs[i]->window_valid = 1;
+            p_array->p_devs[i]->drdy_marked = 0;
+        }
+        status = transport_batch(p_first, xfers, p_array->count);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+    } else {
+        for (i = 0; i < p_array->count; i++) {
+            status = hscdtd_force_trigger(p_array->p_devs[i]);
+            if (status != HSCDTD_STAT_OK)
+                return status;
+        }
+    }
+    last_trigger = transport_now_us(p_first);
+
+    // Devices are polled in trigger order, the first device is the most
+    // likely to be ready. Each device is read as soon as it is ready.
+    pending = (1UL << p_array->count) - 1;
+    for (attempt = 0; attempt < HSCDTD_ARRAY_POLL_ATTEMPTS; attempt++) {
+        for (i = 0; i < p_array->count; i++) {
+            if (!(pending & (1UL << i)))
+                continue;
+
+            status = hscdtd_data_ready(p_array->p_devs[i]);
+            if (status == HSCDTD_STAT_NO_DATA)
+                continue;
+            if (status != HSCDTD_STAT_OK)
+                return status;
+
+            status = hscdtd_read_sample(p_array->p_devs[i], p_array->p_out[i]);
+            if (status != HSCDTD_STAT_OK)
+                return status;
+
+            pending &= ~(1UL << i);
+        }
+
+        if (!pending)
+            break;
+
+        transport_sleep_ms(p_first, 1);
+    }
+
+    if (pending)
+        return HSCDTD_STAT_NO_DATA;
+
+    p_array->trigger_skew_us = last_trigger - first_trigger;
+    if (p_array->trigger_skew_us > p_array->max_trigger_skew_us)
+        p_array->max_trigger_skew_us = p_array->trigger_skew_us;
+    p_array->sweep_time_us = transport_now_us(p_first) - first_trigger;
+    p_array->sweeps++;
+
+    return HSCDTD_STAT_OK;
+}
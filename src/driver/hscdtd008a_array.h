@@ -0,0 +1,46 @@
+#ifndef __HSCDTD008A_ARRAY__
+#define __HSCDTD008A_ARRAY__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+
+// Maximum number of devices in an array.
+#ifndef HSCDTD_ARRAY_MAX_DEVICES
+#define HSCDTD_ARRAY_MAX_DEVICES        8
+#endif  // HSCDTD_ARRAY_MAX_DEVICES
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct {
+    hscdtd_device_t *p_devs[HSCDTD_ARRAY_MAX_DEVICES];
+    hscdtd_sample_t *p_out[HSCDTD_ARRAY_MAX_DEVICES];
+    uint8_t count;
+
+    // Time between the first and the last trigger of the last sweep
+    // (upper bound, includes the duration of one trigger write). Times are
+    // taken from the transport of the first device.
+    uint32_t trigger_skew_us;
+    uint32_t max_trigger_skew_us;
+    // Duration of the last sweep, trigger to last read.
+    uint32_t sweep_time_us;
+    uint32_t sweeps;
+} hscdtd_array_t;
+
+
+hscdtd_status_t hscdtd_array_init(hscdtd_array_t *p_array);
+
+hscdtd_status_t hscdtd_array_add(hscdtd_array_t *p_array,
+                                 hscdtd_device_t *p_dev,
+                                 hscdtd_sample_t *p_out);
+
+hscdtd_status_t hscdtd_array_sweep(hscdtd_array_t *p_array);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_ARRAY__
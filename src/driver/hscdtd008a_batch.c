@@ -0,0 +1,287 @@
+#include <math.h>
+#include <string.h>
+#ifdef RPI
+#include <pthread.h>
+#endif  // RPI
+#include "hscdtd008a_batch.h"
+#include "hscdtd008a_capture.h"
+
+typedef struct {
+    const hscdtd_batch_t *p_batch;
+    const hscdtd_batch_params_t *p_params;
+    uint32_t next_chunk;
+    uint32_t n_chunks;
+} batch_job_t;
+
+
+/**
+ * @brief Process up to HSCDTD_BATCH_TILE samples.
+ *
+ * Every step is its own loop over the tile, without branches, so each
+ * vectorizes. The outputs that are left out cost nothing.
+ */
+static void batch_tile(const hscdtd_batch_t *p_batch,
+                       const hscdtd_batch_params_t *p_params,
+                       uint32_t first, uint32_t n)
+{
+    float fx[HSCDTD_BATCH_TILE];
+    float fy[HSCDTD_BATCH_TILE];
+    float fz[HSCDTD_BATCH_TILE];
+    const int16_t *restrict p_x = p_batch->p_x + first;
+    const int16_t *restrict p_y = p_batch->p_y + first;
+    const int16_t *restrict p_z = p_batch->p_z + first;
+    const float s = p_params->scale;
+    const float ox = p_params->offset[0];
+    const float oy = p_params->offset[1];
+    const float oz = p_params->offset[2];
+    const float m00 = p_params->soft_iron[0][0];
+    const float m01 = p_params->soft_iron[0][1];
+    const float m02 = p_params->soft_iron[0][2];
+    const float m10 = p_params->soft_iron[1][0];
+    const float m11 = p_params->soft_iron[1][1];
+    const float m12 = p_params->soft_iron[1][2];
+    const float m20 = p_params->soft_iron[2][0];
+    const float m21 = p_params->soft_iron[2][1];
+    const float m22 = p_params->soft_iron[2][2];
+    float *restrict p_out;
+    float x, y, z, ax, ay, a, t;
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        x = p_x[i] * s - ox;
+        y = p_y[i] * s - oy;
+        z = p_z[i] * s - oz;
+        fx[i] = m00 * x + m01 * y + m02 * z;
+        fy[i] = m10 * x + m11 * y + m12 * z;
+        fz[i] = m20 * x + m21 * y + m22 * z;
+    }
+
+    if (p_batch->p_field_x)
+        memcpy(p_batch->p_field_x + first, fx, n * sizeof(float));
+    if (p_batch->p_field_y)
+        memcpy(p_batch->p_field_y + first, fy, n * sizeof(float));
+    if (p_batch->p_field_z)
+        memcpy(p_batch->p_field_z + first, fz, n * sizeof(float));
+
+    if (p_batch->p_magnitude) {
+        p_out = p_batch->p_magnitude + first;
+        for (i = 0; i < n; i++)
+            p_out[i] = sqrtf(fx[i] * fx[i] + fy[i] * fy[i] + fz[i] * fz[i]);
+    }
+
+    if (p_batch->p_heading) {
+        // hscdtd_heading with HSCDTD_ATAN2_POLY, the octant reduction as
+        // selects instead of branches.
+        p_out = p_batch->p_heading + first;
+        for (i = 0; i < n; i++) {
+            x = fx[i];
+            y = -fy[i];
+            ax = (x < 0.0f) ? -x : x;
+            ay = (y < 0.0f) ? -y : y;
+            a = ((ay < ax) ? ay : ax) / (((ay < ax) ? ax : ay) + 1e-30f);
+            t = 45.0f * a - a * (a - 1.0f) * (14.0206f + 3.7987f * a);
+            t = (ay > ax) ? 90.0f - t : t;
+            t = (x < 0.0f) ? 180.0f - t : t;
+            p_out[i] = (y < 0.0f) ? 360.0f - t : t;
+        }
+    }
+}
+
+
+static uint8_t batch_next_chunk(batch_job_t *p_job, uint32_t *p_chunk)
+{
+#ifdef RPI
+    *p_chunk = __atomic_fetch_add(&p_job->next_chunk, 1, __ATOMIC_RELAXED);
+#else
+    *p_chunk = p_job->next_chunk++;
+#endif  // RPI
+    return *p_chunk < p_job->n_chunks;
+}
+
+
+static void batch_run(batch_job_t *p_job)
+{
+    uint32_t chunk, first, count;
+
+    while (batch_next_chunk(p_job, &chunk)) {
+        first = chunk * HSCDTD_BATCH_CHUNK;
+        count = p_job->p_batch->count - first;
+        if (count > HSCDTD_BATCH_CHUNK)
+            count = HSCDTD_BATCH_CHUNK;
+        hscdtd_batch_process_range(p_job->p_batch, p_job->p_params, first,
+                                   count);
+    }
+}
+
+
+#ifdef RPI
+static void *batch_thread(void *p_arg)
+{
+    batch_run((batch_job_t *) p_arg);
+    return NULL;
+}
+#endif  // RPI
+
+
+/**
+ * @brief Parameters that only convert LSB to uT.
+ *
+ * @param p_params Pointer to parameter struct.
+ * @param nt_per_lsb Resolution, hscdtd_capture_device_t.nt_per_lsb.
+ */
+void hscdtd_batch_params_init(hscdtd_batch_params_t *p_params,
+                              uint16_t nt_per_lsb)
+{
+    uint8_t i;
+
+    memset(p_params, 0, sizeof(hscdtd_batch_params_t));
+    p_params->scale = nt_per_lsb * 0.001f;
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++)
+        p_params->soft_iron[i][i] = 1.0f;
+}
+
+
+/**
+ * @brief Take the hard and soft-iron correction of a calibration.
+ *
+ * The offset applies to the samples as recorded: if the offset of the
+ * calibration was written to the sensor before the recording, clear
+ * offset again.
+ *
+ * @param p_params Pointer to parameter struct, scale already set.
+ * @param p_result Pointer to the result of hscdtd_calib_solve.
+ */
+void hscdtd_batch_params_calib(hscdtd_batch_params_t *p_params,
+                               const hscdtd_calib_result_t *p_result)
+{
+    memcpy(p_params->offset, p_result->offset, sizeof(p_params->offset));
+    memcpy(p_params->soft_iron, p_result->soft_iron,
+           sizeof(p_params->soft_iron));
+}
+
+
+/**
+ * @brief Process part of a batch in the calling thread.
+ *
+ * For callers with their own thread pool, ranges of different calls must
+ * not overlap.
+ *
+ * @param p_batch Pointer to batch struct.
+ * @param p_params Pointer to parameter struct.
+ * @param first Index of the first sample.
+ * @param count Number of samples.
+ */
+void hscdtd_batch_process_range(const hscdtd_batch_t *p_batch,
+                                const hscdtd_batch_params_t *p_params,
+                                uint32_t first, uint32_t count)
+{
+    uint32_t n;
+
+    while (count > 0) {
+        n = (count > HSCDTD_BATCH_TILE) ? HSCDTD_BATCH_TILE : count;
+        batch_tile(p_batch, p_params, first, n);
+        first += n;
+        count -= n;
+    }
+}
+
+
+/**
+ * @brief Process a batch.
+ *
+ * On RPI n_threads - 1 threads are started for the call and take chunks
+ * with the calling thread. If a thread cannot be started the others do
+ * its share. Elsewhere the calling thread processes every chunk.
+ *
+ * @param p_batch Pointer to batch struct.
+ * @param p_params Pointer to parameter struct.
+ * @param n_threads Threads including the caller, 1 to
+ *                  HSCDTD_BATCH_MAX_THREADS.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_batch_process(const hscdtd_batch_t *p_batch,
+                                     const hscdtd_batch_params_t *p_params,
+                                     uint8_t n_threads)
+{
+    batch_job_t job;
+#ifdef RPI
+    pthread_t threads[HSCDTD_BATCH_MAX_THREADS];
+    uint8_t started = 0;
+    uint8_t i;
+#endif  // RPI
+
+    if (!p_batch || !p_params) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_batch->count > 0 &&
+        (!p_batch->p_x || !p_batch->p_y || !p_batch->p_z)) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (n_threads == 0 || n_threads > HSCDTD_BATCH_MAX_THREADS) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    job.p_batch = p_batch;
+    job.p_params = p_params;
+    job.next_chunk = 0;
+    job.n_chunks = (uint32_t) (((uint64_t) p_batch->count +
+                                HSCDTD_BATCH_CHUNK - 1) / HSCDTD_BATCH_CHUNK);
+
+#ifdef RPI
+    if (n_threads > job.n_chunks)
+        n_threads = (uint8_t) ((job.n_chunks > 0) ? job.n_chunks : 1);
+    for (i = 1; i < n_threads; i++) {
+        if (pthread_create(&threads[started], NULL, batch_thread, &job) == 0)
+            started++;
+    }
+    batch_run(&job);
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+#else
+    batch_run(&job);
+#endif  // RPI
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Extract the samples of one device from capture records.
+ *
+ * For a capture opened with hscdtd_capture_open_read:
+ *   hscdtd_batch_decode(&reader.p_map[reader.header.header_size],
+ *                       reader.records, device, ...)
+ * Stops at the end marker of a capture that was not closed.
+ *
+ * @param p_records Encoded records, HSCDTD_CAPTURE_RECORD_SIZE bytes each.
+ * @param n_records Number of records.
+ * @param device Index in the device table of the capture.
+ * @param p_x Raw counts, room for n_records values.
+ * @param p_y Raw counts, room for n_records values.
+ * @param p_z Raw counts, room for n_records values.
+ * @param p_timestamp_us 64 bit times, room for n_records values, or NULL.
+ * @return Number of samples of the device.
+ */
+uint32_t hscdtd_batch_decode(const uint8_t *p_records, uint32_t n_records,
+                             uint8_t device, int16_t *p_x, int16_t *p_y,
+                             int16_t *p_z, uint64_t *p_timestamp_us)
+{
+    hscdtd_capture_record_t record;
+    uint32_t i, count = 0;
+
+    for (i = 0; i < n_records; i++) {
+        hscdtd_capture_decode_record(&p_records[i * HSCDTD_CAPTURE_RECORD_SIZE],
+                                     &record);
+        if (record.seq == 0)
+            break;
+        if (record.device != device)
+            continue;
+        p_x[count] = record.raw.mag_x;
+        p_y[count] = record.raw.mag_y;
+        p_z[count] = record.raw.mag_z;
+        if (p_timestamp_us)
+            p_timestamp_us[count] = record.timestamp_us;
+        count++;
+    }
+    return count;
+}
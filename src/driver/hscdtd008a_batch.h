@@ -0,0 +1,92 @@
+#ifndef __HSCDTD008A_BATCH__
+#define __HSCDTD008A_BATCH__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+#include "hscdtd008a_calib.h"
+
+/**
+ * Batch processing of recorded samples, for reprocessing captures after a
+ * change of the calibration.
+ *
+ * Samples are given as a structure of arrays of raw counts, every output
+ * is an array of its own and can be left out. One pass per sample:
+ *   field     = soft_iron * (raw * scale - offset)      in uT
+ *   magnitude = |field|
+ *   heading   = as hscdtd_heading of a level sensor, polynomial atan2
+ *               (HSCDTD_ATAN2_POLY, max error 0.09 deg)
+ * The samples are cut in chunks of HSCDTD_BATCH_CHUNK. Within a chunk the
+ * work is done in tiles that stay in the L1 cache, every step a loop
+ * without branches over the tile that the compiler vectorizes (-O3). On RPI
+ * chunks are spread over threads, elsewhere the caller processes them.
+ *
+ * hscdtd_batch_decode turns the records of a capture into these arrays.
+ */
+
+// Samples per chunk, the unit of work of a thread.
+#ifndef HSCDTD_BATCH_CHUNK
+#define HSCDTD_BATCH_CHUNK              16384
+#endif  // HSCDTD_BATCH_CHUNK
+
+// Samples per tile, the unit of a vectorized loop.
+#ifndef HSCDTD_BATCH_TILE
+#define HSCDTD_BATCH_TILE               256
+#endif  // HSCDTD_BATCH_TILE
+
+#ifndef HSCDTD_BATCH_MAX_THREADS
+#define HSCDTD_BATCH_MAX_THREADS        16
+#endif  // HSCDTD_BATCH_MAX_THREADS
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct {
+    // uT per LSB.
+    float scale;
+    // Hard-iron offset in uT, removed before the soft-iron matrix.
+    float offset[HSCDTD_NUM_AXIS];
+    float soft_iron[HSCDTD_NUM_AXIS][HSCDTD_NUM_AXIS];
+} hscdtd_batch_params_t;
+
+
+typedef struct {
+    // Raw counts, as recorded.
+    const int16_t *p_x;
+    const int16_t *p_y;
+    const int16_t *p_z;
+    // Outputs, 0 to skip.
+    float *p_field_x;
+    float *p_field_y;
+    float *p_field_z;
+    float *p_magnitude;
+    float *p_heading;
+    uint32_t count;
+} hscdtd_batch_t;
+
+
+void hscdtd_batch_params_init(hscdtd_batch_params_t *p_params,
+                              uint16_t nt_per_lsb);
+
+void hscdtd_batch_params_calib(hscdtd_batch_params_t *p_params,
+                               const hscdtd_calib_result_t *p_result);
+
+void hscdtd_batch_process_range(const hscdtd_batch_t *p_batch,
+                                const hscdtd_batch_params_t *p_params,
+                                uint32_t first, uint32_t count);
+
+hscdtd_status_t hscdtd_batch_process(const hscdtd_batch_t *p_batch,
+                                     const hscdtd_batch_params_t *p_params,
+                                     uint8_t n_threads);
+
+uint32_t hscdtd_batch_decode(const uint8_t *p_records, uint32_t n_records,
+                             uint8_t device, int16_t *p_x, int16_t *p_y,
+                             int16_t *p_z, uint64_t *p_timestamp_us);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_BATCH__
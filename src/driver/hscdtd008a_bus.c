@@ -0,0 +1,130 @@
+#include "hscdtd008a_bus.h"
+
+
+#ifndef HSCDTD_NO_PLATFORM_TRANSPORT
+hscdtd_bus_t hscdtd_platform_bus =
+    HSCDTD_BUS_INITIALIZER(&hscdtd_platform_transport, 0);
+#endif  // HSCDTD_NO_PLATFORM_TRANSPORT
+
+
+/**
+ * @brief Initialize a mutex.
+ *
+ * @param p_mutex Pointer to the mutex.
+ * @param recursive 1 if the owner may lock the mutex again.
+ */
+void hscdtd_mutex_init(hscdtd_mutex_t *p_mutex, uint8_t recursive)
+{
+#ifdef RPI
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    if (recursive)
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(p_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+#else
+    *p_mutex = 0;
+#endif  // RPI
+}
+
+
+/**
+ * @brief Lock a mutex.
+ *
+ * @param p_mutex Pointer to the mutex.
+ */
+void hscdtd_mutex_lock(hscdtd_mutex_t *p_mutex)
+{
+#ifdef RPI
+    pthread_mutex_lock(p_mutex);
+#endif  // RPI
+}
+
+
+/**
+ * @brief Unlock a mutex.
+ *
+ * @param p_mutex Pointer to the mutex.
+ */
+void hscdtd_mutex_unlock(hscdtd_mutex_t *p_mutex)
+{
+#ifdef RPI
+    pthread_mutex_unlock(p_mutex);
+#endif  // RPI
+}
+
+
+/**
+ * @brief Initialize a bus.
+ *
+ * Attach devices with hscdtd_attach_bus.
+ *
+ * @param p_bus Pointer to bus struct.
+ * @param p_transport Transport of the bus.
+ * @param p_ctx Context of the transport, for example the bus handle.
+ */
+void hscdtd_bus_init(hscdtd_bus_t *p_bus,
+                     const hscdtd_transport_t *p_transport,
+                     void *p_ctx)
+{
+    p_bus->p_transport = p_transport;
+    p_bus->p_transport_ctx = p_ctx;
+    hscdtd_mutex_init(&p_bus->lock, 0);
+    hscdtd_bus_reset_stats(p_bus);
+}
+
+
+/**
+ * @brief Take the bus for one transaction.
+ *
+ * The wait is only timed if the lock is taken, so an uncontended lock
+ * costs a single trylock.
+ *
+ * @param p_bus Pointer to bus struct.
+ */
+void hscdtd_bus_lock(hscdtd_bus_t *p_bus)
+{
+#ifdef RPI
+    uint32_t start, wait;
+
+    if (pthread_mutex_trylock(&p_bus->lock) != 0) {
+        start = p_bus->p_transport->now_us(p_bus->p_transport_ctx);
+        pthread_mutex_lock(&p_bus->lock);
+        wait = p_bus->p_transport->now_us(p_bus->p_transport_ctx) - start;
+
+        p_bus->contended++;
+        p_bus->wait_total_us += wait;
+        if (wait > p_bus->wait_max_us)
+            p_bus->wait_max_us = wait;
+    }
+    p_bus->acquisitions++;
+#endif  // RPI
+}
+
+
+/**
+ * @brief Release the bus.
+ *
+ * @param p_bus Pointer to bus struct.
+ */
+void hscdtd_bus_unlock(hscdtd_bus_t *p_bus)
+{
+#ifdef RPI
+    pthread_mutex_unlock(&p_bus->lock);
+#endif  // RPI
+}
+
+
+/**
+ * @brief Clear the lock statistics of a bus.
+ *
+ * @param p_bus Pointer to bus struct.
+ */
+void hscdtd_bus_reset_stats(hscdtd_bus_t *p_bus)
+{
+    p_bus->acquisitions = 0;
+    p_bus->contended = 0;
+    p_bus->wait_total_us = 0;
+    p_bus->wait_max_us = 0;
+}
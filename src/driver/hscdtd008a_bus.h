@@ -0,0 +1,84 @@
+#ifndef __HSCDTD008A_BUS__
+#define __HSCDTD008A_BUS__
+
+#include <stdint.h>
+#include "platform.h"
+
+#ifdef RPI
+#include <pthread.h>
+#endif  // RPI
+
+/**
+ * Locking for devices that are used from multiple threads.
+ *
+ * A bus serializes the transactions of all devices on it. The bus lock is
+ * only held for a single transaction or read-modify-write, never while the
+ * driver waits for a conversion, so devices on one bus interleave. Devices
+ * on different buses never share a lock.
+ *
+ * Every device also has its own (recursive) lock, held for sequences such
+ * as a measurement or a temperature compensation, so they are atomic for
+ * that device.
+ *
+ * Locks are pthread mutexes on RPI, and no-ops elsewhere.
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+#ifdef RPI
+typedef pthread_mutex_t hscdtd_mutex_t;
+#define HSCDTD_MUTEX_INITIALIZER        PTHREAD_MUTEX_INITIALIZER
+#else
+typedef uint8_t hscdtd_mutex_t;
+#define HSCDTD_MUTEX_INITIALIZER        0
+#endif  // RPI
+
+
+typedef struct hscdtd_bus {
+    const hscdtd_transport_t *p_transport;
+    void *p_transport_ctx;
+    hscdtd_mutex_t lock;
+
+    // Lock statistics, only on RPI. A lock is contended if it was not
+    // free at the first attempt.
+    uint32_t acquisitions;
+    uint32_t contended;
+    uint32_t wait_total_us;
+    uint32_t wait_max_us;
+} hscdtd_bus_t;
+
+#define HSCDTD_BUS_INITIALIZER(p_transport, p_ctx) \
+    {(p_transport), (p_ctx), HSCDTD_MUTEX_INITIALIZER, 0, 0, 0, 0}
+
+
+#ifndef HSCDTD_NO_PLATFORM_TRANSPORT
+// Bus of the platform transport, the default bus of every device.
+extern hscdtd_bus_t hscdtd_platform_bus;
+#endif  // HSCDTD_NO_PLATFORM_TRANSPORT
+
+
+void hscdtd_mutex_init(hscdtd_mutex_t *p_mutex, uint8_t recursive);
+
+void hscdtd_mutex_lock(hscdtd_mutex_t *p_mutex);
+
+void hscdtd_mutex_unlock(hscdtd_mutex_t *p_mutex);
+
+void hscdtd_bus_init(hscdtd_bus_t *p_bus,
+                     const hscdtd_transport_t *p_transport,
+                     void *p_ctx);
+
+void hscdtd_bus_lock(hscdtd_bus_t *p_bus);
+
+void hscdtd_bus_unlock(hscdtd_bus_t *p_bus);
+
+void hscdtd_bus_reset_stats(hscdtd_bus_t *p_bus);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_BUS__
@@ -0,0 +1,449 @@
+#include <math.h>
+#include <string.h>
+#include "hscdtd008a_calib.h"
+
+// Samples are scaled before they enter the normal equations, this keeps
+// the accumulated powers of the field in a sane range.
+#define HSCDTD_CALIB_SCALE              (1.0f / 64.0f)
+
+// Minimal number of samples before a fit is attempted.
+#define HSCDTD_CALIB_MIN_SAMPLES        32
+
+// Number of sweeps for the eigenvalue decomposition. 3x3 converges in ~5.
+#define HSCDTD_CALIB_JACOBI_SWEEPS      10
+
+
+/**
+ * @brief Get the index of element (i, j) in the packed upper triangle.
+ *
+ * @param i Row, must be smaller or equal to j.
+ * @param j Column.
+ * @return Index in the packed array.
+ */
+static uint8_t packed_index(uint8_t i, uint8_t j)
+{
+    return (uint8_t) (i * HSCDTD_CALIB_NUM_PARAMS - (i * (i - 1)) / 2 + (j - i));
+}
+
+
+/**
+ * @brief Count the number of bits set in a bin mask.
+ *
+ * @param mask Bin mask.
+ * @return Number of set bits.
+ */
+static uint8_t count_bins(uint32_t mask)
+{
+    uint8_t count = 0;
+
+    while (mask) {
+        mask &= mask - 1;
+        count++;
+    }
+    return count;
+}
+
+
+/**
+ * @brief Eigen decomposition of a symmetric 3x3 matrix.
+ *
+ * Cyclic Jacobi rotations, the matrix is small enough that this is both
+ * the smallest and the most robust method.
+ *
+ * @param a Symmetric matrix, diagonal contains the eigenvalues on return.
+ * @param v Eigenvectors (columns) on return.
+ */
+static void jacobi_3x3(float a[3][3], float v[3][3])
+{
+    static const uint8_t pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+    uint8_t sweep, n, k, p, q;
+    float theta, t, c, s, akp, akq, vkp, vkq;
+
+    memset(v, 0, sizeof(float) * 9);
+    v[0][0] = v[1][1] = v[2][2] = 1.0f;
+
+    for (sweep = 0; sweep < HSCDTD_CALIB_JACOBI_SWEEPS; sweep++) {
+        if (fabsf(a[0][1]) + fabsf(a[0][2]) + fabsf(a[1][2]) < 1e-12f)
+            break;
+
+        for (n = 0; n < 3; n++) {
+            p = pairs[n][0];
+            q = pairs[n][1];
+            if (a[p][q] == 0.0f)
+                continue;
+
+            theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+            t = 1.0f / (fabsf(theta) + sqrtf(theta * theta + 1.0f));
+            if (theta < 0.0f)
+                t = -t;
+            c = 1.0f / sqrtf(t * t + 1.0f);
+            s = t * c;
+
+            // A' = J^T A J, only rows/columns p and q change.
+            for (k = 0; k < 3; k++) {
+                akp = a[k][p];
+                akq = a[k][q];
+                a[k][p] = c * akp - s * akq;
+                a[k][q] = s * akp + c * akq;
+            }
+            for (k = 0; k < 3; k++) {
+                akp = a[p][k];
+                akq = a[q][k];
+                a[p][k] = c * akp - s * akq;
+                a[q][k] = s * akp + c * akq;
+            }
+            for (k = 0; k < 3; k++) {
+                vkp = v[k][p];
+                vkq = v[k][q];
+                v[k][p] = c * vkp - s * vkq;
+                v[k][q] = s * vkp + c * vkq;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Initialize the streaming calibrator.
+ *
+ * Samples fed to the calibrator must not have a hard-iron offset applied
+ * by the sensor, so clear the offset registers (hscdtd_set_offset with
+ * zeroes) before collecting samples. Running the on-chip offset calibration
+ * first keeps the centre of the fit close to the origin.
+ *
+ * A forget factor below 1.0 exponentially discounts old samples, which
+ * allows the fit to track slowly changing magnetic environments. Use 1.0
+ * for a plain least squares fit.
+ *
+ * @param p_cal Pointer to calibrator struct.
+ * @param forget Forget factor (0.0, 1.0].
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_calib_init(hscdtd_calib_t *p_cal, float forget)
+{
+    uint8_t i;
+
+    if (!p_cal) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (forget <= 0.0f || forget > 1.0f) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    memset(p_cal, 0, sizeof(hscdtd_calib_t));
+    p_cal->forget = forget;
+
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+        p_cal->min[i] = HSCDTD_15BIT_MAX_VALUE;
+        p_cal->max[i] = -HSCDTD_15BIT_MAX_VALUE;
+    }
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Add a sample to the calibrator.
+ *
+ * Updates the normal equations of the ellipsoid fit
+ *   a*x^2 + b*y^2 + c*z^2 + 2d*xy + 2e*xz + 2f*yz + 2g*x + 2h*y + 2i*z = 1
+ * in constant time and memory.
+ *
+ * @param p_cal Pointer to calibrator struct.
+ * @param p_mag Sample in uT, without hard-iron offset applied.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_calib_update(hscdtd_calib_t *p_cal,
+                                    const hscdtd_mag_t *p_mag)
+{
+    hscdtd_calib_real_t phi[HSCDTD_CALIB_NUM_PARAMS];
+    hscdtd_calib_real_t x, y, z;
+    const float *mag_data;
+    float mid, half;
+    uint8_t i, j, k, bin, digit;
+
+    if (!p_cal || !p_mag) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    mag_data = &p_mag->mag_x;
+
+    x = mag_data[0] * HSCDTD_CALIB_SCALE;
+    y = mag_data[1] * HSCDTD_CALIB_SCALE;
+    z = mag_data[2] * HSCDTD_CALIB_SCALE;
+
+    phi[0] = x * x;
+    phi[1] = y * y;
+    phi[2] = z * z;
+    phi[3] = 2 * x * y;
+    phi[4] = 2 * x * z;
+    phi[5] = 2 * y * z;
+    phi[6] = 2 * x;
+    phi[7] = 2 * y;
+    phi[8] = 2 * z;
+
+    // Only discount when requested, this saves 55 multiplications.
+    if (p_cal->forget < 1.0f) {
+        for (k = 0; k < HSCDTD_CALIB_NUM_NORMAL; k++)
+            p_cal->ata[k] *= p_cal->forget;
+        for (k = 0; k < HSCDTD_CALIB_NUM_PARAMS; k++)
+            p_cal->atb[k] *= p_cal->forget;
+        p_cal->weight *= p_cal->forget;
+    }
+
+    k = 0;
+    for (i = 0; i < HSCDTD_CALIB_NUM_PARAMS; i++) {
+        for (j = i; j < HSCDTD_CALIB_NUM_PARAMS; j++)
+            p_cal->ata[k++] += phi[i] * phi[j];
+        p_cal->atb[i] += phi[i];
+    }
+    p_cal->weight += 1;
+
+    // Coverage is tracked on a 3x3x3 grid of directions around the centre of
+    // the range seen so far (the centre cell itself is not a direction).
+    bin = 0;
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+        if (mag_data[i] < p_cal->min[i])
+            p_cal->min[i] = mag_data[i];
+        if (mag_data[i] > p_cal->max[i])
+            p_cal->max[i] = mag_data[i];
+
+        mid = 0.5f * (p_cal->max[i] + p_cal->min[i]);
+        half = 0.5f * (p_cal->max[i] - p_cal->min[i]);
+
+        digit = 1;
+        if (mag_data[i] > mid + 0.5f * half)
+            digit = 2;
+        else if (mag_data[i] < mid - 0.5f * half)
+            digit = 0;
+        bin = (uint8_t) (bin * 3 + digit);
+    }
+
+    // Skip the centre cell (13) so that the bins map onto 0..25.
+    if (bin != 13)
+        p_cal->bins |= 1UL << (bin > 13 ? bin - 1 : bin);
+
+    p_cal->num_samples++;
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Get the fraction of directions covered by the samples.
+ *
+ * @param p_cal Pointer to calibrator struct.
+ * @return Coverage between 0.0 and 1.0.
+ */
+float hscdtd_calib_coverage(const hscdtd_calib_t *p_cal)
+{
+    return (float) count_bins(p_cal->bins) / HSCDTD_CALIB_NUM_BINS;
+}
+
+
+/**
+ * @brief Solve the ellipsoid fit.
+ *
+ * Can be called at any point in the stream; the accumulated state is not
+ * modified. fit_error is the RMS radial error relative to the field
+ * strength, coverage the fraction of directions seen.
+ *
+ * @param p_cal Pointer to calibrator struct.
+ * @param p_result Pointer to struct to store the result.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_calib_solve(const hscdtd_calib_t *p_cal,
+                                   hscdtd_calib_result_t *p_result)
+{
+    hscdtd_calib_real_t u[HSCDTD_CALIB_NUM_NORMAL];
+    hscdtd_calib_real_t p[HSCDTD_CALIB_NUM_PARAMS];
+    hscdtd_calib_real_t s, residual;
+    float m[3][3], inv[3][3], q[3][3], vec[3][3], root[3];
+    float centre[3], det, k, radius;
+    int8_t i, j, l;
+
+    if (!p_cal || !p_result) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (p_cal->num_samples < HSCDTD_CALIB_MIN_SAMPLES) {
+        return HSCDTD_STAT_NO_DATA;
+    }
+
+    // In-place Cholesky decomposition A = U^T U of the packed matrix.
+    memcpy(u, p_cal->ata, sizeof(u));
+    for (i = 0; i < HSCDTD_CALIB_NUM_PARAMS; i++) {
+        for (j = i; j < HSCDTD_CALIB_NUM_PARAMS; j++) {
+            s = u[packed_index(i, j)];
+            for (l = 0; l < i; l++)
+                s -= u[packed_index(l, i)] * u[packed_index(l, j)];
+
+            if (i == j) {
+                // Not positive definite, samples do not span an ellipsoid.
+                if (s <= 0)
+                    return HSCDTD_STAT_CHECK_FAILED;
+                u[packed_index(i, i)] = sqrt(s);
+            } else {
+                u[packed_index(i, j)] = s / u[packed_index(i, i)];
+            }
+        }
+    }
+
+    // Forward substitution U^T y = b.
+    for (i = 0; i < HSCDTD_CALIB_NUM_PARAMS; i++) {
+        s = p_cal->atb[i];
+        for (l = 0; l < i; l++)
+            s -= u[packed_index(l, i)] * p[l];
+        p[i] = s / u[packed_index(i, i)];
+    }
+
+    // Back substitution U p = y.
+    for (i = HSCDTD_CALIB_NUM_PARAMS - 1; i >= 0; i--) {
+        s = p[i];
+        for (l = i + 1; l < HSCDTD_CALIB_NUM_PARAMS; l++)
+            s -= u[packed_index(i, l)] * p[l];
+        p[i] = s / u[packed_index(i, i)];
+    }
+
+    // Sum of squared residuals: n - 2 p^T b + p^T A p, with A p = b.
+    residual = p_cal->weight;
+    for (i = 0; i < HSCDTD_CALIB_NUM_PARAMS; i++)
+        residual -= p[i] * p_cal->atb[i];
+    if (residual < 0)
+        residual = 0;
+
+    m[0][0] = (float) p[0];
+    m[1][1] = (float) p[1];
+    m[2][2] = (float) p[2];
+    m[0][1] = m[1][0] = (float) p[3];
+    m[0][2] = m[2][0] = (float) p[4];
+    m[1][2] = m[2][1] = (float) p[5];
+
+    // Inverse of M through the adjugate.
+    inv[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    inv[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+    inv[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+    inv[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+    inv[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+    inv[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+    inv[1][0] = inv[0][1];
+    inv[2][0] = inv[0][2];
+    inv[2][1] = inv[1][2];
+
+    det = m[0][0] * inv[0][0] + m[0][1] * inv[1][0] + m[0][2] * inv[2][0];
+    if (det <= 0.0f)
+        return HSCDTD_STAT_CHECK_FAILED;
+
+    // Centre c = -M^-1 v.
+    for (i = 0; i < 3; i++) {
+        centre[i] = -(inv[i][0] * (float) p[6] +
+                      inv[i][1] * (float) p[7] +
+                      inv[i][2] * (float) p[8]) / det;
+    }
+
+    // (x - c)^T M (x - c) = 1 + c^T M c
+    k = 1.0f;
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++)
+            k += centre[i] * m[i][j] * centre[j];
+    if (k <= 0.0f)
+        return HSCDTD_STAT_CHECK_FAILED;
+
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < 3; j++)
+            q[i][j] = m[i][j] / k;
+
+    jacobi_3x3(q, vec);
+
+    // Eigenvalues are 1 / radius^2 of the principal axes.
+    radius = 1.0f;
+    for (i = 0; i < 3; i++) {
+        if (q[i][i] <= 0.0f)
+            return HSCDTD_STAT_CHECK_FAILED;
+        root[i] = sqrtf(q[i][i]);
+        radius *= root[i];
+    }
+    // Geometric mean of the radii keeps the volume of the ellipsoid.
+    radius = 1.0f / cbrtf(radius);
+
+    // W = R * V sqrt(Q) V^T
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            p_result->soft_iron[i][j] = radius * (
+                vec[i][0] * root[0] * vec[j][0] +
+                vec[i][1] * root[1] * vec[j][1] +
+                vec[i][2] * root[2] * vec[j][2]);
+        }
+        p_result->offset[i] = centre[i] / HSCDTD_CALIB_SCALE;
+    }
+
+    p_result->field_strength = radius / HSCDTD_CALIB_SCALE;
+    p_result->fit_error = sqrtf((float) (residual / p_cal->weight)) / (2.0f * k);
+    p_result->coverage = hscdtd_calib_coverage(p_cal);
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Write the hard-iron offset of a fit to the offset registers.
+ *
+ * After this the sensor removes the hard-iron offset itself, so there is
+ * no per sample cost on the host.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_result Pointer to the result of hscdtd_calib_solve.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_calib_apply_offset(hscdtd_device_t *p_dev,
+                                          const hscdtd_calib_result_t *p_result)
+{
+    int8_t i;
+
+    if (!p_result) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+        if (p_result->offset[i] > HSCDTD_15BIT_MAX_VALUE ||
+            p_result->offset[i] < -HSCDTD_15BIT_MAX_VALUE) {
+            return HSCDTD_STAT_USER_ERROR;
+        }
+    }
+
+    // hscdtd_set_offset_nt adds the offset to the reading, the centre has
+    // to be subtracted.
+    return hscdtd_set_offset_nt(p_dev,
+                                (int32_t) (-p_result->offset[0] * 1000.0f),
+                                (int32_t) (-p_result->offset[1] * 1000.0f),
+                                (int32_t) (-p_result->offset[2] * 1000.0f));
+}
+
+
+/**
+ * @brief Apply the soft-iron correction to a sample.
+ *
+ * Expects the hard-iron offset to be removed already, which is the case
+ * after hscdtd_calib_apply_offset.
+ *
+ * @param p_result Pointer to the result of hscdtd_calib_solve.
+ * @param p_mag Sample to correct in place.
+ */
+void hscdtd_calib_correct(const hscdtd_calib_result_t *p_result,
+                          hscdtd_mag_t *p_mag)
+{
+    float x = p_mag->mag_x;
+    float y = p_mag->mag_y;
+    float z = p_mag->mag_z;
+
+    p_mag->mag_x = p_result->soft_iron[0][0] * x +
+                   p_result->soft_iron[0][1] * y +
+                   p_result->soft_iron[0][2] * z;
+    p_mag->mag_y = p_result->soft_iron[1][0] * x +
+                   p_result->soft_iron[1][1] * y +
+                   p_result->soft_iron[1][2] * z;
+    p_mag->mag_z = p_result->soft_iron[2][0] * x +
+                   p_result->soft_iron[2][1] * y +
+                   p_result->soft_iron[2][2] * z;
+}
@@ -0,0 +1,82 @@
+#ifndef __HSCDTD008A_CALIB__
+#define __HSCDTD008A_CALIB__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+
+// Number of parameters of the general ellipsoid model.
+#define HSCDTD_CALIB_NUM_PARAMS         9
+
+// Number of packed entries in the upper triangle of the normal matrix.
+#define HSCDTD_CALIB_NUM_NORMAL         45
+
+// Number of direction bins used for the coverage estimate.
+#define HSCDTD_CALIB_NUM_BINS           26
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+/**
+ * Accumulators use double where the platform provides it. On AVR double is
+ * the same size as float, so nothing extra is pulled in there.
+ */
+typedef double hscdtd_calib_real_t;
+
+
+/**
+ * State of the streaming ellipsoid fit.
+ *
+ * The fit only keeps the normal equations of the least squares problem,
+ * so memory use does not depend on the number of samples.
+ */
+typedef struct {
+    hscdtd_calib_real_t ata[HSCDTD_CALIB_NUM_NORMAL];
+    hscdtd_calib_real_t atb[HSCDTD_CALIB_NUM_PARAMS];
+    hscdtd_calib_real_t weight;
+    float forget;
+    float min[HSCDTD_NUM_AXIS];
+    float max[HSCDTD_NUM_AXIS];
+    uint32_t bins;
+    uint32_t num_samples;
+} hscdtd_calib_t;
+
+
+/**
+ * Result of a fit.
+ *
+ * offset is the hard-iron centre in uT, soft_iron maps centred samples
+ * onto a sphere with a radius of field_strength uT.
+ */
+typedef struct {
+    float offset[HSCDTD_NUM_AXIS];
+    float soft_iron[HSCDTD_NUM_AXIS][HSCDTD_NUM_AXIS];
+    float field_strength;
+    float fit_error;
+    float coverage;
+} hscdtd_calib_result_t;
+
+
+hscdtd_status_t hscdtd_calib_init(hscdtd_calib_t *p_cal, float forget);
+
+hscdtd_status_t hscdtd_calib_update(hscdtd_calib_t *p_cal,
+                                    const hscdtd_mag_t *p_mag);
+
+float hscdtd_calib_coverage(const hscdtd_calib_t *p_cal);
+
+hscdtd_status_t hscdtd_calib_solve(const hscdtd_calib_t *p_cal,
+                                   hscdtd_calib_result_t *p_result);
+
+hscdtd_status_t hscdtd_calib_apply_offset(hscdtd_device_t *p_dev,
+                                          const hscdtd_calib_result_t *p_result);
+
+void hscdtd_calib_correct(const hscdtd_calib_result_t *p_result,
+                          hscdtd_mag_t *p_mag);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_CALIB__
@@ -0,0 +1,642 @@
+#include <string.h>
+#include "hscdtd008a_capture.h"
+#include "hscdtd008a_reg.h"
+#include "transport.h"
+
+#ifdef RPI
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#endif  // RPI
+
+
+static void put_u16(uint8_t *p_buffer, uint16_t value)
+{
+    p_buffer[0] = (uint8_t) value;
+    p_buffer[1] = (uint8_t) (value >> 8);
+}
+
+
+static void put_u32(uint8_t *p_buffer, uint32_t value)
+{
+    p_buffer[0] = (uint8_t) value;
+    p_buffer[1] = (uint8_t) (value >> 8);
+    p_buffer[2] = (uint8_t) (value >> 16);
+    p_buffer[3] = (uint8_t) (value >> 24);
+}
+
+
+static void put_u64(uint8_t *p_buffer, uint64_t value)
+{
+    put_u32(&p_buffer[0], (uint32_t) value);
+    put_u32(&p_buffer[4], (uint32_t) (value >> 32));
+}
+
+
+static uint16_t get_u16(const uint8_t *p_buffer)
+{
+    return (uint16_t) (p_buffer[0] | (p_buffer[1] << 8));
+}
+
+
+static uint32_t get_u32(const uint8_t *p_buffer)
+{
+    return (uint32_t) p_buffer[0] | ((uint32_t) p_buffer[1] << 8) |
+           ((uint32_t) p_buffer[2] << 16) | ((uint32_t) p_buffer[3] << 24);
+}
+
+
+static uint64_t get_u64(const uint8_t *p_buffer)
+{
+    return (uint64_t) get_u32(&p_buffer[0]) |
+           ((uint64_t) get_u32(&p_buffer[4]) << 32);
+}
+
+
+/**
+ * @brief Describe a device for the device table of a capture.
+ *
+ * Reads the resolution and the offset registers of the device.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_desc Pointer to store the description.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_capture_describe(hscdtd_device_t *p_dev,
+                                        hscdtd_capture_device_t *p_desc)
+{
+    hscdtd_status_t status;
+    uint8_t buf[6];
+    uint8_t reg;
+    int8_t i;
+
+    if (!p_dev || !p_desc) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    status = read_register(p_dev, HSCDTD_REG_CTRL4, &reg);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    status = read_register_multi(p_dev, HSCDTD_REG_OFFSET_X_L, 6, buf);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    p_desc->addr = p_dev->addr;
+    p_desc->resolution = (hscdtd_res_t) HSCDTD_FIELD_GET(HSCDTD_CTRL4_RS, reg);
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++)
+        p_desc->offset[i] = (int16_t) get_u16(&buf[2 * i]);
+    // Scale of the conversion API, which assumes 15 bit values.
+    p_desc->nt_per_lsb = HSCDTD_NT_PER_LSB_15B;
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Encode a capture header.
+ *
+ * @param p_header Pointer to the header.
+ * @param p_buffer Buffer of HSCDTD_CAPTURE_HEADER_SIZE bytes.
+ */
+void hscdtd_capture_encode_header(const hscdtd_capture_header_t *p_header,
+                                  uint8_t *p_buffer)
+{
+    memset(p_buffer, 0, HSCDTD_CAPTURE_HEADER_SIZE);
+    put_u32(&p_buffer[0], p_header->magic);
+    put_u16(&p_buffer[4], p_header->version);
+    put_u16(&p_buffer[6], p_header->header_size);
+    put_u16(&p_buffer[8], p_header->record_size);
+    p_buffer[10] = p_header->n_devices;
+    p_buffer[11] = p_header->flags;
+    put_u32(&p_buffer[12], p_header->records);
+    put_u64(&p_buffer[16], p_header->start_us);
+}
+
+
+/**
+ * @brief Decode and check a capture header.
+ *
+ * @param p_buffer Buffer of HSCDTD_CAPTURE_HEADER_SIZE bytes.
+ * @param p_header Pointer to store the header.
+ * @return hscdtd_status, HSCDTD_STAT_CHECK_FAILED if this is not a
+ *         capture of a supported version.
+ */
+hscdtd_status_t hscdtd_capture_decode_header(const uint8_t *p_buffer,
+                                             hscdtd_capture_header_t *p_header)
+{
+    p_header->magic = get_u32(&p_buffer[0]);
+    p_header->version = get_u16(&p_buffer[4]);
+    p_header->header_size = get_u16(&p_buffer[6]);
+    p_header->record_size = get_u16(&p_buffer[8]);
+    p_header->n_devices = p_buffer[10];
+    p_header->flags = p_buffer[11];
+    p_header->records = get_u32(&p_buffer[12]);
+    p_header->start_us = get_u64(&p_buffer[16]);
+
+    if (p_header->magic != HSCDTD_CAPTURE_MAGIC ||
+        p_header->version != HSCDTD_CAPTURE_VERSION ||
+        p_header->record_size != HSCDTD_CAPTURE_RECORD_SIZE ||
+        p_header->n_devices > HSCDTD_CAPTURE_MAX_DEVICES ||
+        p_header->header_size < HSCDTD_CAPTURE_HEADER_SIZE +
+                                p_header->n_devices * HSCDTD_CAPTURE_DEVICE_SIZE) {
+        return HSCDTD_STAT_CHECK_FAILED;
+    }
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Encode a device table entry.
+ *
+ * @param p_desc Pointer to the device description.
+ * @param p_buffer Buffer of HSCDTD_CAPTURE_DEVICE_SIZE bytes.
+ */
+void hscdtd_capture_encode_device(const hscdtd_capture_device_t *p_desc,
+                                  uint8_t *p_buffer)
+{
+    int8_t i;
+
+    p_buffer[0] = p_desc->addr;
+    p_buffer[1] = (uint8_t) p_desc->resolution;
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++)
+        put_u16(&p_buffer[2 + 2 * i], (uint16_t) p_desc->offset[i]);
+    put_u16(&p_buffer[8], p_desc->nt_per_lsb);
+    put_u16(&p_buffer[10], 0);
+}
+
+
+/**
+ * @brief Decode a device table entry.
+ *
+ * @param p_buffer Buffer of HSCDTD_CAPTURE_DEVICE_SIZE bytes.
+ * @param p_desc Pointer to store the device description.
+ */
+void hscdtd_capture_decode_device(const uint8_t *p_buffer,
+                                  hscdtd_capture_device_t *p_desc)
+{
+    int8_t i;
+
+    p_desc->addr = p_buffer[0];
+    p_desc->resolution = (hscdtd_res_t) p_buffer[1];
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++)
+        p_desc->offset[i] = (int16_t) get_u16(&p_buffer[2 + 2 * i]);
+    p_desc->nt_per_lsb = get_u16(&p_buffer[8]);
+}
+
+
+/**
+ * @brief Encode a record.
+ *
+ * Also usable without a file, to stream records over a serial port.
+ *
+ * @param p_record Pointer to the record.
+ * @param p_buffer Buffer of HSCDTD_CAPTURE_RECORD_SIZE bytes.
+ */
+void hscdtd_capture_encode_record(const hscdtd_capture_record_t *p_record,
+                                  uint8_t *p_buffer)
+{
+    put_u64(&p_buffer[0], p_record->timestamp_us);
+    put_u32(&p_buffer[8], p_record->seq);
+    put_u16(&p_buffer[12], (uint16_t) p_record->raw.mag_x);
+    put_u16(&p_buffer[14], (uint16_t) p_record->raw.mag_y);
+    put_u16(&p_buffer[16], (uint16_t) p_record->raw.mag_z);
+    p_buffer[18] = p_record->device;
+    p_buffer[19] = p_record->flags;
+}
+
+
+/**
+ * @brief Decode a record.
+ *
+ * @param p_buffer Buffer of HSCDTD_CAPTURE_RECORD_SIZE bytes.
+ * @param p_record Pointer to store the record.
+ */
+void hscdtd_capture_decode_record(const uint8_t *p_buffer,
+                                  hscdtd_capture_record_t *p_record)
+{
+    p_record->timestamp_us = get_u64(&p_buffer[0]);
+    p_record->seq = get_u32(&p_buffer[8]);
+    p_record->raw.mag_x = (int16_t) get_u16(&p_buffer[12]);
+    p_record->raw.mag_y = (int16_t) get_u16(&p_buffer[14]);
+    p_record->raw.mag_z = (int16_t) get_u16(&p_buffer[16]);
+    p_record->device = p_buffer[18];
+    p_record->flags = p_buffer[19];
+}
+
+
+/**
+ * @brief Make a record from a sample.
+ *
+ * @param p_sample Pointer to the sample.
+ * @param device Index of the device in the device table.
+ * @param p_record Pointer to store the record.
+ */
+void hscdtd_capture_from_sample(const hscdtd_sample_t *p_sample,
+                                uint8_t device,
+                                hscdtd_capture_record_t *p_record)
+{
+    p_record->timestamp_us = p_sample->timestamp_us;
+    p_record->seq = p_sample->seq;
+    p_record->raw = p_sample->raw;
+    p_record->device = device;
+    p_record->flags = (uint8_t) (p_sample->flags << 1);
+    if (p_sample->timestamp_err_us == HSCDTD_TIMESTAMP_ERR_UNKNOWN)
+        p_record->flags |= HSCDTD_CAPTURE_TS_UNKNOWN;
+}
+
+
+/**
+ * @brief Make a sample from a record.
+ *
+ * The timestamp of the sample is the low 32 bits of the record time, the
+ * intervals between samples are kept across a wrap. The timestamp error
+ * is not recorded, it is 0 unless the timestamp was unknown. Neither is
+ * odr_seq, it is set to the sequence number.
+ *
+ * @param p_record Pointer to the record.
+ * @param p_sample Pointer to store the sample.
+ */
+void hscdtd_capture_to_sample(const hscdtd_capture_record_t *p_record,
+                              hscdtd_sample_t *p_sample)
+{
+    p_sample->raw = p_record->raw;
+    p_sample->timestamp_us = (uint32_t) p_record->timestamp_us;
+    p_sample->seq = p_record->seq;
+    p_sample->odr_seq = p_record->seq;
+    p_sample->timestamp_err_us = (p_record->flags & HSCDTD_CAPTURE_TS_UNKNOWN) ?
+                                 HSCDTD_TIMESTAMP_ERR_UNKNOWN : 0;
+    p_sample->flags = p_record->flags >> 1;
+}
+
+
+#ifdef RPI
+static uint64_t capture_wall_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+static hscdtd_status_t capture_map(hscdtd_capture_writer_t *p_writer,
+                                   size_t capacity)
+{
+    void *p_map;
+
+    // The file is zero filled, unwritten records read as end of capture.
+    if (ftruncate(p_writer->fd, capacity) != 0)
+        return HSCDTD_STAT_ERROR;
+
+    if (p_writer->p_map)
+        munmap(p_writer->p_map, p_writer->capacity);
+
+    p_map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 p_writer->fd, 0);
+    if (p_map == MAP_FAILED) {
+        p_writer->p_map = NULL;
+        return HSCDTD_STAT_ERROR;
+    }
+
+    p_writer->p_map = (uint8_t *) p_map;
+    p_writer->capacity = capacity;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Create a capture file.
+ *
+ * An existing file is overwritten.
+ *
+ * @param p_writer Pointer to writer struct.
+ * @param path Path of the file.
+ * @param p_devices Device table, record device ids index this table.
+ * @param n_devices Number of devices in the table.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_capture_open_write(hscdtd_capture_writer_t *p_writer,
+                                          const char *path,
+                                          const hscdtd_capture_device_t *p_devices,
+                                          uint8_t n_devices)
+{
+    hscdtd_status_t status;
+    hscdtd_capture_header_t header;
+    uint8_t i;
+
+    if (!p_writer || !path || (!p_devices && n_devices)) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (n_devices > HSCDTD_CAPTURE_MAX_DEVICES) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    memset(p_writer, 0, sizeof(hscdtd_capture_writer_t));
+    p_writer->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (p_writer->fd < 0)
+        return HSCDTD_STAT_ERROR;
+
+    status = capture_map(p_writer, HSCDTD_CAPTURE_CHUNK);
+    if (status != HSCDTD_STAT_OK) {
+        close(p_writer->fd);
+        return status;
+    }
+
+    // A multiple of 4, the sequence numbers are aligned.
+    header.magic = HSCDTD_CAPTURE_MAGIC;
+    header.version = HSCDTD_CAPTURE_VERSION;
+    header.header_size = HSCDTD_CAPTURE_HEADER_SIZE +
+                         n_devices * HSCDTD_CAPTURE_DEVICE_SIZE;
+    header.record_size = HSCDTD_CAPTURE_RECORD_SIZE;
+    header.n_devices = n_devices;
+    header.flags = 0;
+    header.records = 0;
+    header.start_us = capture_wall_us();
+    p_writer->last_ts = t_now_us();
+    p_writer->last_us = header.start_us;
+
+    hscdtd_capture_encode_header(&header, p_writer->p_map);
+    for (i = 0; i < n_devices; i++) {
+        hscdtd_capture_encode_device(&p_devices[i],
+                                     &p_writer->p_map[HSCDTD_CAPTURE_HEADER_SIZE +
+                                                      i * HSCDTD_CAPTURE_DEVICE_SIZE]);
+    }
+    p_writer->size = header.header_size;
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Append a sample to the capture.
+ *
+ * Only a memory copy, unless the file has to grow. The sequence number is
+ * stored last, a record that was cut off by a crash reads as the end of
+ * the capture.
+ *
+ * @param p_writer Pointer to writer struct.
+ * @param device Index of the device in the device table.
+ * @param p_sample Pointer to the sample.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_capture_append(hscdtd_capture_writer_t *p_writer,
+                                      uint8_t device,
+                                      const hscdtd_sample_t *p_sample)
+{
+    hscdtd_status_t status;
+    hscdtd_capture_record_t record;
+    uint8_t buf[HSCDTD_CAPTURE_RECORD_SIZE];
+    uint8_t *p_dst;
+
+    if (!p_writer || !p_writer->p_map || !p_sample) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    // Sequence number 0 is the end marker.
+    if (p_sample->seq == 0) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    if (p_writer->size + HSCDTD_CAPTURE_RECORD_SIZE > p_writer->capacity) {
+        status = capture_map(p_writer,
+                             p_writer->capacity + HSCDTD_CAPTURE_CHUNK);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+    }
+
+    // Samples are appended within minutes of each other, a signed 32 bit
+    // difference covers 35 minutes either way.
+    hscdtd_capture_from_sample(p_sample, device, &record);
+    record.timestamp_us = p_writer->last_us +
+                          (int32_t) (p_sample->timestamp_us - p_writer->last_ts);
+    p_writer->last_ts = p_sample->timestamp_us;
+    p_writer->last_us = record.timestamp_us;
+    hscdtd_capture_encode_record(&record, buf);
+
+    p_dst = &p_writer->p_map[p_writer->size];
+    memcpy(&p_dst[0], &buf[0], 8);
+    memcpy(&p_dst[12], &buf[12], 8);
+    __sync_synchronize();
+    memcpy(&p_dst[8], &buf[8], 4);
+
+    p_writer->size += HSCDTD_CAPTURE_RECORD_SIZE;
+    p_writer->records++;
+    put_u32(&p_writer->p_map[12], p_writer->records);
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Schedule written records for write back to disk.
+ *
+ * Does not wait for the write. Records are kept by the kernel if the
+ * process crashes, this is only needed against power loss.
+ *
+ * @param p_writer Pointer to writer struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_capture_sync(hscdtd_capture_writer_t *p_writer)
+{
+    if (!p_writer || !p_writer->p_map) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (msync(p_writer->p_map, p_writer->size, MS_ASYNC) != 0)
+        return HSCDTD_STAT_ERROR;
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Close the capture and trim the file to the records written.
+ *
+ * @param p_writer Pointer to writer struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_capture_close_write(hscdtd_capture_writer_t *p_writer)
+{
+    hscdtd_status_t status = HSCDTD_STAT_OK;
+
+    if (!p_writer || !p_writer->p_map) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    p_writer->p_map[11] |= HSCDTD_CAPTURE_CLOSED;
+    if (msync(p_writer->p_map, p_writer->size, MS_SYNC) != 0)
+        status = HSCDTD_STAT_ERROR;
+
+    munmap(p_writer->p_map, p_writer->capacity);
+    p_writer->p_map = NULL;
+
+    if (ftruncate(p_writer->fd, p_writer->size) != 0)
+        status = HSCDTD_STAT_ERROR;
+    close(p_writer->fd);
+
+    return status;
+}
+
+
+/**
+ * @brief Open a capture for replay.
+ *
+ * A capture that was not closed is read up to the last complete record.
+ *
+ * @param p_reader Pointer to reader struct.
+ * @param path Path of the file.
+ * @return hscdtd_status, HSCDTD_STAT_CHECK_FAILED if the file is not a
+ *         valid capture.
+ */
+hscdtd_status_t hscdtd_capture_open_read(hscdtd_capture_reader_t *p_reader,
+                                         const char *path)
+{
+    hscdtd_status_t status;
+    struct stat st;
+    void *p_map;
+    size_t max_records;
+    uint8_t i;
+    int fd;
+
+    if (!p_reader || !path) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    memset(p_reader, 0, sizeof(hscdtd_capture_reader_t));
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return HSCDTD_STAT_ERROR;
+
+    if (fstat(fd, &st) != 0 || st.st_size < HSCDTD_CAPTURE_HEADER_SIZE) {
+        close(fd);
+        return HSCDTD_STAT_CHECK_FAILED;
+    }
+
+    // The mapping stays valid after the file is closed.
+    p_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p_map == MAP_FAILED)
+        return HSCDTD_STAT_ERROR;
+
+    p_reader->p_map = (const uint8_t *) p_map;
+    p_reader->map_size = st.st_size;
+    madvise(p_map, st.st_size, MADV_SEQUENTIAL);
+
+    status = hscdtd_capture_decode_header(p_reader->p_map, &p_reader->header);
+    if (status == HSCDTD_STAT_OK && p_reader->header.header_size > p_reader->map_size)
+        status = HSCDTD_STAT_CHECK_FAILED;
+    if (status != HSCDTD_STAT_OK) {
+        hscdtd_capture_close_read(p_reader);
+        return status;
+    }
+
+    for (i = 0; i < p_reader->header.n_devices; i++) {
+        hscdtd_capture_decode_device(&p_reader->p_map[HSCDTD_CAPTURE_HEADER_SIZE +
+                                                      i * HSCDTD_CAPTURE_DEVICE_SIZE],
+                                     &p_reader->devices[i]);
+    }
+
+    // The record count in the header is updated after each record, scan
+    // for records the count missed.
+    max_records = (p_reader->map_size - p_reader->header.header_size) /
+                  HSCDTD_CAPTURE_RECORD_SIZE;
+    p_reader->records = p_reader->header.records;
+    if (p_reader->records > max_records)
+        p_reader->records = max_records;
+    while (p_reader->records < max_records &&
+           get_u32(&p_reader->p_map[p_reader->header.header_size +
+                                    p_reader->records * HSCDTD_CAPTURE_RECORD_SIZE + 8]))
+        p_reader->records++;
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Read the next sample of the capture.
+ *
+ * Use the conversion functions of the driver (hscdtd_raw_to_nt, ...) on
+ * the sample, as for a sample read from a device.
+ *
+ * @param p_reader Pointer to reader struct.
+ * @param p_sample Pointer to store the sample.
+ * @param p_device Pointer to store the index in the device table, or NULL.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA at the end of the capture.
+ */
+hscdtd_status_t hscdtd_capture_next(hscdtd_capture_reader_t *p_reader,
+                                    hscdtd_sample_t *p_sample,
+                                    uint8_t *p_device)
+{
+    hscdtd_capture_record_t record;
+
+    if (!p_reader || !p_reader->p_map || !p_sample) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (p_reader->next >= p_reader->records) {
+        return HSCDTD_STAT_NO_DATA;
+    }
+
+    hscdtd_capture_decode_record(&p_reader->p_map[p_reader->header.header_size +
+                                                  p_reader->next * HSCDTD_CAPTURE_RECORD_SIZE],
+                                 &record);
+    p_reader->next++;
+
+    if (record.device >= p_reader->header.n_devices) {
+        return HSCDTD_STAT_CHECK_FAILED;
+    }
+
+    hscdtd_capture_to_sample(&record, p_sample);
+    p_reader->timestamp_us = record.timestamp_us;
+    if (p_device)
+        *p_device = record.device;
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Move the replay position.
+ *
+ * @param p_reader Pointer to reader struct.
+ * @param index Index of the next record to read.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_capture_seek(hscdtd_capture_reader_t *p_reader,
+                                    uint32_t index)
+{
+    if (!p_reader || !p_reader->p_map) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (index > p_reader->records) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    p_reader->next = index;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Close a capture opened for replay.
+ *
+ * @param p_reader Pointer to reader struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_capture_close_read(hscdtd_capture_reader_t *p_reader)
+{
+    if (!p_reader || !p_reader->p_map) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    munmap((void *) p_reader->p_map, p_reader->map_size);
+    p_reader->p_map = NULL;
+    return HSCDTD_STAT_OK;
+}
+#endif  // RPI
@@ -0,0 +1,178 @@
+#ifndef __HSCDTD008A_CAPTURE__
+#define __HSCDTD008A_CAPTURE__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hscdtd008a_driver.h"
+
+/**
+ * Binary capture format, all fields little endian.
+ *
+ *   header        32 bytes, see hscdtd_capture_header_t
+ *   device table  12 bytes per device, see hscdtd_capture_device_t
+ *   padding       up to header_size, a multiple of 4
+ *   records       20 bytes each, see hscdtd_capture_record_t
+ *
+ * Sequence numbers start at 1, a record with sequence number 0 marks the
+ * end of the capture. Files are grown in zeroed chunks, so a capture that
+ * was not closed ends at the first zero record.
+ *
+ * Times are 64 bit microseconds since 1970, start_us is the wall clock
+ * when the capture was started. Sample timestamps are 32 bit and wrap
+ * every 71.6 minutes, the writer extends them to 64 bit from the difference
+ * to the previous sample, so the times of a capture of any length increase
+ * and a seek needs no earlier records. Version 1 stored the 32 bit
+ * timestamps and is not read.
+ */
+#define HSCDTD_CAPTURE_MAGIC            0x50435348UL  // "HSCP"
+#define HSCDTD_CAPTURE_VERSION          2
+#define HSCDTD_CAPTURE_HEADER_SIZE      32
+#define HSCDTD_CAPTURE_DEVICE_SIZE      12
+#define HSCDTD_CAPTURE_RECORD_SIZE      20
+#define HSCDTD_CAPTURE_MAX_DEVICES      16
+
+// Header flags
+#define HSCDTD_CAPTURE_CLOSED           0x01
+
+// Record flags, above TS_UNKNOWN the HSCDTD_SAMPLE_* flags shifted by one.
+#define HSCDTD_CAPTURE_TS_UNKNOWN       0x01
+#define HSCDTD_CAPTURE_ODR_CHANGE       0x02
+#define HSCDTD_CAPTURE_OVERRUN          0x04
+#define HSCDTD_CAPTURE_SATURATED        0x38
+#define HSCDTD_CAPTURE_STALE            0x40
+#define HSCDTD_CAPTURE_GAP              0x80
+
+// Size the writer grows the file by, in bytes.
+#ifndef HSCDTD_CAPTURE_CHUNK
+#define HSCDTD_CAPTURE_CHUNK            (1024UL * 1024UL)
+#endif  // HSCDTD_CAPTURE_CHUNK
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    // Offset of the first record, in bytes.
+    uint16_t header_size;
+    uint16_t record_size;
+    uint8_t n_devices;
+    uint8_t flags;
+    // Complete records, may lag behind the file if it was not closed.
+    uint32_t records;
+    // Wall clock when the capture was started.
+    uint64_t start_us;
+} hscdtd_capture_header_t;
+
+
+typedef struct {
+    uint8_t addr;
+    hscdtd_res_t resolution;
+    // Offset registers at the start of the capture, in LSB.
+    int16_t offset[HSCDTD_NUM_AXIS];
+    uint16_t nt_per_lsb;
+} hscdtd_capture_device_t;
+
+
+typedef struct {
+    // 64 bit time, see above. hscdtd_capture_from_sample sets the 32 bit
+    // sample timestamp, the writer extends it.
+    uint64_t timestamp_us;
+    uint32_t seq;
+    hscdtd_mag_raw_t raw;
+    // Index in the device table.
+    uint8_t device;
+    uint8_t flags;
+} hscdtd_capture_record_t;
+
+
+hscdtd_status_t hscdtd_capture_describe(hscdtd_device_t *p_dev,
+                                        hscdtd_capture_device_t *p_desc);
+
+void hscdtd_capture_encode_header(const hscdtd_capture_header_t *p_header,
+                                  uint8_t *p_buffer);
+
+hscdtd_status_t hscdtd_capture_decode_header(const uint8_t *p_buffer,
+                                             hscdtd_capture_header_t *p_header);
+
+void hscdtd_capture_encode_device(const hscdtd_capture_device_t *p_desc,
+                                  uint8_t *p_buffer);
+
+void hscdtd_capture_decode_device(const uint8_t *p_buffer,
+                                  hscdtd_capture_device_t *p_desc);
+
+void hscdtd_capture_encode_record(const hscdtd_capture_record_t *p_record,
+                                  uint8_t *p_buffer);
+
+void hscdtd_capture_decode_record(const uint8_t *p_buffer,
+                                  hscdtd_capture_record_t *p_record);
+
+void hscdtd_capture_from_sample(const hscdtd_sample_t *p_sample,
+                                uint8_t device,
+                                hscdtd_capture_record_t *p_record);
+
+void hscdtd_capture_to_sample(const hscdtd_capture_record_t *p_record,
+                              hscdtd_sample_t *p_sample);
+
+
+#ifdef RPI
+// Appends records to a memory mapped file.
+typedef struct {
+    int fd;
+    uint8_t *p_map;
+    size_t capacity;
+    size_t size;
+    uint32_t records;
+    // Previous sample timestamp and its 64 bit time.
+    uint32_t last_ts;
+    uint64_t last_us;
+} hscdtd_capture_writer_t;
+
+
+// Replays a capture from a read-only memory mapped file.
+typedef struct {
+    const uint8_t *p_map;
+    size_t map_size;
+    hscdtd_capture_header_t header;
+    hscdtd_capture_device_t devices[HSCDTD_CAPTURE_MAX_DEVICES];
+    uint32_t records;
+    uint32_t next;
+    // 64 bit time of the sample last returned by hscdtd_capture_next.
+    uint64_t timestamp_us;
+} hscdtd_capture_reader_t;
+
+
+hscdtd_status_t hscdtd_capture_open_write(hscdtd_capture_writer_t *p_writer,
+                                          const char *path,
+                                          const hscdtd_capture_device_t *p_devices,
+                                          uint8_t n_devices);
+
+hscdtd_status_t hscdtd_capture_append(hscdtd_capture_writer_t *p_writer,
+                                      uint8_t device,
+                                      const hscdtd_sample_t *p_sample);
+
+hscdtd_status_t hscdtd_capture_sync(hscdtd_capture_writer_t *p_writer);
+
+hscdtd_status_t hscdtd_capture_close_write(hscdtd_capture_writer_t *p_writer);
+
+hscdtd_status_t hscdtd_capture_open_read(hscdtd_capture_reader_t *p_reader,
+                                         const char *path);
+
+hscdtd_status_t hscdtd_capture_next(hscdtd_capture_reader_t *p_reader,
+                                    hscdtd_sample_t *p_sample,
+                                    uint8_t *p_device);
+
+hscdtd_status_t hscdtd_capture_seek(hscdtd_capture_reader_t *p_reader,
+                                    uint32_t index);
+
+hscdtd_status_t hscdtd_capture_close_read(hscdtd_capture_reader_t *p_reader);
+#endif  // RPI
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_CAPTURE__
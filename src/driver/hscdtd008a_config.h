@@ -0,0 +1,93 @@
+#ifndef __HSCDTD008A_CONFIG__
+#define __HSCDTD008A_CONFIG__
+
+/**
+ * Compile-time configuration of the driver.
+ *
+ * Options can be enabled here or passed as compiler flags (-D...).
+ */
+
+/**
+ * Handle samples, offsets and magnitudes in fixed-point only.
+ *
+ * Samples are converted to integer nT (150nT/LSB, exact) and the float
+ * API (hscdtd_measure, hscdtd_read_magnetodata, hscdtd_set_offset) is not
+ * compiled, so no soft-float code is linked for the conversion path.
+ */
+// #define HSCDTD_FIXED_POINT
+
+/**
+ * Do not use the t_* functions of platform.h as the default transport.
+ *
+ * Every device must be given a transport with hscdtd_set_transport before
+ * it is initialized. For programs that only use other transports, such as
+ * the fake transport, on a platform without t_* functions.
+ */
+// #define HSCDTD_NO_PLATFORM_TRANSPORT
+
+/**
+ * Leave out features that a node does not use. Each removes the functions
+ * named, in C and in the C++ classes, and the code that only they reach:
+ *  - HSCDTD_NO_FIFO: hscdtd_set_fifo_*, the HSCDTD_STREAM_FIFO source.
+ *  - HSCDTD_NO_DRDY_CONFIG: hscdtd_set_data_ready_pin_*, the
+ *    HSCDTD_STREAM_DRDY source. Polling data ready and
+ *    hscdtd_mark_data_ready remain.
+ *  - HSCDTD_NO_SELF_TEST: hscdtd_self_test, hscdtd_initialize only checks
+ *    the Who I Am register.
+ *  - HSCDTD_NO_TEMP_COMP: hscdtd_temperature_compensation,
+ *    hscdtd_read_temp, tcs_every of a duty cycle.
+ *  - HSCDTD_NO_OFFSET_CAL: hscdtd_offset_calibration.
+ *  - HSCDTD_NO_LATENCY: hscdtd_set_latency, samples are not recorded in
+ *    latency histograms.
+ *  - HSCDTD_NO_TIMING: the interval statistics of hscdtd_device_t.timing
+ *    and hscdtd_reset_timing. Samples are still flagged.
+ *  - HSCDTD_NO_RETRY: the retry policy, every transfer is attempted once.
+ * Operations of a removed kind fail with HSCDTD_STAT_USER_ERROR in
+ * hscdtd_op_init.
+ */
+// #define HSCDTD_NO_FIFO
+// #define HSCDTD_NO_DRDY_CONFIG
+// #define HSCDTD_NO_SELF_TEST
+// #define HSCDTD_NO_TEMP_COMP
+// #define HSCDTD_NO_OFFSET_CAL
+// #define HSCDTD_NO_LATENCY
+// #define HSCDTD_NO_TIMING
+// #define HSCDTD_NO_RETRY
+
+/**
+ * Smallest build, for a node that only measures in the force state: all
+ * of the above and HSCDTD_FIXED_POINT. See the size report in the readme.
+ */
+// #define HSCDTD_MINIMAL
+
+#ifdef HSCDTD_MINIMAL
+#ifndef HSCDTD_FIXED_POINT
+#define HSCDTD_FIXED_POINT
+#endif
+#ifndef HSCDTD_NO_FIFO
+#define HSCDTD_NO_FIFO
+#endif
+#ifndef HSCDTD_NO_DRDY_CONFIG
+#define HSCDTD_NO_DRDY_CONFIG
+#endif
+#ifndef HSCDTD_NO_SELF_TEST
+#define HSCDTD_NO_SELF_TEST
+#endif
+#ifndef HSCDTD_NO_TEMP_COMP
+#define HSCDTD_NO_TEMP_COMP
+#endif
+#ifndef HSCDTD_NO_OFFSET_CAL
+#define HSCDTD_NO_OFFSET_CAL
+#endif
+#ifndef HSCDTD_NO_LATENCY
+#define HSCDTD_NO_LATENCY
+#endif
+#ifndef HSCDTD_NO_TIMING
+#define HSCDTD_NO_TIMING
+#endif
+#ifndef HSCDTD_NO_RETRY
+#define HSCDTD_NO_RETRY
+#endif
+#endif  // HSCDTD_MINIMAL
+
+#endif  //__HSCDTD008A_CONFIG__
@@ -3,10 +3,17 @@
 #include "platform.h"
 #include "transport.h"
 
+// hscdtd_device_t.lock_magic of an initialized lock.
+#define HSCDTD_LOCK_MAGIC               0x4C4B
+
 
 /**
  * @brief Configure the virtual device.
  *
+ * The device may be configured again while another thread uses it, its
+ * lock is initialized the first time only and held while the device is
+ * reset.
+ *
  * @param p_dev Pointer to device struct.
  * @param addr I2C addres of the device.
  * @return hscdtd_status.
@@ -14,10 +21,30 @@
 hscdtd_status_t hscdtd_configure_virtual_device(hscdtd_device_t *p_dev,
                                                 uint8_t addr)
 {
+#ifndef HSCDTD_NO_RETRY
+    hscdtd_retry_policy_t retry = HSCDTD_RETRY_POLICY_DEFAULT;
+#endif  // HSCDTD_NO_RETRY
+
     if (!p_dev) {
         return HSCDTD_STAT_ERROR;
     }
+
+    // Initializing a held mutex is undefined.
+    if (p_dev->lock_magic != HSCDTD_LOCK_MAGIC) {
+        hscdtd_mutex_init(&p_dev->lock, 1);
+        p_dev->lock_magic = HSCDTD_LOCK_MAGIC;
+    }
+    hscdtd_mutex_lock(&p_dev->lock);
+
     p_dev->addr = addr;
+    p_dev->reg_shadow_valid = 0;
+#ifndef HSCDTD_NO_PLATFORM_TRANSPORT
+    hscdtd_attach_bus(p_dev, &hscdtd_platform_bus);
+#else
+    p_dev->p_transport = 0;
+    p_dev->p_transport_ctx = 0;
+    p_dev->p_bus = 0;
+#endif  // HSCDTD_NO_PLATFORM_TRANSPORT
 
     // The force state is the default state for the device.
     p_dev->state = HSCDTD_STATE_FORCE;
@@ -25,33 +52,104 @@ hscdtd_status_t hscdtd_configure_virtual_device(hscdtd_device_t *p_dev,
     // Standby is the default mode.
     p_dev->mode = HSCDTD_MODE_STANDBY;
 
+    // 10Hz is the default output data rate.
+    p_dev->odr = HSCDTD_ODR_10HZ;
+
+    p_dev->window_valid = 0;
+    p_dev->drdy_marked = 0;
+    p_dev->trigger_valid = 0;
+    p_dev->p_latency = 0;
+    p_dev->overrun = 0;
+    p_dev->status_read = 0;
+    p_dev->seq = 0;
+    p_dev->odr_seq = 0;
+    p_dev->odr_resync = 1;
+#ifndef HSCDTD_NO_TIMING
+    hscdtd_reset_timing(p_dev);
+#endif  // HSCDTD_NO_TIMING
+    hscdtd_reset_quality(p_dev);
+#ifndef HSCDTD_NO_RETRY
+    p_dev->retry = retry;
+    hscdtd_reset_retry_stats(p_dev);
+#endif  // HSCDTD_NO_RETRY
+#ifndef HSCDTD_NO_FIFO
+    p_dev->fifo_enabled = 0;
+#endif  // HSCDTD_NO_FIFO
+
+    hscdtd_mutex_unlock(&p_dev->lock);
     return HSCDTD_STAT_OK;
 }
 
 
 /**
- * @brief Initialize the device.
+ * @brief Use another transport for the device.
+ *
+ * Call after hscdtd_configure_virtual_device and before the device is
+ * initialized. The device is not on a bus after this, its transactions are
+ * not locked. Use hscdtd_attach_bus if the transport is shared by threads.
  *
  * @param p_dev Pointer to device struct.
+ * @param p_transport Transport operations.
+ * @param p_ctx Context passed to every operation.
  * @return hscdtd_status.
  */
-hscdtd_status_t hscdtd_initialize(hscdtd_device_t *p_dev)
+hscdtd_status_t hscdtd_set_transport(hscdtd_device_t *p_dev,
+                                     const hscdtd_transport_t *p_transport,
+                                     void *p_ctx)
 {
-    int8_t i;
-    hscdtd_status_t status;
+    if (!p_dev || !p_transport) {
+        return HSCDTD_STAT_ERROR;
+    }
 
-    // Check if the device pointer is valid.
-    // Only do this during initialization, after that we can assume
-    // that the pointer is valid.
-    if (!p_dev) {
+    // Reads, writes, sleep and time are required.
+    if (!p_transport->read || !p_transport->write ||
+        !p_transport->sleep_ms || !p_transport->now_us) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    p_dev->p_transport = p_transport;
+    p_dev->p_transport_ctx = p_ctx;
+    p_dev->p_bus = 0;
+    p_dev->reg_shadow_valid = 0;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Put the device on a bus.
+ *
+ * The device uses the transport of the bus, and its transactions are
+ * serialized with those of the other devices on the bus.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_bus Pointer to bus struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_attach_bus(hscdtd_device_t *p_dev,
+                                  hscdtd_bus_t *p_bus)
+{
+    if (!p_dev || !p_bus || !p_bus->p_transport) {
         return HSCDTD_STAT_ERROR;
     }
 
+    p_dev->p_transport = p_bus->p_transport;
+    p_dev->p_transport_ctx = p_bus->p_transport_ctx;
+    p_dev->p_bus = p_bus;
+    return HSCDTD_STAT_OK;
+}
+
+
+// Body of hscdtd_initialize, called with the device lock held.
+static hscdtd_status_t initialize_locked(hscdtd_device_t *p_dev)
+{
+    int8_t i;
+    hscdtd_status_t status;
+
     // Open transport.
-    t_open();
+    transport_open(p_dev);
 
     // Wait a bit for the I2C bus to open.
-    t_sleep_ms(100);
+    transport_sleep_ms(p_dev, 100);
 
     // Reset the chip to make sure register have expected values.
     // Some chips behave weird when starting up. So we have to try a bunch
@@ -60,7 +158,7 @@ hscdtd_status_t hscdtd_initialize(hscdtd_device_t *p_dev)
         status = hscdtd_soft_reset(p_dev);
         if (status == HSCDTD_STAT_OK)
             break;
-        t_sleep_ms(5);
+        transport_sleep_ms(p_dev, 5);
     }
 
     // Check if reset went OK.
@@ -68,37 +166,86 @@ hscdtd_status_t hscdtd_initialize(hscdtd_device_t *p_dev)
         return status;
 
     // Wait bit before getting started.
-    t_sleep_ms(50);
+    transport_sleep_ms(p_dev, 50);
 
     // Check Who I Am
     status = hscdtd_who_i_am_check(p_dev);
     if (status != HSCDTD_STAT_OK)
         return status;
     
-    // Explicitly set the device to force state
-    status = hscdtd_set_state(p_dev, HSCDTD_STATE_FORCE);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
     // Set output resolution to 15 bits.
     status = hscdtd_set_resolution(p_dev, HSCDTD_RESOLUTION_15_BIT);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    // Set the device to active.
-    status = hscdtd_set_mode(p_dev, HSCDTD_MODE_ACTIVE);
+    // Explicitly set the device to force state, and set it to active.
+    // Both fields are in CTRL1, so this is a single read-modify-write.
+    status = update_register(p_dev, HSCDTD_REG_CTRL1,
+                             HSCDTD_CTRL1_FS_MSK | HSCDTD_CTRL1_PC_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL1_FS, HSCDTD_STATE_FORCE) |
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL1_PC, HSCDTD_MODE_ACTIVE));
     if (status != HSCDTD_STAT_OK)
         return status;
 
+    p_dev->state = HSCDTD_STATE_FORCE;
+    p_dev->mode = HSCDTD_MODE_ACTIVE;
+
+#ifndef HSCDTD_NO_SELF_TEST
     // Do a selftest
     status = hscdtd_self_test(p_dev);
     if (status != HSCDTD_STAT_OK)
         return status;
+#endif  // HSCDTD_NO_SELF_TEST
 
     return HSCDTD_STAT_OK;
 }
 
 
+/**
+ * @brief Initialize the device.
+ *
+ * @param p_dev Pointer to device struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_initialize(hscdtd_device_t *p_dev)
+{
+    hscdtd_status_t status;
+
+    // Check if the device pointer is valid.
+    // Only do this during initialization, after that we can assume
+    // that the pointer is valid.
+    if (!p_dev) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = initialize_locked(p_dev);
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
+
+
+/**
+ * @brief Forget the register values kept by the driver.
+ *
+ * The driver keeps the last value of the control and offset registers it
+ * wrote, to update them without reading. Call this if the device may have
+ * lost its configuration without a soft reset by the driver, such as after
+ * a power cycle. To restore the configuration instead, see
+ * hscdtd008a_health.h.
+ *
+ * @param p_dev Pointer to device struct.
+ */
+void hscdtd_invalidate_registers(hscdtd_device_t *p_dev)
+{
+    if (p_dev->p_bus)
+        hscdtd_bus_lock(p_dev->p_bus);
+    p_dev->reg_shadow_valid = 0;
+    if (p_dev->p_bus)
+        hscdtd_bus_unlock(p_dev->p_bus);
+}
+
+
 /* --------------------------------------------------
  * CTRL1 Settings
  */
@@ -125,22 +272,16 @@ hscdtd_status_t hscdtd_initialize(hscdtd_device_t *p_dev)
 hscdtd_status_t hscdtd_set_mode(hscdtd_device_t *p_dev, hscdtd_mode_t mode)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL1_t reg;
-
-    status = read_register(p_dev, HSCDTD_REG_CTRL1, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
-    reg.PC = mode;
-
-    status = write_register(p_dev, HSCDTD_REG_CTRL1, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
 
-    // All is ok now, update device mode.
-    p_dev->mode = mode;
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = update_register(p_dev, HSCDTD_REG_CTRL1, HSCDTD_CTRL1_PC_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL1_PC, mode));
+    // If all is ok, update device mode.
+    if (status == HSCDTD_STAT_OK)
+        p_dev->mode = mode;
+    hscdtd_mutex_unlock(&p_dev->lock);
 
-    return HSCDTD_STAT_OK;
+    return status;
 }
 
 
@@ -166,19 +307,19 @@ hscdtd_status_t hscdtd_set_output_data_rate(hscdtd_device_t *p_dev,
                                             hscdtd_odr_t odr)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL1_t reg;
-
-    status = read_register(p_dev, HSCDTD_REG_CTRL1, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
 
-    reg.ODR = odr;
-
-    status = write_register(p_dev, HSCDTD_REG_CTRL1, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = update_register(p_dev, HSCDTD_REG_CTRL1, HSCDTD_CTRL1_ODR_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL1_ODR, odr));
+    // Samples are stamped with the lock held, they see the old or the new
+    // rate.
+    if (status == HSCDTD_STAT_OK && odr != p_dev->odr) {
+        p_dev->odr = odr;
+        p_dev->odr_resync = 1;
+    }
+    hscdtd_mutex_unlock(&p_dev->lock);
 
-    return HSCDTD_STAT_OK;
+    return status;
 }
 
 
@@ -202,22 +343,24 @@ hscdtd_status_t hscdtd_set_state(hscdtd_device_t *p_dev,
                                  hscdtd_state_t state)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL1_t reg;
-
-    status = read_register(p_dev, HSCDTD_REG_CTRL1, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
-    reg.FS = state;
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL1, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
-    // All is ok now, we can update the device state.
-    p_dev->state = state;
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = update_register(p_dev, HSCDTD_REG_CTRL1, HSCDTD_CTRL1_FS_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL1_FS, state));
+    // If all is ok, we can update the device state.
+    if (status == HSCDTD_STAT_OK) {
+        if (state != p_dev->state)
+            p_dev->odr_resync = 1;
+        p_dev->state = state;
+        // CTRL1 is known after the update, take the rate the device
+        // runs at even if it was never set.
+        if (p_dev->reg_shadow_valid & (1 << HSCDTD_SHADOW_CTRL1))
+            p_dev->odr = (hscdtd_odr_t) HSCDTD_FIELD_GET(HSCDTD_CTRL1_ODR,
+                p_dev->reg_shadow[HSCDTD_SHADOW_CTRL1]);
+    }
+    hscdtd_mutex_unlock(&p_dev->lock);
 
-    return HSCDTD_STAT_OK;
+    return status;
 }
 
 
@@ -226,6 +369,7 @@ hscdtd_status_t hscdtd_set_state(hscdtd_device_t *p_dev,
  */
 
 
+#ifndef HSCDTD_NO_FIFO
 /**
  * @brief Set the fifo data storage method.
  *
@@ -247,15 +391,9 @@ hscdtd_status_t hscdtd_set_fifo_data_storage_method(hscdtd_device_t *p_dev,
                                                     hscdtd_fco_t fco)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL2_t reg;
-
-    status = read_register(p_dev, HSCDTD_REG_CTRL2, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
-    reg.FCO = fco;
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL2, &reg);
+    status = update_register(p_dev, HSCDTD_REG_CTRL2, HSCDTD_CTRL2_FCO_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL2_FCO, fco));
     if (status != HSCDTD_STAT_OK)
         return status;
 
@@ -285,15 +423,9 @@ hscdtd_status_t hscdtd_set_fifo_comparision_method(hscdtd_device_t *p_dev,
                                                    hscdtd_aor_t aor)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL2_t reg;
-
-    status = read_register(p_dev, HSCDTD_REG_CTRL2, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
-    reg.AOR = aor;
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL2, &reg);
+    status = update_register(p_dev, HSCDTD_REG_CTRL2, HSCDTD_CTRL2_AOR_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL2_AOR, aor));
     if (status != HSCDTD_STAT_OK)
         return status;
 
@@ -320,22 +452,18 @@ hscdtd_status_t hscdtd_set_fifo_enable(hscdtd_device_t *p_dev,
                                        hscdtd_ff_t ff)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL2_t reg;
-
-    status = read_register(p_dev, HSCDTD_REG_CTRL2, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
-    reg.FF = ff;
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL2, &reg);
+    status = update_register(p_dev, HSCDTD_REG_CTRL2, HSCDTD_CTRL2_FF_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL2_FF, ff));
     if (status != HSCDTD_STAT_OK)
         return status;
 
     return HSCDTD_STAT_OK;
 }
+#endif  // HSCDTD_NO_FIFO
 
 
+#ifndef HSCDTD_NO_DRDY_CONFIG
 /**
  * @brief Set the data ready pin enable status.
  *
@@ -356,15 +484,9 @@ hscdtd_status_t hscdtd_set_data_ready_pin_enable(hscdtd_device_t *p_dev,
                                                  hscdtd_den_t den)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL2_t reg;
-
-    status = read_register(p_dev, HSCDTD_REG_CTRL2, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
-    reg.DEN = den;
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL2, &reg);
+    status = update_register(p_dev, HSCDTD_REG_CTRL2, HSCDTD_CTRL2_DEN_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL2_DEN, den));
     if (status != HSCDTD_STAT_OK)
         return status;
 
@@ -394,20 +516,15 @@ hscdtd_status_t hscdtd_set_data_ready_pin_polarity(hscdtd_device_t *p_dev,
                                                    hscdtd_drp_t drp)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL2_t reg;
-
-    status = read_register(p_dev, HSCDTD_REG_CTRL2, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
-    reg.DRP = drp;
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL2, &reg);
+    status = update_register(p_dev, HSCDTD_REG_CTRL2, HSCDTD_CTRL2_DRP_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL2_DRP, drp));
     if (status != HSCDTD_STAT_OK)
         return status;
 
     return HSCDTD_STAT_OK;
 }
+#endif  // HSCDTD_NO_DRDY_CONFIG
 
 
 /* --------------------------------------------------
@@ -432,15 +549,9 @@ hscdtd_status_t hscdtd_set_resolution(hscdtd_device_t *p_dev,
                                       hscdtd_res_t resolution)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL4_t reg;
-
-    status = read_register(p_dev, HSCDTD_REG_CTRL4, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
-
-    reg.RS = resolution;
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL4, &reg);
+    status = update_register(p_dev, HSCDTD_REG_CTRL4, HSCDTD_CTRL4_RS_MSK,
+                             HSCDTD_FIELD_PREP(HSCDTD_CTRL4_RS, resolution));
     if (status != HSCDTD_STAT_OK)
         return status;
 
@@ -475,74 +586,113 @@ hscdtd_status_t hscdtd_who_i_am_check(hscdtd_device_t *p_dev)
     return HSCDTD_STAT_OK;
 }
 
-/**
- * @brief Start ADC offset calibration.
- *
- * Refer to 'Offset calibration function' on page 9
- * of the datasheet for more information.
- *
- * Device state is temporarily changed to 'force' if
- * inital state is not the 'force' state.
- *
- * @param p_dev Pointer to device struct.
- * @return hscdtd_status.
- */
-hscdtd_status_t hscdtd_offset_calibration(hscdtd_device_t *p_dev)
+
+// Polls of a status bit before an operation gives up, 1ms apart.
+#define HSCDTD_OP_POLLS                 50
+// Polls for a sample in the normal state, covers the slowest output rate.
+#define HSCDTD_OP_READ_POLLS            2500
+
+
+// Suspend the operation for delay_ms.
+static hscdtd_status_t op_pending(hscdtd_op_t *p_op, uint32_t delay_ms)
+{
+    p_op->delay_ms = delay_ms;
+    return HSCDTD_STAT_PENDING;
+}
+
+
+// Poll for data ready, then read the sample.
+static hscdtd_status_t op_wait_sample(hscdtd_op_t *p_op, uint16_t max_polls)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL3_t reg;
-    hscdtd_state_t old_state = p_dev->state;
 
-    // Set the state to the force state.
-    status = hscdtd_set_state(p_dev, HSCDTD_STATE_FORCE);
+    status = hscdtd_data_ready(p_op->p_dev);
+    if (status == HSCDTD_STAT_NO_DATA && ++p_op->polls < max_polls)
+        return op_pending(p_op, 1);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    status = read_register(p_dev, HSCDTD_REG_CTRL3, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
+    return hscdtd_read_sample(p_op->p_dev, p_op->p_sample);
+}
 
-    reg.OCL = 1;
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL3, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
+static hscdtd_status_t op_measure(hscdtd_op_t *p_op)
+{
+    hscdtd_status_t status;
+    uint8_t stat;
 
-    // Set old state back.
-    status = hscdtd_set_state(p_dev, old_state);
+    if (p_op->step == 0) {
+        // Read the status register to clear any status bits.
+        status = read_register(p_op->p_dev, HSCDTD_REG_STATUS, &stat);
+        // 'status' is the return value of the register read function, not
+        // the content of the register.
+        if (status != HSCDTD_STAT_OK)
+            return status;
+
+        // Start measurement
+        status = hscdtd_force_trigger(p_op->p_dev);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+        p_op->step = 1;
+    }
+
+    // Wait until data is ready.
+    return op_wait_sample(p_op, HSCDTD_OP_POLLS);
+}
+
+
+#ifndef HSCDTD_NO_TEMP_COMP
+static hscdtd_status_t op_temperature_compensation(hscdtd_op_t *p_op)
+{
+    hscdtd_device_t *p_dev = p_op->p_dev;
+    hscdtd_status_t status;
+    uint8_t stat;
+
+    if (p_op->step == 0) {
+        p_op->old_state = p_dev->state;
+
+        // Set the state to the force state.
+        status = hscdtd_set_state(p_dev, HSCDTD_STATE_FORCE);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+
+        status = update_register(p_dev, HSCDTD_REG_CTRL3,
+                                 HSCDTD_CTRL3_TCS_MSK, HSCDTD_CTRL3_TCS_MSK);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+
+        p_op->step = 1;
+        return op_pending(p_op, 1);
+    }
+
+    // Read status register to check if temp data is ready.
+    status = read_register(p_dev, HSCDTD_REG_STATUS, &stat);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    return HSCDTD_STAT_OK;
+    if (!HSCDTD_FIELD_GET(HSCDTD_STATUS_TRDY, stat)) {
+        // Check status for ~50ms (Duration does not really matter).
+        // If no temperature after that, something has gone wrong.
+        if (++p_op->polls < HSCDTD_OP_POLLS)
+            return op_pending(p_op, 1);
+        return HSCDTD_STAT_ERROR;
+    }
+
+    // The datasheet specifies that the bit is cleared after reading the
+    // TEMP register. We don't need the value here.
+    hscdtd_read_temp(p_dev);
+
+    // Set old state back.
+    return hscdtd_set_state(p_dev, p_op->old_state);
 }
+#endif  // HSCDTD_NO_TEMP_COMP
 
 
-/**
- * @brief Starts temperature compenstation.
- *
- * Reads temperature and calibrates sensor values
- * based on measured temperature.
- *
- * Must be called explicitly each time temperature
- * compensation is required. The temperature measured,
- * is used for all future compensation, even if the
- * temperature changes.
- *
- * Device state is temporarily changed to 'force' if
- * inital state is not the 'force' state.
- *
- * Refer to 'Temperature Measurement and Compensation Function'
- * on page 9 of the datasheet for more information.
- *
- * @param p_dev Pointer to device struct.
- * @return hscdtd_status.
- */
-hscdtd_status_t hscdtd_temperature_compensation(hscdtd_device_t *p_dev)
+#ifndef HSCDTD_NO_OFFSET_CAL
+static hscdtd_status_t op_offset_calibration(hscdtd_op_t *p_op)
 {
+    hscdtd_device_t *p_dev = p_op->p_dev;
     hscdtd_status_t status;
-    int8_t i;
-    HSCDTD_CTRL3_t reg;
-    HSCDTD_STAT_t stat;
     hscdtd_state_t old_state = p_dev->state;
 
     // Set the state to the force state.
@@ -550,155 +700,293 @@ hscdtd_status_t hscdtd_temperature_compensation(hscdtd_device_t *p_dev)
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    status = read_register(p_dev, HSCDTD_REG_CTRL3, &reg);
+    status = update_register(p_dev, HSCDTD_REG_CTRL3, HSCDTD_CTRL3_OCL_MSK,
+                             HSCDTD_CTRL3_OCL_MSK);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    reg.TCS = 1;
+    // Set old state back.
+    return hscdtd_set_state(p_dev, old_state);
+}
+#endif  // HSCDTD_NO_OFFSET_CAL
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL3, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
 
-    status = HSCDTD_STAT_ERROR;
-    // Attempt to check status for ~50ms (Duration does not really matter).
-    // If no temperature after that, something has gone wrong.
-    for (i = 0; i < 50; i++) {
-        t_sleep_ms(1);
+#ifndef HSCDTD_NO_SELF_TEST
+static hscdtd_status_t op_self_test(hscdtd_op_t *p_op)
+{
+    hscdtd_device_t *p_dev = p_op->p_dev;
+    hscdtd_status_t status;
+    uint8_t self_test_resp;
 
-        // Read status register to check if temp data is ready.
-        status = read_register(p_dev, HSCDTD_REG_STATUS, &stat);
+    if (p_op->step == 0) {
+        status = update_register(p_dev, HSCDTD_REG_CTRL3,
+                                 HSCDTD_CTRL3_STC_MSK, HSCDTD_CTRL3_STC_MSK);
         if (status != HSCDTD_STAT_OK)
             return status;
 
-        if (stat.TRDY == 1) {
-            // The datasheet specifies that the bit is cleared after
-            // reading the TEMP register.
-            // We don't need the value here, so we don't need the return
-            // value.
-            hscdtd_read_temp(p_dev);
-            status = HSCDTD_STAT_OK;
-            break;
-        }
+        // Wait a bit for the result.
+        // This is not specified in the datasheet, but just to be safe.
+        p_op->step = 1;
+        return op_pending(p_op, 5);
     }
 
+    // According to page 6 of the datasheet value of STB should be 0xAA at
+    // first read.
+    status = read_register(p_dev, HSCDTD_REG_SELFTEST_RESP, &self_test_resp);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    // Set old state back.
-    status = hscdtd_set_state(p_dev, old_state);
+    if (self_test_resp != 0xAA)
+        return HSCDTD_STAT_CHECK_FAILED;
+
+    // After reading again value should be 0x55.
+    status = read_register(p_dev, HSCDTD_REG_SELFTEST_RESP, &self_test_resp);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    return status;
+    if (self_test_resp != 0x55)
+        return HSCDTD_STAT_CHECK_FAILED;
+
+    // If all those test passed, the test is successful.
+    return HSCDTD_STAT_OK;
 }
+#endif  // HSCDTD_NO_SELF_TEST
+
 
 /**
- * @brief Gets formatted temperature.
- *
- * This function reads the temperature that is stored
- * in the 'TEMP' register of the device.
+ * @brief Prepare an operation that can be suspended.
  *
- * This function does not start a temperature reading.
+ * Operations do not sleep, hscdtd_op_step returns HSCDTD_STAT_PENDING
+ * with the time to wait before the next step instead. Between steps the
+ * device must not be used for anything else.
  *
+ * @param p_op Pointer to the operation.
  * @param p_dev Pointer to device struct.
- * @return Temperature as signed integer.
+ * @param kind Operation to run.
+ * @param p_sample Sample for HSCDTD_OP_MEASURE and HSCDTD_OP_READ, else
+ *                 NULL.
+ * @return hscdtd_status.
  */
-int8_t hscdtd_read_temp(hscdtd_device_t *p_dev)
+hscdtd_status_t hscdtd_op_init(hscdtd_op_t *p_op, hscdtd_device_t *p_dev,
+                               hscdtd_op_kind_t kind,
+                               hscdtd_sample_t *p_sample)
 {
-    int8_t temp;
-
-    // We can safely cast the uint8_t to a int8_t as the the value of the
-    // value is formatted as int8_t.
-    read_register(p_dev, HSCDTD_REG_TEMP, &temp);
-    // Ignore read register status.
-
-    return temp;
-}
-
+    if (!p_op || !p_dev) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if ((kind == HSCDTD_OP_MEASURE || kind == HSCDTD_OP_READ) && !p_sample) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (kind > HSCDTD_OP_SELF_TEST) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+#ifdef HSCDTD_NO_TEMP_COMP
+    if (kind == HSCDTD_OP_TEMPERATURE_COMPENSATION) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+#endif  // HSCDTD_NO_TEMP_COMP
+#ifdef HSCDTD_NO_OFFSET_CAL
+    if (kind == HSCDTD_OP_OFFSET_CALIBRATION) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+#endif  // HSCDTD_NO_OFFSET_CAL
+#ifdef HSCDTD_NO_SELF_TEST
+    if (kind == HSCDTD_OP_SELF_TEST) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+#endif  // HSCDTD_NO_SELF_TEST
+
+    p_op->p_dev = p_dev;
+    p_op->p_sample = p_sample;
+    p_op->kind = kind;
+    p_op->step = 0;
+    p_op->polls = 0;
+    p_op->delay_ms = 0;
+    p_op->status = HSCDTD_STAT_PENDING;
+    return HSCDTD_STAT_OK;
+}
+
 
 /**
- * @brief Perform a selftest on the chip.
- *
- * Refer to 'Selftest' on page 6 of the datasheet for more information.
+ * @brief Run the next step of an operation.
  *
- * @param p_dev Pointer to device struct.
- * @return hscdtd_status.
+ * @param p_op Pointer to the operation.
+ * @return HSCDTD_STAT_PENDING to be called again after p_op->delay_ms,
+ *         else the result of the operation.
  */
-hscdtd_status_t hscdtd_self_test(hscdtd_device_t *p_dev)
+hscdtd_status_t hscdtd_op_step(hscdtd_op_t *p_op)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL3_t reg;
-    uint8_t self_test_resp;
 
-    status = read_register(p_dev, HSCDTD_REG_CTRL3, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
+    if (!p_op || !p_op->p_dev) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_op->status != HSCDTD_STAT_PENDING)
+        return p_op->status;
+
+    hscdtd_mutex_lock(&p_op->p_dev->lock);
+    switch (p_op->kind) {
+    case HSCDTD_OP_MEASURE:
+        status = op_measure(p_op);
+        break;
+    case HSCDTD_OP_READ:
+        status = op_wait_sample(p_op, HSCDTD_OP_READ_POLLS);
+        break;
+#ifndef HSCDTD_NO_TEMP_COMP
+    case HSCDTD_OP_TEMPERATURE_COMPENSATION:
+        status = op_temperature_compensation(p_op);
+        break;
+#endif  // HSCDTD_NO_TEMP_COMP
+#ifndef HSCDTD_NO_OFFSET_CAL
+    case HSCDTD_OP_OFFSET_CALIBRATION:
+        status = op_offset_calibration(p_op);
+        break;
+#endif  // HSCDTD_NO_OFFSET_CAL
+#ifndef HSCDTD_NO_SELF_TEST
+    case HSCDTD_OP_SELF_TEST:
+        status = op_self_test(p_op);
+        break;
+#endif  // HSCDTD_NO_SELF_TEST
+    default:
+        status = HSCDTD_STAT_USER_ERROR;
+        break;
+    }
+    hscdtd_mutex_unlock(&p_op->p_dev->lock);
 
-    reg.STC = 1;
+    p_op->status = status;
+    return status;
+}
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL3, &reg);
-    if (status != HSCDTD_STAT_OK)
-        return status;
 
-    // Wait a bit for the result.
-    // This is not specified in the datasheet, but just to be safe.
-    t_sleep_ms(5);
+// Run an operation to the end, sleeping while it is pending. The device
+// lock is held throughout.
+static hscdtd_status_t op_run(hscdtd_device_t *p_dev, hscdtd_op_kind_t kind,
+                              hscdtd_sample_t *p_sample)
+{
+    hscdtd_op_t op;
+    hscdtd_status_t status;
 
-    // According to page 6 of the datasheet value of STB should be 0xAA at
-    // first read.
-    status = read_register(p_dev, HSCDTD_REG_SELFTEST_RESP, &self_test_resp);
+    status = hscdtd_op_init(&op, p_dev, kind, p_sample);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    if (self_test_resp != 0xAA)
-        return HSCDTD_STAT_CHECK_FAILED;
-
-    // After reading again value should be 0x55.
-    status = read_register(p_dev, HSCDTD_REG_SELFTEST_RESP, &self_test_resp);
-    if (status != HSCDTD_STAT_OK)
-        return status;
+    hscdtd_mutex_lock(&p_dev->lock);
+    while ((status = hscdtd_op_step(&op)) == HSCDTD_STAT_PENDING)
+        transport_sleep_ms(p_dev, op.delay_ms);
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
 
-    if (self_test_resp != 0x55)
-        return HSCDTD_STAT_CHECK_FAILED;
 
-    // If all those test passed, the test is successful.
-    return HSCDTD_STAT_OK;
+#ifndef HSCDTD_NO_OFFSET_CAL
+/**
+ * @brief Start ADC offset calibration.
+ *
+ * Refer to 'Offset calibration function' on page 9
+ * of the datasheet for more information.
+ *
+ * Device state is temporarily changed to 'force' if
+ * inital state is not the 'force' state.
+ *
+ * @param p_dev Pointer to device struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_offset_calibration(hscdtd_device_t *p_dev)
+{
+    return op_run(p_dev, HSCDTD_OP_OFFSET_CALIBRATION, 0);
 }
+#endif  // HSCDTD_NO_OFFSET_CAL
 
 
+#ifndef HSCDTD_NO_TEMP_COMP
 /**
- * @brief Soft reset the device.
+ * @brief Starts temperature compenstation.
  *
- * Soft resetting the device also puts the device back into the
- * stand-by mode.
+ * Reads temperature and calibrates sensor values
+ * based on measured temperature.
  *
- * Device must be reconfigured after soft reset.
+ * Must be called explicitly each time temperature
+ * compensation is required. The temperature measured,
+ * is used for all future compensation, even if the
+ * temperature changes.
+ *
+ * Device state is temporarily changed to 'force' if
+ * inital state is not the 'force' state.
+ *
+ * Refer to 'Temperature Measurement and Compensation Function'
+ * on page 9 of the datasheet for more information.
  *
  * @param p_dev Pointer to device struct.
  * @return hscdtd_status.
  */
-hscdtd_status_t hscdtd_soft_reset(hscdtd_device_t *p_dev)
+hscdtd_status_t hscdtd_temperature_compensation(hscdtd_device_t *p_dev)
+{
+    return op_run(p_dev, HSCDTD_OP_TEMPERATURE_COMPENSATION, 0);
+}
+
+/**
+ * @brief Gets formatted temperature.
+ *
+ * This function reads the temperature that is stored
+ * in the 'TEMP' register of the device.
+ *
+ * This function does not start a temperature reading.
+ *
+ * @param p_dev Pointer to device struct.
+ * @return Temperature as signed integer.
+ */
+int8_t hscdtd_read_temp(hscdtd_device_t *p_dev)
+{
+    int8_t temp;
+
+    // We can safely cast the uint8_t to a int8_t as the the value of the
+    // value is formatted as int8_t.
+    read_register(p_dev, HSCDTD_REG_TEMP, &temp);
+    // Ignore read register status.
+
+    return temp;
+}
+#endif  // HSCDTD_NO_TEMP_COMP
+
+
+#ifndef HSCDTD_NO_SELF_TEST
+/**
+ * @brief Perform a selftest on the chip.
+ *
+ * Refer to 'Selftest' on page 6 of the datasheet for more information.
+ *
+ * @param p_dev Pointer to device struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_self_test(hscdtd_device_t *p_dev)
+{
+    return op_run(p_dev, HSCDTD_OP_SELF_TEST, 0);
+}
+#endif  // HSCDTD_NO_SELF_TEST
+
+
+// Body of hscdtd_soft_reset, called with the device lock held.
+static hscdtd_status_t soft_reset_locked(hscdtd_device_t *p_dev)
 {
     hscdtd_status_t status;
-    HSCDTD_CTRL3_t reg;
+    uint8_t reg;
 
     // The intention is to reset the device and its registers.
     // So there is no need to first read the content of the
     // register.
-    reg.SRST = 1;
+    reg = HSCDTD_CTRL3_SRST_MSK;
     status = write_register(p_dev, HSCDTD_REG_CTRL3, &reg);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    t_sleep_ms(5);  // Wait a bit for the chip to reset.
+    transport_sleep_ms(p_dev, 5);  // Wait a bit for the chip to reset.
 
     // Check if the reset went OK
     status = read_register(p_dev, HSCDTD_REG_CTRL3, &reg);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    if (reg.SRST == 1) {
+    if (HSCDTD_FIELD_GET(HSCDTD_CTRL3_SRST, reg)) {
         // If bit is set, something went wrong
         return HSCDTD_STAT_ERROR;
     }
@@ -707,66 +995,491 @@ hscdtd_status_t hscdtd_soft_reset(hscdtd_device_t *p_dev)
 }
 
 
+/**
+ * @brief Soft reset the device.
+ *
+ * Soft resetting the device also puts the device back into the
+ * stand-by mode.
+ *
+ * Device must be reconfigured after soft reset.
+ *
+ * @param p_dev Pointer to device struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_soft_reset(hscdtd_device_t *p_dev)
+{
+    hscdtd_status_t status;
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = soft_reset_locked(p_dev);
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
+
+
+/**
+ * @brief Trigger a measurement in the force state.
+ *
+ * Only starts the conversion, use hscdtd_data_ready to check for the
+ * result. This is a single register write, so devices can be triggered
+ * back-to-back with minimal delay between them.
+ *
+ * @param p_dev Pointer to device struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_force_trigger(hscdtd_device_t *p_dev)
+{
+    hscdtd_status_t status;
+    // All bits in CTRL3 start an action when set, writing 0 to the other
+    // bits has no effect. So there is no need to read the register first.
+    uint8_t reg = HSCDTD_CTRL3_FRC_MSK;
+
+    hscdtd_mutex_lock(&p_dev->lock);
+
+    // The conversion cannot end before it is started.
+    p_dev->window_start_us = transport_now_us(p_dev);
+    p_dev->window_valid = 1;
+    p_dev->drdy_marked = 0;
+    p_dev->trigger_us = p_dev->window_start_us;
+    p_dev->trigger_valid = 1;
+
+    status = write_register(p_dev, HSCDTD_REG_CTRL3, &reg);
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
+
+
+
 /**
  * @brief Start a measurement in the force state.
  *
+ * The sample is timestamped at the end of the conversion, see
+ * hscdtd_data_ready. Polling is done every 1ms, so the timestamp error is
+ * up to ~0.5ms plus the duration of a status read.
+ *
  * @param p_dev Pointer to device struct.
- * @param p_mag_data A pointer to a struct to store the data.
+ * @param p_sample A pointer to a struct to store the sample.
  * @return hscdtd_status.
  */
-hscdtd_status_t hscdtd_measure(hscdtd_device_t *p_dev,
-                               hscdtd_mag_t *p_mag_data)
+hscdtd_status_t hscdtd_measure_sample(hscdtd_device_t *p_dev,
+                                      hscdtd_sample_t *p_sample)
+{
+    return op_run(p_dev, HSCDTD_OP_MEASURE, p_sample);
+}
+
+
+/**
+ * @brief Start a measurement in the force state.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_raw_data A pointer to a struct to store the data.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_measure_raw(hscdtd_device_t *p_dev,
+                                   hscdtd_mag_raw_t *p_raw_data)
 {
     hscdtd_status_t status;
-    HSCDTD_STAT_t stat;
-    HSCDTD_CTRL3_t ctrl3;
-    int8_t i;
+    hscdtd_sample_t sample;
 
-    if (!p_mag_data) {
+    if (!p_raw_data) {
         return HSCDTD_STAT_ERROR;
     }
 
-    // Read the status register to clear any status bits.
-    status = read_register(p_dev, HSCDTD_REG_STATUS, &stat);
-    // 'status' is the return value of the register read function, not the
-    // content of the register.
+    status = hscdtd_measure_sample(p_dev, &sample);
     if (status != HSCDTD_STAT_OK)
         return status;
 
-    // Start measurement
-    status = read_register(p_dev, HSCDTD_REG_CTRL3, &ctrl3);
-    if (status != HSCDTD_STAT_OK)
-        return status;
+    *p_raw_data = sample.raw;
+    return HSCDTD_STAT_OK;
+}
 
-    ctrl3.FRC = 1;
 
-    status = write_register(p_dev, HSCDTD_REG_CTRL3, &ctrl3);
-    if (status != HSCDTD_STAT_OK)
-        return status;
+/**
+ * @brief Read a timestamped sample from the sensor.
+ *
+ * The timestamp is the end of conversion recorded by hscdtd_data_ready or
+ * hscdtd_mark_data_ready. Without either, the time of the read is used,
+ * the timestamp error is HSCDTD_TIMESTAMP_ERR_UNKNOWN and the sample is
+ * flagged HSCDTD_SAMPLE_STALE.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_sample A pointer to a struct to store the sample.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_read_sample(hscdtd_device_t *p_dev,
+                                   hscdtd_sample_t *p_sample)
+{
+    hscdtd_status_t status;
+    uint32_t timestamp;
+    uint16_t err;
+    uint8_t marked;
 
-    // Wait until data is ready.
-    for (i = 0; i < 50; i++) {
-        status = read_register(p_dev, HSCDTD_REG_STATUS, &stat);
-        if (status != HSCDTD_STAT_OK)
-            return status;
+    if (!p_sample) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    hscdtd_mutex_lock(&p_dev->lock);
+
+    // Take the mark before the read, a DRDY interrupt during the read
+    // belongs to the next sample.
+    marked = p_dev->drdy_marked;
+    if (marked) {
+        timestamp = p_dev->drdy_us;
+        err = p_dev->drdy_err_us;
+    } else {
+        timestamp = transport_now_us(p_dev);
+        err = HSCDTD_TIMESTAMP_ERR_UNKNOWN;
+    }
+    p_dev->drdy_marked = 0;
+    p_dev->window_valid = 0;
+
+    status = hscdtd_read_magnetodata_raw(p_dev, &p_sample->raw);
+    if (status == HSCDTD_STAT_OK) {
+        hscdtd_stamp_sample(p_dev, p_sample, timestamp, err);
+        if (!marked) {
+            p_sample->flags |= HSCDTD_SAMPLE_STALE;
+            p_dev->quality.stale++;
+        }
+#ifndef HSCDTD_NO_LATENCY
+        if (p_dev->p_latency)
+            hscdtd_record_latency(p_dev, p_sample, transport_now_us(p_dev));
+#endif  // HSCDTD_NO_LATENCY
+    }
+    p_dev->trigger_valid = 0;
+
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
+
+
+static const uint32_t odr_period_us[] = {
+    2000000,  // HSCDTD_ODR_0_5HZ
+    100000,   // HSCDTD_ODR_10HZ
+    50000,    // HSCDTD_ODR_20HZ
+    10000,    // HSCDTD_ODR_100HZ
+};
 
-        if (stat.DRDY == 1)
-            break;
 
-        t_sleep_ms(1);
+/**
+ * @brief Get the period of an output data rate.
+ *
+ * @param odr Output data rate.
+ * @return Period in us, 0 for an invalid rate.
+ */
+uint32_t hscdtd_odr_period_us(hscdtd_odr_t odr)
+{
+    if (odr > HSCDTD_ODR_100HZ)
+        return 0;
+    return odr_period_us[odr];
+}
+
+
+// Flag the quality of a sample that was just stamped.
+//
+// In the normal state odr_seq counts the conversions. Without DOR in
+// STATUS nothing was overwritten, the sample is the next conversion. Else
+// the timestamp is placed on the conversion grid of the last sample whose
+// place is certain; the count of a single gap may be off by one if the
+// timestamp error is close to half a period, but the errors do not add up.
+static void flag_sample(hscdtd_device_t *p_dev, hscdtd_sample_t *p_sample)
+{
+    const int16_t *p_axis = &p_sample->raw.mag_x;
+    uint16_t err = p_sample->timestamp_err_us;
+    uint32_t period, steps = 1;
+    int32_t grid;
+    int16_t max = HSCDTD_15BIT_MAX_LSB;
+    int16_t min = HSCDTD_15BIT_MIN_LSB;
+    uint8_t i, certain;
+
+    // The range of the resolution in CTRL4, if it is not known that of
+    // hscdtd_initialize.
+    if ((p_dev->reg_shadow_valid & (1 << HSCDTD_SHADOW_CTRL4)) &&
+        HSCDTD_FIELD_GET(HSCDTD_CTRL4_RS, p_dev->reg_shadow[HSCDTD_SHADOW_CTRL4]) ==
+        HSCDTD_RESOLUTION_14_BIT) {
+        max = HSCDTD_14BIT_MAX_LSB;
+        min = HSCDTD_14BIT_MIN_LSB;
     }
 
-    if (stat.DRDY != 1)
-        return HSCDTD_STAT_NO_DATA;
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+        if (p_axis[i] >= max || p_axis[i] <= min)
+            p_sample->flags |= HSCDTD_SAMPLE_SAT_X << i;
+    }
+    if (p_sample->flags & HSCDTD_SAMPLE_SATURATED)
+        p_dev->quality.saturated++;
+
+    // An overrun before the rate or state changed is of no interest.
+    if (p_dev->odr_resync)
+        p_dev->overrun = 0;
+    if (p_dev->overrun) {
+        p_sample->flags |= HSCDTD_SAMPLE_OVERRUN;
+        p_dev->quality.overruns++;
+    }
 
-    // Use magneto read function to read the data into the pointer.
-    status = hscdtd_read_magnetodata(p_dev, p_mag_data);
-    return status;
+    period = hscdtd_odr_period_us(p_dev->odr);
+    certain = p_dev->state != HSCDTD_STATE_NORMAL || p_dev->odr_resync ||
+              (p_dev->status_read && !p_dev->overrun) ||
+              (err != HSCDTD_TIMESTAMP_ERR_UNKNOWN && err <= period / 4);
+
+    if (!p_dev->odr_resync && p_dev->state == HSCDTD_STATE_NORMAL &&
+        (p_dev->overrun || !p_dev->status_read) &&
+        err != HSCDTD_TIMESTAMP_ERR_UNKNOWN) {
+        grid = (int32_t) ((p_sample->timestamp_us - p_dev->odr_anchor_us +
+                           period / 2) / period);
+        grid -= (int32_t) (p_dev->odr_seq - p_dev->odr_anchor_seq);
+        if (grid > 1)
+            steps = (uint32_t) grid;
+    }
+    if (p_dev->overrun && steps < 2)
+        steps = 2;
+    p_dev->overrun = 0;
+    p_dev->status_read = 0;
+    p_dev->odr_resync = 0;
+
+    if (steps > 1) {
+        p_sample->flags |= HSCDTD_SAMPLE_GAP;
+        p_dev->quality.gaps++;
+        p_dev->quality.missed += steps - 1;
+    }
+    p_dev->odr_seq += steps;
+    p_sample->odr_seq = p_dev->odr_seq;
+
+    if (certain) {
+        p_dev->odr_anchor_us = p_sample->timestamp_us;
+        p_dev->odr_anchor_seq = p_dev->odr_seq;
+    }
 }
 
 
 /**
- * @brief Read magneto data from the sensor.
+ * @brief Tag a sample with a timestamp and the next sequence number.
+ *
+ * Also updates the interval statistics and the quality counters of the
+ * device, and sets the quality flags of the sample.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_sample Pointer to the sample.
+ * @param timestamp_us End of conversion, in transport_now_us time.
+ * @param timestamp_err_us Maximum error of the timestamp.
+ */
+void hscdtd_stamp_sample(hscdtd_device_t *p_dev, hscdtd_sample_t *p_sample,
+                         uint32_t timestamp_us, uint16_t timestamp_err_us)
+{
+#ifndef HSCDTD_NO_TIMING
+    hscdtd_timing_t *p_timing = &p_dev->timing;
+    uint32_t interval, interval_q4;
+    int32_t delta;
+#endif  // HSCDTD_NO_TIMING
+
+    p_sample->timestamp_us = timestamp_us;
+    p_sample->timestamp_err_us = timestamp_err_us;
+    p_sample->seq = ++p_dev->seq;
+    p_sample->flags = 0;
+
+#ifndef HSCDTD_NO_TIMING
+    interval = timestamp_us - p_dev->last_timestamp_us;
+    p_dev->last_timestamp_us = timestamp_us;
+#endif  // HSCDTD_NO_TIMING
+    flag_sample(p_dev, p_sample);
+#ifndef HSCDTD_NO_TIMING
+    if (p_dev->seq == 1)
+        return;
+
+    // Intervals over ~134s saturate the averages.
+    interval_q4 = (interval < 0x08000000UL) ? interval << 4 : 0x7FFFFFFFUL;
+
+    p_timing->last_interval_us = interval;
+    if (p_timing->intervals == 0) {
+        p_timing->min_interval_us = interval;
+        p_timing->max_interval_us = interval;
+        p_timing->mean_interval_q4 = interval_q4;
+        p_timing->jitter_q4 = 0;
+    } else {
+        if (interval < p_timing->min_interval_us)
+            p_timing->min_interval_us = interval;
+        if (interval > p_timing->max_interval_us)
+            p_timing->max_interval_us = interval;
+
+        delta = (int32_t) interval_q4 - (int32_t) p_timing->mean_interval_q4;
+        p_timing->mean_interval_q4 += delta / 16;
+        if (delta < 0)
+            delta = -delta;
+        p_timing->jitter_q4 += (delta - (int32_t) p_timing->jitter_q4) / 16;
+    }
+    p_timing->intervals++;
+#endif  // HSCDTD_NO_TIMING
+}
+
+
+#ifndef HSCDTD_NO_TIMING
+/**
+ * @brief Clear the interval statistics of the device.
+ *
+ * Sequence numbers continue.
+ *
+ * @param p_dev Pointer to device struct.
+ */
+void hscdtd_reset_timing(hscdtd_device_t *p_dev)
+{
+    p_dev->timing.intervals = 0;
+    p_dev->timing.last_interval_us = 0;
+    p_dev->timing.min_interval_us = 0;
+    p_dev->timing.max_interval_us = 0;
+    p_dev->timing.mean_interval_q4 = 0;
+    p_dev->timing.jitter_q4 = 0;
+}
+#endif  // HSCDTD_NO_TIMING
+
+
+/**
+ * @brief Clear the sample quality counters of the device.
+ *
+ * @param p_dev Pointer to device struct.
+ */
+void hscdtd_reset_quality(hscdtd_device_t *p_dev)
+{
+    p_dev->quality.overruns = 0;
+    p_dev->quality.saturated = 0;
+    p_dev->quality.stale = 0;
+    p_dev->quality.gaps = 0;
+    p_dev->quality.missed = 0;
+}
+
+
+#ifndef HSCDTD_NO_RETRY
+/**
+ * @brief Set the retry policy of the transfers of the device.
+ *
+ * Applies to every transfer of the driver, see HSCDTD_RETRY_*. The default
+ * is HSCDTD_RETRY_POLICY_DEFAULT.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_policy Policy, copied.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_set_retry_policy(hscdtd_device_t *p_dev,
+                                        const hscdtd_retry_policy_t *p_policy)
+{
+    if (!p_dev || !p_policy) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_policy->max_attempts == 0 ||
+        p_policy->backoff_max_ms < p_policy->backoff_ms) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    p_dev->retry = *p_policy;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Clear the retry counters of the device.
+ *
+ * @param p_dev Pointer to device struct.
+ */
+void hscdtd_reset_retry_stats(hscdtd_device_t *p_dev)
+{
+    p_dev->retry_stats.retries = 0;
+    p_dev->retry_stats.recovered = 0;
+    p_dev->retry_stats.exhausted = 0;
+    p_dev->retry_stats.not_retried = 0;
+}
+#endif  // HSCDTD_NO_RETRY
+
+
+#ifndef HSCDTD_NO_LATENCY
+// Age of a sample at a stage, 0 if the stage came before the estimated
+// end of the conversion.
+static uint32_t latency_age(const hscdtd_sample_t *p_sample, uint32_t now)
+{
+    int32_t age = (int32_t) (now - p_sample->timestamp_us);
+
+    return (age > 0) ? (uint32_t) age : 0;
+}
+
+
+/**
+ * @brief Record the latency of the samples of the device.
+ *
+ * The histograms are updated by the driver, and by hscdtd_consume_sample.
+ * See hscdtd008a_latency.h.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_latency Histograms to update, NULL to stop recording.
+ */
+void hscdtd_set_latency(hscdtd_device_t *p_dev, hscdtd_latency_t *p_latency)
+{
+    hscdtd_mutex_lock(&p_dev->lock);
+    p_dev->p_latency = p_latency;
+    hscdtd_mutex_unlock(&p_dev->lock);
+}
+#endif  // HSCDTD_NO_LATENCY
+
+
+/**
+ * @brief Record the stages up to the read of a sample.
+ *
+ * Called by the driver after every read, with the device lock held. The
+ * trigger and DRDY seen are taken from the device, the DRDY stage is left
+ * out for a sample read without data ready.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_sample Sample that was read.
+ * @param read_us End of the bus read.
+ */
+void hscdtd_record_latency(hscdtd_device_t *p_dev,
+                           const hscdtd_sample_t *p_sample, uint32_t read_us)
+{
+#ifndef HSCDTD_NO_LATENCY
+    hscdtd_latency_t *p_latency = p_dev->p_latency;
+    int32_t conversion;
+
+    if (!p_latency)
+        return;
+
+    if (p_dev->trigger_valid) {
+        conversion = (int32_t) (p_sample->timestamp_us - p_dev->trigger_us);
+        hscdtd_hist_record(&p_latency->stages[HSCDTD_LAT_CONVERSION],
+                           (conversion > 0) ? (uint32_t) conversion : 0);
+    }
+    if (!(p_sample->flags & HSCDTD_SAMPLE_STALE))
+        hscdtd_hist_record(&p_latency->stages[HSCDTD_LAT_DRDY],
+                           latency_age(p_sample, p_dev->drdy_seen_us));
+    hscdtd_hist_record(&p_latency->stages[HSCDTD_LAT_READ],
+                       latency_age(p_sample, read_us));
+#endif  // HSCDTD_NO_LATENCY
+}
+
+
+/**
+ * @brief Record a sample handed to the application.
+ *
+ * Streams and duty cycles call this before their callback, the C++ class
+ * before a measurement returns. Call it from other consumers of samples.
+ * Does nothing unless latency is recorded.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_sample Sample handed over.
+ */
+void hscdtd_consume_sample(hscdtd_device_t *p_dev,
+                           const hscdtd_sample_t *p_sample)
+{
+#ifndef HSCDTD_NO_LATENCY
+    if (!p_dev->p_latency)
+        return;
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    if (p_dev->p_latency)
+        hscdtd_hist_record(&p_dev->p_latency->stages[HSCDTD_LAT_CONSUMER],
+                           latency_age(p_sample,
+                                       transport_now_us(p_dev)));
+    hscdtd_mutex_unlock(&p_dev->lock);
+#endif  // HSCDTD_NO_LATENCY
+}
+
+
+/**
+ * @brief Read magneto data from the sensor, in LSB.
  *
  * If the sensor is configured in 'FORCE' mode, a measurement must
  * be started before results can be read by this register.
@@ -776,23 +1489,22 @@ hscdtd_status_t hscdtd_measure(hscdtd_device_t *p_dev,
  * same value twice.
  *
  * @param p_dev Pointer to device struct.
- * @param p_mag_data A pointer to a struct to store the data.
+ * @param p_raw_data A pointer to a struct to store the data.
  * @return hscdtd_status.
  */
-hscdtd_status_t hscdtd_read_magnetodata(hscdtd_device_t *p_dev,
-                                        hscdtd_mag_t *p_mag_data)
+hscdtd_status_t hscdtd_read_magnetodata_raw(hscdtd_device_t *p_dev,
+                                            hscdtd_mag_raw_t *p_raw_data)
 {
     hscdtd_status_t status;
     int8_t i;
     uint8_t buf[6];
-    int16_t tmp;
-    float *mag_data;
+    int16_t *raw_data;
 
-    if (!p_mag_data) {
+    if (!p_raw_data) {
         return HSCDTD_STAT_ERROR;
     }
 
-    mag_data = &p_mag_data->mag_x;
+    raw_data = &p_raw_data->mag_x;
 
     // Read all mag data registers in one go.
     status = read_register_multi(p_dev, HSCDTD_REG_XOUT_L, 6, buf);
@@ -801,8 +1513,7 @@ hscdtd_status_t hscdtd_read_magnetodata(hscdtd_device_t *p_dev,
 
     for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
         // Each axis is formatted little endian, flip it and make it signed.
-        tmp = (int16_t) ((uint16_t)((buf[2 * i + 1] << 8) | (buf[2 * i])));
-        mag_data[i] = tmp * HSCDTD_UT_PER_LSB_15B;  // Assumes 15 bit value.
+        raw_data[i] = (int16_t) ((uint16_t)((buf[2 * i + 1] << 8) | (buf[2 * i])));
     }
 
     return HSCDTD_STAT_OK;
@@ -810,65 +1521,270 @@ hscdtd_status_t hscdtd_read_magnetodata(hscdtd_device_t *p_dev,
 
 
 /**
- * @brief Check if there is magneto data ready.
+ * @brief Convert magneto data from LSB to nT.
+ *
+ * The conversion is exact, 1 LSB is 150nT (Assumes 15 bit value).
+ *
+ * @param p_raw_data Pointer to the data in LSB.
+ * @param p_nt_data Pointer to a struct to store the data in nT.
+ */
+void hscdtd_raw_to_nt(const hscdtd_mag_raw_t *p_raw_data,
+                      hscdtd_mag_nt_t *p_nt_data)
+{
+    p_nt_data->mag_x = (int32_t) p_raw_data->mag_x * HSCDTD_NT_PER_LSB_15B;
+    p_nt_data->mag_y = (int32_t) p_raw_data->mag_y * HSCDTD_NT_PER_LSB_15B;
+    p_nt_data->mag_z = (int32_t) p_raw_data->mag_z * HSCDTD_NT_PER_LSB_15B;
+}
+
+
+/**
+ * @brief Get the magnitude of the field in nT.
+ *
+ * Integer square root on the sum of squares in LSB, which fits 32 bits
+ * for 15 bit values. The result is rounded to the nearest LSB (+/- 75nT).
+ *
+ * @param p_raw_data Pointer to the data in LSB.
+ * @return Magnitude in nT.
+ */
+uint32_t hscdtd_magnitude_nt(const hscdtd_mag_raw_t *p_raw_data)
+{
+    uint32_t sum, root, bit;
+
+    sum = (uint32_t) ((int32_t) p_raw_data->mag_x * p_raw_data->mag_x) +
+          (uint32_t) ((int32_t) p_raw_data->mag_y * p_raw_data->mag_y) +
+          (uint32_t) ((int32_t) p_raw_data->mag_z * p_raw_data->mag_z);
+
+    // Bitwise integer square root, only shifts and adds.
+    root = 0;
+    bit = 1UL << 30;
+    while (bit > sum)
+        bit >>= 2;
+
+    while (bit) {
+        if (sum >= root + bit) {
+            sum -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    // Round to nearest, remainder is larger than root if the fraction >= .5
+    if (sum > root)
+        root++;
+
+    return root * HSCDTD_NT_PER_LSB_15B;
+}
+
+
+#ifndef HSCDTD_FIXED_POINT
+/**
+ * @brief Start a measurement in the force state.
  *
  * @param p_dev Pointer to device struct.
- * @return hscdtd_status_t.
+ * @param p_mag_data A pointer to a struct to store the data.
+ * @return hscdtd_status.
  */
-hscdtd_status_t hscdtd_data_ready(hscdtd_device_t *p_dev)
+hscdtd_status_t hscdtd_measure(hscdtd_device_t *p_dev,
+                               hscdtd_mag_t *p_mag_data)
+{
+    hscdtd_status_t status;
+    hscdtd_sample_t sample;
+
+    if (!p_mag_data) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    status = hscdtd_measure_sample(p_dev, &sample);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    hscdtd_raw_to_mag(&sample.raw, p_mag_data);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Read magneto data from the sensor.
+ *
+ * See hscdtd_read_magnetodata_raw and hscdtd_read_sample.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_mag_data A pointer to a struct to store the data.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_read_magnetodata(hscdtd_device_t *p_dev,
+                                        hscdtd_mag_t *p_mag_data)
+{
+    hscdtd_status_t status;
+    hscdtd_sample_t sample;
+
+    if (!p_mag_data) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    status = hscdtd_read_sample(p_dev, &sample);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    hscdtd_raw_to_mag(&sample.raw, p_mag_data);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Convert magneto data from LSB to uT.
+ *
+ * @param p_raw_data Pointer to the data in LSB.
+ * @param p_mag_data Pointer to a struct to store the data in uT.
+ */
+void hscdtd_raw_to_mag(const hscdtd_mag_raw_t *p_raw_data,
+                       hscdtd_mag_t *p_mag_data)
+{
+    // Assumes 15 bit value.
+    p_mag_data->mag_x = p_raw_data->mag_x * HSCDTD_UT_PER_LSB_15B;
+    p_mag_data->mag_y = p_raw_data->mag_y * HSCDTD_UT_PER_LSB_15B;
+    p_mag_data->mag_z = p_raw_data->mag_z * HSCDTD_UT_PER_LSB_15B;
+}
+#endif  // HSCDTD_FIXED_POINT
+
+
+// Body of hscdtd_data_ready, called with the device lock held.
+static hscdtd_status_t data_ready_locked(hscdtd_device_t *p_dev)
 {
     hscdtd_status_t status;
-    HSCDTD_STAT_t stat;
+    uint32_t start, end, half;
+    uint8_t stat;
 
+    start = transport_now_us(p_dev);
     status = read_register(p_dev, HSCDTD_REG_STATUS, &stat);
     if (status != 0) {
         return status;
     }
 
-    if (stat.DRDY != 1) {
+    if (HSCDTD_FIELD_GET(HSCDTD_STATUS_DOR, stat))
+        p_dev->overrun = 1;
+
+    if (!HSCDTD_FIELD_GET(HSCDTD_STATUS_DRDY, stat)) {
+        p_dev->window_start_us = start;
+        p_dev->window_valid = 1;
         return HSCDTD_STAT_NO_DATA;
     }
+    p_dev->status_read = 1;
+
+    // An interrupt timestamp is more precise, keep it.
+    if (!p_dev->drdy_marked) {
+        end = transport_now_us(p_dev);
+        p_dev->drdy_seen_us = end;
+        if (p_dev->window_valid) {
+            half = (end - p_dev->window_start_us) / 2;
+            p_dev->drdy_us = end - half;
+            p_dev->drdy_err_us = (half < HSCDTD_TIMESTAMP_ERR_UNKNOWN) ?
+                                 half : HSCDTD_TIMESTAMP_ERR_UNKNOWN;
+        } else if (p_dev->state == HSCDTD_STATE_NORMAL &&
+                   p_dev->mode == HSCDTD_MODE_ACTIVE && !p_dev->odr_resync) {
+            // Conversions run every period, the one in the output
+            // registers ended within the last period.
+            half = hscdtd_odr_period_us(p_dev->odr) / 2;
+            p_dev->drdy_us = end - half;
+            p_dev->drdy_err_us = (half < HSCDTD_TIMESTAMP_ERR_UNKNOWN) ?
+                                 half : HSCDTD_TIMESTAMP_ERR_UNKNOWN;
+        } else {
+            p_dev->drdy_us = end;
+            p_dev->drdy_err_us = HSCDTD_TIMESTAMP_ERR_UNKNOWN;
+        }
+        p_dev->drdy_marked = 1;
+    }
 
     return HSCDTD_STAT_OK;
 }
 
 
+/**
+ * @brief Check if there is magneto data ready.
+ *
+ * Also records the end of conversion for the timestamp of the sample. The
+ * conversion ended between the start of the last read without data ready
+ * (or the trigger) and the end of this read, the midpoint is used. Poll
+ * often for a small timestamp error.
+ *
+ * @param p_dev Pointer to device struct.
+ * @return hscdtd_status_t.
+ */
+hscdtd_status_t hscdtd_data_ready(hscdtd_device_t *p_dev)
+{
+    hscdtd_status_t status;
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = data_ready_locked(p_dev);
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
+
+
+/**
+ * @brief Record the end of conversion from the DRDY interrupt.
+ *
+ * Call from the interrupt handler of the DRDY pin, the sample must be read
+ * before the next conversion ends. The timestamp error is the interrupt
+ * latency.
+ *
+ * @param p_dev Pointer to device struct.
+ */
+void hscdtd_mark_data_ready(hscdtd_device_t *p_dev)
+{
+    p_dev->drdy_us = transport_now_us(p_dev);
+    p_dev->drdy_seen_us = p_dev->drdy_us;
+    p_dev->drdy_err_us = 0;
+    p_dev->drdy_marked = 1;
+}
+
+
 /**
  * @brief Set a fixed offset for the magneto values.
  *
  * @param p_dev Pointer to device struct.
- * @param x_off Offset for x-axis.
- * @param y_off Offset for y-axis.
- * @param z_off Offset for z-axis.
+ * @param x_off Offset for x-axis in nT.
+ * @param y_off Offset for y-axis in nT.
+ * @param z_off Offset for z-axis in nT.
  *
  * @return hscdtd_status_t 
  */
-hscdtd_status_t hscdtd_set_offset(hscdtd_device_t *p_dev,
-                                  float x_off, float y_off, float z_off)
+hscdtd_status_t hscdtd_set_offset_nt(hscdtd_device_t *p_dev,
+                                     int32_t x_off, int32_t y_off,
+                                     int32_t z_off)
 {
-    uint16_t tmp_off;
+    int16_t tmp_off;
+    int32_t offset;
     uint8_t offset_map[6];
     int8_t i;
 
     // Use a variable to make it easier to support 14bit in the future.
-    float max_offset = HSCDTD_15BIT_MAX_VALUE;
+    int32_t max_offset = HSCDTD_15BIT_MAX_VALUE_NT;
 
-    // The sensor substracts the offset from the sensor value.
-    // This doesn't really make sense from a user perspective. So the
-    // negative version of the user supplied offset is applied.
     // Put those in a array to simplify conversion.
-    float offsets[] = {-x_off, -y_off, -z_off};
+    int32_t offsets[] = {x_off, y_off, z_off};
 
     // Loop over the values.
     for (i = 0; i < 3; i++) {
-        // Check if the offset value is valid.
+        // Check if the offset value is valid, before it is negated.
         if (offsets[i] > max_offset || offsets[i] < -max_offset) {
             // If the value is larger than the max value the behavior is 
             // undefined. Best to avoid it.
             return HSCDTD_STAT_USER_ERROR;
         }
-        // Convert to uin16_t
-        tmp_off = (uint16_t) (offsets[i] / HSCDTD_UT_PER_LSB_15B);
+        // The sensor substracts the offset from the sensor value.
+        // This doesn't really make sense from a user perspective. So the
+        // negative version of the user supplied offset is applied.
+        offset = -offsets[i];
+        // Convert to LSB, rounded to the nearest value.
+        if (offset >= 0)
+            tmp_off = (int16_t) ((offset + HSCDTD_NT_PER_LSB_15B / 2) /
+                                 HSCDTD_NT_PER_LSB_15B);
+        else
+            tmp_off = (int16_t) ((offset - HSCDTD_NT_PER_LSB_15B / 2) /
+                                 HSCDTD_NT_PER_LSB_15B);
         // Write the values to the offset map
         offset_map[2 * i] = (uint8_t) (tmp_off & 0xFF);
         offset_map[2 * i + 1] = (uint8_t) ((tmp_off >> 8) & 0xFF);
@@ -877,3 +1793,37 @@ hscdtd_status_t hscdtd_set_offset(hscdtd_device_t *p_dev,
     // Write the offset map to the sensor.
     return write_register_multi(p_dev, HSCDTD_REG_OFFSET_X_L, 6, &offset_map);
 }
+
+
+#ifndef HSCDTD_FIXED_POINT
+/**
+ * @brief Set a fixed offset for the magneto values.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param x_off Offset for x-axis in uT.
+ * @param y_off Offset for y-axis in uT.
+ * @param z_off Offset for z-axis in uT.
+ *
+ * @return hscdtd_status_t 
+ */
+hscdtd_status_t hscdtd_set_offset(hscdtd_device_t *p_dev,
+                                  float x_off, float y_off, float z_off)
+{
+    float offsets[] = {x_off, y_off, z_off};
+    int8_t i;
+
+    // Range check before conversion, out of range floats can not be
+    // represented as nT. Written so that NaN fails it too.
+    for (i = 0; i < 3; i++) {
+        if (!(offsets[i] <= HSCDTD_15BIT_MAX_VALUE &&
+              offsets[i] >= -HSCDTD_15BIT_MAX_VALUE)) {
+            return HSCDTD_STAT_USER_ERROR;
+        }
+    }
+
+    return hscdtd_set_offset_nt(p_dev,
+                                (int32_t) (x_off * 1000.0f),
+                                (int32_t) (y_off * 1000.0f),
+                                (int32_t) (z_off * 1000.0f));
+}
+#endif  // HSCDTD_FIXED_POINT
@@ -2,20 +2,49 @@
 #define __HSCDTD008A_DRIVER__
 
 #include <stdint.h>
+#include "hscdtd008a_config.h"
 #include "platform.h"
+#include "hscdtd008a_bus.h"
+#include "hscdtd008a_latency.h"
 
 /**
  * General Constants
  */
 #define HSCDTD_NUM_AXIS                 3
-#define HSCDTD_UT_PER_LSB_15B           0.150  // (0.150uT)
+#define HSCDTD_UT_PER_LSB_15B           0.150f  // (0.150uT)
+#define HSCDTD_NT_PER_LSB_15B           150     // (150nT), exact
 
 // I2C address of the device.
 #define HSCDTD_DEFAULT_ADDR             0x0C
 #define HSCDTD_ALT_ADDR                 0x0F
 
 // Some useful numbers for general operations
-#define HSCDTD_15BIT_MAX_VALUE          2457.6
+#define HSCDTD_15BIT_MAX_VALUE          2457.6f
+#define HSCDTD_15BIT_MAX_VALUE_NT       2457600L
+
+// Output range in LSB, values at either end are saturated.
+#define HSCDTD_15BIT_MAX_LSB            16383
+#define HSCDTD_15BIT_MIN_LSB            (-16384)
+#define HSCDTD_14BIT_MAX_LSB            8191
+#define HSCDTD_14BIT_MIN_LSB            (-8192)
+
+// Timestamp error of a sample when the time of conversion is not known.
+#define HSCDTD_TIMESTAMP_ERR_UNKNOWN    0xFFFF
+
+// Sample flags
+// First sample after a change of the output data rate.
+#define HSCDTD_SAMPLE_ODR_CHANGE        0x01
+// DOR was set, samples were overwritten before this one was read.
+#define HSCDTD_SAMPLE_OVERRUN           0x02
+// An axis is at the end of the output range.
+#define HSCDTD_SAMPLE_SAT_X             0x04
+#define HSCDTD_SAMPLE_SAT_Y             0x08
+#define HSCDTD_SAMPLE_SAT_Z             0x10
+#define HSCDTD_SAMPLE_SATURATED         0x1C
+// Read without data ready, may repeat the previous sample.
+#define HSCDTD_SAMPLE_STALE             0x20
+// Conversions were lost before this sample, see odr_seq.
+#define HSCDTD_SAMPLE_GAP               0x40
 
 // If we are compiling for
 #ifdef __cplusplus
@@ -102,10 +131,174 @@ typedef struct {
 } hscdtd_mag_t;
 
 
+// Output registers as read from the sensor, in LSB.
+typedef struct {
+    int16_t mag_x;
+    int16_t mag_y;
+    int16_t mag_z;
+} hscdtd_mag_raw_t;
+
+
+// Fixed-point magneto data in nT. Conversion from LSB is exact.
+typedef struct {
+    int32_t mag_x;
+    int32_t mag_y;
+    int32_t mag_z;
+} hscdtd_mag_nt_t;
+
+
+// Magneto data tagged with the time of conversion.
+typedef struct {
+    hscdtd_mag_raw_t raw;
+    // Transport time (now_us) at the estimated end of the conversion.
+    uint32_t timestamp_us;
+    // Sequence number, incremented for every sample of the device.
+    uint32_t seq;
+    // Conversion number on the output data rate: in the normal state it
+    // advances by the periods since the previous sample, so it skips the
+    // conversions that were lost. Advances by 1 in the force state.
+    uint32_t odr_seq;
+    // Maximum error of the timestamp, half the window in which the
+    // conversion ended.
+    uint16_t timestamp_err_us;
+    // HSCDTD_SAMPLE_* flags.
+    uint8_t flags;
+} hscdtd_sample_t;
+
+
+// Intervals between consecutive samples of a device.
+typedef struct {
+    uint32_t intervals;
+    uint32_t last_interval_us;
+    uint32_t min_interval_us;
+    uint32_t max_interval_us;
+    // Running mean and mean absolute deviation from that mean (the
+    // jitter), exponential average over ~16 intervals. In 1/16 us.
+    uint32_t mean_interval_q4;
+    uint32_t jitter_q4;
+} hscdtd_timing_t;
+
+
+// Sample quality counters of a device.
+typedef struct {
+    // Samples flagged HSCDTD_SAMPLE_OVERRUN, _SATURATED and _STALE.
+    uint32_t overruns;
+    uint32_t saturated;
+    uint32_t stale;
+    // Samples flagged HSCDTD_SAMPLE_GAP, and the conversions lost.
+    uint32_t gaps;
+    uint32_t missed;
+} hscdtd_quality_t;
+
+
+#ifndef HSCDTD_NO_RETRY
+// hscdtd_retry_policy_t.retry, the transfers that are repeated after a
+// failure:
+//  - reads of registers, except those a read changes: the self test
+//    response, and the output registers while the FIFO is enabled. These
+//    are never repeated.
+//  - writes of the control, offset and threshold registers, which hold
+//    the value written.
+//  - writes to CTRL3, which start a command. A command that started before
+//    the failure runs again.
+#define HSCDTD_RETRY_READ               0x01
+#define HSCDTD_RETRY_WRITE              0x02
+#define HSCDTD_RETRY_COMMAND            0x04
+
+// Per device, for transient failures of the bus, such as a NAK on a noisy
+// cable.
+typedef struct {
+    // Attempts of a transfer, 1 for no retries.
+    uint8_t max_attempts;
+    // Wait before the first retry, doubled before every next retry up to
+    // backoff_max_ms. The bus is released while waiting.
+    uint16_t backoff_ms;
+    uint16_t backoff_max_ms;
+    // HSCDTD_RETRY_* flags.
+    uint8_t retry;
+} hscdtd_retry_policy_t;
+
+#define HSCDTD_RETRY_POLICY_DEFAULT \
+    {3, 1, 4, HSCDTD_RETRY_READ | HSCDTD_RETRY_WRITE}
+
+
+typedef struct {
+    // Transfers repeated.
+    uint32_t retries;
+    // Transfers that succeeded after a retry.
+    uint32_t recovered;
+    // Transfers that failed after max_attempts.
+    uint32_t exhausted;
+    // Transfers that failed and were not repeated, by the policy or since
+    // a read would change the register.
+    uint32_t not_retried;
+} hscdtd_retry_stats_t;
+#endif  // HSCDTD_NO_RETRY
+
+
 typedef struct {
     uint8_t addr;
     hscdtd_state_t state;
     hscdtd_mode_t mode;
+    hscdtd_odr_t odr;
+
+    const hscdtd_transport_t *p_transport;
+    void *p_transport_ctx;
+    // Bus the device is on, NULL if its transactions are not locked.
+    hscdtd_bus_t *p_bus;
+    // Held for sequences of transactions, such as a measurement.
+    hscdtd_mutex_t lock;
+    // HSCDTD_LOCK_MAGIC once lock is initialized.
+    uint16_t lock_magic;
+
+    // Last value of CTRL1, CTRL2, CTRL4 and the offset registers, valid
+    // per bit of reg_shadow_valid. Updates of a valid register need no
+    // read.
+    uint8_t reg_shadow[9];
+    uint16_t reg_shadow_valid;
+
+    // Start of the window in which the pending conversion ends, the
+    // trigger or the last status read without data ready.
+    uint32_t window_start_us;
+    uint8_t window_valid;
+    // End of conversion of the pending sample, set by hscdtd_data_ready
+    // or from the DRDY interrupt by hscdtd_mark_data_ready.
+    volatile uint32_t drdy_us;
+    volatile uint16_t drdy_err_us;
+    volatile uint8_t drdy_marked;
+    // Time of the force state trigger and of DRDY seen, for the latency
+    // histograms.
+    uint32_t trigger_us;
+    uint8_t trigger_valid;
+    volatile uint32_t drdy_seen_us;
+    hscdtd_latency_t *p_latency;
+    // DOR was seen, flags the next sample. status_read is set if DRDY of
+    // the next sample was seen in STATUS, so DOR is known for it.
+    uint8_t overrun;
+    uint8_t status_read;
+
+    uint32_t seq;
+    uint32_t odr_seq;
+    // Set when the output data rate or state changed, the interval to the
+    // next sample says nothing about lost conversions.
+    uint8_t odr_resync;
+    // Last sample whose place on the conversion grid is certain.
+    uint32_t odr_anchor_us;
+    uint32_t odr_anchor_seq;
+#ifndef HSCDTD_NO_TIMING
+    uint32_t last_timestamp_us;
+    hscdtd_timing_t timing;
+#endif  // HSCDTD_NO_TIMING
+    hscdtd_quality_t quality;
+#ifndef HSCDTD_NO_RETRY
+    hscdtd_retry_policy_t retry;
+    hscdtd_retry_stats_t retry_stats;
+#endif  // HSCDTD_NO_RETRY
+#ifndef HSCDTD_NO_FIFO
+    // FF may be set in CTRL2, reads of the output registers take samples
+    // from the FIFO.
+    uint8_t fifo_enabled;
+#endif  // HSCDTD_NO_FIFO
 } hscdtd_device_t;
 
 
@@ -117,14 +310,50 @@ typedef enum {
     HSCDTD_STAT_CHECK_FAILED,
     HSCDTD_STAT_UNKNOWN,
     HSCDTD_STAT_USER_ERROR,
+    // The operation is suspended, see hscdtd_op_step.
+    HSCDTD_STAT_PENDING,
 } hscdtd_status_t;
 
 
+typedef enum {
+    // Force state measurement.
+    HSCDTD_OP_MEASURE,
+    // Wait for and read the next sample in the normal state.
+    HSCDTD_OP_READ,
+    HSCDTD_OP_TEMPERATURE_COMPENSATION,
+    HSCDTD_OP_OFFSET_CALIBRATION,
+    HSCDTD_OP_SELF_TEST,
+} hscdtd_op_kind_t;
+
+
+// An operation that suspends instead of sleeping.
+typedef struct {
+    hscdtd_device_t *p_dev;
+    hscdtd_sample_t *p_sample;
+    hscdtd_op_kind_t kind;
+    uint8_t step;
+    uint16_t polls;
+    hscdtd_state_t old_state;
+    // Wait before the next step, while the status is HSCDTD_STAT_PENDING.
+    uint32_t delay_ms;
+    hscdtd_status_t status;
+} hscdtd_op_t;
+
+
 hscdtd_status_t hscdtd_configure_virtual_device(hscdtd_device_t *p_dev,
                                                 uint8_t addr);
 
+hscdtd_status_t hscdtd_set_transport(hscdtd_device_t *p_dev,
+                                     const hscdtd_transport_t *p_transport,
+                                     void *p_ctx);
+
+hscdtd_status_t hscdtd_attach_bus(hscdtd_device_t *p_dev,
+                                  hscdtd_bus_t *p_bus);
+
 hscdtd_status_t hscdtd_initialize(hscdtd_device_t *p_dev);
 
+void hscdtd_invalidate_registers(hscdtd_device_t *p_dev);
+
 hscdtd_status_t hscdtd_set_mode(hscdtd_device_t *p_dev, hscdtd_mode_t mode);
 
 hscdtd_status_t hscdtd_set_output_data_rate(hscdtd_device_t *p_dev,
@@ -133,6 +362,7 @@ hscdtd_status_t hscdtd_set_output_data_rate(hscdtd_device_t *p_dev,
 hscdtd_status_t hscdtd_set_state(hscdtd_device_t *p_dev,
                                  hscdtd_state_t state);
 
+#ifndef HSCDTD_NO_FIFO
 hscdtd_status_t hscdtd_set_fifo_data_storage_method(hscdtd_device_t *p_dev,
                                                     hscdtd_fco_t fco);
 
@@ -141,39 +371,112 @@ hscdtd_status_t hscdtd_set_fifo_comparision_method(hscdtd_device_t *p_dev,
 
 hscdtd_status_t hscdtd_set_fifo_enable(hscdtd_device_t *p_dev,
                                        hscdtd_ff_t ff);
+#endif  // HSCDTD_NO_FIFO
 
+#ifndef HSCDTD_NO_DRDY_CONFIG
 hscdtd_status_t hscdtd_set_data_ready_pin_enable(hscdtd_device_t *p_dev,
                                                  hscdtd_den_t den);
 
 hscdtd_status_t hscdtd_set_data_ready_pin_polarity(hscdtd_device_t *p_dev,
                                                    hscdtd_drp_t drp);
+#endif  // HSCDTD_NO_DRDY_CONFIG
 
 hscdtd_status_t hscdtd_set_resolution(hscdtd_device_t *p_dev,
                                       hscdtd_res_t resolution);
 
 hscdtd_status_t hscdtd_who_i_am_check(hscdtd_device_t *p_dev);
 
+#ifndef HSCDTD_NO_OFFSET_CAL
 hscdtd_status_t hscdtd_offset_calibration(hscdtd_device_t *p_dev);
+#endif  // HSCDTD_NO_OFFSET_CAL
 
+#ifndef HSCDTD_NO_TEMP_COMP
 hscdtd_status_t hscdtd_temperature_compensation(hscdtd_device_t *p_dev);
 
 int8_t hscdtd_read_temp(hscdtd_device_t *p_dev);
+#endif  // HSCDTD_NO_TEMP_COMP
 
+#ifndef HSCDTD_NO_SELF_TEST
 hscdtd_status_t hscdtd_self_test(hscdtd_device_t *p_dev);
+#endif  // HSCDTD_NO_SELF_TEST
 
 hscdtd_status_t hscdtd_soft_reset(hscdtd_device_t *p_dev);
 
+hscdtd_status_t hscdtd_force_trigger(hscdtd_device_t *p_dev);
+
+hscdtd_status_t hscdtd_measure_raw(hscdtd_device_t *p_dev,
+                                   hscdtd_mag_raw_t *p_raw_data);
+
+hscdtd_status_t hscdtd_read_magnetodata_raw(hscdtd_device_t *p_dev,
+                                            hscdtd_mag_raw_t *p_raw_data);
+
+hscdtd_status_t hscdtd_data_ready(hscdtd_device_t *p_dev);
+
+void hscdtd_mark_data_ready(hscdtd_device_t *p_dev);
+
+hscdtd_status_t hscdtd_measure_sample(hscdtd_device_t *p_dev,
+                                      hscdtd_sample_t *p_sample);
+
+hscdtd_status_t hscdtd_read_sample(hscdtd_device_t *p_dev,
+                                   hscdtd_sample_t *p_sample);
+
+void hscdtd_stamp_sample(hscdtd_device_t *p_dev, hscdtd_sample_t *p_sample,
+                         uint32_t timestamp_us, uint16_t timestamp_err_us);
+
+#ifndef HSCDTD_NO_TIMING
+void hscdtd_reset_timing(hscdtd_device_t *p_dev);
+#endif  // HSCDTD_NO_TIMING
+
+void hscdtd_reset_quality(hscdtd_device_t *p_dev);
+
+#ifndef HSCDTD_NO_RETRY
+hscdtd_status_t hscdtd_set_retry_policy(hscdtd_device_t *p_dev,
+                                        const hscdtd_retry_policy_t *p_policy);
+
+void hscdtd_reset_retry_stats(hscdtd_device_t *p_dev);
+#endif  // HSCDTD_NO_RETRY
+
+#ifndef HSCDTD_NO_LATENCY
+void hscdtd_set_latency(hscdtd_device_t *p_dev, hscdtd_latency_t *p_latency);
+#endif  // HSCDTD_NO_LATENCY
+
+void hscdtd_record_latency(hscdtd_device_t *p_dev,
+                           const hscdtd_sample_t *p_sample, uint32_t read_us);
+
+void hscdtd_consume_sample(hscdtd_device_t *p_dev,
+                           const hscdtd_sample_t *p_sample);
+
+uint32_t hscdtd_odr_period_us(hscdtd_odr_t odr);
+
+hscdtd_status_t hscdtd_op_init(hscdtd_op_t *p_op, hscdtd_device_t *p_dev,
+                               hscdtd_op_kind_t kind,
+                               hscdtd_sample_t *p_sample);
+
+hscdtd_status_t hscdtd_op_step(hscdtd_op_t *p_op);
+
+hscdtd_status_t hscdtd_set_offset_nt(hscdtd_device_t *p_dev,
+                                     int32_t x_off, int32_t y_off,
+                                     int32_t z_off);
+
+void hscdtd_raw_to_nt(const hscdtd_mag_raw_t *p_raw_data,
+                      hscdtd_mag_nt_t *p_nt_data);
+
+uint32_t hscdtd_magnitude_nt(const hscdtd_mag_raw_t *p_raw_data);
+
+#ifndef HSCDTD_FIXED_POINT
 hscdtd_status_t hscdtd_measure(hscdtd_device_t *p_dev,
                                hscdtd_mag_t *p_mag_data);
 
 hscdtd_status_t hscdtd_read_magnetodata(hscdtd_device_t *p_dev,
                                         hscdtd_mag_t *p_mag_data);
 
-hscdtd_status_t hscdtd_data_ready(hscdtd_device_t *p_dev);
-
 hscdtd_status_t hscdtd_set_offset(hscdtd_device_t *p_dev,
                                   float x_off, float y_off, float z_off);
 
+void hscdtd_raw_to_mag(const hscdtd_mag_raw_t *p_raw_data,
+                       hscdtd_mag_t *p_mag_data);
+#endif  // HSCDTD_FIXED_POINT
+
 
 #ifdef __cplusplus
 }
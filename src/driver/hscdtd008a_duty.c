@@ -0,0 +1,363 @@
+#include <string.h>
+#include "hscdtd008a_duty.h"
+#include "transport.h"
+
+// Tasks of a wake window, in the order they run.
+#define DUTY_TASK_NONE                  0
+#define DUTY_TASK_MEASURE               1
+#define DUTY_TASK_TCS                   2
+#define DUTY_TASK_CHECK                 3
+
+
+// The poll thread reads the flag while another thread stops acquisition.
+static uint8_t duty_running(hscdtd_duty_t *p_duty)
+{
+#ifdef RPI
+    return __atomic_load_n(&p_duty->running, __ATOMIC_ACQUIRE);
+#else
+    return p_duty->running;
+#endif  // RPI
+}
+
+
+static void duty_set_running(hscdtd_duty_t *p_duty, uint8_t running)
+{
+#ifdef RPI
+    __atomic_store_n(&p_duty->running, running, __ATOMIC_RELEASE);
+#else
+    p_duty->running = running;
+#endif  // RPI
+}
+
+
+// Housekeeping is due in the first window and every n-th after it.
+static uint8_t duty_due(hscdtd_duty_t *p_duty, uint16_t every)
+{
+    return every && (p_duty->stats.windows - 1) % every == 0;
+}
+
+
+static uint8_t duty_next_task(hscdtd_duty_t *p_duty, uint8_t task)
+{
+#ifndef HSCDTD_NO_TEMP_COMP
+    if (task < DUTY_TASK_TCS && duty_due(p_duty, p_duty->config.tcs_every))
+        return DUTY_TASK_TCS;
+#endif  // HSCDTD_NO_TEMP_COMP
+    if (task < DUTY_TASK_CHECK &&
+        duty_due(p_duty, p_duty->config.check_every))
+        return DUTY_TASK_CHECK;
+    return DUTY_TASK_NONE;
+}
+
+
+// Back to standby, wake up for the next target that can still be met.
+static hscdtd_status_t duty_close_window(hscdtd_duty_t *p_duty)
+{
+    hscdtd_device_t *p_dev = p_duty->p_dev;
+    hscdtd_status_t status;
+    uint32_t end, window;
+
+    status = hscdtd_set_mode(p_dev, HSCDTD_MODE_STANDBY);
+    end = transport_now_us(p_dev);
+    p_duty->task = DUTY_TASK_NONE;
+
+    window = end - p_duty->wake_us;
+    p_duty->stats.active_us += window;
+    if (window > p_duty->stats.window_max_us)
+        p_duty->stats.window_max_us = window;
+
+    p_duty->target_us += p_duty->config.period_us;
+    while ((int32_t) (p_duty->target_us - p_duty->lead_us - end) < 0) {
+        p_duty->target_us += p_duty->config.period_us;
+        p_duty->stats.skipped++;
+    }
+    p_duty->next_poll_us = p_duty->target_us - p_duty->lead_us;
+    return status;
+}
+
+
+static void duty_sample_done(hscdtd_duty_t *p_duty)
+{
+    uint32_t lead = p_duty->sample.timestamp_us - p_duty->wake_us;
+
+    // Averaged over ~4 windows, a single slow wake up should not make the
+    // device wait in the active mode for the next ones.
+    if (lead > p_duty->config.period_us / 2)
+        lead = p_duty->config.period_us / 2;
+    if (p_duty->stats.samples == 0)
+        p_duty->lead_us = lead;
+    else
+        p_duty->lead_us += ((int32_t) (lead - p_duty->lead_us)) / 4;
+
+    p_duty->stats.samples++;
+    hscdtd_consume_sample(p_duty->p_dev, &p_duty->sample);
+    p_duty->callback(p_duty->p_ctx, &p_duty->sample);
+}
+
+
+// Run the tasks of the window until one waits or all are done.
+static hscdtd_status_t duty_run_window(hscdtd_duty_t *p_duty, uint32_t now)
+{
+    hscdtd_device_t *p_dev = p_duty->p_dev;
+    hscdtd_status_t status;
+    uint8_t task;
+
+    if (p_duty->task == DUTY_TASK_NONE) {
+        if ((int32_t) (now - p_duty->target_us) > 0)
+            p_duty->stats.late++;
+
+        p_duty->wake_us = now;
+        p_duty->stats.windows++;
+        p_duty->window_status = HSCDTD_STAT_NO_DATA;
+
+        status = hscdtd_set_mode(p_dev, HSCDTD_MODE_ACTIVE);
+        if (status != HSCDTD_STAT_OK) {
+            p_duty->stats.errors++;
+            duty_close_window(p_duty);
+            return status;
+        }
+        p_duty->task = DUTY_TASK_MEASURE;
+        hscdtd_op_init(&p_duty->op, p_dev, HSCDTD_OP_MEASURE,
+                       &p_duty->sample);
+    }
+
+    while ((task = p_duty->task) != DUTY_TASK_NONE) {
+        if (task == DUTY_TASK_CHECK)
+            status = hscdtd_health_check(&p_duty->health);
+        else
+            status = hscdtd_op_step(&p_duty->op);
+
+        if (status == HSCDTD_STAT_PENDING) {
+            p_duty->next_poll_us = now + p_duty->op.delay_ms * 1000UL;
+            return HSCDTD_STAT_NO_DATA;
+        }
+
+        if (status != HSCDTD_STAT_OK) {
+            p_duty->stats.errors++;
+            p_duty->window_status = status;
+        } else if (task == DUTY_TASK_MEASURE) {
+            duty_sample_done(p_duty);
+            p_duty->window_status = HSCDTD_STAT_OK;
+        }
+        if (task == DUTY_TASK_TCS)
+            p_duty->stats.tcs++;
+        else if (task == DUTY_TASK_CHECK)
+            p_duty->stats.checks++;
+
+        p_duty->task = duty_next_task(p_duty, task);
+#ifndef HSCDTD_NO_TEMP_COMP
+        if (p_duty->task == DUTY_TASK_TCS)
+            hscdtd_op_init(&p_duty->op, p_dev,
+                           HSCDTD_OP_TEMPERATURE_COMPENSATION, 0);
+#endif  // HSCDTD_NO_TEMP_COMP
+        now = transport_now_us(p_dev);
+    }
+
+    status = duty_close_window(p_duty);
+    if (status != HSCDTD_STAT_OK) {
+        p_duty->stats.errors++;
+        return status;
+    }
+    return p_duty->window_status;
+}
+
+
+#ifdef RPI
+static void *duty_thread(void *p_arg)
+{
+    hscdtd_duty_t *p_duty = (hscdtd_duty_t *) p_arg;
+    int32_t wait;
+
+    while (duty_running(p_duty)) {
+        hscdtd_duty_poll(p_duty);
+        wait = (int32_t) (hscdtd_duty_next_us(p_duty) -
+                          transport_now_us(p_duty->p_dev));
+        // Sleep in short steps so stopping does not wait a whole period.
+        if (wait > 100000)
+            wait = 100000;
+        if (wait > 0)
+            transport_sleep_ms(p_duty->p_dev, (wait + 999) / 1000);
+    }
+    return 0;
+}
+#endif  // RPI
+
+
+/**
+ * @brief Start duty cycled acquisition.
+ *
+ * Puts the device in the force state and in standby. The first sample is
+ * taken right away. With config.thread the samples are acquired from a
+ * thread, else hscdtd_duty_poll must be called.
+ *
+ * @param p_duty Pointer to duty cycle struct.
+ * @param p_dev Pointer to device struct, initialized.
+ * @param p_config Duty cycle configuration.
+ * @param callback Called with every sample.
+ * @param p_ctx Passed to the callback.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_duty_start(hscdtd_duty_t *p_duty,
+                                  hscdtd_device_t *p_dev,
+                                  const hscdtd_duty_config_t *p_config,
+                                  hscdtd_duty_callback_t callback,
+                                  void *p_ctx)
+{
+    hscdtd_health_config_t health = HSCDTD_HEALTH_CONFIG_DEFAULT;
+    hscdtd_status_t status;
+    uint32_t now;
+
+    if (!p_duty || !p_dev || !p_config || !callback) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_config->period_us < HSCDTD_DUTY_MIN_PERIOD_US ||
+        p_config->period_us > 0x7FFFFFFFUL ||
+        (p_config->thread && !HSCDTD_DUTY_HAS_THREAD)) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+#ifdef HSCDTD_NO_TEMP_COMP
+    if (p_config->tcs_every) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+#endif  // HSCDTD_NO_TEMP_COMP
+
+    memset(p_duty, 0, sizeof(hscdtd_duty_t));
+    p_duty->p_dev = p_dev;
+    p_duty->config = *p_config;
+    p_duty->callback = callback;
+    p_duty->p_ctx = p_ctx;
+    p_duty->lead_us = HSCDTD_DUTY_INITIAL_LEAD_US;
+    // Checks run when the window schedules them, not on an interval.
+    hscdtd_health_init(&p_duty->health, p_dev, &health);
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = hscdtd_set_state(p_dev, HSCDTD_STATE_FORCE);
+    if (status == HSCDTD_STAT_OK)
+        status = hscdtd_set_mode(p_dev, HSCDTD_MODE_STANDBY);
+    now = transport_now_us(p_dev);
+    p_duty->target_us = now + p_duty->lead_us;
+    p_duty->next_poll_us = now;
+    p_duty->last_poll_us = now;
+    hscdtd_mutex_unlock(&p_dev->lock);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    duty_set_running(p_duty, 1);
+#ifdef RPI
+    if (p_config->thread &&
+        pthread_create(&p_duty->thread, 0, duty_thread, p_duty) != 0) {
+        duty_set_running(p_duty, 0);
+        return HSCDTD_STAT_ERROR;
+    }
+#endif  // RPI
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Stop acquisition.
+ *
+ * Abandons the tasks of an open wake window. The device is left in
+ * standby. Not from the callback.
+ *
+ * @param p_duty Pointer to duty cycle struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_duty_stop(hscdtd_duty_t *p_duty)
+{
+    hscdtd_device_t *p_dev;
+    hscdtd_status_t status = HSCDTD_STAT_OK;
+    uint32_t now;
+
+    if (!p_duty || !duty_running(p_duty)) {
+        return HSCDTD_STAT_ERROR;
+    }
+    p_dev = p_duty->p_dev;
+
+    duty_set_running(p_duty, 0);
+#ifdef RPI
+    if (p_duty->config.thread)
+        pthread_join(p_duty->thread, 0);
+#endif  // RPI
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    if (p_duty->task != DUTY_TASK_NONE)
+        status = duty_close_window(p_duty);
+    now = transport_now_us(p_dev);
+    p_duty->stats.elapsed_us += now - p_duty->last_poll_us;
+    p_duty->last_poll_us = now;
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
+
+
+/**
+ * @brief Run the wake window that is due.
+ *
+ * Returns immediately if nothing is due. A window that waits for the
+ * device returns and continues on a later poll.
+ *
+ * @param p_duty Pointer to duty cycle struct.
+ * @return hscdtd_status, HSCDTD_STAT_OK if a window was completed with a
+ *         sample, HSCDTD_STAT_NO_DATA if no window was completed.
+ */
+hscdtd_status_t hscdtd_duty_poll(hscdtd_duty_t *p_duty)
+{
+    hscdtd_device_t *p_dev;
+    hscdtd_status_t status;
+    uint32_t now;
+
+    if (!p_duty || !duty_running(p_duty)) {
+        return HSCDTD_STAT_ERROR;
+    }
+    p_dev = p_duty->p_dev;
+    now = transport_now_us(p_dev);
+    p_duty->stats.elapsed_us += now - p_duty->last_poll_us;
+    p_duty->last_poll_us = now;
+
+    if ((int32_t) (now - p_duty->next_poll_us) < 0)
+        return HSCDTD_STAT_NO_DATA;
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = duty_run_window(p_duty, now);
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
+
+
+/**
+ * @brief Time at which hscdtd_duty_poll has work next.
+ *
+ * @param p_duty Pointer to duty cycle struct.
+ * @return Time in transport_now_us time.
+ */
+uint32_t hscdtd_duty_next_us(hscdtd_duty_t *p_duty)
+{
+    return p_duty->next_poll_us;
+}
+
+
+/**
+ * @brief Estimated time in the active mode per hour.
+ *
+ * Measured since hscdtd_duty_start, up to the last poll.
+ *
+ * @param p_duty Pointer to duty cycle struct.
+ * @return Active time in us per hour, 0 before the first poll.
+ */
+uint32_t hscdtd_duty_active_per_hour_us(hscdtd_duty_t *p_duty)
+{
+    uint64_t active, elapsed;
+
+    if (!p_duty || p_duty->stats.elapsed_us == 0)
+        return 0;
+
+    active = p_duty->stats.active_us;
+    elapsed = p_duty->stats.elapsed_us;
+    // Scale down both before the product can overflow.
+    while (active > UINT64_MAX / 3600000000ULL) {
+        active >>= 1;
+        elapsed >>= 1;
+    }
+    return (uint32_t) (active * 3600000000ULL / elapsed);
+}
@@ -0,0 +1,142 @@
+#ifndef __HSCDTD008A_DUTY__
+#define __HSCDTD008A_DUTY__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+#include "hscdtd008a_health.h"
+
+#ifdef RPI
+#include <pthread.h>
+#endif  // RPI
+
+/**
+ * Duty cycled acquisition, for low sample rates on battery.
+ *
+ * The device stays in standby between samples. For every sample the
+ * device is made active, a force state measurement is taken and the
+ * device goes back to standby. The wake up is timed so the conversion
+ * ends at the target time of the sample, from the length of the previous
+ * wake windows.
+ *
+ * Housekeeping runs in the same wake window, after the measurement so it
+ * does not delay the sample: a temperature compensation every tcs_every
+ * samples and a health check every check_every samples, which restores a
+ * device that lost its configuration (see hscdtd008a_health.h). Both are
+ * due in the first window.
+ *
+ * The acquisition runs in hscdtd_duty_poll: on RPI from a thread of the
+ * library, elsewhere from the main loop. A poll returns immediately when
+ * nothing is due, hscdtd_duty_next_us tells when it is. Between polls
+ * the host can sleep as well.
+ *
+ * The time the device was active is measured on the transport clock,
+ * hscdtd_duty_active_per_hour_us gives it per hour of acquisition.
+ */
+
+// Shortest period, a wake window must fit in it.
+#define HSCDTD_DUTY_MIN_PERIOD_US       20000
+
+// Wake lead before the first window is measured.
+#define HSCDTD_DUTY_INITIAL_LEAD_US     2000
+
+#ifdef RPI
+#define HSCDTD_DUTY_HAS_THREAD          1
+#else
+#define HSCDTD_DUTY_HAS_THREAD          0
+#endif  // RPI
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+// Called with every sample, in the wake window.
+typedef void (*hscdtd_duty_callback_t)(void *p_ctx,
+                                       const hscdtd_sample_t *p_sample);
+
+
+typedef struct {
+    // Time between samples, at least HSCDTD_DUTY_MIN_PERIOD_US.
+    uint32_t period_us;
+    // Samples between housekeeping tasks, 0 to never run them. tcs_every
+    // must be 0 with HSCDTD_NO_TEMP_COMP.
+    uint16_t tcs_every;
+    uint16_t check_every;
+    // 1 to poll from a thread of the library (RPI only).
+    uint8_t thread;
+} hscdtd_duty_config_t;
+
+#ifndef HSCDTD_NO_TEMP_COMP
+#define HSCDTD_DUTY_CONFIG_DEFAULT \
+    {1000000, 60, 600, HSCDTD_DUTY_HAS_THREAD}
+#else
+#define HSCDTD_DUTY_CONFIG_DEFAULT \
+    {1000000, 0, 600, HSCDTD_DUTY_HAS_THREAD}
+#endif  // HSCDTD_NO_TEMP_COMP
+
+
+typedef struct {
+    uint32_t samples;
+    uint32_t windows;
+    // Windows that started after their wake time, and targets skipped
+    // because a window ran past them.
+    uint32_t late;
+    uint32_t skipped;
+    uint32_t tcs;
+    uint32_t checks;
+    uint32_t errors;
+    // Longest wake window.
+    uint32_t window_max_us;
+    uint64_t active_us;
+    uint64_t elapsed_us;
+} hscdtd_duty_stats_t;
+
+
+typedef struct {
+    hscdtd_device_t *p_dev;
+    hscdtd_duty_config_t config;
+    hscdtd_duty_callback_t callback;
+    void *p_ctx;
+
+    uint8_t running;
+    // Task of the current wake window, 0 while in standby.
+    uint8_t task;
+    hscdtd_op_t op;
+    hscdtd_sample_t sample;
+    hscdtd_status_t window_status;
+    hscdtd_health_t health;
+
+    // End of conversion wanted for the next sample.
+    uint32_t target_us;
+    // Time from wake up to the end of the conversion.
+    uint32_t lead_us;
+    uint32_t wake_us;
+    uint32_t next_poll_us;
+    uint32_t last_poll_us;
+    hscdtd_duty_stats_t stats;
+#ifdef RPI
+    pthread_t thread;
+#endif  // RPI
+} hscdtd_duty_t;
+
+
+hscdtd_status_t hscdtd_duty_start(hscdtd_duty_t *p_duty,
+                                  hscdtd_device_t *p_dev,
+                                  const hscdtd_duty_config_t *p_config,
+                                  hscdtd_duty_callback_t callback,
+                                  void *p_ctx);
+
+hscdtd_status_t hscdtd_duty_stop(hscdtd_duty_t *p_duty);
+
+hscdtd_status_t hscdtd_duty_poll(hscdtd_duty_t *p_duty);
+
+uint32_t hscdtd_duty_next_us(hscdtd_duty_t *p_duty);
+
+uint32_t hscdtd_duty_active_per_hour_us(hscdtd_duty_t *p_duty);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_DUTY__
@@ -0,0 +1,212 @@
+#include <string.h>
+#include "hscdtd008a_event.h"
+
+#define EVENT_MAX_DEVIATION             32767
+
+
+// Integer square root, once per event.
+static uint16_t event_isqrt(uint32_t x)
+{
+    uint32_t res = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit) {
+        if (x >= res + bit) {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t) res;
+}
+
+
+static void event_track(hscdtd_event_detector_t *p_det, const int32_t *p_d,
+                        uint32_t sq, uint32_t timestamp_us)
+{
+    uint8_t i;
+
+    if (sq <= p_det->peak_sq)
+        return;
+    p_det->peak_sq = sq;
+    p_det->event.peak_us = timestamp_us;
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++)
+        p_det->event.peak[i] = (int16_t) p_d[i];
+}
+
+
+static void event_finish(hscdtd_event_detector_t *p_det, uint32_t end_us)
+{
+    p_det->event.end_us = end_us;
+    p_det->event.peak_mag = event_isqrt(p_det->peak_sq);
+    p_det->active = 0;
+    p_det->run = 0;
+}
+
+
+/**
+ * @brief Initialize the event detector of a sensor.
+ *
+ * @param p_det Pointer to detector struct.
+ * @param p_config Thresholds and debounce, must stay valid.
+ * @param sensor Id of the sensor, copied to its events.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_event_init(hscdtd_event_detector_t *p_det,
+                                  const hscdtd_event_config_t *p_config,
+                                  uint8_t sensor)
+{
+    if (!p_det || !p_config) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_config->baseline_shift < 1 || p_config->baseline_shift > 16 ||
+        (p_config->mag_on == 0 && p_config->axis_on == 0) ||
+        p_config->mag_off > p_config->mag_on ||
+        p_config->axis_off > p_config->axis_on ||
+        p_config->on_samples == 0 || p_config->off_samples == 0 ||
+        p_config->max_duration_us > 0x7FFFFFFFUL) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    memset(p_det, 0, sizeof(hscdtd_event_detector_t));
+    p_det->p_config = p_config;
+    p_det->mag_on_sq = (uint32_t) p_config->mag_on * p_config->mag_on;
+    p_det->mag_off_sq = (uint32_t) p_config->mag_off * p_config->mag_off;
+    p_det->event.sensor = sensor;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Feed a sample to the detector.
+ *
+ * Samples flagged HSCDTD_SAMPLE_STALE are skipped. After
+ * HSCDTD_EVENT_START p_det->event holds the start, the peak so far and the
+ * trigger; after HSCDTD_EVENT_END the complete event, until the next start.
+ *
+ * @param p_det Pointer to detector struct.
+ * @param p_sample Sample of the sensor.
+ * @return HSCDTD_EVENT_NONE, HSCDTD_EVENT_START or HSCDTD_EVENT_END.
+ */
+uint8_t hscdtd_event_update(hscdtd_event_detector_t *p_det,
+                            const hscdtd_sample_t *p_sample)
+{
+    const hscdtd_event_config_t *p_config = p_det->p_config;
+    uint32_t now = p_sample->timestamp_us;
+    int32_t x[HSCDTD_NUM_AXIS];
+    int32_t d[HSCDTD_NUM_AXIS];
+    uint32_t ad, sq = 0;
+    uint8_t trig = 0, above_off = 0;
+    uint8_t sensor;
+    uint8_t i;
+
+    if (p_sample->flags & HSCDTD_SAMPLE_STALE)
+        return HSCDTD_EVENT_NONE;
+
+    x[0] = p_sample->raw.mag_x;
+    x[1] = p_sample->raw.mag_y;
+    x[2] = p_sample->raw.mag_z;
+    if (p_det->warmup == 0) {
+        for (i = 0; i < HSCDTD_NUM_AXIS; i++)
+            p_det->baseline[i] = x[i] * 256;
+        p_det->warmup = 1;
+        return HSCDTD_EVENT_NONE;
+    }
+
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+        d[i] = x[i] - ((p_det->baseline[i] + 128) >> 8);
+        if (d[i] > EVENT_MAX_DEVIATION)
+            d[i] = EVENT_MAX_DEVIATION;
+        if (d[i] < -EVENT_MAX_DEVIATION)
+            d[i] = -EVENT_MAX_DEVIATION;
+        ad = (uint32_t) ((d[i] < 0) ? -d[i] : d[i]);
+        sq += ad * ad;
+        if (p_config->axis_on) {
+            if (ad > p_config->axis_on)
+                trig |= (uint8_t) (HSCDTD_EVENT_TRIG_X << i);
+            if (ad > p_config->axis_off)
+                above_off = 1;
+        }
+    }
+    if (p_config->mag_on) {
+        if (sq > p_det->mag_on_sq)
+            trig |= HSCDTD_EVENT_TRIG_MAG;
+        if (sq > p_det->mag_off_sq)
+            above_off = 1;
+    }
+
+    if (p_det->active) {
+        if (p_det->event.samples < 0xFFFF)
+            p_det->event.samples++;
+        p_det->event.trigger |= trig;
+        event_track(p_det, d, sq, now);
+
+        if (p_config->max_duration_us &&
+            now - p_det->event.start_us >= p_config->max_duration_us) {
+            // A lasting change, start over from the field as it is now.
+            p_det->event.trigger |= HSCDTD_EVENT_TIMEOUT;
+            event_finish(p_det, now);
+            for (i = 0; i < HSCDTD_NUM_AXIS; i++)
+                p_det->baseline[i] = x[i] * 256;
+            return HSCDTD_EVENT_END;
+        }
+        if (above_off) {
+            p_det->run = 0;
+            p_det->last_active_us = now;
+        } else if (++p_det->run >= p_config->off_samples) {
+            event_finish(p_det, p_det->last_active_us);
+            return HSCDTD_EVENT_END;
+        }
+        return HSCDTD_EVENT_NONE;
+    }
+
+    // The baseline settles before anything is detected.
+    if (trig && p_det->warmup >= (1UL << p_config->baseline_shift)) {
+        if (p_det->run == 0) {
+            sensor = p_det->event.sensor;
+            memset(&p_det->event, 0, sizeof(hscdtd_event_t));
+            p_det->event.sensor = sensor;
+            p_det->event.start_us = now;
+            p_det->peak_sq = 0;
+        }
+        p_det->run++;
+        p_det->event.samples = p_det->run;
+        p_det->event.trigger |= trig;
+        event_track(p_det, d, sq, now);
+        if (p_det->run >= p_config->on_samples) {
+            p_det->active = 1;
+            p_det->run = 0;
+            p_det->last_active_us = now;
+            p_det->event.peak_mag = event_isqrt(p_det->peak_sq);
+            return HSCDTD_EVENT_START;
+        }
+        // The baseline is held while the start is debounced.
+        return HSCDTD_EVENT_NONE;
+    }
+
+    p_det->run = 0;
+    if (p_det->warmup < (1UL << p_config->baseline_shift))
+        p_det->warmup++;
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+        p_det->baseline[i] += (x[i] * 256 - p_det->baseline[i]) >>
+                              p_config->baseline_shift;
+    }
+    return HSCDTD_EVENT_NONE;
+}
+
+
+/**
+ * @brief Restart the baseline from the next sample, drop an event.
+ *
+ * @param p_det Pointer to detector struct.
+ */
+void hscdtd_event_reset(hscdtd_event_detector_t *p_det)
+{
+    p_det->warmup = 0;
+    p_det->active = 0;
+    p_det->run = 0;
+}
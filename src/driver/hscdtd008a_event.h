@@ -0,0 +1,115 @@
+#ifndef __HSCDTD008A_EVENT__
+#define __HSCDTD008A_EVENT__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+
+/**
+ * Detection of magnetic disturbances, such as a passing vehicle or an
+ * opening door, in the samples of a sensor.
+ *
+ * Every sensor has its own detector. The baseline of each axis is an
+ * exponential moving average over 2^baseline_shift samples, in integers,
+ * and is held during an event. An event is the deviation from the
+ * baseline:
+ *  - starting when the deviation of an axis or of the vector exceeds the
+ *    on thresholds for on_samples samples in a row,
+ *  - ending when all are below the off thresholds for off_samples samples
+ *    in a row.
+ * Thresholds are in LSB (0.15uT at 15 bit), off below on gives the
+ * hysteresis, on_samples and off_samples the debounce. An event longer
+ * than max_duration_us ends with HSCDTD_EVENT_TIMEOUT and the baseline
+ * restarts from the field at that time, such as after a car parked.
+ *
+ * An update is a few integer operations and three 32 bit products per
+ * sample, and returns whether an event started or ended, so a node can
+ * sleep its radio until then.
+ */
+
+// Result of hscdtd_event_update.
+#define HSCDTD_EVENT_NONE               0
+#define HSCDTD_EVENT_START              1
+#define HSCDTD_EVENT_END                2
+
+// hscdtd_event_t.trigger, thresholds that were exceeded during the event.
+#define HSCDTD_EVENT_TRIG_X             0x01
+#define HSCDTD_EVENT_TRIG_Y             0x02
+#define HSCDTD_EVENT_TRIG_Z             0x04
+#define HSCDTD_EVENT_TRIG_MAG           0x08
+// The event was ended by max_duration_us.
+#define HSCDTD_EVENT_TIMEOUT            0x80
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct {
+    // Baseline over 2^baseline_shift samples, 1 to 16.
+    uint8_t baseline_shift;
+    // Deviation of the vector, 0 to disable.
+    uint16_t mag_on;
+    uint16_t mag_off;
+    // Deviation of a single axis, 0 to disable.
+    uint16_t axis_on;
+    uint16_t axis_off;
+    // Debounce, in samples.
+    uint8_t on_samples;
+    uint8_t off_samples;
+    // 0 for no limit.
+    uint32_t max_duration_us;
+} hscdtd_event_config_t;
+
+// 3uT on the vector, 6uT on an axis, baseline over 256 samples.
+#define HSCDTD_EVENT_CONFIG_DEFAULT \
+    {8, 20, 13, 40, 27, 2, 4, 60000000UL}
+
+
+// Compact record of an event, 24 bytes.
+typedef struct {
+    uint32_t start_us;
+    // Last sample above the off thresholds, 0 in a started event.
+    uint32_t end_us;
+    uint32_t peak_us;
+    // Deviation from the baseline at the peak of the vector, in LSB.
+    int16_t peak[HSCDTD_NUM_AXIS];
+    uint16_t peak_mag;
+    uint16_t samples;
+    uint8_t sensor;
+    // HSCDTD_EVENT_TRIG_* and HSCDTD_EVENT_TIMEOUT.
+    uint8_t trigger;
+} hscdtd_event_t;
+
+
+typedef struct {
+    const hscdtd_event_config_t *p_config;
+    // Baseline in LSB * 256.
+    int32_t baseline[HSCDTD_NUM_AXIS];
+    // Samples seen while the baseline settles, up to 2^baseline_shift.
+    uint32_t warmup;
+    uint32_t mag_on_sq;
+    uint32_t mag_off_sq;
+    uint32_t peak_sq;
+    uint32_t last_active_us;
+    uint8_t active;
+    // Samples in a row above the on or below the off thresholds.
+    uint8_t run;
+    hscdtd_event_t event;
+} hscdtd_event_detector_t;
+
+
+hscdtd_status_t hscdtd_event_init(hscdtd_event_detector_t *p_det,
+                                  const hscdtd_event_config_t *p_config,
+                                  uint8_t sensor);
+
+uint8_t hscdtd_event_update(hscdtd_event_detector_t *p_det,
+                            const hscdtd_sample_t *p_sample);
+
+void hscdtd_event_reset(hscdtd_event_detector_t *p_det);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_EVENT__
@@ -0,0 +1,409 @@
+#include <string.h>
+#include "hscdtd008a_fake.h"
+#include "hscdtd008a_reg.h"
+
+// Default transfer cost, a 400kHz bus, 9 clocks per byte.
+#define HSCDTD_FAKE_XFER_COST_US        10
+#define HSCDTD_FAKE_BYTE_COST_US        23
+#define HSCDTD_FAKE_CONVERSION_US       5000
+
+static const uint32_t odr_period_us[] = {
+    2000000,  // HSCDTD_ODR_0_5HZ
+    100000,   // HSCDTD_ODR_10HZ
+    50000,    // HSCDTD_ODR_20HZ
+    10000,    // HSCDTD_ODR_100HZ
+};
+
+
+// Sleeps run outside of the bus lock, the clock is shared by threads.
+static uint32_t fake_clock_add(hscdtd_fake_bus_t *p_bus, uint32_t us)
+{
+#ifdef RPI
+    return __atomic_add_fetch(&p_bus->now_us, us, __ATOMIC_RELAXED);
+#else
+    return p_bus->now_us += us;
+#endif  // RPI
+}
+
+
+static uint32_t fake_clock(hscdtd_fake_bus_t *p_bus)
+{
+#ifdef RPI
+    return __atomic_load_n(&p_bus->now_us, __ATOMIC_RELAXED);
+#else
+    return p_bus->now_us;
+#endif  // RPI
+}
+
+
+static hscdtd_fake_device_t *fake_find(hscdtd_fake_bus_t *p_bus,
+                                       uint8_t addr)
+{
+    uint8_t i;
+
+    for (i = 0; i < p_bus->count; i++) {
+        if (p_bus->devices[i].addr == addr)
+            return &p_bus->devices[i];
+    }
+    return 0;
+}
+
+
+static void fake_reset(hscdtd_fake_device_t *p_fake)
+{
+    memset(p_fake->regs, 0, sizeof(p_fake->regs));
+    p_fake->regs[HSCDTD_REG_SELFTEST_RESP] = 0x55;
+    p_fake->regs[HSCDTD_REG_WIA] = 0x49;
+    p_fake->regs[HSCDTD_REG_CTRL1] = 0x22;
+    p_fake->regs[HSCDTD_REG_CTRL4] = 0x80;
+    p_fake->converting = 0;
+    p_fake->fifo_count = 0;
+}
+
+
+static void fake_set_output(hscdtd_fake_device_t *p_fake,
+                            const int16_t *p_value)
+{
+    int8_t i;
+
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+        p_fake->regs[HSCDTD_REG_XOUT_L + 2 * i] = (uint8_t) p_value[i];
+        p_fake->regs[HSCDTD_REG_XOUT_H + 2 * i] = (uint8_t) (p_value[i] >> 8);
+    }
+}
+
+
+static void fake_latch(hscdtd_fake_device_t *p_fake)
+{
+    int32_t value;
+    int16_t offset;
+    int16_t sample[HSCDTD_NUM_AXIS];
+    uint8_t *p_status = &p_fake->regs[HSCDTD_REG_STATUS];
+    int32_t max = HSCDTD_15BIT_MAX_LSB;
+    int32_t min = HSCDTD_15BIT_MIN_LSB;
+    int8_t i;
+
+    if (HSCDTD_FIELD_GET(HSCDTD_CTRL4_RS, p_fake->regs[HSCDTD_REG_CTRL4]) ==
+        HSCDTD_RESOLUTION_14_BIT) {
+        max = HSCDTD_14BIT_MAX_LSB;
+        min = HSCDTD_14BIT_MIN_LSB;
+    }
+
+    // The sensor subtracts the offset registers.
+    for (i = 0; i < HSCDTD_NUM_AXIS; i++) {
+        offset = (int16_t) (p_fake->regs[HSCDTD_REG_OFFSET_X_L + 2 * i] |
+                            (p_fake->regs[HSCDTD_REG_OFFSET_X_H + 2 * i] << 8));
+        value = (int32_t) p_fake->field[i] - offset;
+        if (value > max)
+            value = max;
+        if (value < min)
+            value = min;
+        sample[i] = (int16_t) value;
+    }
+    p_fake->conversions++;
+
+    if (!HSCDTD_FIELD_GET(HSCDTD_CTRL2_FF, p_fake->regs[HSCDTD_REG_CTRL2])) {
+        fake_set_output(p_fake, sample);
+        if (HSCDTD_FIELD_GET(HSCDTD_STATUS_DRDY, *p_status))
+            *p_status |= HSCDTD_STATUS_DOR_MSK;
+        *p_status |= HSCDTD_STATUS_DRDY_MSK;
+        return;
+    }
+
+    // The output registers show the oldest sample in the FIFO.
+    if (p_fake->fifo_count >= HSCDTD_FAKE_FIFO_DEPTH) {
+        *p_status |= HSCDTD_STATUS_DOR_MSK;
+        return;
+    }
+    memcpy(p_fake->fifo[p_fake->fifo_count++], sample, sizeof(sample));
+    if (p_fake->fifo_count == 1)
+        fake_set_output(p_fake, sample);
+    if (p_fake->fifo_count == HSCDTD_FAKE_FIFO_DEPTH)
+        *p_status |= HSCDTD_STATUS_FFU_MSK;
+    *p_status |= HSCDTD_STATUS_DRDY_MSK;
+    p_fake->regs[HSCDTD_REG_FIFO_P_STATUS] = p_fake->fifo_count;
+}
+
+
+// Reading the output registers takes the oldest sample from the FIFO.
+static void fake_fifo_pop(hscdtd_fake_device_t *p_fake)
+{
+    uint8_t *p_status = &p_fake->regs[HSCDTD_REG_STATUS];
+
+    if (p_fake->fifo_count > 0) {
+        p_fake->fifo_count--;
+        memmove(p_fake->fifo[0], p_fake->fifo[1],
+                p_fake->fifo_count * sizeof(p_fake->fifo[0]));
+    }
+    p_fake->regs[HSCDTD_REG_FIFO_P_STATUS] = p_fake->fifo_count;
+    *p_status &= ~(HSCDTD_STATUS_FFU_MSK | HSCDTD_STATUS_DOR_MSK);
+    if (p_fake->fifo_count > 0)
+        fake_set_output(p_fake, p_fake->fifo[0]);
+    else
+        *p_status &= ~HSCDTD_STATUS_DRDY_MSK;
+}
+
+
+// Run the conversions that ended before now.
+static void fake_update(hscdtd_fake_device_t *p_fake, uint32_t now)
+{
+    uint8_t ctrl1 = p_fake->regs[HSCDTD_REG_CTRL1];
+    uint32_t period;
+    uint8_t i;
+
+    if (p_fake->converting &&
+        (int32_t) (now - p_fake->conversion_end_us) >= 0) {
+        p_fake->converting = 0;
+        fake_latch(p_fake);
+    }
+
+    if (!HSCDTD_FIELD_GET(HSCDTD_CTRL1_PC, ctrl1) ||
+        HSCDTD_FIELD_GET(HSCDTD_CTRL1_FS, ctrl1))
+        return;
+
+    period = odr_period_us[HSCDTD_FIELD_GET(HSCDTD_CTRL1_ODR, ctrl1)];
+    // Every conversion since the last access, they fill the FIFO or
+    // overrun the output registers.
+    for (i = 0; (int32_t) (now - p_fake->next_sample_us) >= 0; i++) {
+        if (i > HSCDTD_FAKE_FIFO_DEPTH) {
+            p_fake->next_sample_us = now + period;
+            break;
+        }
+        fake_latch(p_fake);
+        p_fake->next_sample_us += period;
+    }
+}
+
+
+static void fake_write_reg(hscdtd_fake_bus_t *p_bus,
+                           hscdtd_fake_device_t *p_fake,
+                           uint8_t reg, uint8_t value)
+{
+    uint8_t old_ctrl1 = p_fake->regs[HSCDTD_REG_CTRL1];
+    uint8_t ctrl1;
+
+    if (reg >= HSCDTD_FAKE_NUM_REGS || reg < HSCDTD_REG_CTRL1)
+        return;
+
+    if (reg != HSCDTD_REG_CTRL3) {
+        p_fake->regs[reg] = value;
+        if (reg == HSCDTD_REG_CTRL1) {
+            // Entering the normal state starts the periodic conversions.
+            ctrl1 = value;
+            if (HSCDTD_FIELD_GET(HSCDTD_CTRL1_PC, ctrl1) &&
+                !HSCDTD_FIELD_GET(HSCDTD_CTRL1_FS, ctrl1) &&
+                ctrl1 != old_ctrl1) {
+                p_fake->next_sample_us = fake_clock(p_bus) +
+                    odr_period_us[HSCDTD_FIELD_GET(HSCDTD_CTRL1_ODR, ctrl1)];
+            }
+        }
+        return;
+    }
+
+    // CTRL3 bits start actions and clear themselves.
+    if (value & HSCDTD_CTRL3_SRST_MSK) {
+        fake_reset(p_fake);
+        return;
+    }
+    if ((value & HSCDTD_CTRL3_FRC_MSK) &&
+        HSCDTD_FIELD_GET(HSCDTD_CTRL1_PC, p_fake->regs[HSCDTD_REG_CTRL1]) &&
+        HSCDTD_FIELD_GET(HSCDTD_CTRL1_FS, p_fake->regs[HSCDTD_REG_CTRL1])) {
+        p_fake->converting = 1;
+        p_fake->conversion_end_us = fake_clock(p_bus) + p_bus->conversion_us;
+    }
+    if (value & HSCDTD_CTRL3_STC_MSK)
+        p_fake->regs[HSCDTD_REG_SELFTEST_RESP] = 0xAA;
+    if (value & HSCDTD_CTRL3_TCS_MSK) {
+        p_fake->regs[HSCDTD_REG_TEMP] = (uint8_t) p_fake->temp;
+        p_fake->regs[HSCDTD_REG_STATUS] |= HSCDTD_STATUS_TRDY_MSK;
+    }
+}
+
+
+static uint8_t fake_read_reg(hscdtd_fake_device_t *p_fake, uint8_t reg)
+{
+    uint8_t value;
+
+    if (reg >= HSCDTD_FAKE_NUM_REGS)
+        return 0;
+
+    value = p_fake->regs[reg];
+    switch (reg) {
+    case HSCDTD_REG_SELFTEST_RESP:
+        p_fake->regs[reg] = 0x55;
+        break;
+    case HSCDTD_REG_ZOUT_H:
+        // Reading the last output register releases the data.
+        if (HSCDTD_FIELD_GET(HSCDTD_CTRL2_FF, p_fake->regs[HSCDTD_REG_CTRL2]))
+            fake_fifo_pop(p_fake);
+        else
+            p_fake->regs[HSCDTD_REG_STATUS] &= ~(HSCDTD_STATUS_DRDY_MSK |
+                                                 HSCDTD_STATUS_DOR_MSK);
+        break;
+    case HSCDTD_REG_TEMP:
+        p_fake->regs[HSCDTD_REG_STATUS] &= ~HSCDTD_STATUS_TRDY_MSK;
+        break;
+    default:
+        break;
+    }
+    return value;
+}
+
+
+// The address of the transfer is not acknowledged.
+static uint8_t fake_nak(hscdtd_fake_bus_t *p_bus)
+{
+    if (p_bus->nak_every == 0 ||
+        (p_bus->reads + p_bus->writes) % p_bus->nak_every != 0)
+        return 0;
+
+    p_bus->naks++;
+    return 1;
+}
+
+
+static int8_t fake_read(void *p_ctx, uint8_t addr, uint8_t reg,
+                        uint8_t length, uint8_t *p_buffer)
+{
+    hscdtd_fake_bus_t *p_bus = (hscdtd_fake_bus_t *) p_ctx;
+    hscdtd_fake_device_t *p_fake = fake_find(p_bus, addr);
+    uint32_t now;
+    uint8_t i;
+
+    now = fake_clock_add(p_bus, p_bus->xfer_cost_us +
+                                p_bus->byte_cost_us * (length + 3));
+    p_bus->reads++;
+    if (!p_fake || fake_nak(p_bus))
+        return -1;
+
+    fake_update(p_fake, now);
+    for (i = 0; i < length; i++)
+        p_buffer[i] = fake_read_reg(p_fake, reg + i);
+
+    return 0;
+}
+
+
+static int8_t fake_write(void *p_ctx, uint8_t addr, uint8_t reg,
+                         uint8_t length, uint8_t *p_buffer)
+{
+    hscdtd_fake_bus_t *p_bus = (hscdtd_fake_bus_t *) p_ctx;
+    hscdtd_fake_device_t *p_fake = fake_find(p_bus, addr);
+    uint32_t now;
+    uint8_t i;
+
+    now = fake_clock_add(p_bus, p_bus->xfer_cost_us +
+                                p_bus->byte_cost_us * (length + 2));
+    p_bus->writes++;
+    if (!p_fake || fake_nak(p_bus))
+        return -1;
+
+    fake_update(p_fake, now);
+    for (i = 0; i < length; i++)
+        fake_write_reg(p_bus, p_fake, reg + i, p_buffer[i]);
+
+    return 0;
+}
+
+
+static void fake_sleep_ms(void *p_ctx, uint32_t duration_ms)
+{
+    fake_clock_add((hscdtd_fake_bus_t *) p_ctx, duration_ms * 1000UL);
+}
+
+
+static uint32_t fake_now_us(void *p_ctx)
+{
+    return fake_clock((hscdtd_fake_bus_t *) p_ctx);
+}
+
+
+static int8_t fake_batch(void *p_ctx, hscdtd_xfer_t *p_xfers, uint8_t count)
+{
+    hscdtd_fake_bus_t *p_bus = (hscdtd_fake_bus_t *) p_ctx;
+    int8_t status;
+    uint8_t i;
+
+    // One transaction, the per transfer cost is paid once.
+    p_bus->batches++;
+    fake_clock_add(p_bus, p_bus->xfer_cost_us);
+    for (i = 0; i < count; i++) {
+        fake_clock_add(p_bus, -p_bus->xfer_cost_us);
+        if (p_xfers[i].read)
+            status = fake_read(p_ctx, p_xfers[i].addr, p_xfers[i].reg,
+                               p_xfers[i].length, p_xfers[i].p_buffer);
+        else
+            status = fake_write(p_ctx, p_xfers[i].addr, p_xfers[i].reg,
+                                p_xfers[i].length, p_xfers[i].p_buffer);
+        if (status != 0)
+            return status;
+    }
+    return 0;
+}
+
+
+const hscdtd_transport_t hscdtd_fake_transport = {
+    0,
+    fake_read,
+    fake_write,
+    fake_sleep_ms,
+    fake_now_us,
+    fake_batch,
+};
+
+
+/**
+ * @brief Initialize an empty fake bus.
+ *
+ * Use with hscdtd_set_transport(p_dev, &hscdtd_fake_transport, p_bus).
+ *
+ * @param p_bus Pointer to bus struct.
+ */
+void hscdtd_fake_init(hscdtd_fake_bus_t *p_bus)
+{
+    memset(p_bus, 0, sizeof(hscdtd_fake_bus_t));
+    p_bus->xfer_cost_us = HSCDTD_FAKE_XFER_COST_US;
+    p_bus->byte_cost_us = HSCDTD_FAKE_BYTE_COST_US;
+    p_bus->conversion_us = HSCDTD_FAKE_CONVERSION_US;
+}
+
+
+/**
+ * @brief Add a device to the fake bus.
+ *
+ * The device starts in its reset state, set field and temp to the values
+ * it should measure.
+ *
+ * @param p_bus Pointer to bus struct.
+ * @param addr I2C address of the device.
+ * @return Pointer to the device model, NULL if the bus is full or the
+ *         address is in use.
+ */
+hscdtd_fake_device_t *hscdtd_fake_add(hscdtd_fake_bus_t *p_bus,
+                                      uint8_t addr)
+{
+    hscdtd_fake_device_t *p_fake;
+
+    if (p_bus->count >= HSCDTD_FAKE_MAX_DEVICES || fake_find(p_bus, addr))
+        return 0;
+
+    p_fake = &p_bus->devices[p_bus->count++];
+    memset(p_fake, 0, sizeof(hscdtd_fake_device_t));
+    p_fake->addr = addr;
+    p_fake->temp = 25;
+    fake_reset(p_fake);
+    return p_fake;
+}
+
+
+/**
+ * @brief Put a device back in its reset state, as after a brown-out.
+ *
+ * The driver is not told, for tests of fault detection and recovery.
+ *
+ * @param p_fake Pointer to the device model.
+ */
+void hscdtd_fake_power_cycle(hscdtd_fake_device_t *p_fake)
+{
+    fake_reset(p_fake);
+}
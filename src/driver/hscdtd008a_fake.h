@@ -0,0 +1,92 @@
+#ifndef __HSCDTD008A_FAKE__
+#define __HSCDTD008A_FAKE__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+
+/**
+ * Fake transport, a register model of HSCDTD008A devices on a simulated
+ * bus. For tests and benchmarks without hardware.
+ *
+ * The bus has its own clock, which only advances by the cost of transfers
+ * and by sleeps, so runs are deterministic. Modelled:
+ *  - reset values, soft reset, self test response, temperature
+ *  - force state conversions, taking conversion_us
+ *  - normal state conversions at the configured output data rate
+ *  - offset registers, DRDY and DOR in STATUS
+ *  - the FIFO, FIFO_P_STATUS and FFU; samples are dropped if it is full
+ *  - a brown-out, with hscdtd_fake_power_cycle
+ *  - a NAK of the address on every nak_every-th transfer, as on a noisy
+ *    bus
+ *
+ * To use the fake from multiple threads, put its devices on one
+ * hscdtd_bus_t.
+ */
+
+#ifndef HSCDTD_FAKE_MAX_DEVICES
+#define HSCDTD_FAKE_MAX_DEVICES         8
+#endif  // HSCDTD_FAKE_MAX_DEVICES
+
+#define HSCDTD_FAKE_NUM_REGS            0x40
+#define HSCDTD_FAKE_FIFO_DEPTH          8
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct {
+    uint8_t addr;
+    uint8_t regs[HSCDTD_FAKE_NUM_REGS];
+    // Field seen by the sensor in LSB, before the offset registers.
+    int16_t field[HSCDTD_NUM_AXIS];
+    int8_t temp;
+
+    uint8_t converting;
+    uint32_t conversion_end_us;
+    uint32_t next_sample_us;
+    uint32_t conversions;
+
+    int16_t fifo[HSCDTD_FAKE_FIFO_DEPTH][HSCDTD_NUM_AXIS];
+    uint8_t fifo_count;
+} hscdtd_fake_device_t;
+
+
+typedef struct {
+    hscdtd_fake_device_t devices[HSCDTD_FAKE_MAX_DEVICES];
+    uint8_t count;
+
+    // Simulated clock.
+    uint32_t now_us;
+    // Cost of a transfer, per transaction and per byte (address and
+    // register byte included).
+    uint32_t xfer_cost_us;
+    uint32_t byte_cost_us;
+    // Duration of a force state conversion.
+    uint32_t conversion_us;
+
+    // Every nak_every-th read or write fails without effect, 0 for none.
+    uint32_t nak_every;
+
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t batches;
+    uint32_t naks;
+} hscdtd_fake_bus_t;
+
+
+extern const hscdtd_transport_t hscdtd_fake_transport;
+
+void hscdtd_fake_init(hscdtd_fake_bus_t *p_bus);
+
+hscdtd_fake_device_t *hscdtd_fake_add(hscdtd_fake_bus_t *p_bus,
+                                      uint8_t addr);
+
+void hscdtd_fake_power_cycle(hscdtd_fake_device_t *p_fake);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_FAKE__
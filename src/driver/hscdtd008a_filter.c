@@ -0,0 +1,415 @@
+#include <math.h>
+#include <string.h>
+#include "hscdtd008a_filter.h"
+
+#define HSCDTD_PI                       3.14159265f
+
+
+/**
+ * @brief Initialize median filters.
+ *
+ * The median of a window of HSCDTD_MEDIAN_WINDOW samples removes spikes up
+ * to (HSCDTD_MEDIAN_WINDOW - 1) / 2 samples long. It delays the signal by
+ * the same number of samples.
+ *
+ * @param p_states Pointer to n_sensors filter states.
+ * @param n_sensors Number of sensors.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_median_init(hscdtd_median_t *p_states,
+                                   uint8_t n_sensors)
+{
+    if (!p_states) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    memset(p_states, 0, sizeof(hscdtd_median_t) * n_sensors);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Median filter a batch of samples in place.
+ *
+ * @param p_states Pointer to n_sensors filter states.
+ * @param n_sensors Number of sensors in the batch.
+ * @param p_samples Samples, interleaved per sweep.
+ * @param n_sweeps Number of sweeps in the batch.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_median_process(void *p_states, uint8_t n_sensors,
+                                      hscdtd_mag_t *p_samples,
+                                      uint16_t n_sweeps)
+{
+    hscdtd_median_t *p_filter;
+    float values[HSCDTD_MEDIAN_WINDOW];
+    float value;
+    float *sample;
+    uint16_t sweep;
+    uint8_t sensor, axis, i, j;
+
+    if (!p_states || !p_samples) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    for (sweep = 0; sweep < n_sweeps; sweep++) {
+        for (sensor = 0; sensor < n_sensors; sensor++) {
+            p_filter = (hscdtd_median_t *) p_states + sensor;
+            sample = &p_samples->mag_x;
+
+            p_filter->window[p_filter->index] = *p_samples;
+            if (++p_filter->index >= HSCDTD_MEDIAN_WINDOW)
+                p_filter->index = 0;
+            if (p_filter->count < HSCDTD_MEDIAN_WINDOW)
+                p_filter->count++;
+
+            for (axis = 0; axis < HSCDTD_NUM_AXIS; axis++) {
+                // Insertion sort, the fastest option for a handful of values.
+                for (i = 0; i < p_filter->count; i++) {
+                    value = (&p_filter->window[i].mag_x)[axis];
+                    for (j = i; j > 0 && values[j - 1] > value; j--)
+                        values[j] = values[j - 1];
+                    values[j] = value;
+                }
+                sample[axis] = values[p_filter->count / 2];
+            }
+            p_samples++;
+        }
+    }
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Initialize single-pole low-pass filters.
+ *
+ * y[n] = y[n-1] + alpha * (x[n] - y[n-1]). The group delay at low
+ * frequencies is (1 - alpha) / alpha samples.
+ *
+ * @param p_states Pointer to n_sensors filter states.
+ * @param n_sensors Number of sensors.
+ * @param alpha Smoothing factor (0.0, 1.0].
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_lowpass_init(hscdtd_lowpass_t *p_states,
+                                    uint8_t n_sensors, float alpha)
+{
+    uint8_t sensor;
+
+    if (!p_states) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (alpha <= 0.0f || alpha > 1.0f) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    memset(p_states, 0, sizeof(hscdtd_lowpass_t) * n_sensors);
+    for (sensor = 0; sensor < n_sensors; sensor++)
+        p_states[sensor].alpha = alpha;
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Low-pass filter a batch of samples in place.
+ *
+ * The filter is primed with the first sample, so there is no settling
+ * from zero.
+ *
+ * @param p_states Pointer to n_sensors filter states.
+ * @param n_sensors Number of sensors in the batch.
+ * @param p_samples Samples, interleaved per sweep.
+ * @param n_sweeps Number of sweeps in the batch.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_lowpass_process(void *p_states, uint8_t n_sensors,
+                                       hscdtd_mag_t *p_samples,
+                                       uint16_t n_sweeps)
+{
+    hscdtd_lowpass_t *p_filter;
+    uint16_t sweep;
+    uint8_t sensor;
+
+    if (!p_states || !p_samples) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    for (sweep = 0; sweep < n_sweeps; sweep++) {
+        for (sensor = 0; sensor < n_sensors; sensor++) {
+            p_filter = (hscdtd_lowpass_t *) p_states + sensor;
+
+            if (!p_filter->primed) {
+                p_filter->state = *p_samples;
+                p_filter->primed = 1;
+            }
+
+            p_filter->state.mag_x += p_filter->alpha *
+                                     (p_samples->mag_x - p_filter->state.mag_x);
+            p_filter->state.mag_y += p_filter->alpha *
+                                     (p_samples->mag_y - p_filter->state.mag_y);
+            p_filter->state.mag_z += p_filter->alpha *
+                                     (p_samples->mag_z - p_filter->state.mag_z);
+            *p_samples++ = p_filter->state;
+        }
+    }
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Initialize second order Butterworth low-pass filters.
+ *
+ * The group delay at low frequencies is about 0.225 * sample_rate_hz /
+ * cutoff_hz samples.
+ *
+ * @param p_states Pointer to n_sensors filter states.
+ * @param n_sensors Number of sensors.
+ * @param cutoff_hz Cut-off frequency (-3dB).
+ * @param sample_rate_hz Sample rate of the stream.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_biquad_init_lowpass(hscdtd_biquad_t *p_states,
+                                           uint8_t n_sensors,
+                                           float cutoff_hz,
+                                           float sample_rate_hz)
+{
+    float w0, cos_w0, alpha, a0;
+    uint8_t sensor;
+
+    if (!p_states) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (cutoff_hz <= 0.0f || cutoff_hz >= 0.5f * sample_rate_hz) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    // Bilinear transform with Q = 1/sqrt(2), see the RBJ audio EQ cookbook.
+    w0 = 2.0f * HSCDTD_PI * cutoff_hz / sample_rate_hz;
+    cos_w0 = cosf(w0);
+    alpha = sinf(w0) * 0.70710678f;
+    a0 = 1.0f + alpha;
+
+    memset(p_states, 0, sizeof(hscdtd_biquad_t) * n_sensors);
+    for (sensor = 0; sensor < n_sensors; sensor++) {
+        p_states[sensor].b0 = 0.5f * (1.0f - cos_w0) / a0;
+        p_states[sensor].b1 = (1.0f - cos_w0) / a0;
+        p_states[sensor].b2 = p_states[sensor].b0;
+        p_states[sensor].a1 = -2.0f * cos_w0 / a0;
+        p_states[sensor].a2 = (1.0f - alpha) / a0;
+    }
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Biquad filter a batch of samples in place.
+ *
+ * The delay line is primed with the steady state of the first sample.
+ *
+ * @param p_states Pointer to n_sensors filter states.
+ * @param n_sensors Number of sensors in the batch.
+ * @param p_samples Samples, interleaved per sweep.
+ * @param n_sweeps Number of sweeps in the batch.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_biquad_process(void *p_states, uint8_t n_sensors,
+                                      hscdtd_mag_t *p_samples,
+                                      uint16_t n_sweeps)
+{
+    hscdtd_biquad_t *p_filter;
+    float *sample;
+    float x, y;
+    uint16_t sweep;
+    uint8_t sensor, axis;
+
+    if (!p_states || !p_samples) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    for (sweep = 0; sweep < n_sweeps; sweep++) {
+        for (sensor = 0; sensor < n_sensors; sensor++) {
+            p_filter = (hscdtd_biquad_t *) p_states + sensor;
+            sample = &p_samples->mag_x;
+
+            if (!p_filter->primed) {
+                for (axis = 0; axis < HSCDTD_NUM_AXIS; axis++) {
+                    p_filter->z1[axis] = sample[axis] * (1.0f - p_filter->b0);
+                    p_filter->z2[axis] = sample[axis] *
+                                         (p_filter->b2 - p_filter->a2);
+                }
+                p_filter->primed = 1;
+            }
+
+            for (axis = 0; axis < HSCDTD_NUM_AXIS; axis++) {
+                x = sample[axis];
+                y = p_filter->b0 * x + p_filter->z1[axis];
+                p_filter->z1[axis] = p_filter->b1 * x - p_filter->a1 * y +
+                                     p_filter->z2[axis];
+                p_filter->z2[axis] = p_filter->b2 * x - p_filter->a2 * y;
+                sample[axis] = y;
+            }
+            p_samples++;
+        }
+    }
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Initialize constant velocity Kalman filters.
+ *
+ * Each axis is modelled as position + velocity, driven by white noise
+ * acceleration. The filter tracks ramps without lag once settled; the
+ * delay on steps depends on the ratio of the noise values, a smaller
+ * process_noise gives more smoothing and more delay.
+ *
+ * @param p_states Pointer to n_sensors filter states.
+ * @param n_sensors Number of sensors.
+ * @param dt Time between samples in seconds.
+ * @param process_noise Acceleration noise density (uT^2/s^3).
+ * @param measurement_noise Measurement variance (uT^2).
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_kalman_init(hscdtd_kalman_t *p_states,
+                                   uint8_t n_sensors, float dt,
+                                   float process_noise,
+                                   float measurement_noise)
+{
+    uint8_t sensor;
+
+    if (!p_states) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    if (dt <= 0.0f || process_noise <= 0.0f || measurement_noise <= 0.0f) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    memset(p_states, 0, sizeof(hscdtd_kalman_t) * n_sensors);
+    for (sensor = 0; sensor < n_sensors; sensor++) {
+        p_states[sensor].dt = dt;
+        // Discretized white noise acceleration, computed once.
+        p_states[sensor].q00 = process_noise * dt * dt * dt / 3.0f;
+        p_states[sensor].q01 = process_noise * dt * dt / 2.0f;
+        p_states[sensor].q11 = process_noise * dt;
+        p_states[sensor].r = measurement_noise;
+    }
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Kalman filter a batch of samples in place.
+ *
+ * The covariance and gains are computed once per sample for all axes.
+ *
+ * @param p_states Pointer to n_sensors filter states.
+ * @param n_sensors Number of sensors in the batch.
+ * @param p_samples Samples, interleaved per sweep.
+ * @param n_sweeps Number of sweeps in the batch.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_kalman_process(void *p_states, uint8_t n_sensors,
+                                      hscdtd_mag_t *p_samples,
+                                      uint16_t n_sweeps)
+{
+    hscdtd_kalman_t *p_filter;
+    float *sample;
+    float p00, p01, p11, k0, k1, innovation;
+    uint16_t sweep;
+    uint8_t sensor, axis;
+
+    if (!p_states || !p_samples) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    for (sweep = 0; sweep < n_sweeps; sweep++) {
+        for (sensor = 0; sensor < n_sensors; sensor++) {
+            p_filter = (hscdtd_kalman_t *) p_states + sensor;
+            sample = &p_samples->mag_x;
+
+            if (!p_filter->primed) {
+                for (axis = 0; axis < HSCDTD_NUM_AXIS; axis++) {
+                    p_filter->pos[axis] = sample[axis];
+                    p_filter->vel[axis] = 0.0f;
+                }
+                p_filter->p00 = p_filter->r;
+                p_filter->p01 = 0.0f;
+                p_filter->p11 = p_filter->r;
+                p_filter->primed = 1;
+                p_samples++;
+                continue;
+            }
+
+            // Predict P = F P F^T + Q with F = [1 dt; 0 1].
+            p00 = p_filter->p00 + p_filter->dt *
+                  (2.0f * p_filter->p01 + p_filter->dt * p_filter->p11) +
+                  p_filter->q00;
+            p01 = p_filter->p01 + p_filter->dt * p_filter->p11 + p_filter->q01;
+            p11 = p_filter->p11 + p_filter->q11;
+
+            // Gain for a position measurement.
+            k0 = p00 / (p00 + p_filter->r);
+            k1 = p01 / (p00 + p_filter->r);
+
+            p_filter->p00 = (1.0f - k0) * p00;
+            p_filter->p01 = (1.0f - k0) * p01;
+            p_filter->p11 = p11 - k1 * p01;
+
+            for (axis = 0; axis < HSCDTD_NUM_AXIS; axis++) {
+                p_filter->pos[axis] += p_filter->dt * p_filter->vel[axis];
+                innovation = sample[axis] - p_filter->pos[axis];
+                p_filter->pos[axis] += k0 * innovation;
+                p_filter->vel[axis] += k1 * innovation;
+                sample[axis] = p_filter->pos[axis];
+            }
+            p_samples++;
+        }
+    }
+
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Run a batch through a chain of filter stages.
+ *
+ * Stages are applied in order, each on the complete batch.
+ *
+ * @param p_stages Pointer to the stages.
+ * @param n_stages Number of stages.
+ * @param p_samples Samples, interleaved per sweep.
+ * @param n_sensors Number of sensors in the batch.
+ * @param n_sweeps Number of sweeps in the batch.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_filter_chain(const hscdtd_filter_stage_t *p_stages,
+                                    uint8_t n_stages,
+                                    hscdtd_mag_t *p_samples,
+                                    uint8_t n_sensors,
+                                    uint16_t n_sweeps)
+{
+    hscdtd_status_t status;
+    uint8_t i;
+
+    if (!p_stages) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    for (i = 0; i < n_stages; i++) {
+        status = p_stages[i].process(p_stages[i].p_states, n_sensors,
+                                     p_samples, n_sweeps);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+    }
+
+    return HSCDTD_STAT_OK;
+}
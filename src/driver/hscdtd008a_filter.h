@@ -0,0 +1,126 @@
+#ifndef __HSCDTD008A_FILTER__
+#define __HSCDTD008A_FILTER__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+
+// Window length of the median filter, must be odd.
+#ifndef HSCDTD_MEDIAN_WINDOW
+#define HSCDTD_MEDIAN_WINDOW            5
+#endif  // HSCDTD_MEDIAN_WINDOW
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+/**
+ * All filters process batches in place. A batch holds n_sweeps samples of
+ * n_sensors sensors, interleaved per sweep:
+ *   p_samples[sweep * n_sensors + sensor]
+ * Every sensor has its own filter state, p_states[sensor].
+ */
+
+
+// Median filter, rejects spikes shorter than half the window.
+typedef struct {
+    hscdtd_mag_t window[HSCDTD_MEDIAN_WINDOW];
+    uint8_t index;
+    uint8_t count;
+} hscdtd_median_t;
+
+
+// Single-pole low-pass, y += alpha * (x - y).
+typedef struct {
+    float alpha;
+    hscdtd_mag_t state;
+    uint8_t primed;
+} hscdtd_lowpass_t;
+
+
+// Biquad in transposed direct form II, coefficients normalized to a0 = 1.
+typedef struct {
+    float b0;
+    float b1;
+    float b2;
+    float a1;
+    float a2;
+    float z1[HSCDTD_NUM_AXIS];
+    float z2[HSCDTD_NUM_AXIS];
+    uint8_t primed;
+} hscdtd_biquad_t;
+
+
+// Constant velocity Kalman filter. The axes share one covariance matrix,
+// they have the same noise model and are always updated together.
+typedef struct {
+    float dt;
+    float q00;
+    float q01;
+    float q11;
+    float r;
+    float p00;
+    float p01;
+    float p11;
+    float pos[HSCDTD_NUM_AXIS];
+    float vel[HSCDTD_NUM_AXIS];
+    uint8_t primed;
+} hscdtd_kalman_t;
+
+
+typedef hscdtd_status_t (*hscdtd_filter_fn_t)(void *p_states,
+                                              uint8_t n_sensors,
+                                              hscdtd_mag_t *p_samples,
+                                              uint16_t n_sweeps);
+
+// One stage in a filter chain, p_states points to n_sensors states.
+typedef struct {
+    hscdtd_filter_fn_t process;
+    void *p_states;
+} hscdtd_filter_stage_t;
+
+
+hscdtd_status_t hscdtd_median_init(hscdtd_median_t *p_states,
+                                   uint8_t n_sensors);
+
+hscdtd_status_t hscdtd_median_process(void *p_states, uint8_t n_sensors,
+                                      hscdtd_mag_t *p_samples,
+                                      uint16_t n_sweeps);
+
+hscdtd_status_t hscdtd_lowpass_init(hscdtd_lowpass_t *p_states,
+                                    uint8_t n_sensors, float alpha);
+
+hscdtd_status_t hscdtd_lowpass_process(void *p_states, uint8_t n_sensors,
+                                       hscdtd_mag_t *p_samples,
+                                       uint16_t n_sweeps);
+
+hscdtd_status_t hscdtd_biquad_init_lowpass(hscdtd_biquad_t *p_states,
+                                           uint8_t n_sensors,
+                                           float cutoff_hz,
+                                           float sample_rate_hz);
+
+hscdtd_status_t hscdtd_biquad_process(void *p_states, uint8_t n_sensors,
+                                      hscdtd_mag_t *p_samples,
+                                      uint16_t n_sweeps);
+
+hscdtd_status_t hscdtd_kalman_init(hscdtd_kalman_t *p_states,
+                                   uint8_t n_sensors, float dt,
+                                   float process_noise,
+                                   float measurement_noise);
+
+hscdtd_status_t hscdtd_kalman_process(void *p_states, uint8_t n_sensors,
+                                      hscdtd_mag_t *p_samples,
+                                      uint16_t n_sweeps);
+
+hscdtd_status_t hscdtd_filter_chain(const hscdtd_filter_stage_t *p_stages,
+                                    uint8_t n_stages,
+                                    hscdtd_mag_t *p_samples,
+                                    uint8_t n_sensors,
+                                    uint16_t n_sweeps);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_FILTER__
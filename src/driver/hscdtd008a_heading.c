@@ -0,0 +1,238 @@
+#include <math.h>
+#include "hscdtd008a_heading.h"
+
+// Keep the lookup tables in flash on AVR, RAM is too scarce for them.
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define HSCDTD_TABLE_READ(p)            pgm_read_word(p)
+#else
+#define PROGMEM
+#define HSCDTD_TABLE_READ(p)            (*(p))
+#endif  // __AVR__
+
+#define HSCDTD_RAD_TO_DEG               57.2957795f
+
+// Number of segments in the atan lookup table over [0, 1].
+#define HSCDTD_ATAN_LUT_SEGMENTS        32
+
+#define HSCDTD_CORDIC_ITERATIONS        16
+
+// CORDIC inputs are normalized to this many bits, which leaves headroom
+// for the CORDIC gain (~1.65).
+#define HSCDTD_CORDIC_INPUT_BITS        28
+
+
+// atan(i / 32) in millidegrees.
+static const uint16_t atan_lut[HSCDTD_ATAN_LUT_SEGMENTS + 1] PROGMEM = {
+    0, 1790, 3576, 5356, 7125, 8881, 10620, 12339, 14036, 15709, 17354,
+    18970, 20556, 22109, 23629, 25115, 26565, 27979, 29358, 30700, 32005,
+    33275, 34509, 35707, 36870, 37999, 39094, 40156, 41186, 42184, 43152,
+    44091, 45000,
+};
+
+// atan(2^-i) in millidegrees.
+static const uint16_t cordic_angles[HSCDTD_CORDIC_ITERATIONS] PROGMEM = {
+    45000, 26565, 14036, 7125, 3576, 1790, 895, 448, 224, 112, 56, 28, 14,
+    7, 3, 2,
+};
+
+
+/**
+ * @brief atan of a ratio in [0, 1] in degrees.
+ *
+ * @param a Ratio between 0 and 1.
+ * @param mode HSCDTD_ATAN2_POLY or HSCDTD_ATAN2_LUT.
+ * @return Angle between 0 and 45 degrees.
+ */
+static float atan_unit_deg(float a, hscdtd_atan2_mode_t mode)
+{
+    uint8_t i;
+    float pos, lo, hi;
+
+    if (mode == HSCDTD_ATAN2_LUT) {
+        pos = a * HSCDTD_ATAN_LUT_SEGMENTS;
+        i = (uint8_t) pos;
+        if (i >= HSCDTD_ATAN_LUT_SEGMENTS)
+            i = HSCDTD_ATAN_LUT_SEGMENTS - 1;
+        lo = HSCDTD_TABLE_READ(&atan_lut[i]);
+        hi = HSCDTD_TABLE_READ(&atan_lut[i + 1]);
+        return (lo + (hi - lo) * (pos - i)) * 0.001f;
+    }
+
+    // pi/4 * a - a * (a - 1) * (0.2447 + 0.0663 * a), in degrees.
+    return 45.0f * a - a * (a - 1.0f) * (14.0206f + 3.7987f * a);
+}
+
+
+/**
+ * @brief CORDIC atan2 on integers.
+ *
+ * Uses only shifts and adds, which makes it the fastest option on targets
+ * without FPU or hardware multiplier. Inputs must be smaller than 2^29 in
+ * magnitude.
+ *
+ * @param y Y coordinate.
+ * @param x X coordinate.
+ * @return Angle in millidegrees, between -180000 and 180000.
+ */
+int32_t hscdtd_atan2_cordic_mdeg(int32_t y, int32_t x)
+{
+    int32_t angle = 0;
+    int32_t tmp;
+    uint8_t i;
+
+    if (x == 0 && y == 0)
+        return 0;
+
+    // CORDIC converges for angles within +/- 99 degrees, rotate the left
+    // half plane onto the right half plane first.
+    if (x < 0) {
+        angle = (y >= 0) ? 180000 : -180000;
+        x = -x;
+        y = -y;
+    }
+
+    // Scale up small inputs, the shifts below truncate.
+    while (x < (1L << (HSCDTD_CORDIC_INPUT_BITS - 1)) &&
+           y < (1L << (HSCDTD_CORDIC_INPUT_BITS - 1)) &&
+           y > -(1L << (HSCDTD_CORDIC_INPUT_BITS - 1))) {
+        x <<= 1;
+        y <<= 1;
+    }
+
+    for (i = 0; i < HSCDTD_CORDIC_ITERATIONS; i++) {
+        tmp = x;
+        if (y > 0) {
+            x += y >> i;
+            y -= tmp >> i;
+            angle += HSCDTD_TABLE_READ(&cordic_angles[i]);
+        } else {
+            x -= y >> i;
+            y += tmp >> i;
+            angle -= HSCDTD_TABLE_READ(&cordic_angles[i]);
+        }
+    }
+
+    return angle;
+}
+
+
+/**
+ * @brief Fast atan2 in degrees.
+ *
+ * @param y Y coordinate.
+ * @param x X coordinate.
+ * @param mode Implementation to use.
+ * @return Angle in degrees, between -180 and 180.
+ */
+float hscdtd_atan2_deg(float y, float x, hscdtd_atan2_mode_t mode)
+{
+    float ax, ay, angle;
+    int exp_x, exp_y;
+
+    switch (mode) {
+    case HSCDTD_ATAN2_EXACT:
+        return atan2f(y, x) * HSCDTD_RAD_TO_DEG;
+
+    case HSCDTD_ATAN2_CORDIC:
+        // Scale both inputs by the same power of two, this only touches
+        // the exponent and keeps the conversion to integer exact enough.
+        frexpf(x, &exp_x);
+        frexpf(y, &exp_y);
+        if (exp_y > exp_x)
+            exp_x = exp_y;
+        return 0.001f * hscdtd_atan2_cordic_mdeg(
+            (int32_t) ldexpf(y, HSCDTD_CORDIC_INPUT_BITS - exp_x),
+            (int32_t) ldexpf(x, HSCDTD_CORDIC_INPUT_BITS - exp_x));
+
+    default:
+        break;
+    }
+
+    ax = fabsf(x);
+    ay = fabsf(y);
+    if (ax == 0.0f && ay == 0.0f)
+        return 0.0f;
+
+    // Reduce to the first octant, only a single division is needed.
+    if (ay <= ax)
+        angle = atan_unit_deg(ay / ax, mode);
+    else
+        angle = 90.0f - atan_unit_deg(ax / ay, mode);
+
+    if (x < 0.0f)
+        angle = 180.0f - angle;
+    if (y < 0.0f)
+        angle = -angle;
+
+    return angle;
+}
+
+
+/**
+ * @brief Convert an angle to a heading between 0 and 360 degrees.
+ *
+ * @param angle Angle between -180 and 180 degrees.
+ * @return Heading in degrees.
+ */
+static float to_heading(float angle)
+{
+    if (angle < 0.0f)
+        angle += 360.0f;
+    if (angle >= 360.0f)
+        angle -= 360.0f;
+    return angle;
+}
+
+
+/**
+ * @brief Compute the heading of a level sensor.
+ *
+ * The heading is the angle between magnetic north and the sensor x-axis,
+ * clockwise when looking down on the sensor (z-axis pointing down).
+ *
+ * @param p_mag Pointer to the magneto data.
+ * @param mode atan2 implementation to use.
+ * @return Heading in degrees, between 0 and 360.
+ */
+float hscdtd_heading(const hscdtd_mag_t *p_mag, hscdtd_atan2_mode_t mode)
+{
+    return to_heading(hscdtd_atan2_deg(-p_mag->mag_y, p_mag->mag_x, mode));
+}
+
+
+/**
+ * @brief Compute a tilt compensated heading.
+ *
+ * Uses the direction of gravity to project the field onto the horizontal
+ * plane. No trigonometric functions are needed, east and north follow from
+ * cross products:
+ *   E = D x B, N = E x D, heading = atan2(E.x * |D|, N.x)
+ *
+ * The gravity vector must be in the frame of the magneto sensor and point
+ * down, e.g. the negated reading of an accelerometer at rest. Its length
+ * does not matter.
+ *
+ * @param p_mag Pointer to the magneto data.
+ * @param p_down Pointer to the gravity vector.
+ * @param mode atan2 implementation to use.
+ * @return Heading in degrees, between 0 and 360.
+ */
+float hscdtd_heading_tilt(const hscdtd_mag_t *p_mag,
+                          const hscdtd_vec3_t *p_down,
+                          hscdtd_atan2_mode_t mode)
+{
+    float dd, db, east, north;
+
+    dd = p_down->x * p_down->x + p_down->y * p_down->y +
+         p_down->z * p_down->z;
+    db = p_down->x * p_mag->mag_x + p_down->y * p_mag->mag_y +
+         p_down->z * p_mag->mag_z;
+
+    // (D x B).x
+    east = p_down->y * p_mag->mag_z - p_down->z * p_mag->mag_y;
+    // ((D x B) x D).x = B.x * |D|^2 - D.x * (D . B)
+    north = p_mag->mag_x * dd - p_down->x * db;
+
+    return to_heading(hscdtd_atan2_deg(east * sqrtf(dd), north, mode));
+}
@@ -0,0 +1,46 @@
+#ifndef __HSCDTD008A_HEADING__
+#define __HSCDTD008A_HEADING__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+/**
+ * atan2 implementations. The error bounds hold over the full circle, run
+ * Example6_Heading_Benchmark for the cost of each mode on a target.
+ */
+typedef enum {
+    HSCDTD_ATAN2_EXACT = 0x00,  // libm atan2f.
+    HSCDTD_ATAN2_POLY,          // Polynomial per octant, max error 0.09 deg.
+    HSCDTD_ATAN2_LUT,           // 33 entry table + interpolation, 0.005 deg.
+    HSCDTD_ATAN2_CORDIC,        // 16 integer iterations, 0.005 deg.
+} hscdtd_atan2_mode_t;
+
+
+typedef struct {
+    float x;
+    float y;
+    float z;
+} hscdtd_vec3_t;
+
+
+float hscdtd_atan2_deg(float y, float x, hscdtd_atan2_mode_t mode);
+
+int32_t hscdtd_atan2_cordic_mdeg(int32_t y, int32_t x);
+
+float hscdtd_heading(const hscdtd_mag_t *p_mag, hscdtd_atan2_mode_t mode);
+
+float hscdtd_heading_tilt(const hscdtd_mag_t *p_mag,
+                          const hscdtd_vec3_t *p_down,
+                          hscdtd_atan2_mode_t mode);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_HEADING__
@@ -0,0 +1,250 @@
+#include <string.h>
+#include "hscdtd008a_health.h"
+#include "hscdtd008a_reg.h"
+#include "transport.h"
+
+#define HEALTH_NUM_REGS                 9
+
+// Register of each entry of hscdtd_device_t.reg_shadow.
+static const uint8_t health_regs[HEALTH_NUM_REGS] = {
+    HSCDTD_REG_CTRL1,
+    HSCDTD_REG_CTRL2,
+    HSCDTD_REG_CTRL4,
+    HSCDTD_REG_OFFSET_X_L,
+    HSCDTD_REG_OFFSET_X_H,
+    HSCDTD_REG_OFFSET_Y_L,
+    HSCDTD_REG_OFFSET_Y_H,
+    HSCDTD_REG_OFFSET_Z_L,
+    HSCDTD_REG_OFFSET_Z_H,
+};
+
+// Order of the restore, CTRL1 last so the device starts measuring with the
+// rest of the configuration in place.
+static const uint8_t health_restore_order[HEALTH_NUM_REGS] = {
+    HSCDTD_SHADOW_CTRL2,
+    HSCDTD_SHADOW_CTRL4,
+    HSCDTD_SHADOW_OFFSET,
+    HSCDTD_SHADOW_OFFSET + 1,
+    HSCDTD_SHADOW_OFFSET + 2,
+    HSCDTD_SHADOW_OFFSET + 3,
+    HSCDTD_SHADOW_OFFSET + 4,
+    HSCDTD_SHADOW_OFFSET + 5,
+    HSCDTD_SHADOW_CTRL1,
+};
+
+
+// Read WIA and the kept registers in one transaction, compare them with
+// the known values.
+static uint8_t health_read(hscdtd_device_t *p_dev, const uint8_t *p_known,
+                           uint16_t known_valid)
+{
+    uint8_t wia;
+    uint8_t ctrl[4];
+    uint8_t offset[6];
+    uint8_t value[HEALTH_NUM_REGS];
+    hscdtd_xfer_t xfers[3] = {
+        {p_dev->addr, HSCDTD_REG_WIA, 1, 1, &wia},
+        {p_dev->addr, HSCDTD_REG_CTRL1, 4, 1, ctrl},
+        {p_dev->addr, HSCDTD_REG_OFFSET_X_L, 6, 1, offset},
+    };
+    uint8_t i;
+
+    if (transport_batch(p_dev, xfers, 3) != HSCDTD_STAT_OK)
+        return HSCDTD_HEALTH_FAULT_BUS;
+    if (wia != 0x49)
+        return HSCDTD_HEALTH_FAULT_WIA;
+
+    value[HSCDTD_SHADOW_CTRL1] = ctrl[0];
+    value[HSCDTD_SHADOW_CTRL2] = ctrl[1];
+    value[HSCDTD_SHADOW_CTRL4] = ctrl[3];
+    memcpy(&value[HSCDTD_SHADOW_OFFSET], offset, sizeof(offset));
+    for (i = 0; i < HEALTH_NUM_REGS; i++) {
+        if ((known_valid & (1 << i)) && value[i] != p_known[i])
+            return HSCDTD_HEALTH_FAULT_CONFIG;
+    }
+    return HSCDTD_HEALTH_FAULT_NONE;
+}
+
+
+// Soft reset, then write the known registers in one transaction.
+static hscdtd_status_t health_restore(hscdtd_device_t *p_dev,
+                                      uint8_t *p_known, uint16_t known_valid)
+{
+    hscdtd_xfer_t xfers[HEALTH_NUM_REGS];
+    hscdtd_xfer_t *p_last;
+    hscdtd_status_t status;
+    uint8_t count = 0;
+    uint8_t i, index;
+
+    status = hscdtd_soft_reset(p_dev);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    for (i = 0; i < HEALTH_NUM_REGS; i++) {
+        index = health_restore_order[i];
+        if (!(known_valid & (1 << index)))
+            continue;
+
+        // Consecutive registers, the offsets, are one transfer.
+        p_last = (count > 0) ? &xfers[count - 1] : 0;
+        if (p_last &&
+            p_last->reg + p_last->length == health_regs[index] &&
+            p_last->p_buffer + p_last->length == &p_known[index]) {
+            p_last->length++;
+            continue;
+        }
+        xfers[count].addr = p_dev->addr;
+        xfers[count].reg = health_regs[index];
+        xfers[count].length = 1;
+        xfers[count].read = 0;
+        xfers[count].p_buffer = &p_known[index];
+        count++;
+    }
+
+    if (count == 0)
+        return HSCDTD_STAT_OK;
+    return transport_batch(p_dev, xfers, count);
+}
+
+
+// Check, and recover from a fault. Called with the device lock held.
+static hscdtd_status_t health_check_locked(hscdtd_health_t *p_health)
+{
+    hscdtd_device_t *p_dev = p_health->p_dev;
+    uint8_t known[HEALTH_NUM_REGS];
+    uint16_t known_valid;
+    uint32_t start, elapsed;
+    uint8_t fault, attempt;
+
+    // The reads below replace the kept values.
+    memcpy(known, p_dev->reg_shadow, sizeof(known));
+    known_valid = p_dev->reg_shadow_valid;
+
+    start = transport_now_us(p_dev);
+    p_health->stats.checks++;
+    fault = health_read(p_dev, known, known_valid);
+    if (fault == HSCDTD_HEALTH_FAULT_NONE) {
+        p_health->failed = 0;
+        return HSCDTD_STAT_OK;
+    }
+    p_health->stats.faults++;
+    p_health->stats.last_fault = fault;
+
+    for (attempt = 0; attempt < p_health->config.attempts; attempt++) {
+        if (health_restore(p_dev, known, known_valid) != HSCDTD_STAT_OK)
+            continue;
+        if (health_read(p_dev, known, known_valid) == HSCDTD_HEALTH_FAULT_NONE)
+            break;
+    }
+
+    // Conversions were lost, the device restarted them.
+    p_dev->window_valid = 0;
+    p_dev->drdy_marked = 0;
+    p_dev->overrun = 0;
+    p_dev->status_read = 0;
+    p_dev->odr_resync = 1;
+
+    if (attempt == p_health->config.attempts) {
+        // Keep the configuration to restore at the next check.
+        if (p_dev->p_bus)
+            hscdtd_bus_lock(p_dev->p_bus);
+        memcpy(p_dev->reg_shadow, known, sizeof(known));
+        p_dev->reg_shadow_valid = known_valid;
+        if (p_dev->p_bus)
+            hscdtd_bus_unlock(p_dev->p_bus);
+
+        p_health->failed = 1;
+        p_health->stats.failed++;
+        return (fault == HSCDTD_HEALTH_FAULT_BUS) ?
+            HSCDTD_STAT_TRANSPORT_ERROR : HSCDTD_STAT_CHECK_FAILED;
+    }
+
+    elapsed = transport_now_us(p_dev) - start;
+    p_health->failed = 0;
+    p_health->stats.recoveries++;
+    p_health->stats.recovery_us = elapsed;
+    if (elapsed > p_health->stats.recovery_max_us)
+        p_health->stats.recovery_max_us = elapsed;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Initialize a health monitor.
+ *
+ * The first check is due right away.
+ *
+ * @param p_health Pointer to health monitor struct.
+ * @param p_dev Pointer to device struct, initialized.
+ * @param p_config Check interval and recovery attempts.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_health_init(hscdtd_health_t *p_health,
+                                   hscdtd_device_t *p_dev,
+                                   const hscdtd_health_config_t *p_config)
+{
+    if (!p_health || !p_dev || !p_config) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_config->interval_us > 0x7FFFFFFFUL || p_config->attempts == 0) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    memset(p_health, 0, sizeof(hscdtd_health_t));
+    p_health->p_dev = p_dev;
+    p_health->config = *p_config;
+    p_health->next_check_us = transport_now_us(p_dev);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Run the check if it is due.
+ *
+ * @param p_health Pointer to health monitor struct.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if no check was due.
+ */
+hscdtd_status_t hscdtd_health_poll(hscdtd_health_t *p_health)
+{
+    uint32_t now = transport_now_us(p_health->p_dev);
+
+    if ((int32_t) (now - p_health->next_check_us) < 0)
+        return HSCDTD_STAT_NO_DATA;
+    return hscdtd_health_check(p_health);
+}
+
+
+/**
+ * @brief Check the device now, recover it from a fault.
+ *
+ * @param p_health Pointer to health monitor struct.
+ * @return hscdtd_status, HSCDTD_STAT_OK if the device is healthy or was
+ *         recovered.
+ */
+hscdtd_status_t hscdtd_health_check(hscdtd_health_t *p_health)
+{
+    hscdtd_device_t *p_dev = p_health->p_dev;
+    hscdtd_status_t status;
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = health_check_locked(p_health);
+    p_health->next_check_us = transport_now_us(p_dev) +
+                              p_health->config.interval_us;
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
+
+
+/**
+ * @brief Make the next poll check.
+ *
+ * For a caller that saw a transfer fail. After a recovery that gave up,
+ * checks stay interval_us apart.
+ *
+ * @param p_health Pointer to health monitor struct.
+ */
+void hscdtd_health_suspect(hscdtd_health_t *p_health)
+{
+    if (!p_health->failed)
+        p_health->next_check_us = transport_now_us(p_health->p_dev);
+}
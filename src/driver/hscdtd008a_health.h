@@ -0,0 +1,91 @@
+#ifndef __HSCDTD008A_HEALTH__
+#define __HSCDTD008A_HEALTH__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+
+/**
+ * Health monitor, detects a device that lost its configuration and
+ * restores it.
+ *
+ * A check reads WIA, the control registers and the offset registers in one
+ * bus transaction and compares them with the values the driver wrote
+ * (see hscdtd_invalidate_registers). A brown-out or a glitch that reset
+ * the device shows as registers back at their defaults, a bus that
+ * returns garbage as a wrong WIA.
+ *
+ * On a fault the device is soft reset and the kept configuration is
+ * written back in one bus transaction, then read back. This takes a few
+ * milliseconds, against the 150ms and the lost configuration of
+ * hscdtd_initialize. The driver state is resynchronized, the next sample
+ * is not counted as a gap of the conversion grid.
+ *
+ * Call hscdtd_health_poll between samples, a check runs every
+ * interval_us. Registers the driver never wrote are taken as read by the
+ * first check. A stream runs a monitor with hscdtd_stream_config_t.p_health.
+ */
+
+// Fault found by the last check that failed.
+#define HSCDTD_HEALTH_FAULT_NONE        0
+// The device did not respond.
+#define HSCDTD_HEALTH_FAULT_BUS         1
+#define HSCDTD_HEALTH_FAULT_WIA         2
+// A register differs from the value written by the driver.
+#define HSCDTD_HEALTH_FAULT_CONFIG      3
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct {
+    // Time between checks.
+    uint32_t interval_us;
+    // Soft resets per recovery before it gives up until the next check.
+    uint8_t attempts;
+} hscdtd_health_config_t;
+
+#define HSCDTD_HEALTH_CONFIG_DEFAULT \
+    {1000000, 3}
+
+
+typedef struct {
+    uint32_t checks;
+    // Checks that found a fault, and the last fault.
+    uint32_t faults;
+    uint8_t last_fault;
+    // Recoveries that restored the configuration, and those that gave up.
+    uint32_t recoveries;
+    uint32_t failed;
+    // Time from the start of the failed check to the verified restore.
+    uint32_t recovery_us;
+    uint32_t recovery_max_us;
+} hscdtd_health_stats_t;
+
+
+typedef struct {
+    hscdtd_device_t *p_dev;
+    hscdtd_health_config_t config;
+    uint32_t next_check_us;
+    // The last recovery gave up, the device is not known to be configured.
+    uint8_t failed;
+    hscdtd_health_stats_t stats;
+} hscdtd_health_t;
+
+
+hscdtd_status_t hscdtd_health_init(hscdtd_health_t *p_health,
+                                   hscdtd_device_t *p_dev,
+                                   const hscdtd_health_config_t *p_config);
+
+hscdtd_status_t hscdtd_health_poll(hscdtd_health_t *p_health);
+
+hscdtd_status_t hscdtd_health_check(hscdtd_health_t *p_health);
+
+void hscdtd_health_suspect(hscdtd_health_t *p_health);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_HEALTH__
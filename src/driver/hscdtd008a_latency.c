@@ -0,0 +1,208 @@
+#include <string.h>
+#include "hscdtd008a_latency.h"
+
+#define HIST_SUB_COUNT                  (1UL << HSCDTD_HIST_SUB_BITS)
+#define HIST_SUB_MASK                   (HIST_SUB_COUNT - 1)
+
+static const char *const stage_names[HSCDTD_LAT_STAGES] = {
+    "conversion",
+    "drdy",
+    "read",
+    "consumer",
+};
+
+
+// Position of the highest bit set, value not 0.
+static uint8_t hist_msb(uint32_t value)
+{
+    uint8_t msb = 0;
+
+    if (value >= 0x10000UL) {
+        value >>= 16;
+        msb += 16;
+    }
+    if (value >= 0x100) {
+        value >>= 8;
+        msb += 8;
+    }
+    if (value >= 0x10) {
+        value >>= 4;
+        msb += 4;
+    }
+    if (value >= 0x4) {
+        value >>= 2;
+        msb += 2;
+    }
+    if (value >= 0x2)
+        msb += 1;
+    return msb;
+}
+
+
+static uint16_t hist_index(uint32_t value)
+{
+    uint8_t shift;
+
+    if (value < HIST_SUB_COUNT)
+        return (uint16_t) value;
+    if (value >> HSCDTD_HIST_MAX_BITS)
+        return HSCDTD_HIST_BUCKETS - 1;
+
+    shift = hist_msb(value) - HSCDTD_HIST_SUB_BITS;
+    return (uint16_t) (((uint32_t) (shift + 1) << HSCDTD_HIST_SUB_BITS) +
+                       ((value >> shift) & HIST_SUB_MASK));
+}
+
+
+static void hist_bounds(uint16_t index, uint32_t *p_low, uint32_t *p_high)
+{
+    uint8_t shift;
+
+    if (index < HIST_SUB_COUNT) {
+        *p_low = index;
+        *p_high = index;
+        return;
+    }
+    shift = (uint8_t) ((index >> HSCDTD_HIST_SUB_BITS) - 1);
+    *p_low = (HIST_SUB_COUNT + (index & HIST_SUB_MASK)) << shift;
+    *p_high = *p_low + (1UL << shift) - 1;
+}
+
+
+/**
+ * @brief Clear a histogram.
+ *
+ * @param p_hist Pointer to histogram struct.
+ */
+void hscdtd_hist_reset(hscdtd_hist_t *p_hist)
+{
+    memset(p_hist, 0, sizeof(hscdtd_hist_t));
+}
+
+
+/**
+ * @brief Add a value to a histogram.
+ *
+ * @param p_hist Pointer to histogram struct.
+ * @param value_us Value to add.
+ */
+void hscdtd_hist_record(hscdtd_hist_t *p_hist, uint32_t value_us)
+{
+    if (p_hist->count == 0 || value_us < p_hist->min_us)
+        p_hist->min_us = value_us;
+    if (value_us > p_hist->max_us)
+        p_hist->max_us = value_us;
+    p_hist->count++;
+    p_hist->sum_us += value_us;
+    p_hist->buckets[hist_index(value_us)]++;
+}
+
+
+/**
+ * @brief Value below which a fraction of the values are.
+ *
+ * @param p_hist Pointer to histogram struct.
+ * @param permille Fraction in 1/1000, 500 for the median, 999 for p99.9.
+ * @return Largest value of the bucket that holds the percentile, at most
+ *         the maximum. 0 for an empty histogram.
+ */
+uint32_t hscdtd_hist_percentile(const hscdtd_hist_t *p_hist,
+                                uint16_t permille)
+{
+    uint32_t rank, seen = 0;
+    uint32_t low, high;
+    uint16_t i;
+
+    if (p_hist->count == 0)
+        return 0;
+    if (permille >= 1000)
+        return p_hist->max_us;
+
+    // Rounded up, the median of 3 values is the second.
+    rank = (uint32_t) (((uint64_t) p_hist->count * permille + 999) / 1000);
+    if (rank == 0)
+        rank = 1;
+    for (i = 0; i < HSCDTD_HIST_BUCKETS; i++) {
+        seen += p_hist->buckets[i];
+        if (seen >= rank)
+            break;
+    }
+    hist_bounds(i, &low, &high);
+    if (high > p_hist->max_us || i == HSCDTD_HIST_BUCKETS - 1)
+        high = p_hist->max_us;
+    if (high < p_hist->min_us)
+        high = p_hist->min_us;
+    return high;
+}
+
+
+/**
+ * @brief Mean of the values of a histogram.
+ *
+ * @param p_hist Pointer to histogram struct.
+ * @return Mean, 0 for an empty histogram.
+ */
+uint32_t hscdtd_hist_mean(const hscdtd_hist_t *p_hist)
+{
+    if (p_hist->count == 0)
+        return 0;
+    return (uint32_t) (p_hist->sum_us / p_hist->count);
+}
+
+
+/**
+ * @brief Clear the histograms of all stages.
+ *
+ * @param p_latency Pointer to latency struct.
+ */
+void hscdtd_latency_reset(hscdtd_latency_t *p_latency)
+{
+    memset(p_latency, 0, sizeof(hscdtd_latency_t));
+}
+
+
+/**
+ * @brief Export the histograms, bucket by bucket.
+ *
+ * Only buckets that hold values are passed, stage by stage. The last
+ * bucket of a stage ends at its maximum.
+ *
+ * @param p_latency Pointer to latency struct.
+ * @param callback Called for every bucket.
+ * @param p_ctx Passed to the callback.
+ */
+void hscdtd_latency_export(const hscdtd_latency_t *p_latency,
+                           hscdtd_latency_export_t callback, void *p_ctx)
+{
+    const hscdtd_hist_t *p_hist;
+    uint32_t low, high;
+    uint16_t i;
+    uint8_t stage;
+
+    for (stage = 0; stage < HSCDTD_LAT_STAGES; stage++) {
+        p_hist = &p_latency->stages[stage];
+        for (i = 0; i < HSCDTD_HIST_BUCKETS; i++) {
+            if (p_hist->buckets[i] == 0)
+                continue;
+            hist_bounds(i, &low, &high);
+            if (high > p_hist->max_us || i == HSCDTD_HIST_BUCKETS - 1)
+                high = p_hist->max_us;
+            callback(p_ctx, (hscdtd_lat_stage_t) stage, low, high,
+                     p_hist->buckets[i]);
+        }
+    }
+}
+
+
+/**
+ * @brief Name of a stage, for exports.
+ *
+ * @param stage Stage.
+ * @return Name, "" for an invalid stage.
+ */
+const char *hscdtd_latency_stage_name(hscdtd_lat_stage_t stage)
+{
+    if (stage >= HSCDTD_LAT_STAGES)
+        return "";
+    return stage_names[stage];
+}
@@ -0,0 +1,101 @@
+#ifndef __HSCDTD008A_LATENCY__
+#define __HSCDTD008A_LATENCY__
+
+#include <stdint.h>
+
+/**
+ * Latency histograms, from the conversion of a sample to its consumer.
+ *
+ * Attached to a device with hscdtd_set_latency, the driver records every
+ * sample it reads:
+ *  - HSCDTD_LAT_CONVERSION: from the force state trigger to the end of
+ *    the conversion.
+ *  - HSCDTD_LAT_DRDY: from the end of the conversion to DRDY seen in
+ *    STATUS or marked by the interrupt.
+ *  - HSCDTD_LAT_READ: from the end of the conversion to the end of the bus
+ *    read of the output registers.
+ *  - HSCDTD_LAT_CONSUMER: from the end of the conversion to the sample
+ *    handed to the application, recorded by hscdtd_consume_sample.
+ * Stages after the conversion are the age of the sample, so a tail in a
+ * later stage includes the stages before it. The end of the conversion is
+ * the timestamp of the sample, its error is that of the timestamp.
+ *
+ * The histograms are log-linear: values below 2^HSCDTD_HIST_SUB_BITS us
+ * have their own bucket, above that every power of two is split in
+ * 2^HSCDTD_HIST_SUB_BITS buckets, so a bucket is at most 1/16 of its value
+ * wide by default. Values from 2^HSCDTD_HIST_MAX_BITS us go in the last
+ * bucket, min, max and the mean are exact. The memory is fixed, recording
+ * is a few shifts and needs no lock beyond that of the device.
+ */
+
+// Buckets per power of two, as a power of two.
+#ifndef HSCDTD_HIST_SUB_BITS
+#define HSCDTD_HIST_SUB_BITS            4
+#endif  // HSCDTD_HIST_SUB_BITS
+
+// Largest value with its own bucket, as a power of two (16.7s).
+#ifndef HSCDTD_HIST_MAX_BITS
+#define HSCDTD_HIST_MAX_BITS            24
+#endif  // HSCDTD_HIST_MAX_BITS
+
+#define HSCDTD_HIST_BUCKETS \
+    ((HSCDTD_HIST_MAX_BITS - HSCDTD_HIST_SUB_BITS + 1) << HSCDTD_HIST_SUB_BITS)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef enum {
+    HSCDTD_LAT_CONVERSION,
+    HSCDTD_LAT_DRDY,
+    HSCDTD_LAT_READ,
+    HSCDTD_LAT_CONSUMER,
+    HSCDTD_LAT_STAGES,
+} hscdtd_lat_stage_t;
+
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[HSCDTD_HIST_BUCKETS];
+} hscdtd_hist_t;
+
+
+typedef struct {
+    hscdtd_hist_t stages[HSCDTD_LAT_STAGES];
+} hscdtd_latency_t;
+
+
+// Called for every bucket that holds values, in order. high_us is the
+// largest value of the bucket.
+typedef void (*hscdtd_latency_export_t)(void *p_ctx,
+                                        hscdtd_lat_stage_t stage,
+                                        uint32_t low_us, uint32_t high_us,
+                                        uint32_t count);
+
+
+void hscdtd_hist_reset(hscdtd_hist_t *p_hist);
+
+void hscdtd_hist_record(hscdtd_hist_t *p_hist, uint32_t value_us);
+
+uint32_t hscdtd_hist_percentile(const hscdtd_hist_t *p_hist,
+                                uint16_t permille);
+
+uint32_t hscdtd_hist_mean(const hscdtd_hist_t *p_hist);
+
+void hscdtd_latency_reset(hscdtd_latency_t *p_latency);
+
+void hscdtd_latency_export(const hscdtd_latency_t *p_latency,
+                           hscdtd_latency_export_t callback, void *p_ctx);
+
+const char *hscdtd_latency_stage_name(hscdtd_lat_stage_t stage);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_LATENCY__
@@ -38,72 +38,89 @@
 #define HSCDTD_REG_TEMP                 0x31
 
 
-#ifdef __cplusplus
-extern "C"
-{
-#endif // __cplusplus
-
-typedef struct {
-    uint8_t ORDY : 1;
-    uint8_t TRDY : 1;
-    uint8_t FFU : 1;
-    uint8_t reserved_0 : 2;
-    uint8_t DOR : 1;
-    uint8_t DRDY : 1;
-    uint8_t reserved_1 : 1;
-} HSCDTD_STAT_t;
-
-
-typedef struct {
-    uint8_t FP : 4;
-    uint8_t reserved_0 : 4;
-} HSCDTD_FFPT_t;
-
-
-typedef struct {
-    uint8_t reserved_0 : 1;
-    uint8_t FS : 1;
-    uint8_t reserved_1 : 1;
-    uint8_t ODR : 2;
-    uint8_t reserved_2 : 2;
-    uint8_t PC : 1;
-
-} HSCDTD_CTRL1_t;
-
-
-typedef struct {
-    uint8_t DOS : 1;
-    uint8_t DTS : 1;
-    uint8_t DRP : 1;
-    uint8_t DEN : 1;
-    uint8_t FF : 1;
-    uint8_t AOR : 1;
-    uint8_t FCO : 1;
-    uint8_t AVG : 1;
-} HSCDTD_CTRL2_t;
-
-typedef struct {
-    uint8_t OCL : 1;
-    uint8_t TCS : 1;
-    uint8_t reserved_0 : 2;
-    uint8_t STC : 1;
-    uint8_t reserved_1 : 1;
-    uint8_t FRC : 1;
-    uint8_t SRST : 1;
-} HSCDTD_CTRL3_t;
-
-
-typedef struct {
-    uint8_t reserved_0 : 3;
-    uint8_t AS : 1;
-    uint8_t RS : 1;
-    uint8_t reserved_1 : 1;
-    uint8_t MMD : 2;
-} HSCDTD_CTRL4_t;
-
-
-#ifdef __cplusplus
-}
-#endif // __cplusplus
+/**
+ * Register fields
+ *
+ * Each field is described by its position (_POS) and mask (_MSK) in the
+ * register. The layout is fixed by these values, not by the compiler.
+ *
+ * Use HSCDTD_FIELD_PREP to build a register value and HSCDTD_FIELD_GET to
+ * extract a field. Both are constant expressions for constant arguments,
+ * so updates of several fields of one register can be combined into a
+ * single mask/value pair at compile time:
+ *
+ *   update_register(p_dev, HSCDTD_REG_CTRL1,
+ *                   HSCDTD_CTRL1_FS_MSK | HSCDTD_CTRL1_PC_MSK,
+ *                   HSCDTD_FIELD_PREP(HSCDTD_CTRL1_FS, HSCDTD_STATE_FORCE) |
+ *                   HSCDTD_FIELD_PREP(HSCDTD_CTRL1_PC, HSCDTD_MODE_ACTIVE));
+ */
+#define HSCDTD_FIELD_PREP(field, value) \
+    ((uint8_t) (((value) << field##_POS) & field##_MSK))
+#define HSCDTD_FIELD_GET(field, reg_value) \
+    ((uint8_t) (((reg_value) & field##_MSK) >> field##_POS))
+
+
+// STATUS
+#define HSCDTD_STATUS_ORDY_POS          0
+#define HSCDTD_STATUS_ORDY_MSK          0x01
+#define HSCDTD_STATUS_TRDY_POS          1
+#define HSCDTD_STATUS_TRDY_MSK          0x02
+#define HSCDTD_STATUS_FFU_POS           2
+#define HSCDTD_STATUS_FFU_MSK           0x04
+#define HSCDTD_STATUS_DOR_POS           5
+#define HSCDTD_STATUS_DOR_MSK           0x20
+#define HSCDTD_STATUS_DRDY_POS          6
+#define HSCDTD_STATUS_DRDY_MSK          0x40
+
+// FIFO_P_STATUS
+#define HSCDTD_FFPT_FP_POS              0
+#define HSCDTD_FFPT_FP_MSK              0x0F
+
+// CTRL1
+#define HSCDTD_CTRL1_FS_POS             1
+#define HSCDTD_CTRL1_FS_MSK             0x02
+#define HSCDTD_CTRL1_ODR_POS            3
+#define HSCDTD_CTRL1_ODR_MSK            0x18
+#define HSCDTD_CTRL1_PC_POS             7
+#define HSCDTD_CTRL1_PC_MSK             0x80
+
+// CTRL2
+#define HSCDTD_CTRL2_DOS_POS            0
+#define HSCDTD_CTRL2_DOS_MSK            0x01
+#define HSCDTD_CTRL2_DTS_POS            1
+#define HSCDTD_CTRL2_DTS_MSK            0x02
+#define HSCDTD_CTRL2_DRP_POS            2
+#define HSCDTD_CTRL2_DRP_MSK            0x04
+#define HSCDTD_CTRL2_DEN_POS            3
+#define HSCDTD_CTRL2_DEN_MSK            0x08
+#define HSCDTD_CTRL2_FF_POS             4
+#define HSCDTD_CTRL2_FF_MSK             0x10
+#define HSCDTD_CTRL2_AOR_POS            5
+#define HSCDTD_CTRL2_AOR_MSK            0x20
+#define HSCDTD_CTRL2_FCO_POS            6
+#define HSCDTD_CTRL2_FCO_MSK            0x40
+#define HSCDTD_CTRL2_AVG_POS            7
+#define HSCDTD_CTRL2_AVG_MSK            0x80
+
+// CTRL3
+#define HSCDTD_CTRL3_OCL_POS            0
+#define HSCDTD_CTRL3_OCL_MSK            0x01
+#define HSCDTD_CTRL3_TCS_POS            1
+#define HSCDTD_CTRL3_TCS_MSK            0x02
+#define HSCDTD_CTRL3_STC_POS            4
+#define HSCDTD_CTRL3_STC_MSK            0x10
+#define HSCDTD_CTRL3_FRC_POS            6
+#define HSCDTD_CTRL3_FRC_MSK            0x40
+#define HSCDTD_CTRL3_SRST_POS           7
+#define HSCDTD_CTRL3_SRST_MSK           0x80
+
+// CTRL4
+#define HSCDTD_CTRL4_AS_POS             3
+#define HSCDTD_CTRL4_AS_MSK             0x08
+#define HSCDTD_CTRL4_RS_POS             4
+#define HSCDTD_CTRL4_RS_MSK             0x10
+#define HSCDTD_CTRL4_MMD_POS            6
+#define HSCDTD_CTRL4_MMD_MSK            0xC0
+
 
 #endif //__HSCDTD008A_REGS__
@@ -0,0 +1,415 @@
+#ifdef RPI
+// pthread_attr_setaffinity_np
+#define _GNU_SOURCE
+#endif  // RPI
+#include "hscdtd008a_rt.h"
+
+#ifdef RPI
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include "hscdtd008a_reg.h"
+#include "transport.h"
+
+#define RT_NS_PER_US                    1000ULL
+#define RT_NS_PER_S                     1000000000ULL
+
+
+static uint8_t rt_running(hscdtd_rt_t *p_rt)
+{
+    return __atomic_load_n(&p_rt->running, __ATOMIC_ACQUIRE);
+}
+
+
+// CLOCK_MONOTONIC, through the vDSO.
+static uint64_t rt_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * RT_NS_PER_S + (uint64_t) ts.tv_nsec;
+}
+
+
+static void rt_sleep_until(uint64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t) (ns / RT_NS_PER_S);
+    ts.tv_nsec = (long) (ns % RT_NS_PER_S);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR)
+        ;
+}
+
+
+static uint32_t rt_us(uint64_t ns)
+{
+    ns /= RT_NS_PER_US;
+    return (ns < 0xFFFFFFFFULL) ? (uint32_t) ns : 0xFFFFFFFFUL;
+}
+
+
+// Fault in the stack the cycles will use, once the memory is locked it
+// stays.
+static void __attribute__((noinline)) rt_prefault_stack(void)
+{
+    volatile uint8_t stack[HSCDTD_RT_STACK_SIZE / 2];
+    uint32_t i;
+
+    for (i = 0; i < sizeof(stack); i += 256)
+        stack[i] = 0;
+}
+
+
+// Trigger every device, then read each once its conversion is done. A
+// device that is not done by the end of the period has HSCDTD_STAT_NO_DATA.
+static uint64_t rt_cycle(hscdtd_rt_t *p_rt, uint64_t start, uint64_t end)
+{
+    hscdtd_device_t *p_dev;
+    hscdtd_status_t status;
+    uint64_t now, next, last = start;
+    uint8_t i, pending = 0, stat;
+
+    for (i = 0; i < p_rt->count; i++) {
+        p_dev = p_rt->p_devs[i];
+        hscdtd_mutex_lock(&p_dev->lock);
+        // Reading the status register clears DRDY of an earlier conversion.
+        status = read_register(p_dev, HSCDTD_REG_STATUS, &stat);
+        if (status == HSCDTD_STAT_OK)
+            status = hscdtd_force_trigger(p_dev);
+        hscdtd_mutex_unlock(&p_dev->lock);
+        if (status == HSCDTD_STAT_OK)
+            status = hscdtd_op_init(&p_rt->ops[i], p_dev, HSCDTD_OP_READ,
+                                    &p_rt->samples[i]);
+        if (status == HSCDTD_STAT_OK) {
+            status = HSCDTD_STAT_PENDING;
+            pending++;
+        }
+        p_rt->status[i] = status;
+        p_rt->due_ns[i] = rt_now_ns() +
+                          p_rt->config.conversion_us * RT_NS_PER_US;
+    }
+
+    while (pending) {
+        now = rt_now_ns();
+        next = end;
+        for (i = 0; i < p_rt->count; i++) {
+            if (p_rt->status[i] != HSCDTD_STAT_PENDING)
+                continue;
+            if (p_rt->due_ns[i] <= now) {
+                status = hscdtd_op_step(&p_rt->ops[i]);
+                now = rt_now_ns();
+                if (status == HSCDTD_STAT_PENDING) {
+                    p_rt->due_ns[i] = now + p_rt->ops[i].delay_ms *
+                                            RT_NS_PER_S / 1000;
+                } else {
+                    p_rt->status[i] = status;
+                    pending--;
+                    last = now;
+                    continue;
+                }
+            }
+            if (p_rt->due_ns[i] < next)
+                next = p_rt->due_ns[i];
+        }
+        if (!pending)
+            break;
+        if (next >= end) {
+            for (i = 0; i < p_rt->count; i++) {
+                if (p_rt->status[i] == HSCDTD_STAT_PENDING)
+                    p_rt->status[i] = HSCDTD_STAT_NO_DATA;
+            }
+            return rt_now_ns();
+        }
+        rt_sleep_until(next);
+    }
+    return last;
+}
+
+
+// Statistics are updated between an odd and an even stats_seq, readers
+// retry instead of taking a lock the thread could wait for.
+static void rt_stats_begin(hscdtd_rt_t *p_rt)
+{
+    __atomic_store_n(&p_rt->stats_seq, p_rt->stats_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+static void rt_stats_end(hscdtd_rt_t *p_rt)
+{
+    __atomic_store_n(&p_rt->stats_seq, p_rt->stats_seq + 1, __ATOMIC_RELEASE);
+}
+
+
+static void rt_record(hscdtd_rt_t *p_rt, uint64_t start, uint64_t wake,
+                      uint64_t done, uint8_t failed)
+{
+    hscdtd_rt_stats_t *p_stats = &p_rt->stats;
+
+    rt_stats_begin(p_rt);
+    p_stats->cycles++;
+    if (failed)
+        p_stats->errors++;
+    if (done - start > p_rt->config.deadline_us * RT_NS_PER_US)
+        p_stats->deadline_misses++;
+    hscdtd_hist_record(&p_stats->wake, rt_us(wake - start));
+    hscdtd_hist_record(&p_stats->cycle, rt_us(done - start));
+    rt_stats_end(p_rt);
+}
+
+
+static void *rt_thread(void *p_arg)
+{
+    hscdtd_rt_t *p_rt = (hscdtd_rt_t *) p_arg;
+    uint64_t period = p_rt->config.period_us * RT_NS_PER_US;
+    uint64_t start, wake, done;
+    uint32_t skipped;
+    uint8_t i, failed;
+
+    rt_prefault_stack();
+    memset(p_rt->ops, 0, sizeof(p_rt->ops));
+    memset(p_rt->samples, 0, sizeof(p_rt->samples));
+    memset(p_rt->due_ns, 0, sizeof(p_rt->due_ns));
+
+    start = rt_now_ns() + period;
+    while (rt_running(p_rt)) {
+        rt_sleep_until(start);
+        wake = rt_now_ns();
+
+        done = rt_cycle(p_rt, start, start + period);
+        failed = 0;
+        for (i = 0; i < p_rt->count; i++) {
+            if (p_rt->status[i] == HSCDTD_STAT_OK)
+                hscdtd_consume_sample(p_rt->p_devs[i], &p_rt->samples[i]);
+            else
+                failed = 1;
+        }
+        rt_record(p_rt, start, wake, done, failed);
+        p_rt->callback(p_rt->p_ctx, p_rt->samples, p_rt->status,
+                       p_rt->count);
+
+        // Stay on the grid, skip the periods that already started.
+        start += period;
+        done = rt_now_ns();
+        skipped = 0;
+        while (start <= done) {
+            start += period;
+            skipped++;
+        }
+        if (skipped) {
+            rt_stats_begin(p_rt);
+            p_rt->stats.skipped += skipped;
+            rt_stats_end(p_rt);
+        }
+    }
+    return 0;
+}
+
+
+// Take the backoff out of the retry policies of the devices, or restore
+// them. Called while the thread does not run.
+static void rt_retry(hscdtd_rt_t *p_rt, uint8_t install)
+{
+#ifndef HSCDTD_NO_RETRY
+    uint8_t i;
+
+    for (i = 0; i < p_rt->count; i++) {
+        if (install) {
+            p_rt->retry[i] = p_rt->p_devs[i]->retry;
+            p_rt->p_devs[i]->retry.backoff_ms = 0;
+            p_rt->p_devs[i]->retry.backoff_max_ms = 0;
+        } else {
+            p_rt->p_devs[i]->retry = p_rt->retry[i];
+        }
+    }
+#endif  // HSCDTD_NO_RETRY
+}
+
+
+/**
+ * @brief Initialize an empty real-time acquisition.
+ *
+ * @param p_rt Pointer to real-time struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_rt_init(hscdtd_rt_t *p_rt)
+{
+    if (!p_rt) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    memset(p_rt, 0, sizeof(hscdtd_rt_t));
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Add a device, measured every cycle.
+ *
+ * @param p_rt Pointer to real-time struct, not running.
+ * @param p_dev Pointer to device struct, initialized.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_rt_add(hscdtd_rt_t *p_rt, hscdtd_device_t *p_dev)
+{
+    if (!p_rt || !p_dev) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_rt->count >= HSCDTD_RT_MAX_DEVICES || p_rt->running) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    p_rt->p_devs[p_rt->count++] = p_dev;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Start the real-time thread.
+ *
+ * Puts the devices in the force state and active mode, locks the memory
+ * of the process and starts the thread with the priority and CPU of the
+ * configuration. The first cycle starts one period later. Statistics
+ * start from zero. Retries of the devices run without backoff until
+ * hscdtd_rt_stop.
+ *
+ * @param p_rt Pointer to real-time struct, with devices.
+ * @param p_config Period, deadline and scheduling of the thread.
+ * @param callback Called with the samples of every cycle.
+ * @param p_ctx Passed to the callback.
+ * @return hscdtd_status, HSCDTD_STAT_ERROR if the memory could not be
+ *         locked or the thread not started with its priority or CPU.
+ */
+hscdtd_status_t hscdtd_rt_start(hscdtd_rt_t *p_rt,
+                                const hscdtd_rt_config_t *p_config,
+                                hscdtd_rt_callback_t callback, void *p_ctx)
+{
+    pthread_attr_t attr;
+    struct sched_param param;
+    cpu_set_t cpus;
+    hscdtd_status_t status = HSCDTD_STAT_OK;
+    uint8_t i;
+    int err;
+
+    if (!p_rt || !p_config || !callback) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_rt->count == 0 || p_rt->running ||
+        p_config->period_us < HSCDTD_RT_MIN_PERIOD_US ||
+        p_config->period_us > 0x7FFFFFFFUL ||
+        p_config->deadline_us > p_config->period_us ||
+        p_config->conversion_us >= p_config->period_us ||
+        p_config->priority > 99 ||
+        p_config->cpu < -1 || p_config->cpu >= CPU_SETSIZE) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    for (i = 0; i < p_rt->count && status == HSCDTD_STAT_OK; i++) {
+        status = hscdtd_set_state(p_rt->p_devs[i], HSCDTD_STATE_FORCE);
+        if (status == HSCDTD_STAT_OK)
+            status = hscdtd_set_mode(p_rt->p_devs[i], HSCDTD_MODE_ACTIVE);
+    }
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    p_rt->config = *p_config;
+    if (p_rt->config.deadline_us == 0)
+        p_rt->config.deadline_us = p_config->period_us;
+    p_rt->callback = callback;
+    p_rt->p_ctx = p_ctx;
+    memset(&p_rt->stats, 0, sizeof(p_rt->stats));
+    hscdtd_hist_reset(&p_rt->stats.wake);
+    hscdtd_hist_reset(&p_rt->stats.cycle);
+    p_rt->stats_seq = 0;
+
+    // The stack of the new thread is locked as it is mapped.
+    p_rt->locked = 0;
+    if (p_config->lock_memory) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+            return HSCDTD_STAT_ERROR;
+        p_rt->locked = 1;
+    }
+    rt_retry(p_rt, 1);
+
+    pthread_attr_init(&attr);
+    err = pthread_attr_setstacksize(&attr, HSCDTD_RT_STACK_SIZE);
+    if (err == 0 && p_config->priority > 0) {
+        param.sched_priority = p_config->priority;
+        err = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        if (err == 0)
+            err = pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        if (err == 0)
+            err = pthread_attr_setschedparam(&attr, &param);
+    }
+    if (err == 0 && p_config->cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(p_config->cpu, &cpus);
+        err = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+
+    __atomic_store_n(&p_rt->running, 1, __ATOMIC_RELEASE);
+    if (err == 0)
+        err = pthread_create(&p_rt->thread, &attr, rt_thread, p_rt);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        __atomic_store_n(&p_rt->running, 0, __ATOMIC_RELEASE);
+        rt_retry(p_rt, 0);
+        if (p_rt->locked)
+            munlockall();
+        p_rt->locked = 0;
+        return HSCDTD_STAT_ERROR;
+    }
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Stop the real-time thread.
+ *
+ * Waits for the cycle that runs, unlocks the memory if it was locked by
+ * hscdtd_rt_start and restores the retry policies. The devices stay in the
+ * force state.
+ *
+ * @param p_rt Pointer to real-time struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_rt_stop(hscdtd_rt_t *p_rt)
+{
+    if (!p_rt || !rt_running(p_rt)) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    __atomic_store_n(&p_rt->running, 0, __ATOMIC_RELEASE);
+    pthread_join(p_rt->thread, 0);
+    rt_retry(p_rt, 0);
+    if (p_rt->locked)
+        munlockall();
+    p_rt->locked = 0;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Copy the statistics, from any thread.
+ *
+ * Does not block the real-time thread, the copy is retried if the thread
+ * updated the statistics meanwhile.
+ *
+ * @param p_rt Pointer to real-time struct.
+ * @param p_stats Pointer to store the statistics.
+ */
+void hscdtd_rt_get_stats(hscdtd_rt_t *p_rt, hscdtd_rt_stats_t *p_stats)
+{
+    uint32_t seq;
+
+    do {
+        seq = __atomic_load_n(&p_rt->stats_seq, __ATOMIC_ACQUIRE);
+        memcpy(p_stats, &p_rt->stats, sizeof(hscdtd_rt_stats_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) ||
+             seq != __atomic_load_n(&p_rt->stats_seq, __ATOMIC_RELAXED));
+}
+#endif  // RPI
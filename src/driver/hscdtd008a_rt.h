@@ -0,0 +1,153 @@
+#ifndef __HSCDTD008A_RT__
+#define __HSCDTD008A_RT__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+#include "hscdtd008a_latency.h"
+
+/**
+ * Real-time acquisition, on RPI only.
+ *
+ * A dedicated thread takes a force state measurement of every device once
+ * per period, on a grid of absolute times, and hands the samples of the
+ * cycle to a callback. The thread:
+ *  - runs with SCHED_FIFO at config.priority and on config.cpu,
+ *  - runs with the memory of the process locked (mlockall) and its stack
+ *    and buffers touched before the first cycle, so no page faults,
+ *  - sleeps with clock_nanosleep on absolute times, so late wake-ups do
+ *    not add up. Between the trigger and the read of a device it sleeps
+ *    for conversion_us, then polls DRDY at the interval of the operation.
+ * Within a cycle the only system calls are these sleeps and the bus
+ * ioctls of the transport, the clock is read through the vDSO. The
+ * callback runs on the thread and must not block or allocate.
+ *
+ * The backoff of a retry policy sleeps, so while the thread runs the
+ * retry policy of its devices has no backoff: failed transfers are
+ * repeated at once, up to max_attempts, and a measurement that still
+ * fails is an error of the cycle. hscdtd_rt_stop restores the policies,
+ * set the policy of a device before hscdtd_rt_start.
+ *
+ * Priority, affinity and locked memory need CAP_SYS_NICE and
+ * CAP_IPC_LOCK (or matching RLIMIT_RTPRIO and RLIMIT_MEMLOCK), without
+ * them hscdtd_rt_start fails; priority 0 runs on the normal scheduler.
+ *
+ * Every cycle records its wake-up latency and the time to its last sample
+ * in histograms, their spread is the jitter of the sampling. A cycle whose last sample is
+ * read after deadline_us misses its deadline; periods that start while a
+ * cycle still runs are skipped. The intervals of each device are in its
+ * hscdtd_timing_t.
+ */
+
+#ifndef HSCDTD_RT_MAX_DEVICES
+#define HSCDTD_RT_MAX_DEVICES           8
+#endif  // HSCDTD_RT_MAX_DEVICES
+
+// Stack of the thread, the half a cycle can use is touched before the
+// first cycle.
+#ifndef HSCDTD_RT_STACK_SIZE
+#define HSCDTD_RT_STACK_SIZE            (256 * 1024UL)
+#endif  // HSCDTD_RT_STACK_SIZE
+
+// Shortest period.
+#define HSCDTD_RT_MIN_PERIOD_US         1000
+
+#ifdef RPI
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+// Called every cycle with the sample and the status of every device, in
+// the order they were added. A sample is valid if its status is
+// HSCDTD_STAT_OK.
+typedef void (*hscdtd_rt_callback_t)(void *p_ctx,
+                                     const hscdtd_sample_t *p_samples,
+                                     const hscdtd_status_t *p_status,
+                                     uint8_t count);
+
+
+typedef struct {
+    // Time between cycles, 10000 for 100Hz.
+    uint32_t period_us;
+    // After the start of a cycle, 0 for the period.
+    uint32_t deadline_us;
+    // Wait from the trigger to the first DRDY poll, 0 to poll at once.
+    uint32_t conversion_us;
+    // SCHED_FIFO priority, 1 to 99, 0 for the normal scheduler.
+    uint8_t priority;
+    // CPU to run on, -1 for any.
+    int16_t cpu;
+    // 1 to lock the memory of the process while running.
+    uint8_t lock_memory;
+} hscdtd_rt_config_t;
+
+#define HSCDTD_RT_CONFIG_DEFAULT \
+    {10000, 0, 0, 80, -1, 1}
+
+
+typedef struct {
+    uint32_t cycles;
+    // Cycles that read their last sample after deadline_us.
+    uint32_t deadline_misses;
+    // Periods skipped because a cycle ran into them.
+    uint32_t skipped;
+    // Cycles in which a measurement failed.
+    uint32_t errors;
+    // Wake-up after the start of the cycle.
+    hscdtd_hist_t wake;
+    // Start of the cycle to the last sample read.
+    hscdtd_hist_t cycle;
+} hscdtd_rt_stats_t;
+
+
+typedef struct {
+    hscdtd_device_t *p_devs[HSCDTD_RT_MAX_DEVICES];
+    uint8_t count;
+
+    hscdtd_rt_config_t config;
+    hscdtd_rt_callback_t callback;
+    void *p_ctx;
+
+    // Buffers of the thread, touched before the first cycle.
+    hscdtd_op_t ops[HSCDTD_RT_MAX_DEVICES];
+    hscdtd_sample_t samples[HSCDTD_RT_MAX_DEVICES];
+    hscdtd_status_t status[HSCDTD_RT_MAX_DEVICES];
+    uint64_t due_ns[HSCDTD_RT_MAX_DEVICES];
+
+    hscdtd_rt_stats_t stats;
+    // Odd while the thread updates stats.
+    uint32_t stats_seq;
+
+#ifndef HSCDTD_NO_RETRY
+    // Retry policies of the devices before hscdtd_rt_start.
+    hscdtd_retry_policy_t retry[HSCDTD_RT_MAX_DEVICES];
+#endif  // HSCDTD_NO_RETRY
+
+    uint8_t running;
+    uint8_t locked;
+    pthread_t thread;
+} hscdtd_rt_t;
+
+
+hscdtd_status_t hscdtd_rt_init(hscdtd_rt_t *p_rt);
+
+hscdtd_status_t hscdtd_rt_add(hscdtd_rt_t *p_rt, hscdtd_device_t *p_dev);
+
+hscdtd_status_t hscdtd_rt_start(hscdtd_rt_t *p_rt,
+                                const hscdtd_rt_config_t *p_config,
+                                hscdtd_rt_callback_t callback, void *p_ctx);
+
+hscdtd_status_t hscdtd_rt_stop(hscdtd_rt_t *p_rt);
+
+void hscdtd_rt_get_stats(hscdtd_rt_t *p_rt, hscdtd_rt_stats_t *p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // RPI
+
+#endif  //__HSCDTD008A_RT__
@@ -0,0 +1,600 @@
+#include "hscdtd008a_sched.h"
+#include "transport.h"
+
+#ifdef RPI
+#include <string.h>
+#include <semaphore.h>
+
+
+// A transaction, built from the head of the queue and the reads that can
+// go with it.
+typedef struct {
+    hscdtd_xfer_t xfers[HSCDTD_SCHED_MAX_BATCH];
+    uint8_t buffers[HSCDTD_SCHED_MAX_BATCH][HSCDTD_SCHED_MAX_MERGE];
+    uint8_t count;
+
+    hscdtd_sched_req_t *p_members[HSCDTD_SCHED_MAX_MEMBERS];
+    // Transfer of each member, unused for a direct request.
+    uint8_t slot[HSCDTD_SCHED_MAX_MEMBERS];
+    uint8_t members;
+    // 1 if the only member runs with its own transfers.
+    uint8_t direct;
+} sched_txn_t;
+
+
+// Nonzero if a runs before b.
+static int sched_before(const hscdtd_sched_req_t *a,
+                        const hscdtd_sched_req_t *b)
+{
+    if (a->priority != b->priority)
+        return a->priority < b->priority;
+    if (a->deadline_us == HSCDTD_SCHED_NO_DEADLINE)
+        return 0;
+    if (b->deadline_us == HSCDTD_SCHED_NO_DEADLINE)
+        return 1;
+    return (int32_t) ((a->submit_us + a->deadline_us) -
+                      (b->submit_us + b->deadline_us)) < 0;
+}
+
+
+// A single read, which may share a transfer or a transaction.
+static int sched_mergeable(const hscdtd_sched_req_t *p_req)
+{
+    return p_req->count == 1 && p_req->p_xfers[0].read &&
+           p_req->p_xfers[0].length <= HSCDTD_SCHED_MAX_MERGE;
+}
+
+
+// Add a read to the transaction, 0 if it does not fit.
+static int sched_add_read(sched_txn_t *p_txn, const hscdtd_sched_t *p_sched,
+                          hscdtd_sched_req_t *p_req)
+{
+    const hscdtd_xfer_t *p_x = &p_req->p_xfers[0];
+    hscdtd_device_t *p_dev = p_sched->p_addr_dev[p_x->addr & 0x7F];
+    hscdtd_xfer_t *p_s;
+    uint16_t start, end;
+    uint8_t i;
+
+    // Registers that touch or overlap an earlier read extend it, unless
+    // each read has to reach the device.
+    for (i = 0; i < p_txn->count; i++) {
+        p_s = &p_txn->xfers[i];
+        if (p_s->addr != p_x->addr ||
+            p_x->reg > p_s->reg + p_s->length ||
+            p_s->reg > p_x->reg + p_x->length)
+            continue;
+
+        start = (p_x->reg < p_s->reg) ? p_x->reg : p_s->reg;
+        end = p_s->reg + p_s->length;
+        if (p_x->reg + p_x->length > end)
+            end = p_x->reg + p_x->length;
+        if (end - start > HSCDTD_SCHED_MAX_MERGE ||
+            !transport_read_repeatable(p_dev, (uint8_t) start,
+                                       (uint8_t) (end - start)))
+            continue;
+
+        p_s->reg = (uint8_t) start;
+        p_s->length = (uint8_t) (end - start);
+        p_txn->slot[p_txn->members] = i;
+        p_txn->p_members[p_txn->members++] = p_req;
+        return 1;
+    }
+
+    // Otherwise a transfer of its own, in the same transaction if the
+    // transport has batches.
+    if (p_txn->count >= HSCDTD_SCHED_MAX_BATCH ||
+        (p_txn->count > 0 && !p_sched->p_transport->batch))
+        return 0;
+
+    p_s = &p_txn->xfers[p_txn->count];
+    *p_s = *p_x;
+    p_s->p_buffer = p_txn->buffers[p_txn->count];
+    p_txn->slot[p_txn->members] = p_txn->count++;
+    p_txn->p_members[p_txn->members++] = p_req;
+    return 1;
+}
+
+
+// Take the next transaction from the queue, called with the lock held.
+static void sched_collect(hscdtd_sched_t *p_sched, sched_txn_t *p_txn)
+{
+    hscdtd_sched_req_t *p_head = p_sched->p_queue;
+    hscdtd_sched_req_t **pp_req;
+    hscdtd_sched_req_t *p_req;
+    uint8_t blocked[HSCDTD_SCHED_MAX_MEMBERS];
+    uint8_t n_blocked = 0;
+    uint8_t i, is_blocked;
+
+    p_sched->p_queue = p_head->p_next;
+    p_txn->count = 0;
+    p_txn->members = 0;
+    p_txn->direct = !sched_mergeable(p_head);
+    if (p_txn->direct) {
+        p_txn->p_members[p_txn->members++] = p_head;
+        return;
+    }
+    sched_add_read(p_txn, p_sched, p_head);
+
+    // Reads of the same priority join, but never pass a queued request
+    // of the same device.
+    pp_req = &p_sched->p_queue;
+    while (*pp_req && (*pp_req)->priority == p_head->priority &&
+           p_txn->members < HSCDTD_SCHED_MAX_MEMBERS) {
+        p_req = *pp_req;
+
+        is_blocked = 0;
+        for (i = 0; i < n_blocked; i++) {
+            if (blocked[i] == p_req->p_xfers[0].addr)
+                is_blocked = 1;
+        }
+
+        if (!is_blocked && sched_mergeable(p_req) &&
+            sched_add_read(p_txn, p_sched, p_req)) {
+            *pp_req = p_req->p_next;
+            continue;
+        }
+
+        if (n_blocked + p_req->count > HSCDTD_SCHED_MAX_MEMBERS)
+            break;
+        for (i = 0; i < p_req->count; i++)
+            blocked[n_blocked++] = p_req->p_xfers[i].addr;
+        pp_req = &p_req->p_next;
+    }
+}
+
+
+// Run transfers as one transaction if possible.
+static int8_t sched_run(hscdtd_sched_t *p_sched, hscdtd_xfer_t *p_xfers,
+                        uint8_t count, uint32_t *p_transactions)
+{
+    const hscdtd_transport_t *p_tr = p_sched->p_transport;
+    void *p_ctx = p_sched->p_transport_ctx;
+    int8_t result = 0;
+    uint8_t i;
+
+    if (count > 1 && p_tr->batch) {
+        (*p_transactions)++;
+        return p_tr->batch(p_ctx, p_xfers, count);
+    }
+
+    for (i = 0; i < count && result == 0; i++) {
+        (*p_transactions)++;
+        if (p_xfers[i].read)
+            result = p_tr->read(p_ctx, p_xfers[i].addr, p_xfers[i].reg,
+                                p_xfers[i].length, p_xfers[i].p_buffer);
+        else
+            result = p_tr->write(p_ctx, p_xfers[i].addr, p_xfers[i].reg,
+                                 p_xfers[i].length, p_xfers[i].p_buffer);
+    }
+    return result;
+}
+
+
+static void sched_execute(hscdtd_sched_t *p_sched, sched_txn_t *p_txn,
+                          uint32_t *p_transactions)
+{
+    hscdtd_sched_req_t *p_req;
+    hscdtd_xfer_t *p_s;
+    int8_t result;
+    uint8_t i;
+
+    if (p_txn->direct) {
+        p_req = p_txn->p_members[0];
+        p_req->result = sched_run(p_sched, p_req->p_xfers, p_req->count,
+                                  p_transactions);
+        return;
+    }
+
+    result = sched_run(p_sched, p_txn->xfers, p_txn->count, p_transactions);
+    for (i = 0; i < p_txn->members; i++) {
+        p_req = p_txn->p_members[i];
+        p_s = &p_txn->xfers[p_txn->slot[i]];
+        p_req->result = result;
+        if (result == 0) {
+            memcpy(p_req->p_xfers[0].p_buffer,
+                   p_s->p_buffer + (p_req->p_xfers[0].reg - p_s->reg),
+                   p_req->p_xfers[0].length);
+        }
+    }
+}
+
+
+static void *sched_thread(void *p_arg)
+{
+    hscdtd_sched_t *p_sched = (hscdtd_sched_t *) p_arg;
+    hscdtd_sched_stats_t *p_stats = &p_sched->stats;
+    hscdtd_sched_req_t *p_req;
+    sched_txn_t txn;
+    uint32_t transactions, now, latency;
+    uint8_t i;
+
+    pthread_mutex_lock(&p_sched->lock);
+    for (;;) {
+        while (!p_sched->p_queue && p_sched->running)
+            pthread_cond_wait(&p_sched->work, &p_sched->lock);
+        // Stopping drains the queue first.
+        if (!p_sched->p_queue)
+            break;
+
+        sched_collect(p_sched, &txn);
+        pthread_mutex_unlock(&p_sched->lock);
+
+        transactions = 0;
+        sched_execute(p_sched, &txn, &transactions);
+        now = p_sched->p_transport->now_us(p_sched->p_transport_ctx);
+
+        pthread_mutex_lock(&p_sched->lock);
+        p_stats->transactions += transactions;
+        p_stats->coalesced += txn.members - 1;
+        for (i = 0; i < txn.members; i++) {
+            p_req = txn.p_members[i];
+            p_req->complete_us = now;
+            latency = now - p_req->submit_us;
+            p_stats->requests[p_req->priority]++;
+            p_stats->latency_total_us[p_req->priority] += latency;
+            if (latency > p_stats->latency_max_us[p_req->priority])
+                p_stats->latency_max_us[p_req->priority] = latency;
+            if (p_req->deadline_us != HSCDTD_SCHED_NO_DEADLINE &&
+                latency > p_req->deadline_us)
+                p_stats->missed[p_req->priority]++;
+        }
+        pthread_mutex_unlock(&p_sched->lock);
+
+        for (i = 0; i < txn.members; i++) {
+            p_req = txn.p_members[i];
+            if (p_req->complete) {
+                p_req->done = 1;
+                p_req->complete(p_req);
+            } else {
+                pthread_mutex_lock(&p_sched->lock);
+                p_req->done = 1;
+                pthread_cond_broadcast(&p_sched->done);
+                pthread_mutex_unlock(&p_sched->lock);
+            }
+        }
+        pthread_mutex_lock(&p_sched->lock);
+    }
+    pthread_mutex_unlock(&p_sched->lock);
+    return 0;
+}
+
+
+// Request of a caller that blocks until completion.
+typedef struct {
+    hscdtd_sched_req_t req;
+    sem_t sem;
+} sched_waiter_t;
+
+
+static void sched_wake(hscdtd_sched_req_t *p_req)
+{
+    sem_post(&((sched_waiter_t *) p_req)->sem);
+}
+
+
+static int8_t sched_transfer(hscdtd_sched_t *p_sched, hscdtd_xfer_t *p_xfers,
+                             uint8_t count)
+{
+    sched_waiter_t waiter;
+    uint8_t addr = p_xfers[0].addr & 0x7F;
+
+    memset(&waiter.req, 0, sizeof(waiter.req));
+    waiter.req.p_xfers = p_xfers;
+    waiter.req.count = count;
+    waiter.req.priority = p_sched->addr_priority[addr];
+    waiter.req.deadline_us = p_sched->addr_deadline_us[addr];
+    waiter.req.complete = sched_wake;
+    sem_init(&waiter.sem, 0, 0);
+
+    if (hscdtd_sched_submit(p_sched, &waiter.req) != HSCDTD_STAT_OK) {
+        sem_destroy(&waiter.sem);
+        return -1;
+    }
+    while (sem_wait(&waiter.sem) != 0)
+        ;
+    sem_destroy(&waiter.sem);
+    return waiter.req.result;
+}
+
+
+static int8_t sched_open(void *p_ctx)
+{
+    hscdtd_sched_t *p_sched = (hscdtd_sched_t *) p_ctx;
+
+    if (!p_sched->p_transport->open)
+        return 0;
+    return p_sched->p_transport->open(p_sched->p_transport_ctx);
+}
+
+
+static int8_t sched_read(void *p_ctx, uint8_t addr, uint8_t reg,
+                         uint8_t length, uint8_t *p_buffer)
+{
+    hscdtd_xfer_t xfer = {addr, reg, length, 1, p_buffer};
+
+    return sched_transfer((hscdtd_sched_t *) p_ctx, &xfer, 1);
+}
+
+
+static int8_t sched_write(void *p_ctx, uint8_t addr, uint8_t reg,
+                          uint8_t length, uint8_t *p_buffer)
+{
+    hscdtd_xfer_t xfer = {addr, reg, length, 0, p_buffer};
+
+    return sched_transfer((hscdtd_sched_t *) p_ctx, &xfer, 1);
+}
+
+
+static void sched_sleep_ms(void *p_ctx, uint32_t duration_ms)
+{
+    hscdtd_sched_t *p_sched = (hscdtd_sched_t *) p_ctx;
+
+    p_sched->p_transport->sleep_ms(p_sched->p_transport_ctx, duration_ms);
+}
+
+
+static uint32_t sched_now_us(void *p_ctx)
+{
+    hscdtd_sched_t *p_sched = (hscdtd_sched_t *) p_ctx;
+
+    return p_sched->p_transport->now_us(p_sched->p_transport_ctx);
+}
+
+
+static int8_t sched_batch(void *p_ctx, hscdtd_xfer_t *p_xfers, uint8_t count)
+{
+    return sched_transfer((hscdtd_sched_t *) p_ctx, p_xfers, count);
+}
+
+
+const hscdtd_transport_t hscdtd_sched_transport = {
+    sched_open,
+    sched_read,
+    sched_write,
+    sched_sleep_ms,
+    sched_now_us,
+    sched_batch,
+};
+
+
+/**
+ * @brief Initialize a scheduler for a bus.
+ *
+ * Every device has the normal priority and no deadline until it is
+ * attached with hscdtd_sched_attach.
+ *
+ * @param p_sched Pointer to scheduler struct.
+ * @param p_transport Transport of the bus.
+ * @param p_ctx Context of the transport.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_sched_init(hscdtd_sched_t *p_sched,
+                                  const hscdtd_transport_t *p_transport,
+                                  void *p_ctx)
+{
+    if (!p_sched || !p_transport) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (!p_transport->read || !p_transport->write ||
+        !p_transport->sleep_ms || !p_transport->now_us) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    memset(p_sched, 0, sizeof(hscdtd_sched_t));
+    p_sched->p_transport = p_transport;
+    p_sched->p_transport_ctx = p_ctx;
+    pthread_mutex_init(&p_sched->lock, 0);
+    pthread_cond_init(&p_sched->work, 0);
+    pthread_cond_init(&p_sched->done, 0);
+    p_sched->joined = 1;
+    memset(p_sched->addr_priority, HSCDTD_SCHED_PRIO_NORMAL,
+           sizeof(p_sched->addr_priority));
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Start the scheduler thread.
+ *
+ * @param p_sched Pointer to scheduler struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_sched_start(hscdtd_sched_t *p_sched)
+{
+    hscdtd_status_t status = HSCDTD_STAT_OK;
+
+    if (!p_sched) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    // The thread waits for the lock before it looks at the queue.
+    pthread_mutex_lock(&p_sched->lock);
+    if (p_sched->running || !p_sched->joined) {
+        status = HSCDTD_STAT_ERROR;
+    } else {
+        p_sched->running = 1;
+        p_sched->joined = 0;
+        if (pthread_create(&p_sched->thread, 0, sched_thread, p_sched) != 0) {
+            p_sched->running = 0;
+            p_sched->joined = 1;
+            status = HSCDTD_STAT_ERROR;
+        }
+    }
+    pthread_mutex_unlock(&p_sched->lock);
+    return status;
+}
+
+
+/**
+ * @brief Stop the scheduler thread.
+ *
+ * Requests that are queued still run, later submissions fail. The
+ * scheduler can be started again once this returns.
+ *
+ * @param p_sched Pointer to scheduler struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_sched_stop(hscdtd_sched_t *p_sched)
+{
+    pthread_t thread;
+
+    if (!p_sched) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    pthread_mutex_lock(&p_sched->lock);
+    if (!p_sched->running) {
+        pthread_mutex_unlock(&p_sched->lock);
+        return HSCDTD_STAT_ERROR;
+    }
+    p_sched->running = 0;
+    thread = p_sched->thread;
+    pthread_cond_signal(&p_sched->work);
+    pthread_mutex_unlock(&p_sched->lock);
+
+    pthread_join(thread, 0);
+    pthread_mutex_lock(&p_sched->lock);
+    p_sched->joined = 1;
+    pthread_mutex_unlock(&p_sched->lock);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Run the transactions of a device on the scheduler.
+ *
+ * Sets the scheduler as transport of the device. The device should not
+ * also be on a hscdtd_bus_t, the scheduler already serializes the bus.
+ *
+ * @param p_sched Pointer to scheduler struct.
+ * @param p_dev Pointer to device struct.
+ * @param priority HSCDTD_SCHED_PRIO_HIGH (0) to HSCDTD_SCHED_PRIO_IDLE.
+ * @param deadline_us Deadline of each transaction from its submission, or
+ *                    HSCDTD_SCHED_NO_DEADLINE.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_sched_attach(hscdtd_sched_t *p_sched,
+                                    hscdtd_device_t *p_dev,
+                                    uint8_t priority,
+                                    uint32_t deadline_us)
+{
+    hscdtd_status_t status;
+
+    if (!p_sched || !p_dev) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (priority >= HSCDTD_SCHED_NUM_PRIO) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    status = hscdtd_set_transport(p_dev, &hscdtd_sched_transport, p_sched);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    pthread_mutex_lock(&p_sched->lock);
+    p_sched->addr_priority[p_dev->addr & 0x7F] = priority;
+    p_sched->addr_deadline_us[p_dev->addr & 0x7F] = deadline_us;
+    p_sched->p_addr_dev[p_dev->addr & 0x7F] = p_dev;
+    pthread_mutex_unlock(&p_sched->lock);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Queue a request.
+ *
+ * The request and its buffers must stay valid until it is complete.
+ *
+ * @param p_sched Pointer to scheduler struct.
+ * @param p_req Pointer to the request.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_sched_submit(hscdtd_sched_t *p_sched,
+                                    hscdtd_sched_req_t *p_req)
+{
+    hscdtd_sched_req_t **pp_pos;
+
+    if (!p_sched || !p_req || !p_req->p_xfers) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_req->count == 0 || p_req->priority >= HSCDTD_SCHED_NUM_PRIO) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    p_req->done = 0;
+    p_req->result = 0;
+    p_req->submit_us = p_sched->p_transport->now_us(p_sched->p_transport_ctx);
+
+    pthread_mutex_lock(&p_sched->lock);
+    if (!p_sched->running) {
+        pthread_mutex_unlock(&p_sched->lock);
+        return HSCDTD_STAT_ERROR;
+    }
+
+    // After requests that run before it or are equal, so equal requests
+    // keep their order.
+    pp_pos = &p_sched->p_queue;
+    while (*pp_pos && !sched_before(p_req, *pp_pos))
+        pp_pos = &(*pp_pos)->p_next;
+    p_req->p_next = *pp_pos;
+    *pp_pos = p_req;
+
+    pthread_cond_signal(&p_sched->work);
+    pthread_mutex_unlock(&p_sched->lock);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Wait until a request without completion function is complete.
+ *
+ * @param p_sched Pointer to scheduler struct.
+ * @param p_req Pointer to the request.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_sched_wait(hscdtd_sched_t *p_sched,
+                                  hscdtd_sched_req_t *p_req)
+{
+    if (!p_sched || !p_req || p_req->complete) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    pthread_mutex_lock(&p_sched->lock);
+    while (!p_req->done)
+        pthread_cond_wait(&p_sched->done, &p_sched->lock);
+    pthread_mutex_unlock(&p_sched->lock);
+
+    if (p_req->result != 0)
+        return HSCDTD_STAT_TRANSPORT_ERROR;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Copy the statistics of a scheduler.
+ *
+ * @param p_sched Pointer to scheduler struct.
+ * @param p_stats Pointer for the result.
+ */
+void hscdtd_sched_get_stats(hscdtd_sched_t *p_sched,
+                            hscdtd_sched_stats_t *p_stats)
+{
+    pthread_mutex_lock(&p_sched->lock);
+    *p_stats = p_sched->stats;
+    pthread_mutex_unlock(&p_sched->lock);
+}
+
+
+/**
+ * @brief Clear the statistics of a scheduler.
+ *
+ * @param p_sched Pointer to scheduler struct.
+ */
+void hscdtd_sched_reset_stats(hscdtd_sched_t *p_sched)
+{
+    pthread_mutex_lock(&p_sched->lock);
+    memset(&p_sched->stats, 0, sizeof(hscdtd_sched_stats_t));
+    pthread_mutex_unlock(&p_sched->lock);
+}
+
+#endif  // RPI
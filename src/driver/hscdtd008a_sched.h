@@ -0,0 +1,155 @@
+#ifndef __HSCDTD008A_SCHED__
+#define __HSCDTD008A_SCHED__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+
+/**
+ * Bus scheduler, on RPI only.
+ *
+ * A scheduler owns a bus, a single thread runs every transaction on it.
+ * Devices queue their transactions (hscdtd_sched_attach makes the
+ * scheduler the transport of a device), the thread runs them by priority,
+ * then earliest deadline first, and hands the results back through
+ * completions.
+ *
+ * Reads queued behind the one that runs next are coalesced. Reads of
+ * adjacent or overlapping registers of one device become a single read,
+ * other reads of the same priority go out in the same bus transaction if
+ * the transport supports batches. Reads with side effects keep their own
+ * transfer: the self test response, and the output registers if the FIFO
+ * of the device may be enabled, or the address has no attached device.
+ *
+ * A transaction is never preempted, so a high priority read waits at most
+ * for the transaction that is on the bus. Sequences such as a temperature
+ * compensation or a self test are many short transactions, reads of other
+ * devices run in between. Lower priorities only run when no higher
+ * priority request is queued.
+ *
+ * Requests of one device run in submission order as long as they have the
+ * same priority and relative deadline.
+ */
+
+#define HSCDTD_SCHED_NUM_PRIO           4
+#define HSCDTD_SCHED_PRIO_HIGH          0
+#define HSCDTD_SCHED_PRIO_NORMAL        1
+#define HSCDTD_SCHED_PRIO_LOW           2
+#define HSCDTD_SCHED_PRIO_IDLE          3
+
+#define HSCDTD_SCHED_NO_DEADLINE        0
+
+// Transfers per bus transaction and requests per transaction.
+#ifndef HSCDTD_SCHED_MAX_BATCH
+#define HSCDTD_SCHED_MAX_BATCH          8
+#endif  // HSCDTD_SCHED_MAX_BATCH
+#define HSCDTD_SCHED_MAX_MEMBERS        (2 * HSCDTD_SCHED_MAX_BATCH)
+
+// Longest read after coalescing, the register map fits.
+#define HSCDTD_SCHED_MAX_MERGE          0x40
+
+#ifdef RPI
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct hscdtd_sched_req hscdtd_sched_req_t;
+
+// Called from the scheduler thread, must not wait for the scheduler.
+typedef void (*hscdtd_sched_complete_t)(hscdtd_sched_req_t *p_req);
+
+
+struct hscdtd_sched_req {
+    // Set before hscdtd_sched_submit. The transfers run as one bus
+    // transaction if count > 1.
+    hscdtd_xfer_t *p_xfers;
+    uint8_t count;
+    uint8_t priority;
+    // Relative to submission, HSCDTD_SCHED_NO_DEADLINE for none.
+    uint32_t deadline_us;
+    // NULL to wait with hscdtd_sched_wait.
+    hscdtd_sched_complete_t complete;
+    void *p_arg;
+
+    // Set by the scheduler, result is 0 on success.
+    int8_t result;
+    volatile uint8_t done;
+    uint32_t submit_us;
+    uint32_t complete_us;
+    hscdtd_sched_req_t *p_next;
+};
+
+
+typedef struct {
+    uint32_t requests[HSCDTD_SCHED_NUM_PRIO];
+    // Completed after their deadline.
+    uint32_t missed[HSCDTD_SCHED_NUM_PRIO];
+    // From submission to completion.
+    uint32_t latency_max_us[HSCDTD_SCHED_NUM_PRIO];
+    uint64_t latency_total_us[HSCDTD_SCHED_NUM_PRIO];
+    uint32_t transactions;
+    // Requests that did not need a transaction of their own.
+    uint32_t coalesced;
+} hscdtd_sched_stats_t;
+
+
+typedef struct {
+    const hscdtd_transport_t *p_transport;
+    void *p_transport_ctx;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    // Under lock. joined is 0 from a start until its thread is joined.
+    uint8_t running;
+    uint8_t joined;
+    // Sorted by priority, then deadline.
+    hscdtd_sched_req_t *p_queue;
+
+    // Class of the transactions of attached devices, by address.
+    uint8_t addr_priority[128];
+    uint32_t addr_deadline_us[128];
+    hscdtd_device_t *p_addr_dev[128];
+
+    hscdtd_sched_stats_t stats;
+} hscdtd_sched_t;
+
+
+// Transport that queues transfers on the scheduler passed as context.
+extern const hscdtd_transport_t hscdtd_sched_transport;
+
+hscdtd_status_t hscdtd_sched_init(hscdtd_sched_t *p_sched,
+                                  const hscdtd_transport_t *p_transport,
+                                  void *p_ctx);
+
+hscdtd_status_t hscdtd_sched_start(hscdtd_sched_t *p_sched);
+
+hscdtd_status_t hscdtd_sched_stop(hscdtd_sched_t *p_sched);
+
+hscdtd_status_t hscdtd_sched_attach(hscdtd_sched_t *p_sched,
+                                    hscdtd_device_t *p_dev,
+                                    uint8_t priority,
+                                    uint32_t deadline_us);
+
+hscdtd_status_t hscdtd_sched_submit(hscdtd_sched_t *p_sched,
+                                    hscdtd_sched_req_t *p_req);
+
+hscdtd_status_t hscdtd_sched_wait(hscdtd_sched_t *p_sched,
+                                  hscdtd_sched_req_t *p_req);
+
+void hscdtd_sched_get_stats(hscdtd_sched_t *p_sched,
+                            hscdtd_sched_stats_t *p_stats);
+
+void hscdtd_sched_reset_stats(hscdtd_sched_t *p_sched);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // RPI
+
+#endif  //__HSCDTD008A_SCHED__
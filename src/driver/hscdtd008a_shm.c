@@ -0,0 +1,423 @@
+#include "hscdtd008a_shm.h"
+
+#ifdef RPI
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+
+// Not shared with FUTEX_PRIVATE_FLAG, the waiters are other processes.
+static void shm_futex_wake(uint32_t *p_word)
+{
+    syscall(SYS_futex, p_word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+
+static void shm_futex_wait(const uint32_t *p_word, uint32_t value,
+                           uint32_t timeout_ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long) (timeout_ms % 1000) * 1000000L;
+    syscall(SYS_futex, p_word, FUTEX_WAIT, value, &ts, NULL, 0);
+}
+
+
+static uint8_t shm_closed(const hscdtd_shm_client_t *p_client)
+{
+    return __atomic_load_n(&p_client->p_header->closed, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @brief Create a ring and publish to it.
+ *
+ * A ring of the same name is replaced, its readers keep the old mapping
+ * and see it closed only if its publisher closed it.
+ *
+ * @param p_pub Pointer to publisher struct.
+ * @param name Name of the shared memory, "/" and up to
+ *             HSCDTD_SHM_NAME_MAX - 2 characters.
+ * @param slots Samples in the ring, a power of two.
+ * @param p_devices Device table, the device of a sample indexes it.
+ * @param n_devices Number of devices in the table.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_shm_create(hscdtd_shm_publisher_t *p_pub,
+                                  const char *name, uint32_t slots,
+                                  const hscdtd_capture_device_t *p_devices,
+                                  uint8_t n_devices)
+{
+    hscdtd_shm_header_t *p_header;
+    size_t map_size;
+    void *p_map;
+    int fd;
+
+    if (!p_pub || !name || !p_devices) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (name[0] != '/' || strlen(name) >= HSCDTD_SHM_NAME_MAX ||
+        slots < 2 || (slots & (slots - 1)) != 0 || slots > 0x1000000UL ||
+        n_devices == 0 || n_devices > HSCDTD_CAPTURE_MAX_DEVICES) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    map_size = sizeof(hscdtd_shm_header_t) +
+               (size_t) slots * sizeof(hscdtd_shm_slot_t);
+
+    // A new object, so readers of the old one never see it shrink.
+    shm_unlink(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        return HSCDTD_STAT_ERROR;
+    // Zero filled, no slot holds a sample.
+    if (ftruncate(fd, map_size) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return HSCDTD_STAT_ERROR;
+    }
+    p_map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p_map == MAP_FAILED) {
+        shm_unlink(name);
+        return HSCDTD_STAT_ERROR;
+    }
+
+    memset(p_pub, 0, sizeof(hscdtd_shm_publisher_t));
+    strcpy(p_pub->name, name);
+    p_pub->p_map = (uint8_t *) p_map;
+    p_pub->map_size = map_size;
+    p_pub->p_header = (hscdtd_shm_header_t *) p_map;
+    p_pub->p_slots = (hscdtd_shm_slot_t *) (p_pub->p_map +
+                                            sizeof(hscdtd_shm_header_t));
+    p_pub->mask = slots - 1;
+
+    p_header = p_pub->p_header;
+    p_header->version = HSCDTD_SHM_VERSION;
+    p_header->slot_size = sizeof(hscdtd_shm_slot_t);
+    p_header->slots = slots;
+    p_header->pid = (uint32_t) getpid();
+    p_header->n_devices = n_devices;
+    memcpy(p_header->devices, p_devices,
+           n_devices * sizeof(hscdtd_capture_device_t));
+    __atomic_store_n(&p_header->magic, HSCDTD_SHM_MAGIC, __ATOMIC_RELEASE);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Publish samples of a device.
+ *
+ * Never blocks. From one thread at a time, such as the callback of a
+ * stream.
+ *
+ * @param p_pub Pointer to publisher struct.
+ * @param device Index in the device table.
+ * @param p_samples Samples, in order.
+ * @param count Number of samples.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_shm_publish(hscdtd_shm_publisher_t *p_pub,
+                                   uint8_t device,
+                                   const hscdtd_sample_t *p_samples,
+                                   uint8_t count)
+{
+    hscdtd_shm_header_t *p_header = p_pub->p_header;
+    hscdtd_shm_slot_t *p_slot;
+    uint32_t lock;
+    uint8_t i;
+
+    if (!p_samples) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (device >= p_header->n_devices) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+
+    for (i = 0; i < count; i++) {
+        p_slot = &p_pub->p_slots[p_pub->head & p_pub->mask];
+        lock = p_slot->lock;
+        __atomic_store_n(&p_slot->lock, lock + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&p_slot->pos, p_pub->head, __ATOMIC_RELAXED);
+        p_slot->sample = p_samples[i];
+        p_slot->device = device;
+        __atomic_store_n(&p_slot->lock, lock + 2, __ATOMIC_RELEASE);
+        p_pub->head++;
+    }
+
+    __atomic_store_n(&p_header->head, p_pub->head, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&p_header->wake, 1, __ATOMIC_RELEASE);
+    shm_futex_wake(&p_header->wake);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Close the ring and remove its name.
+ *
+ * Readers that have it open read the samples left, then
+ * hscdtd_shm_wait returns HSCDTD_STAT_ERROR.
+ *
+ * @param p_pub Pointer to publisher struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_shm_destroy(hscdtd_shm_publisher_t *p_pub)
+{
+    hscdtd_shm_header_t *p_header;
+
+    if (!p_pub || !p_pub->p_map) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    p_header = p_pub->p_header;
+    __atomic_store_n(&p_header->closed, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&p_header->wake, 1, __ATOMIC_RELEASE);
+    shm_futex_wake(&p_header->wake);
+
+    munmap(p_pub->p_map, p_pub->map_size);
+    shm_unlink(p_pub->name);
+    p_pub->p_map = NULL;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Map a ring read-only.
+ *
+ * The cursor starts at the next sample published, see
+ * hscdtd_shm_seek_oldest.
+ *
+ * @param p_client Pointer to client struct.
+ * @param name Name of the ring.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if there is no ring of that
+ *         name yet and HSCDTD_STAT_CHECK_FAILED if it was published by an
+ *         incompatible build.
+ */
+hscdtd_status_t hscdtd_shm_open(hscdtd_shm_client_t *p_client,
+                                const char *name)
+{
+    const hscdtd_shm_header_t *p_header;
+    struct stat st;
+    void *p_map;
+    int fd;
+
+    if (!p_client || !name) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return (errno == ENOENT) ? HSCDTD_STAT_NO_DATA : HSCDTD_STAT_ERROR;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return HSCDTD_STAT_ERROR;
+    }
+    if ((size_t) st.st_size < sizeof(hscdtd_shm_header_t)) {
+        close(fd);
+        return HSCDTD_STAT_NO_DATA;
+    }
+    p_map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p_map == MAP_FAILED)
+        return HSCDTD_STAT_ERROR;
+
+    memset(p_client, 0, sizeof(hscdtd_shm_client_t));
+    p_client->p_map = (const uint8_t *) p_map;
+    p_client->map_size = st.st_size;
+    p_header = (const hscdtd_shm_header_t *) p_map;
+    p_client->p_header = p_header;
+
+    // Not ready while the publisher fills in the header.
+    if (__atomic_load_n(&p_header->magic, __ATOMIC_ACQUIRE) !=
+        HSCDTD_SHM_MAGIC) {
+        hscdtd_shm_close(p_client);
+        return HSCDTD_STAT_NO_DATA;
+    }
+    if (p_header->version != HSCDTD_SHM_VERSION ||
+        p_header->slot_size != sizeof(hscdtd_shm_slot_t) ||
+        p_header->slots < 2 ||
+        (p_header->slots & (p_header->slots - 1)) != 0 ||
+        sizeof(hscdtd_shm_header_t) +
+        (size_t) p_header->slots * sizeof(hscdtd_shm_slot_t) >
+        p_client->map_size) {
+        hscdtd_shm_close(p_client);
+        return HSCDTD_STAT_CHECK_FAILED;
+    }
+
+    p_client->p_slots = (const hscdtd_shm_slot_t *)
+                        (p_client->p_map + sizeof(hscdtd_shm_header_t));
+    p_client->mask = p_header->slots - 1;
+    p_client->cursor = __atomic_load_n(&p_header->head, __ATOMIC_ACQUIRE);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Move the cursor to the oldest sample in the ring.
+ *
+ * @param p_client Pointer to client struct.
+ */
+void hscdtd_shm_seek_oldest(hscdtd_shm_client_t *p_client)
+{
+    uint32_t head = __atomic_load_n(&p_client->p_header->head,
+                                    __ATOMIC_ACQUIRE);
+
+    // The slot after the oldest may be written.
+    p_client->cursor = (head < p_client->mask) ? 0 : head - p_client->mask;
+}
+
+
+/**
+ * @brief Get the next sample, in place.
+ *
+ * The sample may be overwritten while it is used, the caller copies what
+ * it needs and then calls hscdtd_shm_release, which says whether it was.
+ *
+ * @param p_client Pointer to client struct.
+ * @param pp_sample Set to the sample in the ring.
+ * @param p_device Pointer to store the index of the device, or NULL.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the reader is up to date.
+ */
+hscdtd_status_t hscdtd_shm_peek(hscdtd_shm_client_t *p_client,
+                                const hscdtd_sample_t **pp_sample,
+                                uint8_t *p_device)
+{
+    const hscdtd_shm_slot_t *p_slot;
+    uint32_t head, behind, lock;
+
+    for (;;) {
+        head = __atomic_load_n(&p_client->p_header->head, __ATOMIC_ACQUIRE);
+        behind = head - p_client->cursor;
+        if (behind == 0)
+            return HSCDTD_STAT_NO_DATA;
+        // Lapped, skip to the oldest sample that is not being written.
+        if (behind > p_client->mask) {
+            p_client->lost += behind - p_client->mask;
+            p_client->cursor = head - p_client->mask;
+        }
+
+        p_slot = &p_client->p_slots[p_client->cursor & p_client->mask];
+        lock = __atomic_load_n(&p_slot->lock, __ATOMIC_ACQUIRE);
+        if ((lock & 1) == 0 &&
+            __atomic_load_n(&p_slot->pos, __ATOMIC_RELAXED) ==
+            p_client->cursor)
+            break;
+
+        // Overwritten since head was read.
+        p_client->lost++;
+        p_client->cursor++;
+    }
+
+    p_client->lock = lock;
+    *pp_sample = &p_slot->sample;
+    if (p_device)
+        *p_device = p_slot->device;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Move past the sample of hscdtd_shm_peek.
+ *
+ * @param p_client Pointer to client struct.
+ * @return hscdtd_status, HSCDTD_STAT_CHECK_FAILED if the sample was
+ *         overwritten while it was used, it counts as lost.
+ */
+hscdtd_status_t hscdtd_shm_release(hscdtd_shm_client_t *p_client)
+{
+    const hscdtd_shm_slot_t *p_slot;
+
+    p_slot = &p_client->p_slots[p_client->cursor & p_client->mask];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    p_client->cursor++;
+    if (__atomic_load_n(&p_slot->lock, __ATOMIC_RELAXED) != p_client->lock) {
+        p_client->lost++;
+        return HSCDTD_STAT_CHECK_FAILED;
+    }
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Copy the next sample.
+ *
+ * @param p_client Pointer to client struct.
+ * @param p_sample Pointer to store the sample.
+ * @param p_device Pointer to store the index of the device, or NULL.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if the reader is up to date.
+ */
+hscdtd_status_t hscdtd_shm_read(hscdtd_shm_client_t *p_client,
+                                hscdtd_sample_t *p_sample,
+                                uint8_t *p_device)
+{
+    const hscdtd_sample_t *p_slot_sample;
+    hscdtd_status_t status;
+
+    do {
+        status = hscdtd_shm_peek(p_client, &p_slot_sample, p_device);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+        *p_sample = *p_slot_sample;
+    } while (hscdtd_shm_release(p_client) != HSCDTD_STAT_OK);
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Wait until a sample is published.
+ *
+ * @param p_client Pointer to client struct.
+ * @param timeout_ms Longest wait.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA after the timeout and
+ *         HSCDTD_STAT_ERROR if the publisher closed the ring and every
+ *         sample was read.
+ */
+hscdtd_status_t hscdtd_shm_wait(hscdtd_shm_client_t *p_client,
+                                uint32_t timeout_ms)
+{
+    const hscdtd_shm_header_t *p_header = p_client->p_header;
+    uint32_t wake;
+
+    // A publish after wake was read changes it, the futex does not sleep.
+    wake = __atomic_load_n(&p_header->wake, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&p_header->head, __ATOMIC_ACQUIRE) !=
+        p_client->cursor)
+        return HSCDTD_STAT_OK;
+    if (shm_closed(p_client))
+        return HSCDTD_STAT_ERROR;
+
+    shm_futex_wait(&p_header->wake, wake, timeout_ms);
+
+    if (__atomic_load_n(&p_header->head, __ATOMIC_ACQUIRE) !=
+        p_client->cursor)
+        return HSCDTD_STAT_OK;
+    return shm_closed(p_client) ? HSCDTD_STAT_ERROR : HSCDTD_STAT_NO_DATA;
+}
+
+
+/**
+ * @brief Unmap the ring.
+ *
+ * @param p_client Pointer to client struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_shm_close(hscdtd_shm_client_t *p_client)
+{
+    if (!p_client || !p_client->p_map) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    munmap((void *) p_client->p_map, p_client->map_size);
+    p_client->p_map = NULL;
+    return HSCDTD_STAT_OK;
+}
+#endif  // RPI
@@ -0,0 +1,147 @@
+#ifndef __HSCDTD008A_SHM__
+#define __HSCDTD008A_SHM__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hscdtd008a_driver.h"
+#include "hscdtd008a_capture.h"
+
+/**
+ * Shared-memory sample ring, on RPI only.
+ *
+ * One process owns the sensors and publishes their samples to a ring in
+ * POSIX shared memory (/dev/shm/<name>), any number of processes read them
+ * from a read-only mapping. There is no extra bus traffic per reader and
+ * a reader does not copy a sample to use it.
+ *
+ * The ring has a single writer and never waits for readers:
+ *  - every slot holds a sample, its position in the stream (0 for the
+ *    first sample) and a lock, odd while the slot is written,
+ *  - head is the number of samples published, stored after the slot,
+ *  - a reader keeps its own cursor, the position of the next sample it
+ *    reads, in its own memory. A reader that falls behind by more than the
+ *    ring loses the oldest samples, counted in lost.
+ * A sample read in place is valid if the lock of its slot did not change
+ * while it was used, hscdtd_shm_release checks this. Counters are 32 bit,
+ * so the atomics need no library on 32 bit ARM, and wrap around.
+ *
+ * Readers sleep in hscdtd_shm_wait on a futex in the ring, the publisher
+ * wakes them once per publish call.
+ */
+
+#define HSCDTD_SHM_MAGIC                0x52435348UL  // "HSCR"
+#define HSCDTD_SHM_VERSION              1
+
+// Slots in a ring, a power of two. 4096 is 4s at 1kHz.
+#ifndef HSCDTD_SHM_SLOTS_DEFAULT
+#define HSCDTD_SHM_SLOTS_DEFAULT        4096
+#endif  // HSCDTD_SHM_SLOTS_DEFAULT
+
+// Longest name of a ring, with the leading '/'.
+#define HSCDTD_SHM_NAME_MAX             64
+
+#ifdef RPI
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef struct {
+    // Incremented before and after the slot is written.
+    uint32_t lock;
+    // Position of the sample in the stream.
+    uint32_t pos;
+    hscdtd_sample_t sample;
+    // Index in the device table.
+    uint8_t device;
+} hscdtd_shm_slot_t;
+
+
+// Start of the shared memory, followed by the slots.
+typedef struct {
+    // Set last, a ring with another magic is not ready.
+    uint32_t magic;
+    uint16_t version;
+    // sizeof(hscdtd_shm_slot_t) of the publisher.
+    uint16_t slot_size;
+    uint32_t slots;
+    uint32_t pid;
+    uint8_t n_devices;
+    // Set when the publisher stopped.
+    uint8_t closed;
+    hscdtd_capture_device_t devices[HSCDTD_CAPTURE_MAX_DEVICES];
+
+    // Written for every sample, apart from the fields above.
+    uint32_t head __attribute__((aligned(64)));
+    // Futex readers wait on, changes with every publish.
+    uint32_t wake;
+} hscdtd_shm_header_t;
+
+
+typedef struct {
+    uint8_t *p_map;
+    size_t map_size;
+    hscdtd_shm_header_t *p_header;
+    hscdtd_shm_slot_t *p_slots;
+    uint32_t mask;
+    uint32_t head;
+    char name[HSCDTD_SHM_NAME_MAX];
+} hscdtd_shm_publisher_t;
+
+
+typedef struct {
+    const uint8_t *p_map;
+    size_t map_size;
+    const hscdtd_shm_header_t *p_header;
+    const hscdtd_shm_slot_t *p_slots;
+    uint32_t mask;
+    // Position of the next sample.
+    uint32_t cursor;
+    // Lock of the slot returned by hscdtd_shm_peek.
+    uint32_t lock;
+    // Samples overwritten before they were read.
+    uint32_t lost;
+} hscdtd_shm_client_t;
+
+
+hscdtd_status_t hscdtd_shm_create(hscdtd_shm_publisher_t *p_pub,
+                                  const char *name, uint32_t slots,
+                                  const hscdtd_capture_device_t *p_devices,
+                                  uint8_t n_devices);
+
+hscdtd_status_t hscdtd_shm_publish(hscdtd_shm_publisher_t *p_pub,
+                                   uint8_t device,
+                                   const hscdtd_sample_t *p_samples,
+                                   uint8_t count);
+
+hscdtd_status_t hscdtd_shm_destroy(hscdtd_shm_publisher_t *p_pub);
+
+hscdtd_status_t hscdtd_shm_open(hscdtd_shm_client_t *p_client,
+                                const char *name);
+
+void hscdtd_shm_seek_oldest(hscdtd_shm_client_t *p_client);
+
+hscdtd_status_t hscdtd_shm_peek(hscdtd_shm_client_t *p_client,
+                                const hscdtd_sample_t **pp_sample,
+                                uint8_t *p_device);
+
+hscdtd_status_t hscdtd_shm_release(hscdtd_shm_client_t *p_client);
+
+hscdtd_status_t hscdtd_shm_read(hscdtd_shm_client_t *p_client,
+                                hscdtd_sample_t *p_sample,
+                                uint8_t *p_device);
+
+hscdtd_status_t hscdtd_shm_wait(hscdtd_shm_client_t *p_client,
+                                uint32_t timeout_ms);
+
+hscdtd_status_t hscdtd_shm_close(hscdtd_shm_client_t *p_client);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // RPI
+
+#endif  //__HSCDTD008A_SHM__
@@ -0,0 +1,510 @@
+#include <string.h>
+#include "hscdtd008a_stream.h"
+#include "hscdtd008a_reg.h"
+#include "transport.h"
+
+// The poll thread reads the flag while another thread stops the stream.
+static uint8_t stream_running(hscdtd_stream_t *p_stream)
+{
+#ifdef RPI
+    return __atomic_load_n(&p_stream->running, __ATOMIC_ACQUIRE);
+#else
+    return p_stream->running;
+#endif  // RPI
+}
+
+
+static void stream_set_running(hscdtd_stream_t *p_stream, uint8_t running)
+{
+#ifdef RPI
+    __atomic_store_n(&p_stream->running, running, __ATOMIC_RELEASE);
+#else
+    p_stream->running = running;
+#endif  // RPI
+}
+
+
+static void stream_deliver(hscdtd_stream_t *p_stream)
+{
+    uint8_t i;
+
+    if (p_stream->count == 0)
+        return;
+
+    for (i = 0; i < p_stream->count; i++)
+        hscdtd_consume_sample(p_stream->p_dev, &p_stream->buffer[i]);
+    p_stream->callback(p_stream->p_ctx, p_stream->buffer, p_stream->count);
+    p_stream->count = 0;
+    p_stream->stats.batches++;
+}
+
+
+// Add the sample in the next buffer slot to the batch.
+static void stream_push(hscdtd_stream_t *p_stream)
+{
+    hscdtd_sample_t *p_sample = &p_stream->buffer[p_stream->count];
+
+    if (p_stream->odr_changed) {
+        p_sample->flags |= HSCDTD_SAMPLE_ODR_CHANGE;
+        p_stream->odr_changed = 0;
+    }
+
+    // The driver counts the conversions between samples, the gap to the
+    // first sample at a new rate is not counted.
+    if (p_stream->stats.samples > 0)
+        p_stream->stats.missed += p_sample->odr_seq - p_stream->last_odr_seq - 1;
+    p_stream->last_odr_seq = p_sample->odr_seq;
+
+    if (p_stream->config.p_adapt)
+        hscdtd_adapt_update(&p_stream->adapt, p_sample);
+
+    p_stream->stats.samples++;
+    if (++p_stream->count >= p_stream->config.batch)
+        stream_deliver(p_stream);
+}
+
+
+// A single sample, after DRDY was seen or marked.
+static hscdtd_status_t stream_read_one(hscdtd_stream_t *p_stream,
+                                       uint32_t now)
+{
+    hscdtd_sample_t *p_sample = &p_stream->buffer[p_stream->count];
+    hscdtd_status_t status;
+
+    if (p_stream->config.source == HSCDTD_STREAM_POLL) {
+        status = hscdtd_data_ready(p_stream->p_dev);
+        if (status == HSCDTD_STAT_NO_DATA) {
+            p_stream->next_poll_us =
+                now + p_stream->period_us / HSCDTD_STREAM_POLL_DIV;
+            return status;
+        }
+        if (status != HSCDTD_STAT_OK)
+            return status;
+    }
+
+    status = hscdtd_read_sample(p_stream->p_dev, p_sample);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    // Start polling shortly before the next sample is due.
+    p_stream->next_poll_us = p_sample->timestamp_us + p_stream->period_us -
+                             p_stream->period_us / HSCDTD_STREAM_POLL_DIV;
+    if ((int32_t) (p_stream->next_poll_us - now) < 0)
+        p_stream->next_poll_us = now;
+
+    stream_push(p_stream);
+    return HSCDTD_STAT_OK;
+}
+
+
+#ifndef HSCDTD_NO_FIFO
+// All samples in the FIFO, read in one bus transaction.
+static hscdtd_status_t stream_read_fifo(hscdtd_stream_t *p_stream,
+                                        uint32_t now)
+{
+    hscdtd_device_t *p_dev = p_stream->p_dev;
+    hscdtd_xfer_t xfers[HSCDTD_STREAM_FIFO_DEPTH];
+    uint8_t buf[HSCDTD_STREAM_FIFO_DEPTH][6];
+    uint8_t stat[2];
+    hscdtd_sample_t *p_sample;
+    hscdtd_status_t status;
+    uint32_t first, period = p_stream->period_us;
+    uint16_t err;
+    uint8_t n, i, j, fill, overrun;
+
+    // STATUS and FIFO_P_STATUS are adjacent.
+    status = read_register_multi(p_dev, HSCDTD_REG_STATUS, 2, stat);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    p_dev->drdy_seen_us = transport_now_us(p_dev);
+
+    n = HSCDTD_FIELD_GET(HSCDTD_FFPT_FP, stat[1]);
+    if (n > HSCDTD_STREAM_FIFO_DEPTH)
+        n = HSCDTD_STREAM_FIFO_DEPTH;
+    if (n == 0) {
+        p_stream->next_poll_us = now + period / HSCDTD_STREAM_POLL_DIV;
+        return HSCDTD_STAT_NO_DATA;
+    }
+    if (HSCDTD_FIELD_GET(HSCDTD_STATUS_FFU, stat[0]))
+        p_stream->stats.fifo_full++;
+    // Conversions were dropped after the FIFO filled up. The samples in
+    // the FIFO are older than usual, the loss is before the next read.
+    overrun = HSCDTD_FIELD_GET(HSCDTD_STATUS_DOR, stat[0]);
+
+    // Every read of the output registers takes one sample from the FIFO.
+    for (i = 0; i < n; i++) {
+        xfers[i].addr = p_dev->addr;
+        xfers[i].reg = HSCDTD_REG_XOUT_L;
+        xfers[i].length = 6;
+        xfers[i].read = 1;
+        xfers[i].p_buffer = buf[i];
+    }
+    status = transport_batch(p_dev, xfers, n);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    // The newest sample ended within the last period, unless the FIFO
+    // overran: then it filled up from the last read on. Samples are
+    // consecutive unless the last read saw an overrun, only then the
+    // driver counts lost conversions from the timestamps.
+    err = (period / 2 < HSCDTD_TIMESTAMP_ERR_UNKNOWN) ?
+          period / 2 : HSCDTD_TIMESTAMP_ERR_UNKNOWN;
+    now = transport_now_us(p_dev);
+    if (overrun)
+        first = p_stream->fifo_read_us + period / 2;
+    else
+        first = now - period / 2 - (n - 1) * period;
+    p_stream->fifo_read_us = now;
+    if (!p_dev->overrun)
+        p_dev->odr_resync = 1;
+    for (i = 0; i < n; i++) {
+        p_sample = &p_stream->buffer[p_stream->count];
+        for (j = 0; j < HSCDTD_NUM_AXIS; j++)
+            (&p_sample->raw.mag_x)[j] =
+                (int16_t) ((uint16_t) ((buf[i][2 * j + 1] << 8) |
+                                       buf[i][2 * j]));
+        hscdtd_stamp_sample(p_dev, p_sample, first + i * period, err);
+        hscdtd_record_latency(p_dev, p_sample, now);
+        stream_push(p_stream);
+    }
+    if (overrun)
+        p_dev->overrun = 1;
+
+    // Come back when the FIFO holds a batch, before it is full.
+    fill = p_stream->config.batch - p_stream->count;
+    if (fill > HSCDTD_STREAM_FIFO_DEPTH - 2)
+        fill = HSCDTD_STREAM_FIFO_DEPTH - 2;
+    p_stream->next_poll_us = now + fill * period;
+    return HSCDTD_STAT_OK;
+}
+#endif  // HSCDTD_NO_FIFO
+
+
+// Follow the adaptive rate, after a read so the FIFO holds no samples of
+// the old rate.
+static hscdtd_status_t stream_adapt(hscdtd_stream_t *p_stream, uint32_t now)
+{
+    hscdtd_odr_t odr = p_stream->adapt.odr;
+    hscdtd_status_t status;
+
+    if (odr == p_stream->odr)
+        return HSCDTD_STAT_OK;
+
+    // CTRL1 is known after the start, this is a single write.
+    status = hscdtd_set_output_data_rate(p_stream->p_dev, odr);
+    if (status != HSCDTD_STAT_OK) {
+        hscdtd_adapt_set_odr(&p_stream->adapt, p_stream->odr);
+        return status;
+    }
+
+    p_stream->odr = odr;
+    p_stream->period_us = hscdtd_odr_period_us(odr);
+    p_stream->odr_changed = 1;
+    p_stream->stats.odr_changes++;
+    p_stream->next_poll_us = now + p_stream->period_us / HSCDTD_STREAM_POLL_DIV;
+    return HSCDTD_STAT_OK;
+}
+
+
+// Check the device between samples. A recovered device restarted its
+// conversions, and emptied the FIFO.
+static hscdtd_status_t stream_health(hscdtd_stream_t *p_stream,
+                                     hscdtd_status_t read_status)
+{
+    hscdtd_device_t *p_dev = p_stream->p_dev;
+    uint32_t recoveries = p_stream->health.stats.recoveries;
+    hscdtd_status_t status;
+    uint32_t now;
+
+    if (read_status != HSCDTD_STAT_OK && read_status != HSCDTD_STAT_NO_DATA)
+        hscdtd_health_suspect(&p_stream->health);
+
+    status = hscdtd_health_poll(&p_stream->health);
+    if (p_stream->health.stats.recoveries != recoveries) {
+        now = transport_now_us(p_dev);
+        p_stream->fifo_read_us = now;
+        p_stream->next_poll_us = now + p_stream->period_us;
+    }
+    return status;
+}
+
+
+#ifdef RPI
+static void *stream_thread(void *p_arg)
+{
+    hscdtd_stream_t *p_stream = (hscdtd_stream_t *) p_arg;
+    int32_t wait;
+
+    while (stream_running(p_stream)) {
+        hscdtd_stream_poll(p_stream);
+        wait = (int32_t) (hscdtd_stream_next_us(p_stream) -
+                          transport_now_us(p_stream->p_dev));
+        if (wait > 0)
+            transport_sleep_ms(p_stream->p_dev, (wait + 999) / 1000);
+    }
+    return 0;
+}
+#endif  // RPI
+
+
+/**
+ * @brief Start continuous acquisition.
+ *
+ * Puts the device in the normal state at the configured output data rate
+ * and makes it active. With config.thread the samples are acquired from a
+ * thread, else hscdtd_stream_poll must be called. An adaptive stream
+ * starts at the low rate of config.p_adapt, a health monitor checks on
+ * the first poll.
+ *
+ * @param p_stream Pointer to stream struct.
+ * @param p_dev Pointer to device struct, initialized.
+ * @param p_config Stream configuration.
+ * @param callback Called with every batch of samples.
+ * @param p_ctx Passed to the callback.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_stream_start(hscdtd_stream_t *p_stream,
+                                    hscdtd_device_t *p_dev,
+                                    const hscdtd_stream_config_t *p_config,
+                                    hscdtd_stream_callback_t callback,
+                                    void *p_ctx)
+{
+    hscdtd_status_t status;
+    uint8_t clear[6];
+
+    if (!p_stream || !p_dev || !p_config || !callback) {
+        return HSCDTD_STAT_ERROR;
+    }
+    if (p_config->batch == 0 || p_config->batch > HSCDTD_STREAM_MAX_BATCH ||
+        p_config->odr > HSCDTD_ODR_100HZ ||
+        p_config->source > HSCDTD_STREAM_FIFO ||
+        (p_config->thread && !HSCDTD_STREAM_HAS_THREAD)) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+#ifdef HSCDTD_NO_FIFO
+    if (p_config->source == HSCDTD_STREAM_FIFO) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+#endif  // HSCDTD_NO_FIFO
+#ifdef HSCDTD_NO_DRDY_CONFIG
+    if (p_config->source == HSCDTD_STREAM_DRDY) {
+        return HSCDTD_STAT_USER_ERROR;
+    }
+#endif  // HSCDTD_NO_DRDY_CONFIG
+
+    memset(p_stream, 0, sizeof(hscdtd_stream_t));
+    p_stream->p_dev = p_dev;
+    p_stream->config = *p_config;
+    p_stream->callback = callback;
+    p_stream->p_ctx = p_ctx;
+    p_stream->odr = p_config->odr;
+    if (p_config->p_adapt) {
+        status = hscdtd_adapt_init(&p_stream->adapt, p_config->p_adapt);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+        p_stream->odr = p_stream->adapt.odr;
+    }
+    if (p_config->p_health) {
+        status = hscdtd_health_init(&p_stream->health, p_dev,
+                                    p_config->p_health);
+        if (status != HSCDTD_STAT_OK)
+            return status;
+    }
+    p_stream->period_us = hscdtd_odr_period_us(p_stream->odr);
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    // Reading the output registers clears DRDY and DOR left from before.
+    status = read_register_multi(p_dev, HSCDTD_REG_XOUT_L, 6, clear);
+    if (status == HSCDTD_STAT_OK)
+        status = hscdtd_set_output_data_rate(p_dev, p_stream->odr);
+#ifndef HSCDTD_NO_FIFO
+    if (status == HSCDTD_STAT_OK)
+        status = hscdtd_set_fifo_enable(p_dev,
+            (p_config->source == HSCDTD_STREAM_FIFO) ? HSCDTD_FF_ENABLE :
+                                                       HSCDTD_FF_DISABLE);
+#endif  // HSCDTD_NO_FIFO
+#ifndef HSCDTD_NO_DRDY_CONFIG
+    if (status == HSCDTD_STAT_OK && p_config->source == HSCDTD_STREAM_DRDY)
+        status = hscdtd_set_data_ready_pin_enable(p_dev, HSCDTD_DEN_ENABLED);
+#endif  // HSCDTD_NO_DRDY_CONFIG
+    if (status == HSCDTD_STAT_OK)
+        status = hscdtd_set_state(p_dev, HSCDTD_STATE_NORMAL);
+    if (status == HSCDTD_STAT_OK)
+        status = hscdtd_set_mode(p_dev, HSCDTD_MODE_ACTIVE);
+    p_dev->drdy_marked = 0;
+    p_dev->window_valid = 0;
+    p_stream->next_poll_us = transport_now_us(p_dev) + p_stream->period_us;
+    p_stream->fifo_read_us = transport_now_us(p_dev);
+    p_dev->overrun = 0;
+    hscdtd_mutex_unlock(&p_dev->lock);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    stream_set_running(p_stream, 1);
+#ifdef RPI
+    if (p_config->thread &&
+        pthread_create(&p_stream->thread, 0, stream_thread, p_stream) != 0) {
+        stream_set_running(p_stream, 0);
+        return HSCDTD_STAT_ERROR;
+    }
+#endif  // RPI
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Stop acquisition.
+ *
+ * Delivers the samples of a partial batch and puts the device back in the
+ * force state. Not from the callback.
+ *
+ * @param p_stream Pointer to stream struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t hscdtd_stream_stop(hscdtd_stream_t *p_stream)
+{
+    hscdtd_device_t *p_dev;
+    hscdtd_status_t status;
+
+    if (!p_stream || !stream_running(p_stream)) {
+        return HSCDTD_STAT_ERROR;
+    }
+    p_dev = p_stream->p_dev;
+
+    stream_set_running(p_stream, 0);
+#ifdef RPI
+    if (p_stream->config.thread)
+        pthread_join(p_stream->thread, 0);
+#endif  // RPI
+    stream_deliver(p_stream);
+
+    hscdtd_mutex_lock(&p_dev->lock);
+    status = hscdtd_set_state(p_dev, HSCDTD_STATE_FORCE);
+#ifndef HSCDTD_NO_FIFO
+    if (status == HSCDTD_STAT_OK &&
+        p_stream->config.source == HSCDTD_STREAM_FIFO)
+        status = hscdtd_set_fifo_enable(p_dev, HSCDTD_FF_DISABLE);
+#endif  // HSCDTD_NO_FIFO
+#ifndef HSCDTD_NO_DRDY_CONFIG
+    if (status == HSCDTD_STAT_OK &&
+        p_stream->config.source == HSCDTD_STREAM_DRDY)
+        status = hscdtd_set_data_ready_pin_enable(p_dev, HSCDTD_DEN_DISABLED);
+#endif  // HSCDTD_NO_DRDY_CONFIG
+    hscdtd_mutex_unlock(&p_dev->lock);
+    return status;
+}
+
+
+/**
+ * @brief Acquire the samples that are due.
+ *
+ * Returns immediately if nothing is due. Calls the callback for every
+ * full batch, and for a partial batch after max_latency_us. Runs the
+ * health check when it is due.
+ *
+ * @param p_stream Pointer to stream struct.
+ * @return hscdtd_status, HSCDTD_STAT_NO_DATA if no sample was read.
+ */
+hscdtd_status_t hscdtd_stream_poll(hscdtd_stream_t *p_stream)
+{
+    hscdtd_device_t *p_dev;
+    hscdtd_status_t status = HSCDTD_STAT_NO_DATA;
+    hscdtd_status_t health;
+    uint32_t now;
+
+    if (!p_stream || !stream_running(p_stream)) {
+        return HSCDTD_STAT_ERROR;
+    }
+    p_dev = p_stream->p_dev;
+    now = transport_now_us(p_dev);
+
+    if (p_stream->config.source == HSCDTD_STREAM_DRDY) {
+        if (p_dev->drdy_marked)
+            status = stream_read_one(p_stream, now);
+    } else if ((int32_t) (now - p_stream->next_poll_us) >= 0) {
+        hscdtd_mutex_lock(&p_dev->lock);
+#ifndef HSCDTD_NO_FIFO
+        if (p_stream->config.source == HSCDTD_STREAM_FIFO)
+            status = stream_read_fifo(p_stream, now);
+        else
+#endif  // HSCDTD_NO_FIFO
+            status = stream_read_one(p_stream, now);
+        hscdtd_mutex_unlock(&p_dev->lock);
+    }
+
+    if (status == HSCDTD_STAT_OK && p_stream->config.p_adapt) {
+        hscdtd_mutex_lock(&p_dev->lock);
+        status = stream_adapt(p_stream, now);
+        hscdtd_mutex_unlock(&p_dev->lock);
+    }
+
+    if (p_stream->config.p_health) {
+        health = stream_health(p_stream, status);
+        if (health != HSCDTD_STAT_OK && health != HSCDTD_STAT_NO_DATA &&
+            (status == HSCDTD_STAT_OK || status == HSCDTD_STAT_NO_DATA))
+            status = health;
+    }
+
+    if (status != HSCDTD_STAT_OK && status != HSCDTD_STAT_NO_DATA) {
+        p_stream->stats.errors++;
+        p_stream->next_poll_us = now + p_stream->period_us;
+    }
+
+    if (p_stream->count > 0 && p_stream->config.max_latency_us &&
+        now - p_stream->buffer[0].timestamp_us >=
+            p_stream->config.max_latency_us)
+        stream_deliver(p_stream);
+
+    return status;
+}
+
+
+/**
+ * @brief Time at which hscdtd_stream_poll has work next.
+ *
+ * @param p_stream Pointer to stream struct.
+ * @return Time in transport_now_us time.
+ */
+uint32_t hscdtd_stream_next_us(hscdtd_stream_t *p_stream)
+{
+    uint32_t next = p_stream->next_poll_us;
+    uint32_t flush;
+
+    // The interrupt is only seen by polling the mark.
+    if (p_stream->config.source == HSCDTD_STREAM_DRDY)
+        next = transport_now_us(p_stream->p_dev) +
+               p_stream->period_us / HSCDTD_STREAM_POLL_DIV;
+
+    if (p_stream->count > 0 && p_stream->config.max_latency_us) {
+        flush = p_stream->buffer[0].timestamp_us +
+                p_stream->config.max_latency_us;
+        if ((int32_t) (flush - next) < 0)
+            next = flush;
+    }
+    return next;
+}
+
+
+/**
+ * @brief Signal a sample from the DRDY pin interrupt.
+ *
+ * @param p_stream Pointer to stream struct.
+ */
+void hscdtd_stream_notify(hscdtd_stream_t *p_stream)
+{
+    hscdtd_mark_data_ready(p_stream->p_dev);
+}
+
+
+/**
+ * @brief Deliver the samples of a partial batch now.
+ *
+ * Only from the context that polls, not while the stream thread runs.
+ *
+ * @param p_stream Pointer to stream struct.
+ */
+void hscdtd_stream_flush(hscdtd_stream_t *p_stream)
+{
+    stream_deliver(p_stream);
+}
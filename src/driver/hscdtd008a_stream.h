@@ -0,0 +1,158 @@
+#ifndef __HSCDTD008A_STREAM__
+#define __HSCDTD008A_STREAM__
+
+#include <stdint.h>
+#include "hscdtd008a_driver.h"
+#include "hscdtd008a_adapt.h"
+#include "hscdtd008a_health.h"
+
+#ifdef RPI
+#include <pthread.h>
+#endif  // RPI
+
+/**
+ * Continuous acquisition in the normal state.
+ *
+ * hscdtd_stream_start configures the output data rate and the data
+ * source, then samples are delivered to a callback in batches. The
+ * acquisition runs in hscdtd_stream_poll: on RPI from a thread of the
+ * library, elsewhere from the main loop. A poll returns immediately when
+ * nothing is due, call it often (hscdtd_stream_next_us tells when).
+ *
+ * Sources:
+ *  - HSCDTD_STREAM_POLL: DRDY is read over the bus, at a fraction of the
+ *    output data period once a sample is expected.
+ *  - HSCDTD_STREAM_DRDY: the DRDY pin interrupt calls hscdtd_stream_notify,
+ *    the sample is read on the next poll. No status reads. Not with
+ *    HSCDTD_NO_DRDY_CONFIG.
+ *  - HSCDTD_STREAM_FIFO: the sensor buffers samples in its FIFO, which is
+ *    read in one bus transaction every few periods. Timestamps are spaced
+ *    by the output data period. Not with HSCDTD_NO_FIFO.
+ *
+ * Bigger batches mean fewer callbacks, and for the FIFO fewer bus
+ * transactions, at the cost of latency. max_latency_us bounds it.
+ *
+ * With p_adapt the output data rate follows the signal, see
+ * hscdtd008a_adapt.h. A change is a single write of CTRL1, the first
+ * sample at the new rate has HSCDTD_SAMPLE_ODR_CHANGE set.
+ *
+ * With p_health the device is checked between samples, and at once after
+ * a failed read, see hscdtd008a_health.h. A recovered device continues
+ * at the same rate, the samples lost are not counted as missed.
+ */
+
+#ifndef HSCDTD_STREAM_MAX_BATCH
+#define HSCDTD_STREAM_MAX_BATCH         16
+#endif  // HSCDTD_STREAM_MAX_BATCH
+
+#define HSCDTD_STREAM_FIFO_DEPTH        8
+
+// DRDY is polled this many times per output data period.
+#define HSCDTD_STREAM_POLL_DIV          8
+
+#ifdef RPI
+#define HSCDTD_STREAM_HAS_THREAD        1
+#else
+#define HSCDTD_STREAM_HAS_THREAD        0
+#endif  // RPI
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  // __cplusplus
+
+typedef enum {
+    HSCDTD_STREAM_POLL,
+    HSCDTD_STREAM_DRDY,
+    HSCDTD_STREAM_FIFO,
+} hscdtd_stream_source_t;
+
+
+// Called with count samples, oldest first. Must not stop the stream.
+typedef void (*hscdtd_stream_callback_t)(void *p_ctx,
+                                         const hscdtd_sample_t *p_samples,
+                                         uint8_t count);
+
+
+typedef struct {
+    hscdtd_odr_t odr;
+    hscdtd_stream_source_t source;
+    // Samples per callback, 1 to HSCDTD_STREAM_MAX_BATCH.
+    uint8_t batch;
+    // Deliver a partial batch once its oldest sample is this old, 0 to
+    // wait for full batches.
+    uint32_t max_latency_us;
+    // 1 to poll from a thread of the library (RPI only).
+    uint8_t thread;
+    // Adaptive output data rate, NULL to keep odr. Starts at odr_low.
+    const hscdtd_adapt_config_t *p_adapt;
+    // Health monitor, NULL for none.
+    const hscdtd_health_config_t *p_health;
+} hscdtd_stream_config_t;
+
+#define HSCDTD_STREAM_CONFIG_DEFAULT \
+    {HSCDTD_ODR_100HZ, HSCDTD_STREAM_POLL, 1, 0, HSCDTD_STREAM_HAS_THREAD, 0, \
+     0}
+
+
+typedef struct {
+    uint32_t samples;
+    uint32_t batches;
+    // Conversions lost, from the odr_seq of the samples.
+    uint32_t missed;
+    uint32_t fifo_full;
+    uint32_t errors;
+    uint32_t odr_changes;
+} hscdtd_stream_stats_t;
+
+
+typedef struct {
+    hscdtd_device_t *p_dev;
+    hscdtd_stream_config_t config;
+    hscdtd_stream_callback_t callback;
+    void *p_ctx;
+
+    hscdtd_sample_t buffer[HSCDTD_STREAM_MAX_BATCH];
+    uint8_t count;
+
+    uint8_t running;
+    // Output data rate the device runs at.
+    hscdtd_odr_t odr;
+    uint32_t period_us;
+    hscdtd_adapt_t adapt;
+    hscdtd_health_t health;
+    uint32_t last_odr_seq;
+    // End of the last FIFO read, the FIFO fills up from there.
+    uint32_t fifo_read_us;
+    // The next sample is the first at a new rate.
+    uint8_t odr_changed;
+    uint32_t next_poll_us;
+    hscdtd_stream_stats_t stats;
+#ifdef RPI
+    pthread_t thread;
+#endif  // RPI
+} hscdtd_stream_t;
+
+
+hscdtd_status_t hscdtd_stream_start(hscdtd_stream_t *p_stream,
+                                    hscdtd_device_t *p_dev,
+                                    const hscdtd_stream_config_t *p_config,
+                                    hscdtd_stream_callback_t callback,
+                                    void *p_ctx);
+
+hscdtd_status_t hscdtd_stream_stop(hscdtd_stream_t *p_stream);
+
+hscdtd_status_t hscdtd_stream_poll(hscdtd_stream_t *p_stream);
+
+uint32_t hscdtd_stream_next_us(hscdtd_stream_t *p_stream);
+
+void hscdtd_stream_notify(hscdtd_stream_t *p_stream);
+
+void hscdtd_stream_flush(hscdtd_stream_t *p_stream);
+
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  //__HSCDTD008A_STREAM__
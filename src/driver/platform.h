@@ -13,6 +13,44 @@ extern "C"
 {
 #endif // __cplusplus
 
+// A register transfer, for transports that run a batch of transfers as one
+// bus transaction.
+typedef struct {
+    uint8_t addr;
+    uint8_t reg;
+    uint8_t length;
+    // 1 to read registers, 0 to write.
+    uint8_t read;
+    uint8_t *p_buffer;
+} hscdtd_xfer_t;
+
+
+/**
+ * Transport operations of a device.
+ *
+ * Every device references a transport and a context, which is passed to
+ * every operation. Devices on different buses or backends can be mixed in
+ * one program. Return values are as for the t_* functions below.
+ *
+ * open and batch are optional (NULL). Without batch, transfers are done
+ * one by one with read and write.
+ */
+typedef struct {
+    int8_t (*open)(void *p_ctx);
+    int8_t (*read)(void *p_ctx, uint8_t addr, uint8_t reg, uint8_t length,
+                   uint8_t *p_buffer);
+    int8_t (*write)(void *p_ctx, uint8_t addr, uint8_t reg, uint8_t length,
+                    uint8_t *p_buffer);
+    void (*sleep_ms)(void *p_ctx, uint32_t duration_ms);
+    uint32_t (*now_us)(void *p_ctx);
+    int8_t (*batch)(void *p_ctx, hscdtd_xfer_t *p_xfers, uint8_t count);
+} hscdtd_transport_t;
+
+
+// Transport on top of the t_* functions of the platform, the default of
+// every device.
+extern const hscdtd_transport_t hscdtd_platform_transport;
+
 /**
  * @brief Open a connection with the device.
  *
@@ -76,6 +114,41 @@ int8_t t_close(void);
 void t_sleep_ms(uint32_t duration_ms);
 
 
+/**
+ * @brief Get a monotonic timestamp.
+ *
+ * Wraps around after ~71 minutes, use unsigned subtraction for intervals.
+ *
+ * @return Time in microseconds.
+ */
+uint32_t t_now_us(void);
+
+
+#ifdef RPI
+/**
+ * @brief Run transfers as one bus transaction.
+ *
+ * @param p_xfers Transfers, in order.
+ * @param count Number of transfers.
+ *
+ * @return 0 on success.
+ */
+int8_t t_batch(hscdtd_xfer_t *p_xfers, uint8_t count);
+
+
+// An I2C bus, the context of hscdtd_rpi_transport.
+typedef struct {
+    const char *path;
+    int fd;
+} hscdtd_rpi_i2c_t;
+
+#define HSCDTD_RPI_I2C_INITIALIZER(path)    {(path), -1}
+
+// Transport with a file descriptor per bus, for devices on several buses.
+extern const hscdtd_transport_t hscdtd_rpi_transport;
+#endif // RPI
+
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
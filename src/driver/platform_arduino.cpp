@@ -80,4 +80,10 @@ void t_sleep_ms(uint32_t duration_ms)
     delay(duration_ms);
 }
 
+
+uint32_t t_now_us(void)
+{
+    return micros();
+}
+
 #endif //ARDUINO
@@ -19,12 +19,15 @@
 #include <errno.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 #include <linux/i2c-dev.h>
 #define I2C_ADDR 0x0f
 #define device "/dev/i2c-1"
 #ifndef I2C_M_RD
 #include <linux/i2c.h>
 #endif
+// The kernel accepts up to 42 messages per I2C_RDWR ioctl, two per read.
+#define HSCDTD_RPI_BATCH_MAX 16
 
 int fd = -1;
 
@@ -41,7 +44,8 @@ int8_t t_open(void)
     return (fd < 0);
 }
 
-int8_t t_read_register(uint8_t addr,
+static int8_t rpi_read(int bus_fd,
+                       uint8_t addr,
                        uint8_t reg,
                        uint8_t length,
                        uint8_t *p_buffer)
@@ -77,7 +81,7 @@ int8_t t_read_register(uint8_t addr,
 
     // hand over prepared messages to the kernel via ioctl driver for execution
     *p_buffer = 0;
-    if (ioctl(fd, I2C_RDWR, &msgset) < 0) {
+    if (ioctl(bus_fd, I2C_RDWR, &msgset) < 0) {
         printf("ioctl(I2C_RDWR) in i2c_read");
         printf("t_read_register: Error writing to i2c device: %s\n", 
   		strerror(errno));
@@ -87,11 +91,12 @@ int8_t t_read_register(uint8_t addr,
     }
 
     //copy received bytes into buffer
-    strncpy((char*) p_buffer, (char*) inbuf, length); 
+    memcpy(p_buffer, inbuf, length);
     return 0;
 }
 
-int8_t t_write_register(uint8_t addr,
+static int8_t rpi_write(int bus_fd,
+                        uint8_t addr,
                         uint8_t reg,
                         uint8_t length,
                         uint8_t *p_buffer)
@@ -104,7 +109,7 @@ int8_t t_write_register(uint8_t addr,
     if (length >= 31) 
       return -2; 
 
-    strncpy((char*)buffer+1, (char*) p_buffer, length);
+    memcpy(buffer + 1, p_buffer, length);
    
     // prepare i2c write message 
     msgs[0].addr = addr;
@@ -116,7 +121,7 @@ int8_t t_write_register(uint8_t addr,
     msgset[0].nmsgs = 1;
 
     // hand over prepared messages to the kernel driver via ioctl for execution
-    if (ioctl(fd, I2C_RDWR, &msgset) < 0)
+    if (ioctl(bus_fd, I2C_RDWR, &msgset) < 0)
     {
         printf("t_write_register: ioctl(I2C_RDWR) in i2c_write");
 	printf("Error writing to i2c device: %s.\n", strerror(errno));
@@ -128,6 +133,72 @@ int8_t t_write_register(uint8_t addr,
     return 0;
 }
 
+static int8_t rpi_batch(int bus_fd, hscdtd_xfer_t *p_xfers, uint8_t count)
+{
+    uint8_t outbuf[HSCDTD_RPI_BATCH_MAX][32];
+    struct i2c_msg msgs[2 * HSCDTD_RPI_BATCH_MAX];
+    struct i2c_rdwr_ioctl_data msgset[1];
+    uint8_t i, n = 0;
+
+    if (count > HSCDTD_RPI_BATCH_MAX)
+      return -2;
+
+    // A write is one message with the register in front of the data, a
+    // read selects the register and reads in a second message.
+    for (i = 0; i < count; i++) {
+        if (p_xfers[i].length >= 31)
+          return -2;
+
+        outbuf[i][0] = p_xfers[i].reg;
+        msgs[n].addr = p_xfers[i].addr;
+        msgs[n].flags = 0;
+        msgs[n].buf = outbuf[i];
+        if (p_xfers[i].read) {
+            msgs[n++].len = 1;
+            msgs[n].addr = p_xfers[i].addr;
+            msgs[n].flags = I2C_M_RD | I2C_M_NOSTART;
+            msgs[n].len = p_xfers[i].length;
+            msgs[n++].buf = p_xfers[i].p_buffer;
+        } else {
+            memcpy(&outbuf[i][1], p_xfers[i].p_buffer, p_xfers[i].length);
+            msgs[n++].len = p_xfers[i].length + 1;
+        }
+    }
+
+    msgset[0].msgs = msgs;
+    msgset[0].nmsgs = n;
+
+    // hand over all messages to the kernel in one ioctl, no gaps between
+    // the transfers for other processes or scheduling
+    if (ioctl(bus_fd, I2C_RDWR, &msgset) < 0) {
+        printf("t_batch: Error on i2c device: %s.\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int8_t t_read_register(uint8_t addr,
+                       uint8_t reg,
+                       uint8_t length,
+                       uint8_t *p_buffer)
+{
+    return rpi_read(fd, addr, reg, length, p_buffer);
+}
+
+int8_t t_write_register(uint8_t addr,
+                        uint8_t reg,
+                        uint8_t length,
+                        uint8_t *p_buffer)
+{
+    return rpi_write(fd, addr, reg, length, p_buffer);
+}
+
+int8_t t_batch(hscdtd_xfer_t *p_xfers, uint8_t count)
+{
+    return rpi_batch(fd, p_xfers, count);
+}
+
 int8_t t_flush(void)
 {
     return 0;
@@ -145,4 +216,67 @@ void t_sleep_ms(uint32_t duration_ms)
 {
     usleep(duration_ms * 1000);
 }
+
+
+uint32_t t_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+
+/*
+ * Transport with one file descriptor per bus, the context is a
+ * hscdtd_rpi_i2c_t. Devices on different buses share nothing.
+ */
+static int8_t rpi_bus_open(void *p_ctx)
+{
+    hscdtd_rpi_i2c_t *p_i2c = (hscdtd_rpi_i2c_t *) p_ctx;
+
+    // Opened once for all devices on the bus.
+    if (p_i2c->fd < 0)
+        p_i2c->fd = open(p_i2c->path, O_RDWR);
+    return (p_i2c->fd < 0);
+}
+
+static int8_t rpi_bus_read(void *p_ctx, uint8_t addr, uint8_t reg,
+                           uint8_t length, uint8_t *p_buffer)
+{
+    return rpi_read(((hscdtd_rpi_i2c_t *) p_ctx)->fd, addr, reg, length,
+                    p_buffer);
+}
+
+static int8_t rpi_bus_write(void *p_ctx, uint8_t addr, uint8_t reg,
+                            uint8_t length, uint8_t *p_buffer)
+{
+    return rpi_write(((hscdtd_rpi_i2c_t *) p_ctx)->fd, addr, reg, length,
+                     p_buffer);
+}
+
+static void rpi_bus_sleep_ms(void *p_ctx, uint32_t duration_ms)
+{
+    t_sleep_ms(duration_ms);
+}
+
+static uint32_t rpi_bus_now_us(void *p_ctx)
+{
+    return t_now_us();
+}
+
+static int8_t rpi_bus_batch(void *p_ctx, hscdtd_xfer_t *p_xfers,
+                            uint8_t count)
+{
+    return rpi_batch(((hscdtd_rpi_i2c_t *) p_ctx)->fd, p_xfers, count);
+}
+
+const hscdtd_transport_t hscdtd_rpi_transport = {
+    rpi_bus_open,
+    rpi_bus_read,
+    rpi_bus_write,
+    rpi_bus_sleep_ms,
+    rpi_bus_now_us,
+    rpi_bus_batch,
+};
 #endif
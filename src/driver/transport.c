@@ -1,8 +1,222 @@
 #include "transport.h"
+#include "hscdtd008a_reg.h"
 
 // Read limit is equal to the number of available registers.
 #define HSCDTD_TRANSPORT_READ_LIMIT 0x32
 
+
+// CTRL1, CTRL2, CTRL4 and the offsets only change when they are written,
+// so the driver keeps their value. CTRL3 holds self clearing commands.
+static int8_t shadow_index(uint8_t reg)
+{
+    if (reg >= HSCDTD_REG_OFFSET_X_L && reg <= HSCDTD_REG_OFFSET_Z_H)
+        return HSCDTD_SHADOW_OFFSET + (reg - HSCDTD_REG_OFFSET_X_L);
+
+    switch (reg) {
+    case HSCDTD_REG_CTRL1:
+        return HSCDTD_SHADOW_CTRL1;
+    case HSCDTD_REG_CTRL2:
+        return HSCDTD_SHADOW_CTRL2;
+    case HSCDTD_REG_CTRL4:
+        return HSCDTD_SHADOW_CTRL4;
+    default:
+        return -1;
+    }
+}
+
+
+// Keep the shadowed registers in a transfer, called with the bus held.
+// A failed write leaves the register unknown.
+static void shadow_store(hscdtd_device_t *p_dev, uint8_t reg, uint8_t length,
+                         const uint8_t *p_buffer, int8_t status)
+{
+    uint8_t i;
+    int8_t index;
+
+    for (i = 0; i < length; i++) {
+        // A soft reset restores the defaults, an offset calibration
+        // writes the offsets.
+        if (reg + i == HSCDTD_REG_CTRL3) {
+            if (p_buffer[i] & HSCDTD_CTRL3_SRST_MSK) {
+                p_dev->reg_shadow_valid = 0;
+#ifndef HSCDTD_NO_FIFO
+                if (status == 0)
+                    p_dev->fifo_enabled = 0;
+#endif  // HSCDTD_NO_FIFO
+            } else if (p_buffer[i] & HSCDTD_CTRL3_OCL_MSK) {
+                p_dev->reg_shadow_valid &= ~HSCDTD_SHADOW_OFFSET_MSK;
+            }
+            continue;
+        }
+#ifndef HSCDTD_NO_FIFO
+        // A failed write may have enabled the FIFO all the same.
+        if (reg + i == HSCDTD_REG_CTRL2 &&
+            ((p_buffer[i] & HSCDTD_CTRL2_FF_MSK) || status == 0))
+            p_dev->fifo_enabled = HSCDTD_FIELD_GET(HSCDTD_CTRL2_FF,
+                                                   p_buffer[i]);
+#endif  // HSCDTD_NO_FIFO
+
+        index = shadow_index(reg + i);
+        if (index < 0)
+            continue;
+        if (status == 0) {
+            p_dev->reg_shadow[index] = p_buffer[i];
+            p_dev->reg_shadow_valid |= 1 << index;
+        } else {
+            p_dev->reg_shadow_valid &= ~(1 << index);
+        }
+    }
+}
+
+
+/**
+ * @brief Whether reading registers again returns the same.
+ *
+ * Reading the self test response or a sample from the FIFO changes what
+ * the next read returns, such a read may not be repeated or shared.
+ *
+ * @param p_dev Pointer to device struct, NULL if the device is not known,
+ *              its FIFO is then taken as enabled.
+ * @param reg First register.
+ * @param length Number of registers.
+ * @return 1 if the read has no side effects.
+ */
+uint8_t transport_read_repeatable(hscdtd_device_t *p_dev, uint8_t reg,
+                                  uint8_t length)
+{
+    uint16_t end = reg + length;
+    uint8_t fifo;
+
+#ifndef HSCDTD_NO_FIFO
+    fifo = !p_dev || p_dev->fifo_enabled;
+#else
+    // The driver never enables the FIFO.
+    fifo = !p_dev;
+#endif  // HSCDTD_NO_FIFO
+
+    if (reg <= HSCDTD_REG_SELFTEST_RESP && end > HSCDTD_REG_SELFTEST_RESP)
+        return 0;
+    if (fifo && reg <= HSCDTD_REG_ZOUT_H && end > HSCDTD_REG_XOUT_L)
+        return 0;
+    return 1;
+}
+
+
+// Whether a failed transfer to the device may be repeated.
+static uint8_t retry_allowed(hscdtd_device_t *p_dev, uint8_t read,
+                             uint8_t reg, uint8_t length)
+{
+#ifndef HSCDTD_NO_RETRY
+    uint8_t end = reg + length;
+
+    if (read) {
+        if (!transport_read_repeatable(p_dev, reg, length))
+            return 0;
+        return p_dev->retry.retry & HSCDTD_RETRY_READ;
+    }
+    if (reg <= HSCDTD_REG_CTRL3 && end > HSCDTD_REG_CTRL3)
+        return p_dev->retry.retry & HSCDTD_RETRY_COMMAND;
+    return p_dev->retry.retry & HSCDTD_RETRY_WRITE;
+#else
+    return 0;
+#endif  // HSCDTD_NO_RETRY
+}
+
+
+// After a transfer, whether to repeat it. Waits for the backoff of the
+// attempt, called with the bus released.
+static uint8_t retry_next(hscdtd_device_t *p_dev, int8_t status,
+                          uint8_t attempt, uint8_t allowed)
+{
+#ifndef HSCDTD_NO_RETRY
+    uint32_t backoff_ms;
+
+    if (status == 0) {
+        if (attempt > 1)
+            p_dev->retry_stats.recovered++;
+        return 0;
+    }
+    if (!allowed) {
+        p_dev->retry_stats.not_retried++;
+        return 0;
+    }
+    if (attempt >= p_dev->retry.max_attempts) {
+        p_dev->retry_stats.exhausted++;
+        return 0;
+    }
+
+    backoff_ms = (attempt < 16) ?
+                 (uint32_t) p_dev->retry.backoff_ms << (attempt - 1) :
+                 p_dev->retry.backoff_max_ms;
+    if (backoff_ms > p_dev->retry.backoff_max_ms)
+        backoff_ms = p_dev->retry.backoff_max_ms;
+    if (backoff_ms > 0)
+        transport_sleep_ms(p_dev, backoff_ms);
+    p_dev->retry_stats.retries++;
+    return 1;
+#else
+    return 0;
+#endif  // HSCDTD_NO_RETRY
+}
+
+
+#ifndef HSCDTD_NO_PLATFORM_TRANSPORT
+static int8_t platform_open(void *p_ctx)
+{
+    return t_open();
+}
+
+
+static int8_t platform_read(void *p_ctx, uint8_t addr, uint8_t reg,
+                            uint8_t length, uint8_t *p_buffer)
+{
+    return t_read_register(addr, reg, length, p_buffer);
+}
+
+
+static int8_t platform_write(void *p_ctx, uint8_t addr, uint8_t reg,
+                             uint8_t length, uint8_t *p_buffer)
+{
+    return t_write_register(addr, reg, length, p_buffer);
+}
+
+
+static void platform_sleep_ms(void *p_ctx, uint32_t duration_ms)
+{
+    t_sleep_ms(duration_ms);
+}
+
+
+static uint32_t platform_now_us(void *p_ctx)
+{
+    return t_now_us();
+}
+
+
+#ifdef RPI
+static int8_t platform_batch(void *p_ctx, hscdtd_xfer_t *p_xfers,
+                             uint8_t count)
+{
+    return t_batch(p_xfers, count);
+}
+#endif  // RPI
+
+
+const hscdtd_transport_t hscdtd_platform_transport = {
+    platform_open,
+    platform_read,
+    platform_write,
+    platform_sleep_ms,
+    platform_now_us,
+#ifdef RPI
+    platform_batch,
+#else
+    0,
+#endif  // RPI
+};
+#endif  // HSCDTD_NO_PLATFORM_TRANSPORT
+
+
 /**
  * @brief Read a single register from the sensor.
  *
@@ -36,6 +250,7 @@ hscdtd_status_t read_register_multi(hscdtd_device_t *p_dev,
                                     void *p_buffer)
 {
     int8_t status;
+    uint8_t attempt = 0;
 
     // Check if result buffer is ok.
     if (!p_buffer) {
@@ -47,7 +262,24 @@ hscdtd_status_t read_register_multi(hscdtd_device_t *p_dev,
         return HSCDTD_STAT_USER_ERROR;
     }
 
-    status = t_read_register(p_dev->addr, reg, length, (uint8_t* ) p_buffer);
+    if (!p_dev->p_transport) {
+        return HSCDTD_STAT_TRANSPORT_ERROR;
+    }
+
+    do {
+        attempt++;
+        if (p_dev->p_bus)
+            hscdtd_bus_lock(p_dev->p_bus);
+        status = p_dev->p_transport->read(p_dev->p_transport_ctx,
+                                          p_dev->addr, reg, length,
+                                          (uint8_t* ) p_buffer);
+        if (status == 0)
+            shadow_store(p_dev, reg, length, (uint8_t *) p_buffer, status);
+        if (p_dev->p_bus)
+            hscdtd_bus_unlock(p_dev->p_bus);
+    } while (retry_next(p_dev, status, attempt,
+                        retry_allowed(p_dev, 1, reg, length)));
+
     if (status != 0) {
         return HSCDTD_STAT_TRANSPORT_ERROR;
     }
@@ -86,15 +318,239 @@ hscdtd_status_t write_register_multi(hscdtd_device_t *p_dev,
                                      void *p_buffer)
 {
     int8_t status;
+    uint8_t attempt = 0;
 
     // Check if data buffer pointer is ok.
     if (!p_buffer) {
         return HSCDTD_STAT_TRANSPORT_ERROR;
     }
 
-    status = t_write_register(p_dev->addr, reg, length, (uint8_t* ) p_buffer);
+    if (!p_dev->p_transport) {
+        return HSCDTD_STAT_TRANSPORT_ERROR;
+    }
+
+    do {
+        attempt++;
+        if (p_dev->p_bus)
+            hscdtd_bus_lock(p_dev->p_bus);
+        status = p_dev->p_transport->write(p_dev->p_transport_ctx,
+                                           p_dev->addr, reg, length,
+                                           (uint8_t* ) p_buffer);
+        shadow_store(p_dev, reg, length, (uint8_t *) p_buffer, status);
+        if (p_dev->p_bus)
+            hscdtd_bus_unlock(p_dev->p_bus);
+    } while (retry_next(p_dev, status, attempt,
+                        retry_allowed(p_dev, 0, reg, length)));
+
+    if (status != 0) {
+        return HSCDTD_STAT_TRANSPORT_ERROR;
+    }
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Update fields of a register.
+ *
+ * Read-modify-write of the bits in mask. The write is skipped if the
+ * register already holds the requested value. The bus is held for both
+ * transfers, so updates of other threads cannot interleave. For the
+ * registers kept by the driver the kept value is used, without a read.
+ * A retry repeats the read-modify-write.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param reg Register to update.
+ * @param mask Mask of the bits to update.
+ * @param value New value of the masked bits.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t update_register(hscdtd_device_t *p_dev,
+                                uint8_t reg,
+                                uint8_t mask,
+                                uint8_t value)
+{
+    const hscdtd_transport_t *p_transport = p_dev->p_transport;
+    int8_t status;
+    int8_t index = shadow_index(reg);
+    uint8_t old_value;
+    uint8_t new_value;
+    uint8_t attempt = 0;
+    uint8_t read;
+
+    if (!p_transport) {
+        return HSCDTD_STAT_TRANSPORT_ERROR;
+    }
+
+    do {
+        attempt++;
+        if (p_dev->p_bus)
+            hscdtd_bus_lock(p_dev->p_bus);
+
+        read = 1;
+        if (index >= 0 && (p_dev->reg_shadow_valid & (1 << index))) {
+            old_value = p_dev->reg_shadow[index];
+            status = 0;
+        } else {
+            status = p_transport->read(p_dev->p_transport_ctx, p_dev->addr,
+                                       reg, 1, &old_value);
+        }
+        if (status == 0) {
+            new_value = (uint8_t) ((old_value & ~mask) | (value & mask));
+            if (new_value != old_value) {
+                read = 0;
+                status = p_transport->write(p_dev->p_transport_ctx,
+                                            p_dev->addr, reg, 1, &new_value);
+                shadow_store(p_dev, reg, 1, &new_value, status);
+            } else {
+                shadow_store(p_dev, reg, 1, &old_value, status);
+            }
+        }
+
+        if (p_dev->p_bus)
+            hscdtd_bus_unlock(p_dev->p_bus);
+    } while (retry_next(p_dev, status, attempt,
+                        retry_allowed(p_dev, read, reg, 1)));
+
+    if (status != 0) {
+        return HSCDTD_STAT_TRANSPORT_ERROR;
+    }
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Open the transport of the device.
+ *
+ * @param p_dev Pointer to device struct.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t transport_open(hscdtd_device_t *p_dev)
+{
+    int8_t status;
+
+    if (!p_dev->p_transport) {
+        return HSCDTD_STAT_TRANSPORT_ERROR;
+    }
+
+    if (!p_dev->p_transport->open)
+        return HSCDTD_STAT_OK;
+
+    // Devices on one bus may be initialized from different threads.
+    if (p_dev->p_bus)
+        hscdtd_bus_lock(p_dev->p_bus);
+    status = p_dev->p_transport->open(p_dev->p_transport_ctx);
+    if (p_dev->p_bus)
+        hscdtd_bus_unlock(p_dev->p_bus);
+
+    if (status != 0) {
+        return HSCDTD_STAT_TRANSPORT_ERROR;
+    }
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Run transfers on the transport of the device.
+ *
+ * The transfers may address other devices on the same transport. Runs as
+ * one bus transaction if the transport supports it, else one by one with
+ * the bus held. Other devices do not see the control registers written
+ * to them, CTRL1, CTRL2 and CTRL4 must only be written to p_dev. The
+ * transfers are repeated together, if the retry policy of p_dev allows
+ * every one of them.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param p_xfers Transfers, in order.
+ * @param count Number of transfers.
+ * @return hscdtd_status.
+ */
+hscdtd_status_t transport_batch(hscdtd_device_t *p_dev,
+                                hscdtd_xfer_t *p_xfers,
+                                uint8_t count)
+{
+    const hscdtd_transport_t *p_transport = p_dev->p_transport;
+    int8_t status;
+    uint8_t attempt = 0;
+    uint8_t allowed;
+    uint8_t i;
+
+    if (!p_transport || !p_xfers) {
+        return HSCDTD_STAT_TRANSPORT_ERROR;
+    }
+
+    do {
+        attempt++;
+        if (p_dev->p_bus)
+            hscdtd_bus_lock(p_dev->p_bus);
+
+        if (p_transport->batch) {
+            status = p_transport->batch(p_dev->p_transport_ctx, p_xfers,
+                                        count);
+        } else {
+            status = 0;
+            for (i = 0; i < count && status == 0; i++) {
+                if (p_xfers[i].read)
+                    status = p_transport->read(p_dev->p_transport_ctx,
+                                               p_xfers[i].addr,
+                                               p_xfers[i].reg,
+                                               p_xfers[i].length,
+                                               p_xfers[i].p_buffer);
+                else
+                    status = p_transport->write(p_dev->p_transport_ctx,
+                                                p_xfers[i].addr,
+                                                p_xfers[i].reg,
+                                                p_xfers[i].length,
+                                                p_xfers[i].p_buffer);
+            }
+        }
+
+        // A failed read says nothing about the registers.
+        for (i = 0; i < count; i++) {
+            if (p_xfers[i].addr == p_dev->addr &&
+                (status == 0 || !p_xfers[i].read))
+                shadow_store(p_dev, p_xfers[i].reg, p_xfers[i].length,
+                             p_xfers[i].p_buffer, status);
+        }
+
+        if (p_dev->p_bus)
+            hscdtd_bus_unlock(p_dev->p_bus);
+
+        allowed = (status != 0);
+        for (i = 0; i < count && allowed; i++)
+            allowed = retry_allowed(p_dev, p_xfers[i].read, p_xfers[i].reg,
+                                    p_xfers[i].length);
+    } while (retry_next(p_dev, status, attempt, allowed));
+
     if (status != 0) {
         return HSCDTD_STAT_TRANSPORT_ERROR;
     }
     return HSCDTD_STAT_OK;
 }
+
+
+/**
+ * @brief Sleep using the transport of the device.
+ *
+ * @param p_dev Pointer to device struct.
+ * @param duration_ms Duration to sleep in milliseconds.
+ */
+void transport_sleep_ms(hscdtd_device_t *p_dev, uint32_t duration_ms)
+{
+    if (p_dev->p_transport)
+        p_dev->p_transport->sleep_ms(p_dev->p_transport_ctx, duration_ms);
+}
+
+
+/**
+ * @brief Get the time of the transport of the device.
+ *
+ * @param p_dev Pointer to device struct.
+ * @return Time in microseconds, wraps around.
+ */
+uint32_t transport_now_us(hscdtd_device_t *p_dev)
+{
+    if (!p_dev->p_transport)
+        return 0;
+
+    return p_dev->p_transport->now_us(p_dev->p_transport_ctx);
+}
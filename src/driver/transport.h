@@ -4,6 +4,13 @@
 #include <stdint.h>
 #include "hscdtd008a_driver.h"
 
+// Index of the registers in hscdtd_device_t.reg_shadow. The offset
+// registers are kept in order, from OFFSET_X_L.
+#define HSCDTD_SHADOW_CTRL1             0
+#define HSCDTD_SHADOW_CTRL2             1
+#define HSCDTD_SHADOW_CTRL4             2
+#define HSCDTD_SHADOW_OFFSET            3
+#define HSCDTD_SHADOW_OFFSET_MSK        (0x3F << HSCDTD_SHADOW_OFFSET)
 
 hscdtd_status_t read_register(hscdtd_device_t *p_dev,
                               uint8_t reg,
@@ -25,4 +32,22 @@ hscdtd_status_t write_register_multi(hscdtd_device_t *p_dev,
                                      uint8_t length,
                                      void *p_buffer);
 
+hscdtd_status_t update_register(hscdtd_device_t *p_dev,
+                                uint8_t reg,
+                                uint8_t mask,
+                                uint8_t value);
+
+hscdtd_status_t transport_open(hscdtd_device_t *p_dev);
+
+hscdtd_status_t transport_batch(hscdtd_device_t *p_dev,
+                                hscdtd_xfer_t *p_xfers,
+                                uint8_t count);
+
+void transport_sleep_ms(hscdtd_device_t *p_dev, uint32_t duration_ms);
+
+uint32_t transport_now_us(hscdtd_device_t *p_dev);
+
+uint8_t transport_read_repeatable(hscdtd_device_t *p_dev, uint8_t reg,
+                                  uint8_t length);
+
 #endif  //__TRANSPORT__
@@ -23,6 +23,53 @@ void HSCDTD008A::begin(uint8_t device_addr)
 }
 
 
+/**
+ * @brief Use another transport than the platform default.
+ *
+ * Call after begin and before initialize.
+ *
+ * @param p_transport Transport operations
+ * @param p_ctx Context passed to every operation
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008A::setTransport(const hscdtd_transport_t *p_transport,
+                                         void *p_ctx)
+{
+    return hscdtd_set_transport(&this->device, p_transport, p_ctx);
+}
+
+
+/**
+ * @brief Put the device on a bus shared with other threads.
+ *
+ * @param p_bus Pointer to the bus.
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008A::setBus(hscdtd_bus_t *p_bus)
+{
+    return hscdtd_attach_bus(&this->device, p_bus);
+}
+
+
+#ifdef RPI
+/**
+ * @brief Run the transactions of the device on a bus scheduler.
+ *
+ * @param p_sched Pointer to the scheduler.
+ * @param priority HSCDTD_SCHED_PRIO_HIGH to HSCDTD_SCHED_PRIO_IDLE.
+ * @param deadline_us Deadline of each transaction, or
+ *                    HSCDTD_SCHED_NO_DEADLINE.
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008A::setScheduler(hscdtd_sched_t *p_sched,
+                                         uint8_t priority,
+                                         uint32_t deadline_us)
+{
+    return hscdtd_sched_attach(p_sched, &this->device, priority, deadline_us);
+}
+#endif  // RPI
+
+
 /**
  * @brief Initialize the device.
  *
@@ -41,10 +88,20 @@ hscdtd_status_t HSCDTD008A::initialize(void)
  */
 hscdtd_status_t HSCDTD008A::startMeasurement(void)
 {
-    return hscdtd_measure(&this->device, &this->mag);
+    hscdtd_status_t status;
+
+    status = hscdtd_measure_sample(&this->device, &this->sample);
+    if (status == HSCDTD_STAT_OK) {
+#ifndef HSCDTD_FIXED_POINT
+        hscdtd_raw_to_mag(&this->sample.raw, &this->mag);
+#endif  // HSCDTD_FIXED_POINT
+        hscdtd_consume_sample(&this->device, &this->sample);
+    }
+    return status;
 }
 
 
+#ifndef HSCDTD_NO_TEMP_COMP
 /**
  * @brief Run temperature compenstation.
  *
@@ -57,8 +114,10 @@ hscdtd_status_t HSCDTD008A::temperatureCompensation(void)
 {
     return hscdtd_temperature_compensation(&this->device);
 }
+#endif  // HSCDTD_NO_TEMP_COMP
 
 
+#ifndef HSCDTD_NO_OFFSET_CAL
 /**
  * @brief Run offset calibration.
  *
@@ -70,8 +129,10 @@ hscdtd_status_t HSCDTD008A::offsetCalibration(void)
 {
     return hscdtd_offset_calibration(&this->device);
 }
+#endif  // HSCDTD_NO_OFFSET_CAL
 
 
+#ifndef HSCDTD_NO_SELF_TEST
 /**
  * @brief Run a self test
  *
@@ -83,6 +144,7 @@ hscdtd_status_t HSCDTD008A::runSelfTest(void)
 {
     return hscdtd_self_test(&this->device);
 }
+#endif  // HSCDTD_NO_SELF_TEST
 
 
 /**
@@ -187,10 +249,20 @@ hscdtd_status_t HSCDTD008A::configureOutputDataRate(hscdtd_odr_t odr)
  */
 hscdtd_status_t HSCDTD008A::retrieveMagData(void)
 {
-    return hscdtd_read_magnetodata(&this->device, &this->mag);
+    hscdtd_status_t status;
+
+    status = hscdtd_read_sample(&this->device, &this->sample);
+    if (status == HSCDTD_STAT_OK) {
+#ifndef HSCDTD_FIXED_POINT
+        hscdtd_raw_to_mag(&this->sample.raw, &this->mag);
+#endif  // HSCDTD_FIXED_POINT
+        hscdtd_consume_sample(&this->device, &this->sample);
+    }
+    return status;
 }
 
 
+#ifndef HSCDTD_FIXED_POINT
 /**
  * @brief Apply an offset to the sensor readings
  *
@@ -204,8 +276,40 @@ hscdtd_status_t HSCDTD008A::applyOffsetDrift(float x_off, float y_off,
 {
     return hscdtd_set_offset(&this->device, x_off, y_off, z_off);
 }
+#endif  // HSCDTD_FIXED_POINT
 
 
+/**
+ * @brief Apply an offset to the sensor readings
+ *
+ * @param x_off x Offset in nT
+ * @param y_off y Offset in nT
+ * @param z_off z Offset in nT
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008A::applyOffsetDriftNt(int32_t x_off, int32_t y_off,
+                                               int32_t z_off)
+{
+    return hscdtd_set_offset_nt(&this->device, x_off, y_off, z_off);
+}
+
+
+/**
+ * @brief Apply the hard-iron offset of a calibration fit
+ *
+ * Writes the offset to the sensor, after this readings in mag are corrected
+ * for the hard-iron offset without any extra cost.
+ *
+ * @param p_result Result of hscdtd_calib_solve
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008A::applyCalibration(const hscdtd_calib_result_t *p_result)
+{
+    return hscdtd_calib_apply_offset(&this->device, p_result);
+}
+
+
+#ifndef HSCDTD_NO_DRDY_CONFIG
 /**
  * @brief Set the Data Ready Pin Enabled Status
  *
@@ -234,8 +338,130 @@ hscdtd_status_t HSCDTD008A::setDataReadyPinPolarity(hscdtd_drp_t drp)
 {
     return hscdtd_set_data_ready_pin_polarity(&this->device, drp);
 }
+#endif  // HSCDTD_NO_DRDY_CONFIG
+
+
+/**
+ * @brief Record the end of conversion, call from the DRDY interrupt.
+ *
+ * The next retrieveMagData uses this time as the timestamp of the sample.
+ *
+ */
+void HSCDTD008A::markDataReady(void)
+{
+    hscdtd_mark_data_ready(&this->device);
+}
+
+
+#ifndef HSCDTD_NO_TIMING
+/**
+ * @brief Get the interval and jitter statistics of the samples.
+ *
+ * @return const hscdtd_timing_t*
+ */
+const hscdtd_timing_t *HSCDTD008A::getTiming(void)
+{
+    return &this->device.timing;
+}
+
+
+/**
+ * @brief Clear the interval and jitter statistics.
+ *
+ */
+void HSCDTD008A::resetTiming(void)
+{
+    hscdtd_reset_timing(&this->device);
+}
+#endif  // HSCDTD_NO_TIMING
+
+
+/**
+ * @brief Get the overrun, saturation, stale and gap counters.
+ *
+ * @return const hscdtd_quality_t*
+ */
+const hscdtd_quality_t *HSCDTD008A::getQuality(void)
+{
+    return &this->device.quality;
+}
+
+
+/**
+ * @brief Clear the quality counters.
+ *
+ */
+void HSCDTD008A::resetQuality(void)
+{
+    hscdtd_reset_quality(&this->device);
+}
+
+
+#ifndef HSCDTD_NO_RETRY
+/**
+ * @brief Set which failed transfers are repeated, how often and after
+ *        what wait.
+ *
+ * @param p_policy Retry policy, see hscdtd_retry_policy_t
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008A::setRetryPolicy(const hscdtd_retry_policy_t *p_policy)
+{
+    return hscdtd_set_retry_policy(&this->device, p_policy);
+}
+
+
+/**
+ * @brief Get the retry, recovery and failure counters.
+ *
+ * @return const hscdtd_retry_stats_t*
+ */
+const hscdtd_retry_stats_t *HSCDTD008A::getRetryStats(void)
+{
+    return &this->device.retry_stats;
+}
+
+
+/**
+ * @brief Clear the retry counters.
+ *
+ */
+void HSCDTD008A::resetRetryStats(void)
+{
+    hscdtd_reset_retry_stats(&this->device);
+}
+#endif  // HSCDTD_NO_RETRY
+
+
+#ifndef HSCDTD_NO_LATENCY
+/**
+ * @brief Record the latency of the samples in histograms.
+ *
+ * See hscdtd008a_latency.h. startMeasurement and retrieveMagData record
+ * the consumer stage when they return.
+ *
+ * @param p_latency Histograms to update, NULL to stop recording.
+ */
+void HSCDTD008A::setLatency(hscdtd_latency_t *p_latency)
+{
+    hscdtd_set_latency(&this->device, p_latency);
+}
+#endif  // HSCDTD_NO_LATENCY
+
+
+/**
+ * @brief Describe the sensor for the device table of a capture.
+ *
+ * @param p_desc Pointer to store the description
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008A::getCaptureDevice(hscdtd_capture_device_t *p_desc)
+{
+    return hscdtd_capture_describe(&this->device, p_desc);
+}
 
 
+#ifndef HSCDTD_NO_TEMP_COMP
 /**
  * @brief Get the temperature value.
  *
@@ -248,3 +474,544 @@ int HSCDTD008A::getTemperature(void)
 {
     return hscdtd_read_temp(&this->device);
 }
+#endif  // HSCDTD_NO_TEMP_COMP
+
+
+/**
+ * @brief Get the last reading in nT.
+ *
+ * @param p_nt_data Pointer to a struct to store the data.
+ */
+void HSCDTD008A::getMagDataNt(hscdtd_mag_nt_t *p_nt_data)
+{
+    hscdtd_raw_to_nt(&this->sample.raw, p_nt_data);
+}
+
+
+/**
+ * @brief Get the magnitude of the last reading.
+ *
+ * @return uint32_t, magnitude in nT
+ */
+uint32_t HSCDTD008A::getMagnitudeNt(void)
+{
+    return hscdtd_magnitude_nt(&this->sample.raw);
+}
+
+
+#ifndef HSCDTD_FIXED_POINT
+/**
+ * @brief Get the heading of the last reading.
+ *
+ * Assumes the sensor is level. Heading is relative to the x-axis of the
+ * sensor.
+ *
+ * @param mode atan2 implementation, trades accuracy for speed
+ * @return float, heading in degrees (0 - 360)
+ */
+float HSCDTD008A::getHeading(hscdtd_atan2_mode_t mode)
+{
+    return hscdtd_heading(&this->mag, mode);
+}
+
+
+/**
+ * @brief Get the tilt compensated heading of the last reading.
+ *
+ * @param p_down Gravity vector (pointing down) in the frame of the sensor
+ * @param mode atan2 implementation, trades accuracy for speed
+ * @return float, heading in degrees (0 - 360)
+ */
+float HSCDTD008A::getHeading(const hscdtd_vec3_t *p_down,
+                             hscdtd_atan2_mode_t mode)
+{
+    return hscdtd_heading_tilt(&this->mag, p_down, mode);
+}
+#endif  // HSCDTD_FIXED_POINT
+
+
+/**
+ * @brief Standard enable function for the array.
+ *
+ */
+void HSCDTD008AArray::begin(void)
+{
+    hscdtd_array_init(&this->array);
+}
+
+
+/**
+ * @brief Add a sensor to the array.
+ *
+ * The sensor must be initialized. Sensors are triggered in the order they
+ * are added.
+ *
+ * @param p_sensor Pointer to the sensor
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008AArray::add(HSCDTD008A *p_sensor)
+{
+    hscdtd_status_t status;
+
+    if (!p_sensor) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    status = hscdtd_array_add(&this->array, &p_sensor->device, &p_sensor->sample);
+    if (status != HSCDTD_STAT_OK)
+        return status;
+
+    this->p_sensors[this->array.count - 1] = p_sensor;
+    return HSCDTD_STAT_OK;
+}
+
+
+/**
+ * @brief Take an aligned snapshot of all sensors.
+ *
+ * All sensors are triggered back-to-back, the results are stored in the
+ * sensor objects.
+ *
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008AArray::sweep(void)
+{
+    hscdtd_status_t status;
+
+    status = hscdtd_array_sweep(&this->array);
+    if (status == HSCDTD_STAT_OK) {
+        for (uint8_t i = 0; i < this->array.count; i++) {
+#ifndef HSCDTD_FIXED_POINT
+            hscdtd_raw_to_mag(&this->p_sensors[i]->sample.raw, &this->p_sensors[i]->mag);
+#endif  // HSCDTD_FIXED_POINT
+            hscdtd_consume_sample(&this->p_sensors[i]->device,
+                                  &this->p_sensors[i]->sample);
+        }
+    }
+    return status;
+}
+
+
+/**
+ * @brief Get the trigger skew of the last sweep.
+ *
+ * @return uint32_t, time between first and last trigger in microseconds
+ */
+uint32_t HSCDTD008AArray::getTriggerSkewUs(void)
+{
+    return this->array.trigger_skew_us;
+}
+
+
+/**
+ * @brief Get the largest trigger skew of all sweeps.
+ *
+ * @return uint32_t, skew in microseconds
+ */
+uint32_t HSCDTD008AArray::getMaxTriggerSkewUs(void)
+{
+    return this->array.max_trigger_skew_us;
+}
+
+
+/**
+ * @brief Get the duration of the last sweep.
+ *
+ * @return uint32_t, time from first trigger to last read in microseconds
+ */
+uint32_t HSCDTD008AArray::getSweepTimeUs(void)
+{
+    return this->array.sweep_time_us;
+}
+
+
+/**
+ * @brief Start streaming samples of a sensor.
+ *
+ * The sensor must be initialized. Samples are delivered to the callback in
+ * batches, see hscdtd008a_stream.h.
+ *
+ * @param p_sensor Pointer to the sensor
+ * @param p_config Stream configuration
+ * @param callback Called with every batch of samples
+ * @param p_ctx Passed to the callback
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008AStream::start(HSCDTD008A *p_sensor,
+                                        const hscdtd_stream_config_t *p_config,
+                                        hscdtd_stream_callback_t callback,
+                                        void *p_ctx)
+{
+    if (!p_sensor) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    return hscdtd_stream_start(&this->stream, &p_sensor->device, p_config,
+                               callback, p_ctx);
+}
+
+
+/**
+ * @brief Stop streaming, delivers a partial batch.
+ *
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008AStream::stop(void)
+{
+    return hscdtd_stream_stop(&this->stream);
+}
+
+
+/**
+ * @brief Acquire the samples that are due.
+ *
+ * Call often from the main loop if the stream has no thread.
+ *
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008AStream::poll(void)
+{
+    return hscdtd_stream_poll(&this->stream);
+}
+
+
+/**
+ * @brief Get the time at which poll has work next.
+ *
+ * @return uint32_t, time in microseconds of the transport clock
+ */
+uint32_t HSCDTD008AStream::getNextPollUs(void)
+{
+    return hscdtd_stream_next_us(&this->stream);
+}
+
+
+/**
+ * @brief Signal a sample, call from the DRDY pin interrupt.
+ */
+void HSCDTD008AStream::notify(void)
+{
+    hscdtd_stream_notify(&this->stream);
+}
+
+
+/**
+ * @brief Deliver the samples of a partial batch now.
+ */
+void HSCDTD008AStream::flush(void)
+{
+    hscdtd_stream_flush(&this->stream);
+}
+
+
+/**
+ * @brief Get the output data rate the sensor runs at.
+ *
+ * Changes while the stream runs if it is adaptive.
+ *
+ * @return hscdtd_odr_t
+ */
+hscdtd_odr_t HSCDTD008AStream::getOutputDataRate(void)
+{
+    return this->stream.odr;
+}
+
+
+/**
+ * @brief Get the acquisition statistics.
+ *
+ * @return const hscdtd_stream_stats_t*
+ */
+const hscdtd_stream_stats_t *HSCDTD008AStream::getStats(void)
+{
+    return &this->stream.stats;
+}
+
+
+/**
+ * @brief Get the statistics of the health monitor of the stream.
+ *
+ * @return const hscdtd_health_stats_t*
+ */
+const hscdtd_health_stats_t *HSCDTD008AStream::getHealthStats(void)
+{
+    return &this->stream.health.stats;
+}
+
+
+/**
+ * @brief Start duty cycled acquisition of a sensor.
+ *
+ * The sensor must be initialized. It is kept in standby between samples,
+ * see hscdtd008a_duty.h.
+ *
+ * @param p_sensor Pointer to the sensor
+ * @param p_config Duty cycle configuration
+ * @param callback Called with every sample
+ * @param p_ctx Passed to the callback
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008ADuty::start(HSCDTD008A *p_sensor,
+                                      const hscdtd_duty_config_t *p_config,
+                                      hscdtd_duty_callback_t callback,
+                                      void *p_ctx)
+{
+    if (!p_sensor) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    return hscdtd_duty_start(&this->duty, &p_sensor->device, p_config,
+                             callback, p_ctx);
+}
+
+
+/**
+ * @brief Stop acquisition, the sensor is left in standby.
+ *
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008ADuty::stop(void)
+{
+    return hscdtd_duty_stop(&this->duty);
+}
+
+
+/**
+ * @brief Run the wake window that is due.
+ *
+ * Call from the main loop if acquisition has no thread.
+ *
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008ADuty::poll(void)
+{
+    return hscdtd_duty_poll(&this->duty);
+}
+
+
+/**
+ * @brief Get the time at which poll has work next.
+ *
+ * @return uint32_t, time in microseconds of the transport clock
+ */
+uint32_t HSCDTD008ADuty::getNextPollUs(void)
+{
+    return hscdtd_duty_next_us(&this->duty);
+}
+
+
+/**
+ * @brief Get the estimated time the sensor is active per hour.
+ *
+ * @return uint32_t, active time in microseconds per hour
+ */
+uint32_t HSCDTD008ADuty::getActivePerHourUs(void)
+{
+    return hscdtd_duty_active_per_hour_us(&this->duty);
+}
+
+
+/**
+ * @brief Get the acquisition statistics.
+ *
+ * @return const hscdtd_duty_stats_t*
+ */
+const hscdtd_duty_stats_t *HSCDTD008ADuty::getStats(void)
+{
+    return &this->duty.stats;
+}
+
+
+/**
+ * @brief Monitor the health of a sensor.
+ *
+ * The sensor must be initialized. See hscdtd008a_health.h.
+ *
+ * @param p_sensor Pointer to the sensor
+ * @param p_config Check interval and recovery attempts, NULL for the
+ *                 defaults
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008AHealth::begin(HSCDTD008A *p_sensor,
+                                        const hscdtd_health_config_t *p_config)
+{
+    hscdtd_health_config_t config = HSCDTD_HEALTH_CONFIG_DEFAULT;
+
+    if (!p_sensor) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    return hscdtd_health_init(&this->health, &p_sensor->device,
+                              p_config ? p_config : &config);
+}
+
+
+/**
+ * @brief Check the sensor if a check is due.
+ *
+ * Call between samples from the main loop.
+ *
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008AHealth::poll(void)
+{
+    return hscdtd_health_poll(&this->health);
+}
+
+
+/**
+ * @brief Check the sensor now, restore its configuration if it was lost.
+ *
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008AHealth::check(void)
+{
+    return hscdtd_health_check(&this->health);
+}
+
+
+/**
+ * @brief Get the check and recovery statistics.
+ *
+ * @return const hscdtd_health_stats_t*
+ */
+const hscdtd_health_stats_t *HSCDTD008AHealth::getStats(void)
+{
+    return &this->health.stats;
+}
+
+
+/**
+ * @brief Detect magnetic events in the samples of a sensor.
+ *
+ * See hscdtd008a_event.h.
+ *
+ * @param p_config Thresholds and debounce, NULL for the defaults
+ * @param sensor Id of the sensor in the events
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008AEvents::begin(const hscdtd_event_config_t *p_config,
+                                        uint8_t sensor)
+{
+    hscdtd_event_config_t config = HSCDTD_EVENT_CONFIG_DEFAULT;
+
+    this->config = p_config ? *p_config : config;
+    return hscdtd_event_init(&this->detector, &this->config, sensor);
+}
+
+
+/**
+ * @brief Feed the last sample of a sensor, after startMeasurement or
+ *        retrieveMagData.
+ *
+ * @param p_sensor Pointer to the sensor
+ * @return HSCDTD_EVENT_NONE, HSCDTD_EVENT_START or HSCDTD_EVENT_END
+ */
+uint8_t HSCDTD008AEvents::update(const HSCDTD008A *p_sensor)
+{
+    return hscdtd_event_update(&this->detector, &p_sensor->sample);
+}
+
+
+/**
+ * @brief Feed a sample, such as one delivered by a stream.
+ *
+ * @param p_sample Pointer to the sample
+ * @return HSCDTD_EVENT_NONE, HSCDTD_EVENT_START or HSCDTD_EVENT_END
+ */
+uint8_t HSCDTD008AEvents::update(const hscdtd_sample_t *p_sample)
+{
+    return hscdtd_event_update(&this->detector, p_sample);
+}
+
+
+/**
+ * @brief Get the event that started or ended at the last update.
+ *
+ * @return const hscdtd_event_t*
+ */
+const hscdtd_event_t *HSCDTD008AEvents::getEvent(void)
+{
+    return &this->detector.event;
+}
+
+
+/**
+ * @brief Restart the baseline from the next sample.
+ */
+void HSCDTD008AEvents::reset(void)
+{
+    hscdtd_event_reset(&this->detector);
+}
+
+
+#ifdef RPI
+/**
+ * @brief Standard enable function for real-time acquisition.
+ *
+ */
+void HSCDTD008ARealtime::begin(void)
+{
+    hscdtd_rt_init(&this->rt);
+}
+
+
+/**
+ * @brief Add a sensor, measured every cycle.
+ *
+ * The sensor must be initialized. Samples are passed to the callback in
+ * the order the sensors are added, the sensor objects are not updated.
+ *
+ * @param p_sensor Pointer to the sensor
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008ARealtime::add(HSCDTD008A *p_sensor)
+{
+    if (!p_sensor) {
+        return HSCDTD_STAT_ERROR;
+    }
+
+    return hscdtd_rt_add(&this->rt, &p_sensor->device);
+}
+
+
+/**
+ * @brief Start the real-time thread.
+ *
+ * See hscdtd008a_rt.h. Fails without the privileges for the priority or
+ * the locked memory of the configuration.
+ *
+ * @param p_config Period, deadline and scheduling of the thread
+ * @param callback Called on the thread with the samples of every cycle
+ * @param p_ctx Passed to the callback
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008ARealtime::start(const hscdtd_rt_config_t *p_config,
+                                          hscdtd_rt_callback_t callback,
+                                          void *p_ctx)
+{
+    return hscdtd_rt_start(&this->rt, p_config, callback, p_ctx);
+}
+
+
+/**
+ * @brief Stop the real-time thread.
+ *
+ * @return hscdtd_status_t
+ */
+hscdtd_status_t HSCDTD008ARealtime::stop(void)
+{
+    return hscdtd_rt_stop(&this->rt);
+}
+
+
+/**
+ * @brief Copy the cycle, deadline and jitter statistics.
+ *
+ * @param p_stats Pointer to store the statistics
+ */
+void HSCDTD008ARealtime::getStats(hscdtd_rt_stats_t *p_stats)
+{
+    hscdtd_rt_get_stats(&this->rt, p_stats);
+}
+#endif  // RPI
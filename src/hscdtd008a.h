@@ -2,16 +2,44 @@
 #define __HSCDTD008A__
 
 #include "driver/hscdtd008a_driver.h"
+#include "driver/hscdtd008a_calib.h"
+#include "driver/hscdtd008a_heading.h"
+#include "driver/hscdtd008a_array.h"
+#include "driver/hscdtd008a_capture.h"
+#include "driver/hscdtd008a_sched.h"
+#include "driver/hscdtd008a_stream.h"
+#include "driver/hscdtd008a_duty.h"
+#include "driver/hscdtd008a_health.h"
+#include "driver/hscdtd008a_event.h"
+#include "driver/hscdtd008a_rt.h"
+
+#ifdef __cpp_impl_coroutine
+class HSCDTD008AOp;
+class HSCDTD008AScheduler;
+#endif  // __cpp_impl_coroutine
 
 class HSCDTD008A {
 public:
     void begin(void);
     void begin(uint8_t device_addr);
+    hscdtd_status_t setTransport(const hscdtd_transport_t *p_transport,
+                                 void *p_ctx);
+    hscdtd_status_t setBus(hscdtd_bus_t *p_bus);
+#ifdef RPI
+    hscdtd_status_t setScheduler(hscdtd_sched_t *p_sched, uint8_t priority,
+                                 uint32_t deadline_us = HSCDTD_SCHED_NO_DEADLINE);
+#endif  // RPI
     hscdtd_status_t initialize(void);
     hscdtd_status_t startMeasurement(void);
+#ifndef HSCDTD_NO_TEMP_COMP
     hscdtd_status_t temperatureCompensation(void);
+#endif  // HSCDTD_NO_TEMP_COMP
+#ifndef HSCDTD_NO_OFFSET_CAL
     hscdtd_status_t offsetCalibration(void);
+#endif  // HSCDTD_NO_OFFSET_CAL
+#ifndef HSCDTD_NO_SELF_TEST
     hscdtd_status_t runSelfTest(void);
+#endif  // HSCDTD_NO_SELF_TEST
     hscdtd_status_t softReset(void);
     hscdtd_status_t setStandby(void);
     hscdtd_status_t setActive(void);
@@ -20,17 +48,175 @@ public:
     hscdtd_status_t isDataReady(void);
     hscdtd_status_t configureOutputDataRate(hscdtd_odr_t odr);
     hscdtd_status_t retrieveMagData(void);
-    hscdtd_status_t applyOffsetDrift(float x_off, float y_off, float z_off);
+    hscdtd_status_t applyOffsetDriftNt(int32_t x_off, int32_t y_off,
+                                       int32_t z_off);
+    hscdtd_status_t applyCalibration(const hscdtd_calib_result_t *p_result);
+    void getMagDataNt(hscdtd_mag_nt_t *p_nt_data);
+    uint32_t getMagnitudeNt(void);
+#ifndef HSCDTD_NO_DRDY_CONFIG
     hscdtd_status_t setDataReadyPinEnabledStatus(hscdtd_den_t den);
     hscdtd_status_t setDataReadyPinPolarity(hscdtd_drp_t drp);
+#endif  // HSCDTD_NO_DRDY_CONFIG
+    void markDataReady(void);
+#ifndef HSCDTD_NO_TIMING
+    const hscdtd_timing_t *getTiming(void);
+    void resetTiming(void);
+#endif  // HSCDTD_NO_TIMING
+    const hscdtd_quality_t *getQuality(void);
+    void resetQuality(void);
+#ifndef HSCDTD_NO_RETRY
+    hscdtd_status_t setRetryPolicy(const hscdtd_retry_policy_t *p_policy);
+    const hscdtd_retry_stats_t *getRetryStats(void);
+    void resetRetryStats(void);
+#endif  // HSCDTD_NO_RETRY
+#ifndef HSCDTD_NO_LATENCY
+    void setLatency(hscdtd_latency_t *p_latency);
+#endif  // HSCDTD_NO_LATENCY
+    hscdtd_status_t getCaptureDevice(hscdtd_capture_device_t *p_desc);
 
+#ifndef HSCDTD_NO_TEMP_COMP
     int getTemperature(void);
+#endif  // HSCDTD_NO_TEMP_COMP
+
+#ifdef __cpp_impl_coroutine
+    // Awaitable versions, see hscdtd008a_coro.h.
+    HSCDTD008AOp startMeasurementAsync(HSCDTD008AScheduler &sched);
+    HSCDTD008AOp retrieveMagDataAsync(HSCDTD008AScheduler &sched);
+#ifndef HSCDTD_NO_TEMP_COMP
+    HSCDTD008AOp temperatureCompensationAsync(HSCDTD008AScheduler &sched);
+#endif  // HSCDTD_NO_TEMP_COMP
+#ifndef HSCDTD_NO_OFFSET_CAL
+    HSCDTD008AOp offsetCalibrationAsync(HSCDTD008AScheduler &sched);
+#endif  // HSCDTD_NO_OFFSET_CAL
+#ifndef HSCDTD_NO_SELF_TEST
+    HSCDTD008AOp runSelfTestAsync(HSCDTD008AScheduler &sched);
+#endif  // HSCDTD_NO_SELF_TEST
+#endif  // __cpp_impl_coroutine
 
+#ifndef HSCDTD_FIXED_POINT
+    hscdtd_status_t applyOffsetDrift(float x_off, float y_off, float z_off);
+    float getHeading(hscdtd_atan2_mode_t mode = HSCDTD_ATAN2_POLY);
+    float getHeading(const hscdtd_vec3_t *p_down,
+                     hscdtd_atan2_mode_t mode = HSCDTD_ATAN2_POLY);
 
+    // Last reading in uT.
     hscdtd_mag_t mag;
+#endif  // HSCDTD_FIXED_POINT
+
+    // Last reading in LSB, with timestamp and sequence number.
+    hscdtd_sample_t sample;
 
 private:
+    friend class HSCDTD008AArray;
+    friend class HSCDTD008AStream;
+    friend class HSCDTD008ADuty;
+    friend class HSCDTD008AHealth;
+#ifdef RPI
+    friend class HSCDTD008ARealtime;
+#endif  // RPI
+#ifdef __cpp_impl_coroutine
+    friend class HSCDTD008AOp;
+#endif  // __cpp_impl_coroutine
+
     hscdtd_device_t device;
 };
 
+
+class HSCDTD008AArray {
+public:
+    void begin(void);
+    hscdtd_status_t add(HSCDTD008A *p_sensor);
+    hscdtd_status_t sweep(void);
+    uint32_t getTriggerSkewUs(void);
+    uint32_t getMaxTriggerSkewUs(void);
+    uint32_t getSweepTimeUs(void);
+
+private:
+    HSCDTD008A *p_sensors[HSCDTD_ARRAY_MAX_DEVICES];
+    hscdtd_array_t array;
+};
+
+
+class HSCDTD008AStream {
+public:
+    hscdtd_status_t start(HSCDTD008A *p_sensor,
+                          const hscdtd_stream_config_t *p_config,
+                          hscdtd_stream_callback_t callback,
+                          void *p_ctx = 0);
+    hscdtd_status_t stop(void);
+    hscdtd_status_t poll(void);
+    uint32_t getNextPollUs(void);
+    void notify(void);
+    void flush(void);
+    hscdtd_odr_t getOutputDataRate(void);
+    const hscdtd_stream_stats_t *getStats(void);
+    const hscdtd_health_stats_t *getHealthStats(void);
+
+private:
+    hscdtd_stream_t stream;
+};
+
+
+class HSCDTD008ADuty {
+public:
+    hscdtd_status_t start(HSCDTD008A *p_sensor,
+                          const hscdtd_duty_config_t *p_config,
+                          hscdtd_duty_callback_t callback,
+                          void *p_ctx = 0);
+    hscdtd_status_t stop(void);
+    hscdtd_status_t poll(void);
+    uint32_t getNextPollUs(void);
+    uint32_t getActivePerHourUs(void);
+    const hscdtd_duty_stats_t *getStats(void);
+
+private:
+    hscdtd_duty_t duty;
+};
+
+
+class HSCDTD008AHealth {
+public:
+    hscdtd_status_t begin(HSCDTD008A *p_sensor,
+                          const hscdtd_health_config_t *p_config = 0);
+    hscdtd_status_t poll(void);
+    hscdtd_status_t check(void);
+    const hscdtd_health_stats_t *getStats(void);
+
+private:
+    hscdtd_health_t health;
+};
+
+class HSCDTD008AEvents {
+public:
+    hscdtd_status_t begin(const hscdtd_event_config_t *p_config = 0,
+                          uint8_t sensor = 0);
+    uint8_t update(const HSCDTD008A *p_sensor);
+    uint8_t update(const hscdtd_sample_t *p_sample);
+    const hscdtd_event_t *getEvent(void);
+    void reset(void);
+
+private:
+    hscdtd_event_config_t config;
+    hscdtd_event_detector_t detector;
+};
+
+#ifdef RPI
+class HSCDTD008ARealtime {
+public:
+    void begin(void);
+    hscdtd_status_t add(HSCDTD008A *p_sensor);
+    hscdtd_status_t start(const hscdtd_rt_config_t *p_config,
+                          hscdtd_rt_callback_t callback, void *p_ctx = 0);
+    hscdtd_status_t stop(void);
+    void getStats(hscdtd_rt_stats_t *p_stats);
+
+private:
+    hscdtd_rt_t rt;
+};
+#endif  // RPI
+
+#ifdef __cpp_impl_coroutine
+#include "hscdtd008a_coro.h"
+#endif  // __cpp_impl_coroutine
+
 #endif  //__HSCDTD008A__
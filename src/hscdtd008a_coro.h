@@ -0,0 +1,372 @@
+#ifndef __HSCDTD008A_CORO__
+#define __HSCDTD008A_CORO__
+
+/**
+ * C++20 coroutine interface, included by hscdtd008a.h if the compiler
+ * supports coroutines.
+ *
+ * The *Async methods of HSCDTD008A return an awaitable operation. Awaiting
+ * it runs the operation up to its first wait, then suspends the coroutine
+ * and hands the operation to a HSCDTD008AScheduler, which calls resume()
+ * once the wait is over. One thread can so drive many sensors:
+ *
+ *   HSCDTD008ATask poll(HSCDTD008A &sensor, HSCDTD008AScheduler &sched)
+ *   {
+ *       hscdtd_status_t status = co_await sensor.startMeasurementAsync(sched);
+ *       co_return status;
+ *   }
+ *
+ *   HSCDTD008AExecutor executor;
+ *   executor.spawn(poll(sensor, executor));
+ *   executor.run();
+ *
+ * HSCDTD008AExecutor is a single threaded executor on the transport clock.
+ * To use another event loop, implement HSCDTD008AScheduler::schedule or
+ * call HSCDTD008AExecutor::poll from the loop.
+ *
+ * An operation must not run concurrently with other calls for the same
+ * sensor.
+ */
+
+#include <coroutine>
+#include <exception>
+#include "hscdtd008a.h"
+
+class HSCDTD008AScheduler;
+
+
+// Awaitable driver operation, see hscdtd_op_step.
+class HSCDTD008AOp {
+public:
+    HSCDTD008AOp(HSCDTD008A *p_sensor, HSCDTD008AScheduler *p_sched,
+                 hscdtd_op_kind_t kind)
+        : p_next(nullptr), wake_us(0), p_sensor(p_sensor), p_sched(p_sched),
+          kind(kind), status(HSCDTD_STAT_OK) {}
+    HSCDTD008AOp(const HSCDTD008AOp &) = delete;
+    HSCDTD008AOp &operator=(const HSCDTD008AOp &) = delete;
+
+    bool await_ready(void);
+    void await_suspend(std::coroutine_handle<> handle);
+    hscdtd_status_t await_resume(void);
+
+    // Run the next step once the wait is over. Returns true if the
+    // operation completed and the awaiting coroutine was resumed.
+    bool resume(void);
+
+    // Wait before resume() in ms.
+    uint32_t getDelayMs(void) const { return op.delay_ms; }
+
+    // Free for the scheduler, to queue the operation.
+    HSCDTD008AOp *p_next;
+    uint32_t wake_us;
+
+private:
+    HSCDTD008A *p_sensor;
+    HSCDTD008AScheduler *p_sched;
+    hscdtd_op_kind_t kind;
+    hscdtd_op_t op;
+    hscdtd_status_t status;
+    std::coroutine_handle<> handle;
+};
+
+
+// Runs suspended operations once their wait is over.
+class HSCDTD008AScheduler {
+public:
+    virtual ~HSCDTD008AScheduler() = default;
+
+    // Call p_op->resume() after delay_ms.
+    virtual void schedule(HSCDTD008AOp *p_op, uint32_t delay_ms) = 0;
+};
+
+
+class HSCDTD008AExecutor;
+
+
+// Coroutine returning a hscdtd_status_t. Starts when it is awaited or
+// spawned on an executor.
+class HSCDTD008ATask {
+public:
+    struct promise_type;
+    typedef std::coroutine_handle<promise_type> handle_t;
+
+    struct FinalAwaiter {
+        bool await_ready(void) noexcept { return false; }
+        std::coroutine_handle<> await_suspend(handle_t handle) noexcept;
+        void await_resume(void) noexcept {}
+    };
+
+    struct promise_type {
+        hscdtd_status_t status = HSCDTD_STAT_OK;
+        std::coroutine_handle<> continuation;
+        // Set if spawned, the executor owns the coroutine.
+        HSCDTD008AExecutor *p_executor = nullptr;
+
+        HSCDTD008ATask get_return_object(void)
+        {
+            return HSCDTD008ATask(handle_t::from_promise(*this));
+        }
+        std::suspend_always initial_suspend(void) noexcept { return {}; }
+        FinalAwaiter final_suspend(void) noexcept { return {}; }
+        void return_value(hscdtd_status_t value) { status = value; }
+        void unhandled_exception(void) { std::terminate(); }
+    };
+
+    struct Awaiter {
+        handle_t handle;
+
+        bool await_ready(void) { return !handle || handle.done(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller)
+        {
+            handle.promise().continuation = caller;
+            return handle;
+        }
+        hscdtd_status_t await_resume(void) { return handle.promise().status; }
+    };
+
+    explicit HSCDTD008ATask(handle_t handle) : handle(handle) {}
+    HSCDTD008ATask(HSCDTD008ATask &&other) noexcept : handle(other.handle)
+    {
+        other.handle = nullptr;
+    }
+    HSCDTD008ATask(const HSCDTD008ATask &) = delete;
+    HSCDTD008ATask &operator=(const HSCDTD008ATask &) = delete;
+    ~HSCDTD008ATask()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    Awaiter operator co_await(void) { return Awaiter{handle}; }
+
+private:
+    friend class HSCDTD008AExecutor;
+
+    handle_t handle;
+};
+
+
+// Single threaded executor, waits on the clock of a transport.
+class HSCDTD008AExecutor : public HSCDTD008AScheduler {
+public:
+    HSCDTD008AExecutor(const hscdtd_transport_t *p_transport, void *p_ctx)
+        : p_transport(p_transport), p_ctx(p_ctx), p_queue(nullptr),
+          tasks(0), failed(0) {}
+#ifndef HSCDTD_NO_PLATFORM_TRANSPORT
+    HSCDTD008AExecutor(void)
+        : HSCDTD008AExecutor(&hscdtd_platform_transport, nullptr) {}
+#endif  // HSCDTD_NO_PLATFORM_TRANSPORT
+
+    void spawn(HSCDTD008ATask task);
+    void schedule(HSCDTD008AOp *p_op, uint32_t delay_ms) override;
+    bool poll(void);
+    void run(void);
+
+    // Spawned tasks that did not finish yet.
+    uint32_t getPendingTasks(void) const { return tasks; }
+    // Spawned tasks that finished with a status other than OK.
+    uint32_t getFailedTasks(void) const { return failed; }
+
+private:
+    friend struct HSCDTD008ATask::FinalAwaiter;
+
+    void finished(hscdtd_status_t status);
+
+    const hscdtd_transport_t *p_transport;
+    void *p_ctx;
+    // Suspended operations, by wake time.
+    HSCDTD008AOp *p_queue;
+    uint32_t tasks;
+    uint32_t failed;
+};
+
+
+inline bool HSCDTD008AOp::await_ready(void)
+{
+    hscdtd_sample_t *p_sample = nullptr;
+
+    if (kind == HSCDTD_OP_MEASURE || kind == HSCDTD_OP_READ)
+        p_sample = &p_sensor->sample;
+
+    status = hscdtd_op_init(&op, &p_sensor->device, kind, p_sample);
+    if (status == HSCDTD_STAT_OK)
+        status = hscdtd_op_step(&op);
+    return status != HSCDTD_STAT_PENDING;
+}
+
+
+inline void HSCDTD008AOp::await_suspend(std::coroutine_handle<> handle)
+{
+    this->handle = handle;
+    p_sched->schedule(this, op.delay_ms);
+}
+
+
+inline hscdtd_status_t HSCDTD008AOp::await_resume(void)
+{
+    if (status == HSCDTD_STAT_OK &&
+        (kind == HSCDTD_OP_MEASURE || kind == HSCDTD_OP_READ)) {
+#ifndef HSCDTD_FIXED_POINT
+        hscdtd_raw_to_mag(&p_sensor->sample.raw, &p_sensor->mag);
+#endif  // HSCDTD_FIXED_POINT
+        hscdtd_consume_sample(&p_sensor->device, &p_sensor->sample);
+    }
+    return status;
+}
+
+
+inline bool HSCDTD008AOp::resume(void)
+{
+    status = hscdtd_op_step(&op);
+    if (status == HSCDTD_STAT_PENDING) {
+        p_sched->schedule(this, op.delay_ms);
+        return false;
+    }
+    // The operation lives in the coroutine frame, do not touch it after.
+    handle.resume();
+    return true;
+}
+
+
+inline std::coroutine_handle<> HSCDTD008ATask::FinalAwaiter::await_suspend(
+    handle_t handle) noexcept
+{
+    promise_type &promise = handle.promise();
+
+    if (promise.continuation)
+        return promise.continuation;
+    if (promise.p_executor) {
+        promise.p_executor->finished(promise.status);
+        handle.destroy();
+    }
+    return std::noop_coroutine();
+}
+
+
+/**
+ * @brief Start a task, the executor owns it from now on.
+ *
+ * The task runs until its first suspension before spawn returns.
+ *
+ * @param task Task to run.
+ */
+inline void HSCDTD008AExecutor::spawn(HSCDTD008ATask task)
+{
+    HSCDTD008ATask::handle_t handle = task.handle;
+
+    if (!handle)
+        return;
+    task.handle = nullptr;
+    handle.promise().p_executor = this;
+    tasks++;
+    handle.resume();
+}
+
+
+/**
+ * @brief Queue an operation to resume after delay_ms.
+ *
+ * @param p_op Suspended operation.
+ * @param delay_ms Wait in ms.
+ */
+inline void HSCDTD008AExecutor::schedule(HSCDTD008AOp *p_op,
+                                         uint32_t delay_ms)
+{
+    HSCDTD008AOp **pp_pos = &p_queue;
+
+    p_op->wake_us = p_transport->now_us(p_ctx) + delay_ms * 1000UL;
+    while (*pp_pos && (int32_t) (p_op->wake_us - (*pp_pos)->wake_us) >= 0)
+        pp_pos = &(*pp_pos)->p_next;
+    p_op->p_next = *pp_pos;
+    *pp_pos = p_op;
+}
+
+
+/**
+ * @brief Resume the operations whose wait is over, without sleeping.
+ *
+ * @return true while operations or tasks are pending.
+ */
+inline bool HSCDTD008AExecutor::poll(void)
+{
+    HSCDTD008AOp *p_op;
+    uint32_t now = p_transport->now_us(p_ctx);
+
+    while (p_queue && (int32_t) (now - p_queue->wake_us) >= 0) {
+        p_op = p_queue;
+        p_queue = p_op->p_next;
+        p_op->resume();
+    }
+    return p_queue || tasks;
+}
+
+
+/**
+ * @brief Run until all spawned tasks finished.
+ *
+ * Sleeps until the next operation is due.
+ */
+inline void HSCDTD008AExecutor::run(void)
+{
+    int32_t wait;
+
+    while (poll()) {
+        // Tasks that wait on something else than an operation.
+        if (!p_queue)
+            break;
+
+        wait = (int32_t) (p_queue->wake_us - p_transport->now_us(p_ctx));
+        if (wait > 0)
+            p_transport->sleep_ms(p_ctx, (wait + 999) / 1000);
+    }
+}
+
+
+inline void HSCDTD008AExecutor::finished(hscdtd_status_t status)
+{
+    tasks--;
+    if (status != HSCDTD_STAT_OK)
+        failed++;
+}
+
+
+inline HSCDTD008AOp HSCDTD008A::startMeasurementAsync(
+    HSCDTD008AScheduler &sched)
+{
+    return HSCDTD008AOp(this, &sched, HSCDTD_OP_MEASURE);
+}
+
+
+inline HSCDTD008AOp HSCDTD008A::retrieveMagDataAsync(
+    HSCDTD008AScheduler &sched)
+{
+    return HSCDTD008AOp(this, &sched, HSCDTD_OP_READ);
+}
+
+
+#ifndef HSCDTD_NO_TEMP_COMP
+inline HSCDTD008AOp HSCDTD008A::temperatureCompensationAsync(
+    HSCDTD008AScheduler &sched)
+{
+    return HSCDTD008AOp(this, &sched, HSCDTD_OP_TEMPERATURE_COMPENSATION);
+}
+#endif  // HSCDTD_NO_TEMP_COMP
+
+
+#ifndef HSCDTD_NO_OFFSET_CAL
+inline HSCDTD008AOp HSCDTD008A::offsetCalibrationAsync(
+    HSCDTD008AScheduler &sched)
+{
+    return HSCDTD008AOp(this, &sched, HSCDTD_OP_OFFSET_CALIBRATION);
+}
+#endif  // HSCDTD_NO_OFFSET_CAL
+
+
+#ifndef HSCDTD_NO_SELF_TEST
+inline HSCDTD008AOp HSCDTD008A::runSelfTestAsync(HSCDTD008AScheduler &sched)
+{
+    return HSCDTD008AOp(this, &sched, HSCDTD_OP_SELF_TEST);
+}
+#endif  // HSCDTD_NO_SELF_TEST
+
+#endif  //__HSCDTD008A_CORO__